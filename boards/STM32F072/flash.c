@@ -134,7 +134,16 @@ void flash_program_half_word_buffer(uint16_t* dst, uint16_t *data, uint16_t size
   flash_unlock();
   flash_erase_pages_unlocked((uint32_t)dst, size);
   flash_exit_critical(primask);
-  
+  flash_program_half_words(dst, data, size);
+}
+
+// Program already erased flash (the journal appends to partly written pages)
+void flash_program_half_words(uint16_t* dst, const uint16_t *data, uint16_t size) {
+  uint32_t primask = flash_enter_critical();
+  if (FLASH->CR & FLASH_CR_LOCK)  // a second key sequence on unlocked flash is a bus error
+    flash_unlock();
+  flash_exit_critical(primask);
+
   __IO uint16_t* p = dst;
   for (uint32_t i = 0; i < size / sizeof(uint16_t); i++) {
     primask = flash_enter_critical();
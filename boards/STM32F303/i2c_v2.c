@@ -21,6 +21,11 @@
 #define VNA_I2C                         I2C1
 #define I2C_CR2_SADD_7BIT_SHIFT         1
 #define I2C_CR2_NBYTES_SHIFT            16
+#define VNA_I2C_IRQ_NUMBER              STM32_I2C1_EVENT_NUMBER
+#define VNA_I2C_IRQ_HANDLER             STM32_I2C1_EVENT_HANDLER
+
+// Write queue, DMA feeds TXDR and the STOP interrupt ends the request
+static i2c_queue_t i2c_queue;
 
 void i2c_set_timings(uint32_t timings) {
   VNA_I2C->CR1&=~I2C_CR1_PE;
@@ -28,15 +33,57 @@ void i2c_set_timings(uint32_t timings) {
   VNA_I2C->CR1|= I2C_CR1_PE;
 }
 
+static void i2c_dma_start(const i2c_request_t *req) {
+  VNA_I2C->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF; // left by polled transfers
+  VNA_I2C->CR1|= I2C_CR1_PE | I2C_CR1_TXDMAEN | I2C_CR1_STOPIE;
+  dmaChannelSetMemory(I2C_DMA_TX, req->data);
+  dmaChannelSetTransactionSize(I2C_DMA_TX, req->len);
+  dmaChannelSetMode(I2C_DMA_TX, STM32_DMA_CR_PL(STM32_I2C_I2C1_DMA_PRIORITY) | STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_MINC | STM32_DMA_CR_BYTE | STM32_DMA_CR_EN);
+  VNA_I2C->CR2 = (req->addr << I2C_CR2_SADD_7BIT_SHIFT) | (req->len << I2C_CR2_NBYTES_SHIFT) | I2C_CR2_AUTOEND | I2C_CR2_START;
+}
+
+// AUTOEND sends STOP after the last byte or after a NACK
+OSAL_IRQ_HANDLER(VNA_I2C_IRQ_HANDLER)
+{
+  OSAL_IRQ_PROLOGUE();
+  uint32_t isr = VNA_I2C->ISR;
+  if (isr & I2C_ISR_STOPF) {
+    VNA_I2C->CR1&=~(I2C_CR1_TXDMAEN | I2C_CR1_STOPIE);
+    VNA_I2C->ICR = I2C_ICR_STOPCF | I2C_ICR_NACKCF;
+    VNA_I2C->ISR = I2C_ISR_TXE; // flush TXDR byte left by NACK
+    dmaChannelSetMode(I2C_DMA_TX, 0);
+    osalSysLockFromISR();
+    i2c_queue_complete_i(&i2c_queue, (isr & I2C_ISR_NACKF) == 0);
+    osalSysUnlockFromISR();
+  }
+  OSAL_IRQ_EPILOGUE();
+}
+
 void i2c_start(void) {
   rccEnableI2C1(FALSE);
   i2c_set_timings(STM32_I2C_INIT_T);
+  dmaChannelSetPeripheral(I2C_DMA_TX, &VNA_I2C->TXDR);
+  i2c_queue_init(&i2c_queue, i2c_dma_start);
+  nvicEnableVector(VNA_I2C_IRQ_NUMBER, STM32_I2C_I2C1_IRQ_PRIORITY);
+}
+
+bool i2c_write_async(uint8_t addr, const uint8_t *w, size_t wn)
+{
+  if (i2c_queue_write(&i2c_queue, addr, w, wn, NULL, NULL))
+    return true;
+  return i2c_transfer(addr, w, wn); // not fit in queue slot
+}
+
+bool i2c_flush(void)
+{
+  return i2c_queue_flush(&i2c_queue);
 }
 
 // I2C TX only (compact version)
 bool i2c_transfer(uint8_t addr, const uint8_t *w, size_t wn)
 {
   //if (wn == 0) return false;
+  i2c_queue_wait(&i2c_queue);         // wait queued writes
   while(VNA_I2C->ISR & I2C_ISR_BUSY); // wait last transaction
   VNA_I2C->CR1|= I2C_CR1_PE;
   VNA_I2C->CR2 = (addr << I2C_CR2_SADD_7BIT_SHIFT) | (wn << I2C_CR2_NBYTES_SHIFT) | I2C_CR2_AUTOEND | I2C_CR2_START;
@@ -51,6 +98,7 @@ bool i2c_transfer(uint8_t addr, const uint8_t *w, size_t wn)
 // I2C TX and RX variant
 bool i2c_receive(uint8_t addr, const uint8_t *w, size_t wn, uint8_t *r, size_t rn)
 {
+  i2c_queue_wait(&i2c_queue);         // wait queued writes
   while(VNA_I2C->ISR & I2C_ISR_BUSY); // wait last transaction
   VNA_I2C->CR1|= I2C_CR1_PE;
   if (wn) {
@@ -81,6 +81,24 @@ extern "C" {
 #define __USE_VNA_MATH__
 // Use cache for window function used by FFT (but need FFT_SIZE*sizeof(float) RAM)
 //#define USE_FFT_WINDOW_BUFFER
+// Cache calibration interpolation index/weight per sweep point (need SWEEP_POINTS_MAX*6 bytes RAM)
+#if !defined(NANOVNA_F303)
+#define __USE_CAL_INTERP_PLAN__
+#endif
+// Publish complete sweeps to two separate buffers, data readers never wait for the sweep (need SWEEP_POINTS_MAX*32 bytes RAM)
+#if defined(NANOVNA_F303)
+#define __USE_MEASURED_SNAPSHOT__
+#endif
+// Index trace segments by plot cell, Smith/polar and stored trace cells draw only nearby segments
+// (need (TRACES_MAX + STORED_TRACES) * plot cells * 2 bytes RAM)
+#if defined(NANOVNA_F303)
+#define __USE_TRACE_CELL_INDEX__
+#endif
+// Stop IF averaging of a point early once its measured variance is low enough (sweepmode adaptive),
+// keep per point averaging counts (need SWEEP_POINTS_MAX*2 bytes RAM)
+#if defined(NANOVNA_F303)
+#define __USE_ADAPTIVE_IFBW__
+#endif
 // Enable data smooth option
 #define __USE_SMOOTH__
 // Enable optional change digit separator for locales (dot or comma, need for correct work some external software)
@@ -145,6 +163,12 @@ extern "C" {
 
 // Maximum sweep point count (limit by flash and RAM size)
 #define SWEEP_POINTS_MAX         401
+// Keep uncorrected sweep data for instant re-correction (need SWEEP_POINTS_MAX*16 bytes RAM)
+//#define __USE_RAW_SWEEP_DATA__
+// Sweep-to-sweep trace averaging, average command (need SWEEP_POINTS_MAX*16 bytes RAM)
+//#define __USE_TRACE_AVERAGE__
+// Shell commands queued for the sweep thread (need VNA_SHELL_MAX_LENGTH + 8 bytes RAM each)
+#define SHELL_DEFERRED_QUEUE_SIZE 8
 
 #define AUDIO_ADC_FREQ_K1        384
 #else
@@ -167,6 +191,8 @@ extern "C" {
 
 // Maximum sweep point count (limit by flash and RAM size)
 #define SWEEP_POINTS_MAX         101
+// Shell commands queued for the sweep thread (need VNA_SHELL_MAX_LENGTH + 8 bytes RAM each)
+#define SHELL_DEFERRED_QUEUE_SIZE 2
 #endif
 // Minimum sweep point count
 #define SWEEP_POINTS_MIN         21
@@ -0,0 +1,102 @@
+/*
+ * Non-blocking I2C write queue: requests are copied into a small ring and
+ * shifted out by a bus backend (DMA fed on the target), the caller only
+ * waits when the ring is full or on i2c_queue_flush().
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __DRIVER_I2C_QUEUE_H__
+#define __DRIVER_I2C_QUEUE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "ch.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Requests in the ring (one point of si5351 writes fits)
+#ifndef I2C_QUEUE_LENGTH
+#define I2C_QUEUE_LENGTH 4
+#endif
+// Bytes per request: register address and two si5351 parameter blocks
+#ifndef I2C_QUEUE_DATA_SIZE
+#define I2C_QUEUE_DATA_SIZE 17
+#endif
+
+// Completion callback, called from the bus interrupt
+typedef void (*i2c_queue_done_t)(void* arg, bool ok);
+
+typedef struct {
+  uint8_t addr;
+  uint8_t len;
+  uint8_t data[I2C_QUEUE_DATA_SIZE];
+  i2c_queue_done_t done;
+  void* arg;
+} i2c_request_t;
+
+/*
+ * Bus backend, called with the system locked: start shifting out req and
+ * report the end with i2c_queue_complete_i() from the bus interrupt (or from
+ * start itself when the bus is synchronous).
+ */
+typedef void (*i2c_queue_start_t)(const i2c_request_t* req);
+
+typedef struct {
+  i2c_queue_start_t start;
+  i2c_request_t req[I2C_QUEUE_LENGTH];
+  volatile uint8_t head;  // next free slot
+  volatile uint8_t tail;  // request on the bus
+  volatile uint8_t count; // queued requests, the one on the bus included
+  volatile bool failed;   // a transfer failed since the last flush
+  thread_reference_t waiter;
+} i2c_queue_t;
+
+void i2c_queue_init(i2c_queue_t* q, i2c_queue_start_t start);
+
+/*
+ * Queue a write of data (copied) to addr, waits for a free slot when the ring
+ * is full. Returns false when len is 0 or over I2C_QUEUE_DATA_SIZE. One thread
+ * at a time may use the queue.
+ */
+bool i2c_queue_write(i2c_queue_t* q, uint8_t addr, const uint8_t* data, size_t len,
+                     i2c_queue_done_t done, void* arg);
+
+// Wait until every queued write is on the wire
+void i2c_queue_wait(i2c_queue_t* q);
+
+// i2c_queue_wait(), false if any write failed since the last flush
+bool i2c_queue_flush(i2c_queue_t* q);
+
+// Backend: the request on the bus ended, start the next one
+void i2c_queue_complete_i(i2c_queue_t* q, bool ok);
+
+static inline bool i2c_queue_idle(const i2c_queue_t* q) {
+  return q->count == 0U;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __DRIVER_I2C_QUEUE_H__
@@ -89,7 +89,12 @@ void si5351_disable_output(void);
 void si5351_enable_output(void);
 
 void si5351_set_frequency_offset(int32_t offset);
+// Register writes are queued, si5351_flush() waits for them
 int si5351_set_frequency(uint32_t freq, uint8_t drive_strength);
+// Wait for queued writes, on a bus error the register cache is dropped and false returned
+bool si5351_flush(void);
+// Compute the register plan of freq ahead, si5351_set_frequency(freq) then only sends it
+void si5351_prepare_frequency(uint32_t freq);
 uint8_t si5351_take_settling_cycles(void);
 void si5351_set_power(uint8_t drive_strength);
 void si5351_set_band_mode(uint16_t t);
@@ -103,6 +108,9 @@ void si5351_set_tcxo(uint32_t xtal);
 
 // Get info functions
 uint32_t si5351_get_frequency(void);
+uint8_t si5351_get_band(void); // band_s index of the current frequency, 0 - not set
+// band_s index si5351_set_frequency(freq) selects, a change of it resets the PLLs
+uint8_t si5351_get_frequency_band(uint32_t freq);
 uint32_t si5351_get_harmonic_lvl(uint32_t f);
 
 #ifdef __cplusplus
@@ -99,6 +99,10 @@ void i2c_start(void);
 void i2c_set_timings(uint32_t timings);
 bool i2c_transfer(uint8_t addr, const uint8_t* w, size_t wn);
 bool i2c_receive(uint8_t addr, const uint8_t* w, size_t wn, uint8_t* r, size_t rn);
+// Queued write, DMA shifts it out while the caller runs (i2c_transfer/i2c_receive wait for it)
+bool i2c_write_async(uint8_t addr, const uint8_t* w, size_t wn);
+// Wait for the queued writes, false if any failed since the last flush
+bool i2c_flush(void);
 
 /*
  * rtc.c
@@ -193,6 +197,19 @@ void dac_setvalue_ch2(uint16_t v);
  */
 void init_i2s(void* buffer, uint16_t count);
 
+/*
+ * dwt.c (F303) / systick.c (F072)
+ * Free running CPU cycle counter used by the sweep profiler
+ */
+#if defined(NANOVNA_F303)
+#define CYCLE_COUNTER_MASK 0xFFFFFFFFU
+#else
+#define CYCLE_COUNTER_MASK 0x00FFFFFFU
+#endif
+#define CYCLE_COUNTER_FREQ STM32_HCLK
+void cycle_counter_init(void);
+uint32_t cycle_counter_read(void);
+
 /*
  * flash.c
  * Used for store config and calibration data on CPU flash
@@ -214,6 +231,10 @@ void init_i2s(void* buffer, uint16_t count);
 // Flash region reserved for calibration/configuration storage (matches linker flash7)
 #define FLASH_CALIBRATION_SECTOR_START 0x0801C800U
 #define FLASH_CALIBRATION_SECTOR_SIZE  0x0001C800U
+
+// Settings journal pages, the slots fill flash7 so use the free pages after it
+#define SAVE_JOURNAL_SIZE (4 * FLASH_PAGESIZE)
+#define SAVE_JOURNAL_ADDR (FLASH_CALIBRATION_SECTOR_START + FLASH_CALIBRATION_SECTOR_SIZE)
 #else
 // For STM32F072xB CPU setting
 #define FLASH_START_ADDRESS 0x08000000
@@ -231,6 +252,10 @@ void init_i2s(void* buffer, uint16_t count);
 // Flash region reserved for calibration/configuration storage (matches linker flash7)
 #define FLASH_CALIBRATION_SECTOR_START 0x08018800U
 #define FLASH_CALIBRATION_SECTOR_SIZE  0x00007800U
+
+// Settings journal pages, the free start of flash7 below the slots
+#define SAVE_JOURNAL_SIZE (2 * FLASH_PAGESIZE)
+#define SAVE_JOURNAL_ADDR (SAVE_PROP_CONFIG_ADDR - SAVE_JOURNAL_SIZE)
 #endif
 
 // Save config_t and properties_t flash area (see flash7 from *.ld settings)
@@ -247,11 +272,23 @@ void init_i2s(void* buffer, uint16_t count);
 #if (SAVE_PROP_CONFIG_ADDR < FLASH_CALIBRATION_SECTOR_START)
 #error "Calibration storage overlaps application flash"
 #endif
+#if (SAVE_JOURNAL_ADDR + SAVE_JOURNAL_SIZE > SAVE_PROP_CONFIG_ADDR &&                               \
+     SAVE_JOURNAL_ADDR < SAVE_CONFIG_ADDR + SAVE_CONFIG_SIZE)
+#error "Settings journal overlaps calibration storage"
+#endif
+#if (SAVE_JOURNAL_ADDR < FLASH_CALIBRATION_SECTOR_START)
+#error "Settings journal overlaps application flash"
+#endif
+#if (SAVE_JOURNAL_ADDR + SAVE_JOURNAL_SIZE > FLASH_START_ADDRESS + FLASH_TOTAL_SIZE)
+#error "Settings journal exceeds flash size"
+#endif
 
 // Erase settings on page
 void flash_erase_pages(uint32_t page_address, uint32_t size);
 // Write data
 void flash_program_half_word_buffer(uint16_t* dst, uint16_t* data, uint16_t size);
+// Write data to erased flash (no page erase)
+void flash_program_half_words(uint16_t* dst, const uint16_t* data, uint16_t size);
 
 /*
  * gpio.c
@@ -315,6 +352,7 @@ void palSetPadGroupMode(GPIO_TypeDef* port, uint32_t mask, uint32_t mode);
  * DMA channels support
  */
 #define I2S_DMA_RX DMA1_Channel4 // DMA1 channel 4 use for I2S rx
+#define I2C_DMA_TX DMA1_Channel6 // DMA1 channel 6 use for I2C1 tx (remapped on F072)
 
 // Interrupt handler for DMA
 extern void i2s_lld_serve_rx_interrupt(uint32_t flags);
@@ -181,6 +181,11 @@ void reset_dsp_accumerator(void);
 void calculate_gamma(float *gamma);
 void fetch_amplitude(float *gamma);
 void fetch_amplitude_ref(float *gamma);
+#ifdef __USE_ADAPTIVE_IFBW__
+uint16_t dsp_adaptive_update(void);
+uint16_t dsp_adaptive_count(void);
+bool dsp_adaptive_converged(float target, uint16_t min_count);
+#endif
 void generate_dsp_table(int offset);
 
 /*
@@ -202,6 +207,11 @@ int get_str_index(const char* v, const char* list);
 int parse_line(char* line, char* args[], int max_cnt);
 void swap_bytes(uint16_t* buf, int size);
 int packbits(char* source, char* dest, int size);
+// Fast number to text for data export, return end of string (not null terminated)
+#define MY_FTOA_DIGITS   9  // significant digits needed to read back the same float
+#define MY_FTOA_MAX_SIZE 15 // "-1.23456789e-38"
+char* my_utoa(char* p, uint32_t value);
+char* my_ftoa(char* p, float value, int digits, char separator);
 void _delay_8t(uint32_t cycles);
 
 #include "processing/vna_math.h"
@@ -694,6 +704,14 @@ void lcd_vector_draw(int x, int y, const vector_data *v);
 
 uint32_t lcd_send_register(uint8_t cmd, uint8_t len, const uint8_t *data);
 void     lcd_set_flip(bool flip);
+// Display rotation
+enum {
+  DISPLAY_ROTATION_0 = 0,
+  DISPLAY_ROTATION_90,
+  DISPLAY_ROTATION_180,
+  DISPLAY_ROTATION_270,
+};
+void     lcd_set_rotation(uint8_t r);
 
 #ifdef __USE_SD_CARD__
 #include "ff.h"
@@ -706,6 +724,22 @@ void     lcd_set_flip(bool flip);
 FATFS *filesystem_volume(void);
 FIL   *filesystem_file(void);
 void test_log(void);
+
+// SD card transfer counters, times in system ticks
+typedef struct {
+  uint32_t read_calls;    // disk_read calls
+  uint32_t read_multi;    // calls that used READ_MULTIPLE_BLOCK
+  uint32_t read_sectors;
+  uint32_t read_time;
+  uint32_t write_calls;   // disk_write calls
+  uint32_t write_multi;   // calls that used WRITE_MULTIPLE_BLOCK
+  uint32_t write_sectors;
+  uint32_t write_time;
+  uint32_t errors;
+} sd_card_stats_t;
+
+void sd_card_get_stats(sd_card_stats_t *stats);
+void sd_card_reset_stats(void);
 #endif
 
 /*
@@ -790,6 +824,7 @@ get_sweep_frequency(uint16_t type)
 }
 
 int caldata_save(uint32_t id);
+int caldata_autosave(uint32_t id);
 int caldata_recall(uint32_t id);
 const properties_t *get_properties(uint32_t id);
 
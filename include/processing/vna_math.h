@@ -101,6 +101,8 @@ float vna_modff(float x, float* iptr);
 void fft(float array[][2], const uint8_t dir);
 #define fft_forward(array) fft(array, 0)
 #define fft_inverse(array) fft(array, 1)
+// Inverse of a Hermitian spectrum (bins 0..FFT_SIZE/2), FFT_SIZE real samples out in place
+void fft_inverse_real(float array[][2]);
 
 // cube root
 float vna_cbrtf(float x);
@@ -0,0 +1,94 @@
+/*
+ * Per-point sweep correction: error terms, electrical delay and S21 offset.
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RF_CORRECTION_H__
+#define __RF_CORRECTION_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nanovna.h"
+
+// Electrical delay rotation is evaluated directly every SWEEP_EDELAY_RESEED points
+#define SWEEP_EDELAY_RESEED 32
+
+/*
+ * Electrical delay rotation of one channel. On a uniform sweep the rotation
+ * between consecutive points is constant, so it is advanced by one complex
+ * multiply and only reseeded with vna_sincosf on a point jump or every
+ * SWEEP_EDELAY_RESEED points (this also renormalizes the magnitude).
+ */
+typedef struct {
+  float rot[2];     // cos, sin of the rotation at point index next - 1
+  float step[2];    // rotation between consecutive points
+  uint16_t next;    // point index the rotation can be advanced to
+  uint8_t advanced; // points since the last direct evaluation
+  bool valid;
+} sweep_edelay_phasor_t;
+
+/*
+ * Correction parameters captured once per sweep call. mask uses the
+ * SWEEP_* bits from rf/sweep.h. freq_step is the frequency step of a uniform
+ * sweep in Hz, 0 evaluates the electrical delay directly at every point
+ * (segmented sweeps).
+ */
+typedef struct {
+  uint16_t mask;
+  bool enhanced_response;
+  float edelay_s11;
+  float edelay_s21;
+  float s21_gain; // linear factor derived from s21_offset (dB)
+  float freq_step;
+  sweep_edelay_phasor_t phasor[2];
+} sweep_correction_t;
+
+// Fill the parameters, phasors start invalid
+void sweep_correction_init(sweep_correction_t* corr, uint16_t mask, bool enhanced_response,
+                           float edelay_s11, float edelay_s21, float s21_gain,
+                           float freq_step);
+
+/*
+ * Correct the raw sample of one channel at sweep point idx in place. data
+ * holds S11 in [0..1] and S21 in [2..3]; channel 1 correction reads the
+ * already corrected S11 (enhanced response), so channel 0 must be corrected
+ * first.
+ */
+void sweep_correct_channel(sweep_correction_t* corr, uint8_t channel, uint16_t idx,
+                           freq_t frequency, float data[4], float cal[CAL_TYPE_COUNT][2]);
+
+/*
+ * Sweep order helpers. The default order measures both channels at every
+ * point (one pass). SWEEP_CHANNEL_MAJOR with both channels selected splits
+ * the sweep into a channel 0 pass followed by a channel 1 pass.
+ */
+uint8_t sweep_order_pass_count(uint16_t mask);
+uint16_t sweep_order_pass_mask(uint16_t mask, uint8_t pass);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RF_CORRECTION_H__
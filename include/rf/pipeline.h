@@ -45,6 +45,12 @@ uint16_t measurement_pipeline_active_mask(measurement_pipeline_t* pipeline);
 bool measurement_pipeline_execute(measurement_pipeline_t* pipeline, bool break_on_operation,
                                   uint16_t channel_mask);
 
+/*
+ * Rebuild measured[] from the raw samples of the last sweep with the current
+ * correction settings. Returns false when no raw data matches the frequency set.
+ */
+bool measurement_pipeline_recorrect(measurement_pipeline_t* pipeline, uint16_t channel_mask);
+
 #ifdef __cplusplus
 }
 #endif
@@ -39,6 +39,9 @@ extern "C" {
 #include "ch.h"
 #include "sys/event_bus.h"
 #include "nanovna.h"
+#include "rf/sweep_segments.h"
+#include "rf/trace_average.h"
+#include "rf/sweep_profile.h"
 
 #define SWEEP_CH0_MEASURE (1U << 0)
 #define SWEEP_CH1_MEASURE (1U << 1)
@@ -48,6 +51,11 @@ extern "C" {
 #define SWEEP_APPLY_CALIBRATION (1U << 5)
 #define SWEEP_USE_INTERPOLATION (1U << 6)
 #define SWEEP_USE_RENORMALIZATION (1U << 7)
+// Runtime sweep modes (selected by the sweepmode command, OR-ed into the sweep mask)
+#define SWEEP_PIPELINE_SETUP (1U << 8)
+#define SWEEP_CHANNEL_MAJOR (1U << 9)
+#define SWEEP_ADAPTIVE_IFBW (1U << 10)
+#define SWEEP_MODE_MASK (SWEEP_PIPELINE_SETUP | SWEEP_CHANNEL_MAJOR | SWEEP_ADAPTIVE_IFBW)
 
 
 
@@ -57,6 +65,16 @@ typedef struct {
   uint32_t generation;
 } sweep_service_snapshot_t;
 
+// Time spent in each sweep FSM state, in system ticks, since the last reset
+typedef struct {
+  uint32_t setup_freq;
+  uint32_t setup_measure;
+  uint32_t wait_capture;
+  uint32_t process;
+  uint32_t overlap;  // settling time hidden behind processing (pipelined setup)
+  uint32_t points;
+} sweep_service_timing_t;
+
 void sweep_service_init(event_bus_t* bus);
 void sweep_service_cancel_scan(void);
 void sweep_service_wait_for_copy_release(void);
@@ -68,6 +86,8 @@ void sweep_service_wait_for_generation(void);
 void sweep_service_reset_progress(void);
 bool sweep_service_snapshot_acquire(uint8_t channel, sweep_service_snapshot_t* snapshot);
 bool sweep_service_snapshot_release(const sweep_service_snapshot_t* snapshot);
+// Publish measured[] to snapshot readers, call only when it holds a complete sweep
+void sweep_service_publish_snapshot(void);
 
 void sweep_service_start_capture(systime_t delay_ticks);
 bool sweep_service_wait_for_capture(void);
@@ -87,11 +107,57 @@ void app_measurement_reset(void);
 void app_measurement_update_frequencies(void);
 void app_measurement_transform_domain(uint16_t ch_mask);
 void measurement_data_smooth(uint16_t ch_mask);
+bool app_measurement_sweep_settled(uint16_t mask);
+void app_measurement_request_recorrection(void);
+bool app_measurement_recorrection_pending(void);
+bool app_measurement_recorrect(uint16_t mask, uint16_t* unfinished_points);
+
+/*
+ * Segmented stimulus. enable(true) sweeps the segment list (frequency0/1 and
+ * sweep_points become its range and total), enable(false) restores the linear
+ * sweep. Calibration is always interpolated onto the segment points.
+ */
+const sweep_segment_table_t* sweep_service_segments(void);
+bool sweep_service_segments_active(void);
+bool sweep_service_segments_add(const sweep_segment_t* segment);
+void sweep_service_segments_clear(void);
+bool sweep_service_segments_enable(bool enable);
+// False while active segments change the point spacing (no time domain transform)
+bool sweep_service_uniform_spacing(void);
 
 void set_smooth_factor(uint8_t factor);
 uint8_t get_smooth_factor(void);
 
+#ifdef __USE_TRACE_AVERAGE__
+/*
+ * Sweep-to-sweep averaging of measured[], applied to each complete sweep
+ * before the time domain transform, returns true when a block average is
+ * complete. get_average returns the mode and the progress (count of
+ * trace_average_target() sweeps).
+ */
+bool measurement_data_average(uint16_t ch_mask);
+bool sweep_service_set_average(uint8_t mode, uint16_t factor);
+void sweep_service_restart_average(void);
+void sweep_service_get_average(trace_average_t* state);
+#endif
+
 void sweep_service_set_sample_function(void (*func)(float*));
+// Called from the sweep thread each time a point is complete for all selected channels
+typedef void (*sweep_point_callback_t)(uint16_t point);
+void sweep_service_set_point_callback(sweep_point_callback_t callback);
+void sweep_service_set_mode(uint16_t mode, bool enable);
+uint16_t sweep_service_get_mode(void);
+#ifdef __USE_ADAPTIVE_IFBW__
+// Adaptive IF averaging: relative variance target and buffers averaged per point on the last sweep
+void sweep_service_set_adaptive_target(float target);
+float sweep_service_get_adaptive_target(void);
+uint16_t sweep_service_if_count(uint8_t channel, uint16_t point);
+#endif
+void sweep_service_get_timing(sweep_service_timing_t* timing);
+void sweep_service_reset_timing(void);
+// Per state and band cycle statistics since the last sweep_service_reset_timing()
+const sweep_profile_t* sweep_service_get_profile(void);
+uint32_t sweep_service_dsp_overruns(void);
 
 void i2s_lld_serve_rx_interrupt(uint32_t flags);
 
@@ -0,0 +1,97 @@
+/*
+ * Sweep profiler: cycle-accurate min/avg/max time of every sweep FSM state,
+ * per si5351 band.
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RF_SWEEP_PROFILE_H__
+#define __RF_SWEEP_PROFILE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+// Profiled states, in rf_state_t order starting from RF_STATE_SETUP_FREQ
+#define SWEEP_PROFILE_SETUP_FREQ 0
+#define SWEEP_PROFILE_SETUP_MEASURE 1
+#define SWEEP_PROFILE_WAIT_CAPTURE 2
+#define SWEEP_PROFILE_PROCESS 3
+#define SWEEP_PROFILE_NEXT_STEP 4 // progress, point callback
+#define SWEEP_PROFILE_STATES 5
+
+// si5351 band index, higher bands are accounted in the last one
+#if defined(NANOVNA_F303)
+#define SWEEP_PROFILE_BANDS 16
+#else
+#define SWEEP_PROFILE_BANDS 4
+#endif
+#define SWEEP_PROFILE_ALL_BANDS 0xFF
+
+typedef struct {
+  uint32_t count;
+  uint32_t min; // cycles
+  uint32_t max; // cycles
+  uint64_t total; // cycles
+} sweep_profile_stat_t;
+
+// Point in time: system ticks and the (possibly narrower) cycle counter
+typedef struct {
+  uint32_t ticks;
+  uint32_t cycles;
+} sweep_profile_stamp_t;
+
+/*
+ * The cycle counter is clock_mask + 1 wide (DWT CYCCNT is 32 bit, SysTick
+ * 24 bit, 350 ms at 48 MHz). An interval that may have wrapped it is
+ * measured with the system ticks instead.
+ */
+typedef struct {
+  uint32_t clock_hz;
+  uint32_t clock_mask;
+  uint32_t tick_hz;
+  uint32_t wrap_ticks; // shortest counter wrap in system ticks
+  sweep_profile_stat_t stat[SWEEP_PROFILE_STATES][SWEEP_PROFILE_BANDS];
+} sweep_profile_t;
+
+void sweep_profile_init(sweep_profile_t* profile, uint32_t clock_hz, uint32_t clock_mask,
+                        uint32_t tick_hz);
+
+void sweep_profile_reset(sweep_profile_t* profile);
+
+// Cycles from start to end
+uint32_t sweep_profile_elapsed(const sweep_profile_t* profile, const sweep_profile_stamp_t* start,
+                               const sweep_profile_stamp_t* end);
+
+// Account one state run, states out of range are ignored
+void sweep_profile_add(sweep_profile_t* profile, uint8_t state, uint8_t band, uint32_t cycles);
+
+// Stats of a state for one band or merged over SWEEP_PROFILE_ALL_BANDS (min 0 when empty)
+void sweep_profile_get(const sweep_profile_t* profile, uint8_t state, uint8_t band,
+                       sweep_profile_stat_t* stat);
+
+uint32_t sweep_profile_cycles_to_us(const sweep_profile_t* profile, uint64_t cycles);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RF_SWEEP_PROFILE_H__
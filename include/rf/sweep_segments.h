@@ -0,0 +1,90 @@
+/*
+ * Segmented sweep stimulus: a list of linear ranges, each with its own point
+ * count, IF bandwidth and output power.
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RF_SWEEP_SEGMENTS_H__
+#define __RF_SWEEP_SEGMENTS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/data_types.h"
+
+#define SWEEP_SEGMENTS_MAX 8
+// Segment bandwidth/power value meaning "use the global setting"
+#define SWEEP_SEGMENT_BW_GLOBAL 0xFFFFU
+#define SWEEP_SEGMENT_POWER_GLOBAL 0xFEU
+
+typedef struct {
+  freq_t start;
+  freq_t stop;
+  uint16_t points;
+  uint16_t bandwidth; // config._bandwidth units (buffers - 1) or SWEEP_SEGMENT_BW_GLOBAL
+  uint8_t power;      // si5351 drive (0..3, 255 auto) or SWEEP_SEGMENT_POWER_GLOBAL
+} sweep_segment_t;
+
+/*
+ * Segments are swept in list order. Point i of the sweep belongs to the
+ * segment with first[s] <= i < first[s] + seg[s].points, and is spread over
+ * the segment range the same way as a linear sweep.
+ */
+typedef struct {
+  sweep_segment_t seg[SWEEP_SEGMENTS_MAX];
+  uint16_t first[SWEEP_SEGMENTS_MAX]; // sweep index of the segment first point
+  uint16_t points;                    // total points
+  uint8_t count;
+} sweep_segment_table_t;
+
+void sweep_segments_clear(sweep_segment_table_t* table);
+
+/*
+ * Append a segment, the total may not exceed max_points. Returns false (table
+ * unchanged) on a full table, zero points, stop < start or too many points.
+ */
+bool sweep_segments_add(sweep_segment_table_t* table, const sweep_segment_t* segment,
+                        uint16_t max_points);
+
+// Segment holding sweep point idx (the last one for idx past the end)
+uint8_t sweep_segments_find(const sweep_segment_table_t* table, uint16_t idx);
+
+// Frequency of sweep point idx, table must not be empty
+freq_t sweep_segments_frequency(const sweep_segment_table_t* table, uint16_t idx);
+
+// Lowest and highest frequency covered by the table
+void sweep_segments_range(const sweep_segment_table_t* table, freq_t* start, freq_t* stop);
+
+/*
+ * True when the points are evenly spaced, the table then sweeps as one linear
+ * range from its first to its last point (1 Hz rounding allowed). The time
+ * domain transform needs that.
+ */
+bool sweep_segments_uniform(const sweep_segment_table_t* table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RF_SWEEP_SEGMENTS_H__
@@ -0,0 +1,81 @@
+/*
+ * Sweep-to-sweep trace averaging: exponential (weight 2^-k) and N-sweep block.
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RF_TRACE_AVERAGE_H__
+#define __RF_TRACE_AVERAGE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define TRACE_AVERAGE_OFF 0
+#define TRACE_AVERAGE_EXP 1   // running average, new sweep weight 1/min(n, 2^k)
+#define TRACE_AVERAGE_BLOCK 2 // mean of N sweeps, then the sweep stops
+
+#define TRACE_AVERAGE_EXP_MAX 10
+#define TRACE_AVERAGE_BLOCK_MAX 1000
+
+/*
+ * The accumulator holds the running mean, so a sweep is folded in place:
+ * acc += (data - acc) * weight, then data = acc. Exponential mode starts as
+ * a plain mean and settles at weight 2^-k after 2^k sweeps. Block mode is
+ * complete after N sweeps and the next sweep starts a new block. A change of
+ * key (stimulus, IF bandwidth, power or correction) or mask starts the average again.
+ */
+typedef struct {
+  uint8_t mode;
+  uint16_t factor; // EXP: k, BLOCK: N
+  uint16_t count;  // sweeps in the running average, 0 - restart on the next sweep
+  uint16_t mask;
+  uint32_t key;
+} trace_average_t;
+
+void trace_average_init(trace_average_t* avg);
+
+// Select the mode, returns false (state unchanged) on a factor out of range
+bool trace_average_configure(trace_average_t* avg, uint8_t mode, uint16_t factor);
+
+void trace_average_restart(trace_average_t* avg);
+
+// Sweeps that complete the average (0 when off)
+uint16_t trace_average_target(const trace_average_t* avg);
+
+// Block mode holds the mean of N sweeps, the caller stops the sweep on it
+bool trace_average_complete(const trace_average_t* avg);
+
+/*
+ * Account one complete sweep. Returns false when averaging is off, else the
+ * weight of the sweep in *weight (1 - restart).
+ */
+bool trace_average_next(trace_average_t* avg, uint32_t key, uint16_t mask, float* weight);
+
+// Fold points samples of data into acc with weight and copy the result to data
+void trace_average_fold(float (*acc)[2], float (*data)[2], uint16_t points, float weight);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RF_TRACE_AVERAGE_H__
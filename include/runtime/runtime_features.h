@@ -63,6 +63,10 @@ extern "C" {
 #define ENABLE_SD_CARD_COMMAND 1
 #endif
 
+#ifndef ENABLE_SWEEPMODE_COMMAND
+#define ENABLE_SWEEPMODE_COMMAND 1
+#endif
+
 #ifndef ENABLE_THREADS_COMMAND
 #define ENABLE_THREADS_COMMAND 0
 #endif
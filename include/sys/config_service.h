@@ -39,6 +39,8 @@ typedef struct {
   int (*load_configuration)(void);
   int (*save_calibration)(uint32_t slot);
   int (*load_calibration)(uint32_t slot);
+  // Save only what changed: settings to the journal, the slot if calibration data changed
+  int (*autosave_calibration)(uint32_t slot);
   void (*erase_calibration)(void);
 } config_service_api_t;
 
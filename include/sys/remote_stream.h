@@ -0,0 +1,74 @@
+/*
+ * Delta and palette/RLE encoded remote desktop stream.
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SYS_REMOTE_STREAM_H__
+#define __SYS_REMOTE_STREAM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "nanovna.h"
+
+/*
+ * Every message is a remote_region_t header, a payload and the shell prompt
+ * ("ch> \r\n"), the same framing as the raw "refresh on" stream:
+ *   "bulk\r\n" w*h raw pixels
+ *   "fill\r\n" one pixel, the region is filled by it
+ *   "palt\r\n" w = REMOTE_PACK_PALETTE_SIZE pixels, palette for "pack" (x, y, h = 0)
+ *   "pack\r\n" encoded pixels, row-major tokens until w*h pixels are decoded:
+ *     byte t: index = t & 0x1F, code = t >> 5
+ *       code 0..6 run of code + 1 pixels
+ *       code 7    run of next byte + 8 pixels
+ *       index REMOTE_PACK_LITERAL: pixel follows the run bytes, else palette[index]
+ * Pixels use the raw "bulk" byte order. Regions of the plot cell grid that are
+ * drawn again with the same content are not sent at all.
+ */
+#define REMOTE_PACK_LITERAL      0x1F
+#define REMOTE_PACK_PALETTE_SIZE REMOTE_PACK_LITERAL
+#define REMOTE_PACK_RUN_SHORT    7
+#define REMOTE_PACK_RUN_MAX      (255 + 8)
+
+// Plot cell grid (cells drawn at OFFSETX + n * CELLWIDTH, OFFSETY + m * CELLHEIGHT)
+#define REMOTE_GRID_COLS ((LCD_WIDTH - OFFSETX + CELLWIDTH - 1) / CELLWIDTH)
+#define REMOTE_GRID_ROWS ((LCD_HEIGHT - OFFSETY + CELLHEIGHT - 1) / CELLHEIGHT)
+
+typedef void (*remote_stream_write_t)(const void* data, size_t size);
+
+// Start delta mode: forget sent cells and palette, next regions are sent in full
+void remote_stream_start(remote_stream_write_t write);
+void remote_stream_stop(void);
+bool remote_stream_enabled(void);
+
+// Send a drawn region, return false if skipped (same as already sent)
+bool remote_stream_bulk(int16_t x, int16_t y, int16_t w, int16_t h, const pixel_t* pixels);
+void remote_stream_fill(int16_t x, int16_t y, int16_t w, int16_t h, pixel_t color);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SYS_REMOTE_STREAM_H__
@@ -0,0 +1,79 @@
+/*
+ * Framed binary records for the streaming scan mode.
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SYS_SCAN_STREAM_H__
+#define __SYS_SCAN_STREAM_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "core/data_types.h"
+
+// scan command output mask
+#define SCAN_MASK_OUT_FREQ 0x01
+#define SCAN_MASK_OUT_DATA0 0x02
+#define SCAN_MASK_OUT_DATA1 0x04
+#define SCAN_MASK_NO_CALIBRATION 0x08
+#define SCAN_MASK_NO_EDELAY 0x10
+#define SCAN_MASK_NO_S21OFFS 0x20
+#define SCAN_MASK_STREAM 0x40
+#define SCAN_MASK_BINARY 0x80
+
+/*
+ * Stream record layout (little endian, no padding):
+ *   uint8_t  sync      SCAN_STREAM_SYNC
+ *   uint8_t  seq       free running record counter (detects dropped records)
+ *   uint16_t index     sweep point index
+ *   freq_t   frequency if SCAN_MASK_OUT_FREQ
+ *   float[2] S11       if SCAN_MASK_OUT_DATA0
+ *   float[2] S21       if SCAN_MASK_OUT_DATA1
+ *   uint16_t crc       CRC-16/CCITT-FALSE of all previous record bytes
+ */
+#define SCAN_STREAM_SYNC 0x5A
+#define SCAN_STREAM_HEADER_SIZE 4
+#define SCAN_STREAM_CRC_SIZE 2
+#define SCAN_STREAM_RECORD_MAX \
+  (SCAN_STREAM_HEADER_SIZE + sizeof(freq_t) + 4 * sizeof(float) + SCAN_STREAM_CRC_SIZE)
+
+#define SCAN_STREAM_CRC_INIT 0xFFFF
+
+uint16_t scan_stream_crc16(uint16_t crc, const uint8_t* data, size_t size);
+
+// Record size for the output mask
+size_t scan_stream_record_size(uint16_t mask);
+
+/*
+ * Build one record into buffer (at least SCAN_STREAM_RECORD_MAX bytes).
+ * s11/s21 are only read when selected by mask. Returns the record size.
+ */
+size_t scan_stream_encode(uint8_t* buffer, uint16_t mask, uint8_t seq, uint16_t index,
+                          freq_t frequency, const float s11[2], const float s21[2]);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SYS_SCAN_STREAM_H__
@@ -0,0 +1,102 @@
+/*
+ * Append-only settings journal in reserved flash pages.
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __SYS_SETTINGS_JOURNAL_H__
+#define __SYS_SETTINGS_JOURNAL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * The journal stores small settings records for save slots without rewriting
+ * the slot itself. Records are appended to a ring of flash pages; when the
+ * current page is full the next one is erased and used (wear leveling over all
+ * pages). The newest record of every slot on that page is copied forward
+ * first: the tail of the current page is kept free for them. A record is only
+ * valid for the slot content it was written against (base, the slot checksum),
+ * so a full slot save makes older records stale.
+ *
+ * Record layout (4 byte aligned, never crosses a page):
+ *   uint16_t magic  SETTINGS_JOURNAL_MAGIC
+ *   uint16_t seq    free running, newest record wins
+ *   uint8_t  slot
+ *   uint8_t  reserved
+ *   uint16_t size   payload bytes
+ *   uint32_t base   slot checksum the payload applies to
+ *   uint32_t hash   FNV-1a of the previous header bytes and the payload
+ *   payload, padded to 4 bytes
+ * The header is programmed first, a torn payload fails the hash and is skipped.
+ */
+#define SETTINGS_JOURNAL_MAGIC 0x4A53
+
+typedef struct {
+  uint16_t magic;
+  uint16_t seq;
+  uint8_t slot;
+  uint8_t reserved;
+  uint16_t size;
+  uint32_t base;
+  uint32_t hash;
+} settings_journal_record_t;
+
+// Flash access, pages are memory mapped at address
+typedef struct {
+  uintptr_t address;
+  uint32_t page_size;
+  uint16_t pages;
+  void (*erase_page)(uintptr_t address);
+  // Program erased flash (size is even), never called across a page boundary
+  void (*program)(uintptr_t address, const void* data, uint32_t size);
+} settings_journal_flash_t;
+
+typedef struct {
+  const settings_journal_flash_t* flash;
+  uintptr_t write; // next record address, page end if the page is full
+  uint16_t page;   // page holding write
+  uint16_t seq;    // seq of the next record
+} settings_journal_t;
+
+// Scan the pages and find the append position
+void settings_journal_init(settings_journal_t* journal, const settings_journal_flash_t* flash);
+
+// Newest valid payload for slot/base with exactly size bytes, NULL if none
+const void* settings_journal_find(const settings_journal_t* journal, uint8_t slot, uint32_t base,
+                                  uint16_t size);
+
+// Append a record (data 2 byte aligned), false if it can not fit in a page or the
+// live records of the next page can not be copied forward (rewrite the slot instead)
+bool settings_journal_append(settings_journal_t* journal, uint8_t slot, uint32_t base,
+                             const void* data, uint16_t size);
+
+// Erase all pages
+void settings_journal_erase(settings_journal_t* journal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __SYS_SETTINGS_JOURNAL_H__
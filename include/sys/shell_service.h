@@ -67,7 +67,8 @@ int shell_printf(const char* fmt, ...);
 int serial_shell_printf(const char* fmt, ...);
 #endif
 
-void shell_stream_write(const void* buffer, size_t size);
+// Returns false if the host stopped reading (write timed out on a lost connection)
+bool shell_stream_write(const void* buffer, size_t size);
 
 void shell_wake_all_waiting_threadsI(void);
 
@@ -80,7 +81,22 @@ void shell_restore_stream(void);
 
 const vna_shell_command* shell_parse_command(char* line, uint16_t* argc, char*** argv,
                                            const char** name_out);
-void shell_request_deferred_execution(const vna_shell_command* command, uint16_t argc, char** argv);
+/*
+ * Deferred commands run on the sweep thread from a ring of copied commands,
+ * the shell thread goes on reading while they run. Each one prints its
+ * prompt after its output. request queues a command for which the shell
+ * thread already paused the sweep; queue only appends if commands are still
+ * queued or running (returns false otherwise) and decides the sweep
+ * pause/resume when the command runs, as if it had been parsed after them.
+ * If the ring stays full until the timeout the command is dropped with an
+ * error line; request then returns false so the caller undoes its pause.
+ */
+bool shell_request_deferred_execution(const vna_shell_command* command, uint16_t argc, char** argv);
+bool shell_queue_deferred_execution(const vna_shell_command* command, uint16_t argc, char** argv);
+bool shell_deferred_pending(void);
+// Wait until all deferred commands are done, then echo the last line if it was read silently
+void shell_wait_deferred_commands(void);
+void shell_print_prompt(void);
 void shell_service_pending_commands(void);
 void shell_attach_event_bus(event_bus_t* bus);
 void shell_register_session_start_callback(shell_session_callback_t callback);
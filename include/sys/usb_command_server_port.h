@@ -39,13 +39,16 @@ typedef struct usb_command_server_port usb_command_server_port_t;
 typedef struct usb_command_server_port_api {
   void (*register_commands)(const vna_shell_command* table);
   int (*printf)(const char* fmt, ...);
-  void (*stream_write)(const void* buffer, size_t size);
+  bool (*stream_write)(const void* buffer, size_t size);
   void (*update_speed)(uint32_t speed);
   bool (*check_connect)(void);
   void (*init_connection)(void);
   const vna_shell_command* (*parse_command)(char* line, uint16_t* argc, char*** argv,
                                           const char** name_out);
-  void (*request_deferred_execution)(const vna_shell_command* command, uint16_t argc, char** argv);
+  bool (*request_deferred_execution)(const vna_shell_command* command, uint16_t argc, char** argv);
+  bool (*queue_deferred_execution)(const vna_shell_command* command, uint16_t argc, char** argv);
+  void (*wait_deferred_commands)(void);
+  void (*print_prompt)(void);
   void (*service_pending_commands)(void);
   int (*read_line)(char* line, int max_size);
   void (*execute_cmd_line)(char* line);
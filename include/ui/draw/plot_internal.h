@@ -182,25 +182,40 @@ static inline float get_l(float re, float im) {
   return re * re + im * im;
 }
 
-static inline float get_s11_r(float re, float im, float z) {
-  float l = get_l(re, im);
+// Variants taking l = get_l(re, im), for callers that already have it
+static inline float get_s11_r_l(float re, float l, float z) {
   return z * (1.0f - l) / (1.0f - 2.0f * re + l);
 }
 
+static inline float get_s11_x_l(float re, float im, float l, float z) {
+  return -2.0f * z * im / (1.0f - 2.0f * re + l);
+}
+
+static inline float get_s21_r_l(float l, float z) {
+  return z * (1.0f - l) / l;
+}
+
+static inline float get_s21_x_l(float im, float l, float z) {
+  return -2.0f * z * im / l;
+}
+
+static inline float get_s11_r(float re, float im, float z) {
+  return get_s11_r_l(re, get_l(re, im), z);
+}
+
 static inline float get_s11_x(float re, float im, float z) {
-  return -2.0f * z * im / (1.0f - 2.0f * re + get_l(re, im));
+  return get_s11_x_l(re, im, get_l(re, im), z);
 }
 
 static inline float get_s21_r(float re, float im, float z) {
-  float l = get_l(re, im);
-  return z * (1.0f - l) / l;
+  return get_s21_r_l(get_l(re, im), z);
 }
 
 static inline float get_s21_x(float re, float im, float z) {
-  return -2.0f * z * im / get_l(re, im);
+  return get_s21_x_l(im, get_l(re, im), z);
 }
 
-static inline float get_w(int i) { return 2 * VNA_PI * get_sweep_frequency(ST_START + i); }
+static inline float get_w(int i) { return 2 * VNA_PI * get_frequency(i); }
 
 #ifdef __cplusplus
 }
@@ -121,7 +121,23 @@ void toggle_stored_trace(int idx);
 uint8_t get_stored_traces(void);
 bool need_process_trace(uint16_t idx);
 
+// Points converted per batch (trace_get_values keeps two batches on the caller stack)
+#ifdef NANOVNA_F303
+#define TRACE_BATCH_POINTS 16
+#else
+#define TRACE_BATCH_POINTS 8
+#endif
+
+/*
+ * Values of trace type for points first .. first + count - 1 of array into out,
+ * same results as trace_info_list[type].get_value_cb (0 for types without one).
+ */
+void trace_get_values(uint8_t type, const float (*array)[2], uint16_t first, uint16_t count,
+                      float* out);
+
 void trace_into_index(int t);
+// Update index tables of all enabled traces, traces on one channel share per point terms
+void traces_into_index(void);
 void render_traces_in_cell(RenderCellCtx* rcx);
 
 #ifdef __cplusplus
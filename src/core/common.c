@@ -23,6 +23,7 @@
 #include <stdbool.h>
 #include <string.h>
 #include "hal.h"
+#include "nanovna.h"
 
 // Use macro, std isdigit more big
 #define _isdigit(c) (c >= '0' && c <= '9')
@@ -283,6 +284,191 @@ int packbits(char* source, char* dest, int size) {
   return pk;
 }
 
+/*
+ * Fast number to text conversion for bulk data export (scan, data, Touchstone).
+ * No division instructions on the float path (Cortex-M0 has no divider and no
+ * FPU), strings are not null terminated, functions return the end of string.
+ */
+// Division by 10 with shifts, exact for all uint64_t values
+static uint64_t udiv10(uint64_t n, uint32_t* rem) {
+  uint64_t q = (n >> 1) + (n >> 2);
+  q += q >> 4;
+  q += q >> 8;
+  q += q >> 16;
+  q += q >> 32;
+  q >>= 3;
+  uint32_t r = (uint32_t)(n - q * 10);
+  while (r >= 10) {
+    q++;
+    r -= 10;
+  }
+  *rem = r;
+  return q;
+}
+
+// Same for 32 bit values, used for digit output
+static inline uint32_t udiv10_32(uint32_t n, uint32_t* rem) {
+  uint32_t q = (n >> 1) + (n >> 2);
+  q += q >> 4;
+  q += q >> 8;
+  q += q >> 16;
+  q >>= 3;
+  uint32_t r = n - ((q << 3) + (q << 1));
+  if (r >= 10) {
+    q++;
+    r -= 10;
+  }
+  *rem = r;
+  return q;
+}
+
+char* my_utoa(char* p, uint32_t value) {
+  char buf[10];
+  int i = 0;
+  do {
+    uint32_t c;
+    value = udiv10_32(value, &c);
+    buf[i++] = (char)('0' + c);
+  } while (value);
+  do
+    *p++ = buf[--i];
+  while (i);
+  return p;
+}
+
+// value * 10 for 64 bit mantissa normalized to bit 63 (mantissa * 2^exp)
+static uint64_t ftoa_mul10(uint64_t m, int* exp) {
+  m = (m >> 1) + (m >> 3); // m * 10 / 16
+  *exp += 4;
+  if (!(m >> 63)) {
+    m <<= 1;
+    (*exp)--;
+  }
+  return m;
+}
+
+// 10^12 < 2^40, so a 24 bit mantissa * ftoa_pow10[] product fits in 64 bit
+#define FTOA_POW10_FAST 12
+static const uint64_t ftoa_pow10[FTOA_POW10_FAST + 1] = {
+    1ULL,          10ULL,          100ULL,          1000ULL,          10000ULL,
+    100000ULL,     1000000ULL,     10000000ULL,     100000000ULL,     1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL};
+
+/*
+ * Format value in scientific notation with fixed number of significant digits
+ * ("-1.23456789e-01"). MY_FTOA_DIGITS (9) digits are enough to read back the
+ * same float. Conversion use exact integer scaling of the float mantissa with
+ * round half to even, output size is at most MY_FTOA_MAX_SIZE chars.
+ */
+char* my_ftoa(char* p, float value, int digits, char separator) {
+  union {
+    float f;
+    uint32_t u;
+  } v = {.f = value};
+  if (digits < 1)
+    digits = 1;
+  if (digits > MY_FTOA_DIGITS)
+    digits = MY_FTOA_DIGITS;
+  if (v.u & 0x80000000U)
+    *p++ = '-';
+  uint32_t bexp = (v.u >> 23) & 0xFF;
+  uint32_t m = v.u & 0x7FFFFF;
+  if (bexp == 0xFF) {
+    const char* s = m ? "nan" : "inf";
+    while (*s)
+      *p++ = *s++;
+    return p;
+  }
+  uint32_t n = 0;
+  int e10 = 0;
+  if (bexp != 0 || m != 0) {
+    uint64_t t;
+    bool sticky;
+    // value in [2^(bexp-127), 2^(bexp-126)), log10(2) ~ 1233/4096, estimate can be one off
+    e10 = (((int)bexp - 127) * 1233) >> 12;
+    // Scale to digits+1 integer digits (last one used for rounding)
+    int s = digits - e10;
+    int e2 = (int)bexp - 150; // value = m * 2^e2
+    if (bexp != 0 && s >= 0 && s < FTOA_POW10_FAST && e2 < 0 && e2 > -64) {
+      // Fast path (all values between ~1e-7 and 1e9): one exact 64 bit product
+      m |= 0x800000;
+      uint64_t prod = (uint64_t)m * ftoa_pow10[s];
+      t = prod >> -e2;
+      if (t < ftoa_pow10[digits]) { // estimate one high
+        prod = (uint64_t)m * ftoa_pow10[s + 1];
+        t = prod >> -e2;
+        e10--;
+      }
+      sticky = (prod << (64 + e2)) != 0;
+    } else {
+      if (bexp)
+        m |= 0x800000;
+      else
+        bexp = 1; // denormal
+      // value = mant * 2^e2, mant normalized to bit 63
+      uint64_t mant = (uint64_t)m << 40;
+      e2 = (int)bexp - 150 - 40;
+      while (!(mant >> 63)) {
+        mant <<= 1;
+        e2--;
+      }
+      e10 = ((e2 + 63) * 1233) >> 12;
+      s = digits - e10;
+      for (; s > 0; s--)
+        mant = ftoa_mul10(mant, &e2);
+      for (; s < 0; s++) { // only for values >= 1e9
+        mant /= 5;
+        e2--;
+        while (!(mant >> 63)) {
+          mant <<= 1;
+          e2--;
+        }
+      }
+      t = mant >> -e2;
+      if (t < ftoa_pow10[digits]) { // estimate one high
+        mant = ftoa_mul10(mant, &e2);
+        t = mant >> -e2;
+        e10--;
+      }
+      sticky = (mant << (64 + e2)) != 0;
+    }
+    uint32_t r;
+    while (t >= ftoa_pow10[digits + 1]) { // estimate one low
+      t = udiv10(t, &r);
+      sticky |= r != 0;
+      e10++;
+    }
+    n = (uint32_t)udiv10(t, &r);
+    if (r > 5 || (r == 5 && (sticky || (n & 1))))
+      n++;
+    if (n == ftoa_pow10[digits]) {
+      n = (uint32_t)ftoa_pow10[digits - 1];
+      e10++;
+    }
+  }
+  char buf[MY_FTOA_DIGITS];
+  for (int i = digits - 1; i >= 0; i--) {
+    uint32_t c;
+    n = udiv10_32(n, &c);
+    buf[i] = (char)('0' + c);
+  }
+  *p++ = buf[0];
+  if (digits > 1) {
+    *p++ = separator;
+    for (int i = 1; i < digits; i++)
+      *p++ = buf[i];
+  }
+  *p++ = 'e';
+  if (e10 < 0) {
+    *p++ = '-';
+    e10 = -e10;
+  } else
+    *p++ = '+';
+  if (e10 < 10)
+    *p++ = '0';
+  return my_utoa(p, (uint32_t)e10);
+}
+
 #ifndef NANOVNA_HOST_TEST
 /*
  * Delay 8 core tick function
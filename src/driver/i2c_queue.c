@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "driver/i2c_queue.h"
+#include "hal.h"
+
+#include <string.h>
+
+void i2c_queue_init(i2c_queue_t* q, i2c_queue_start_t start) {
+  q->start = start;
+  q->head = 0;
+  q->tail = 0;
+  q->count = 0;
+  q->failed = false;
+  q->waiter = NULL;
+}
+
+bool i2c_queue_write(i2c_queue_t* q, uint8_t addr, const uint8_t* data, size_t len,
+                     i2c_queue_done_t done, void* arg) {
+  if (len == 0U || len > I2C_QUEUE_DATA_SIZE)
+    return false;
+  osalSysLock();
+  while (q->count >= I2C_QUEUE_LENGTH)
+    osalThreadSuspendS(&q->waiter);
+  // The slot is not seen by the interrupt until count includes it
+  osalSysUnlock();
+  i2c_request_t* req = &q->req[q->head];
+  req->addr = addr;
+  req->len = (uint8_t)len;
+  memcpy(req->data, data, len);
+  req->done = done;
+  req->arg = arg;
+  osalSysLock();
+  q->head = (uint8_t)((q->head + 1U) % I2C_QUEUE_LENGTH);
+  if (q->count++ == 0U)
+    q->start(req);
+  osalSysUnlock();
+  return true;
+}
+
+void i2c_queue_wait(i2c_queue_t* q) {
+  osalSysLock();
+  while (q->count != 0U)
+    osalThreadSuspendS(&q->waiter);
+  osalSysUnlock();
+}
+
+bool i2c_queue_flush(i2c_queue_t* q) {
+  i2c_queue_wait(q);
+  osalSysLock();
+  bool ok = !q->failed;
+  q->failed = false;
+  osalSysUnlock();
+  return ok;
+}
+
+void i2c_queue_complete_i(i2c_queue_t* q, bool ok) {
+  if (q->count == 0U)
+    return;
+  const i2c_request_t* req = &q->req[q->tail];
+  q->tail = (uint8_t)((q->tail + 1U) % I2C_QUEUE_LENGTH);
+  q->count--;
+  if (!ok)
+    q->failed = true;
+  if (req->done)
+    req->done(req->arg, ok);
+  // A slot is free, the writer may be waiting for one or for the flush
+  osalThreadResumeI(&q->waiter, MSG_OK);
+  if (q->count != 0U)
+    q->start(&q->req[q->tail]);
+}
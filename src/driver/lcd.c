@@ -65,12 +65,6 @@
 #undef __USE_DISPLAY_DMA_RX__
 #endif
 
-// LCD display buffer
-alignas(8) pixel_t spi_buffer[SPI_BUFFER_SIZE];
-// Default foreground & background colors
-pixel_t foreground_color = 0;
-pixel_t background_color = 0;
-
 //*****************************************************
 // SPI functions, settings and data
 //*****************************************************
@@ -266,13 +260,6 @@ static void spi_init(void) {
 #define LCD_MADCTL_MV 0x20
 #define LCD_MADCTL_MX 0x40
 #define LCD_MADCTL_MY 0x80
-// Display rotation enum
-enum {
-  DISPLAY_ROTATION_0 = 0,
-  DISPLAY_ROTATION_90,
-  DISPLAY_ROTATION_180,
-  DISPLAY_ROTATION_270,
-};
 
 //******************************************************************************
 // Custom ILI9391 level 2 commands
@@ -788,178 +775,6 @@ void lcd_line(int x0, int y0, int x1, int y1) {
   }
 }
 
-void lcd_clear_screen(void) {
-  lcd_fill(0, 0, LCD_WIDTH, LCD_HEIGHT);
-}
-
-void lcd_set_foreground(uint16_t fg_idx) {
-  foreground_color = GET_PALTETTE_COLOR(fg_idx);
-}
-
-void lcd_set_background(uint16_t bg_idx) {
-  background_color = GET_PALTETTE_COLOR(bg_idx);
-}
-
-void lcd_set_colors(uint16_t fg_idx, uint16_t bg_idx) {
-  foreground_color = GET_PALTETTE_COLOR(fg_idx);
-  background_color = GET_PALTETTE_COLOR(bg_idx);
-}
-
-void lcd_blit_bitmap(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* b) {
-#if 1 // Use this for remote desktop (in this case bulk operation send to remote)
-  pixel_t* buf = spi_buffer;
-  uint8_t bits = 0;
-  for (uint32_t c = 0; c < height; c++) {
-    for (uint32_t r = 0; r < width; r++) {
-      if ((r & 7) == 0)
-        bits = *b++;
-      *buf++ = (0x80 & bits) ? foreground_color : background_color;
-      bits <<= 1;
-    }
-  }
-  lcd_bulk(x, y, width, height);
-#else
-  uint8_t bits = 0;
-  lcd_set_window(x, y, width, height, LCD_RAMWR);
-  for (uint32_t c = 0; c < height; c++) {
-    for (uint32_t r = 0; r < width; r++) {
-      if ((r & 7) == 0)
-        bits = *b++;
-      while (SPI_TX_IS_NOT_EMPTY(LCD_SPI))
-        ;
-      SPI_WRITE_16BIT(LCD_SPI, (0x80 & bits) ? foreground_color : background_color);
-      bits <<= 1;
-    }
-  }
-#endif
-}
-
-void lcd_drawchar(uint8_t ch, int x, int y) {
-  lcd_blit_bitmap(x, y, FONT_GET_WIDTH(ch), FONT_GET_HEIGHT, FONT_GET_DATA(ch));
-}
-
-#ifndef lcd_drawstring
-void lcd_drawstring(int16_t x, int16_t y, const char* str) {
-  int x_pos = x;
-  while (*str) {
-    uint8_t ch = *str++;
-    if (ch == '\n') {
-      x = x_pos;
-      y += FONT_STR_HEIGHT;
-      continue;
-    }
-    const uint8_t* char_buf = FONT_GET_DATA(ch);
-    uint16_t w = FONT_GET_WIDTH(ch);
-    lcd_blit_bitmap(x, y, w, FONT_GET_HEIGHT, char_buf);
-    x += w;
-  }
-}
-#endif
-
-typedef struct {
-  const void* vmt;
-  int16_t start_x, start_y;
-  int16_t x, y;
-  uint16_t state;
-} lcdPrintStream;
-
-static void put_normal(lcdPrintStream* ps, uint8_t ch) {
-  if (ch == '\n') {
-    ps->x = ps->start_x;
-    ps->y += FONT_STR_HEIGHT;
-    return;
-  }
-  uint16_t w = FONT_GET_WIDTH(ch);
-#if _USE_FONT_ < 3
-  lcd_blit_bitmap(ps->x, ps->y, w, FONT_GET_HEIGHT, FONT_GET_DATA(ch));
-#else
-  lcd_blit_bitmap(ps->x, ps->y, w < 9 ? 9 : w, FONT_GET_HEIGHT, FONT_GET_DATA(ch));
-#endif
-  ps->x += w;
-}
-
-#if _USE_FONT_ != _USE_SMALL_FONT_
-typedef void (*font_put_t)(lcdPrintStream* ps, uint8_t ch);
-static font_put_t put_char = put_normal;
-static void put_small(lcdPrintStream* ps, uint8_t ch) {
-  if (ch == '\n') {
-    ps->x = ps->start_x;
-    ps->y += sFONT_STR_HEIGHT;
-    return;
-  }
-  uint16_t w = sFONT_GET_WIDTH(ch);
-#if _USE_SMALL_FONT_ < 3
-  lcd_blit_bitmap(ps->x, ps->y, w, sFONT_GET_HEIGHT, sFONT_GET_DATA(ch));
-#else
-  lcd_blit_bitmap(ps->x, ps->y, w < 9 ? 9 : w, sFONT_GET_HEIGHT, sFONT_GET_DATA(ch));
-#endif
-  ps->x += w;
-}
-void lcd_set_font(int type) {
-  put_char = type == FONT_SMALL ? put_small : put_normal;
-}
-
-#else
-#define put_char put_normal
-#endif
-
-static msg_t lcd_put(void* ip, uint8_t ch) {
-  lcdPrintStream* ps = ip;
-  if (ps->state) {
-    if (ps->state == R_BGCOLOR[0])
-      lcd_set_background(ch);
-    else if (ps->state == R_FGCOLOR[0])
-      lcd_set_foreground(ch);
-    ps->state = 0;
-    return MSG_OK;
-  } else if (ch < 0x09) {
-    ps->state = ch;
-    return MSG_OK;
-  }
-  put_char(ps, ch);
-  return MSG_OK;
-}
-
-// Simple print in buffer function
-int lcd_printf_va(int16_t x, int16_t y, const char* fmt, va_list ap) {
-  struct lcd_printStreamVMT {
-    _base_sequential_stream_methods
-  } lcd_vmt = {NULL, NULL, lcd_put, NULL};
-  lcdPrintStream ps = {&lcd_vmt, x, y, x, y, 0};
-  va_list args;
-  va_copy(args, ap);
-  int retval = chvprintf((BaseSequentialStream*)(void*)&ps, fmt, args);
-  va_end(args);
-  return retval;
-}
-
-int lcd_printf(int16_t x, int16_t y, const char* fmt, ...) {
-  va_list ap;
-  va_start(ap, fmt);
-  int retval = lcd_printf_va(x, y, fmt, ap);
-  va_end(ap);
-  return retval;
-}
-
-int lcd_printf_v(int16_t x, int16_t y, const char* fmt, ...) {
-  // Init small lcd print stream
-  struct lcd_printStreamVMT {
-    _base_sequential_stream_methods
-  } lcd_vmt = {NULL, NULL, lcd_put, NULL};
-  lcdPrintStream ps = {&lcd_vmt, x, y, x, y, 0};
-  lcd_set_foreground(LCD_FG_COLOR);
-  lcd_set_background(LCD_BG_COLOR);
-  lcd_set_rotation(DISPLAY_ROTATION_270);
-  // Performing the print operation using the common code.
-  va_list ap;
-  va_start(ap, fmt);
-  int retval = chvprintf((BaseSequentialStream*)(void*)&ps, fmt, ap);
-  va_end(ap);
-  lcd_set_rotation(DISPLAY_ROTATION_0);
-  // Return number of bytes that would have been written.
-  return retval;
-}
-
 void lcd_blit_bitmap_scale(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t size,
                            const uint8_t* b) {
   lcd_set_window(x, y, w * size, h * size, LCD_RAMWR);
@@ -982,58 +797,6 @@ void lcd_blit_bitmap_scale(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint1
   }
 }
 
-int lcd_drawchar_size(uint8_t ch, int x, int y, uint8_t size) {
-  const uint8_t* char_buf = FONT_GET_DATA(ch);
-  uint16_t w = FONT_GET_WIDTH(ch);
-#if 1 // Use this for remote desctop (in this case bulk operation send to remote)
-  pixel_t* buf = spi_buffer;
-  for (uint32_t c = 0; c < FONT_GET_HEIGHT; c++, char_buf++) {
-    for (uint32_t i = 0; i < size; i++) {
-      uint8_t bits = *char_buf;
-      for (uint32_t r = 0; r < w; r++, bits <<= 1)
-        for (uint32_t j = 0; j < size; j++)
-          *buf++ = (0x80 & bits) ? foreground_color : background_color;
-    }
-  }
-  lcd_bulk(x, y, w * size, FONT_GET_HEIGHT * size);
-#else
-  lcd_set_window(x, y, w * size, FONT_GET_HEIGHT * size, LCD_RAMWR);
-  for (int c = 0; c < FONT_GET_HEIGHT; c++, char_buf++) {
-    for (int i = 0; i < size; i++) {
-      uint8_t bits = *char_buf;
-      for (int r = 0; r < w; r++, bits <<= 1)
-        for (int j = 0; j < size; j++) {
-          while (SPI_TX_IS_NOT_EMPTY(LCD_SPI))
-            ;
-          SPI_WRITE_16BIT(LCD_SPI, (0x80 & bits) ? foreground_color : background_color);
-        }
-    }
-  }
-#endif
-  return w * size;
-}
-
-void lcd_drawfont(uint8_t ch, int x, int y) {
-  lcd_blit_bitmap(x, y, NUM_FONT_GET_WIDTH, NUM_FONT_GET_HEIGHT, NUM_FONT_GET_DATA(ch));
-}
-
-void lcd_drawstring_size(const char* str, int x, int y, uint8_t size) {
-  while (*str)
-    x += lcd_drawchar_size(*str++, x, y, size);
-}
-
-void lcd_vector_draw(int x, int y, const vector_data* v) {
-  while (v->shift_x || v->shift_y) {
-    int x1 = x + (int)v->shift_x;
-    int y1 = y + (int)v->shift_y;
-    if (!v->transparent)
-      lcd_line(x, y, x1, y1);
-    x = x1;
-    y = y1;
-    v++;
-  }
-}
-
 #if 0
 static const uint16_t colormap[] = {
   RGBHEX(0x00ff00), RGBHEX(0x0000ff), RGBHEX(0xff0000),
@@ -1107,6 +870,7 @@ void ili9341_test(int mode) {
 #define CMD58 (0x40 + 58) // READ_OCR
 #define CMD59 (0x40 + 59) // CRC_ON_OFF
 // Then send after CMD55 (APP_CMD) interpret as ACMD
+#define ACMD23 (0xC0 + 23) // SET_WR_BLK_ERASE_COUNT (ACMD)
 #define ACMD41 (0xC0 + 41) // SEND_OP_COND (ACMD)
 
 // MMC card type and status flags
@@ -1204,18 +968,27 @@ int shell_printf(const char* fmt, ...);
     if (DEBUG)                                                                                     \
       shell_printf(__VA_ARGS__);                                                                   \
   } while (0)
+// Transfer counters, always kept (sd_stat command)
+static sd_card_stats_t sd_stats;
+
+void sd_card_get_stats(sd_card_stats_t* stats) {
+  *stats = sd_stats;
+}
+
+void sd_card_reset_stats(void) {
+  sd_stats = (sd_card_stats_t){0};
+}
+
 #if DEBUG == 1
-uint32_t w_cnt;
-uint32_t w_time;
-uint32_t r_cnt;
-uint32_t r_time;
 uint32_t total_time;
 uint32_t crc_time;
 void test_log(void) {
-  DEBUG_PRINT(" Read  speed = %d Byte/s (count %d, time %d)\r\n", r_cnt * 512 * 100000 / r_time,
-              r_cnt, r_time);
-  DEBUG_PRINT(" Write speed = %d Byte/s (count %d, time %d)\r\n", w_cnt * 512 * 100000 / w_time,
-              w_cnt, w_time);
+  DEBUG_PRINT(" Read  speed = %d Byte/s (count %d, time %d)\r\n",
+              sd_stats.read_sectors * 512 * 100000 / sd_stats.read_time, sd_stats.read_sectors,
+              sd_stats.read_time);
+  DEBUG_PRINT(" Write speed = %d Byte/s (count %d, time %d)\r\n",
+              sd_stats.write_sectors * 512 * 100000 / sd_stats.write_time, sd_stats.write_sectors,
+              sd_stats.write_time);
   DEBUG_PRINT(" Total time = %d\r\n", chVTGetSystemTimeX() - total_time);
   DEBUG_PRINT(" CRC16 time %d\r\n", crc_time);
 }
@@ -1440,10 +1213,6 @@ DWORD get_fattime(void) {
 // diskio.c - Initialize SD
 DSTATUS disk_initialize(BYTE pdrv) {
 #if DEBUG == 1
-  w_cnt = 0;
-  w_time = 0;
-  r_cnt = 0;
-  r_time = 0;
   crc_time = 0;
   total_time = chVTGetSystemTimeX();
 #endif
@@ -1512,64 +1281,89 @@ DSTATUS disk_status(BYTE pdrv) {
 }
 
 // diskio.c - Read sector
+// A run of sectors is read with one READ_MULTIPLE_BLOCK command and ended by STOP_TRANSMISSION
 DRESULT disk_read(BYTE pdrv, BYTE* buff, DWORD sector, UINT count) {
   if (pdrv != 0 || !(CardStatus & CT_POWER_ON))
     return RES_NOTRDY;
-#if DEBUG == 1
-  r_cnt += count;
-  r_time -= chVTGetSystemTimeX();
-#endif
+  systime_t start = chVTGetSystemTimeX();
+  UINT done = 0;
+  DWORD addr = sector;
+  if (!(CardStatus & CT_BLOCK))
+    addr *= SD_SECTOR_SIZE;
   sd_select_spi(SD_SPI_RX_SPEED);
-  while (count) {
-    DWORD addr = sector;
-    if (!(CardStatus & CT_BLOCK))
-      addr *= SD_SECTOR_SIZE;
-    if (sd_send_cmd(CMD17, addr) != 0 ||
-        !sd_rx_data_block(buff, SD_SECTOR_SIZE, SD_TOKEN_START_BLOCK))
-      break;
-    buff += SD_SECTOR_SIZE;
-    sector++;
-    count--;
+  if (count == 1) {
+    if (sd_send_cmd(CMD17, addr) == 0 &&
+        sd_rx_data_block(buff, SD_SECTOR_SIZE, SD_TOKEN_START_BLOCK))
+      done = 1;
+  } else if (sd_send_cmd(CMD18, addr) == 0) {
+    while (done < count && sd_rx_data_block(buff, SD_SECTOR_SIZE, SD_TOKEN_START_BLOCK)) {
+      buff += SD_SECTOR_SIZE;
+      done++;
+    }
+    // Stop the card streaming, a failed stop leaves it unusable for the next command
+    if (sd_send_cmd(CMD12, 0) != 0 || sd_wait_not_busy(MS2ST(200)) != 0xFF)
+      done = 0;
+    sd_stats.read_multi++;
   }
   sd_unselect_spi();
-#if DEBUG == 1
-  r_time += chVTGetSystemTimeX();
-  if (count)
-    DEBUG_PRINT(" err READ_BLOCK %d 0x%08x\r\n", count, sector);
-#endif
-  return count ? RES_ERROR : RES_OK;
+  sd_stats.read_calls++;
+  sd_stats.read_sectors += done;
+  sd_stats.read_time += chVTTimeElapsedSinceX(start);
+  if (done != count) {
+    sd_stats.errors++;
+    DEBUG_PRINT(" err READ_BLOCK %d 0x%08x\r\n", count - done, sector + done);
+    return RES_ERROR;
+  }
+  return RES_OK;
 }
 
 // diskio.c - Write sector
+// A run of sectors is written with one WRITE_MULTIPLE_BLOCK command and ended by the stop token,
+// SD cards get the run length first so they can pre-erase the blocks
 DRESULT disk_write(BYTE pdrv, const BYTE* buff, DWORD sector, UINT count) {
   if (pdrv != 0 || !(CardStatus & CT_POWER_ON))
     return RES_NOTRDY;
   if (CardStatus & CT_WRPROTECT)
     return RES_WRPRT;
-#if DEBUG == 1
-  w_cnt += count;
-  w_time -= chVTGetSystemTimeX();
-#endif
+  systime_t start = chVTGetSystemTimeX();
+  UINT done = 0;
+  DWORD addr = sector;
+  if (!(CardStatus & CT_BLOCK))
+    addr *= SD_SECTOR_SIZE;
   sd_select_spi(SD_SPI_SPEED);
-  while (count) {
-    DWORD addr = sector;
-    if (!(CardStatus & CT_BLOCK))
-      addr *= SD_SECTOR_SIZE;
-    if (sd_send_cmd(CMD24, addr) != 0 ||
-        !sd_tx_data_block(buff, SD_SECTOR_SIZE, SD_TOKEN_START_BLOCK))
-      break;
-    buff += SD_SECTOR_SIZE;
-    sector++;
-    count--;
+  if (count == 1) {
+    if (sd_send_cmd(CMD24, addr) == 0 &&
+        sd_tx_data_block(buff, SD_SECTOR_SIZE, SD_TOKEN_START_BLOCK))
+      done = 1;
+  } else {
+    if (CardStatus & CT_SDC)
+      sd_send_cmd(ACMD23, count); // pre-erase hint only, the write works without it
+    if (sd_send_cmd(CMD25, addr) == 0) {
+      while (done < count && sd_tx_data_block(buff, SD_SECTOR_SIZE, SD_TOKEN_START_M_BLOCK)) {
+        buff += SD_SECTOR_SIZE;
+        done++;
+      }
+      // The stop token is needed even after an error to leave the receive data state
+      if (sd_wait_not_busy(MS2ST(2000)) == 0xFF) {
+        spi_tx_byte(SD_TOKEN_STOP_M_BLOCK);
+        spi_rx_byte(); // skip one byte before the busy signal
+      } else
+        done = 0;
+      sd_stats.write_multi++;
+    }
   }
-  sd_wait_not_busy(MS2ST(2000));
+  if (sd_wait_not_busy(MS2ST(2000)) != 0xFF)
+    done = 0;
   sd_unselect_spi();
-#if DEBUG == 1
-  w_time += chVTGetSystemTimeX();
-  if (count)
-    DEBUG_PRINT(" WRITE_BLOCK %d 0x%08x\r\n", count, sector);
-#endif
-  return count ? RES_ERROR : RES_OK;
+  sd_stats.write_calls++;
+  sd_stats.write_sectors += done;
+  sd_stats.write_time += chVTTimeElapsedSinceX(start);
+  if (done != count) {
+    sd_stats.errors++;
+    DEBUG_PRINT(" WRITE_BLOCK %d 0x%08x\r\n", count - done, sector + done);
+    return RES_ERROR;
+  }
+  return RES_OK;
 }
 
 // diskio.c - Control device specific features
@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * Originally written using elements from Dmitry (DiSlord) dislordlive@gmail.com
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+#include "ch.h"
+#include "nanovna.h"
+#include "chprintf.h"
+
+/*
+ * Display draw functions that only use the panel primitives (lcd_bulk,
+ * lcd_fill, lcd_line and lcd_set_rotation). The SPI panel driver in lcd.c
+ * implements them on the target, tests/sim/sim_lcd.c on the host.
+ */
+
+// LCD display buffer
+alignas(8) pixel_t spi_buffer[SPI_BUFFER_SIZE];
+// Default foreground & background colors
+pixel_t foreground_color = 0;
+pixel_t background_color = 0;
+
+void lcd_clear_screen(void) {
+  lcd_fill(0, 0, LCD_WIDTH, LCD_HEIGHT);
+}
+
+void lcd_set_foreground(uint16_t fg_idx) {
+  foreground_color = GET_PALTETTE_COLOR(fg_idx);
+}
+
+void lcd_set_background(uint16_t bg_idx) {
+  background_color = GET_PALTETTE_COLOR(bg_idx);
+}
+
+void lcd_set_colors(uint16_t fg_idx, uint16_t bg_idx) {
+  foreground_color = GET_PALTETTE_COLOR(fg_idx);
+  background_color = GET_PALTETTE_COLOR(bg_idx);
+}
+
+void lcd_blit_bitmap(uint16_t x, uint16_t y, uint16_t width, uint16_t height, const uint8_t* b) {
+  pixel_t* buf = spi_buffer;
+  uint8_t bits = 0;
+  for (uint32_t c = 0; c < height; c++) {
+    for (uint32_t r = 0; r < width; r++) {
+      if ((r & 7) == 0)
+        bits = *b++;
+      *buf++ = (0x80 & bits) ? foreground_color : background_color;
+      bits <<= 1;
+    }
+  }
+  lcd_bulk(x, y, width, height);
+}
+
+void lcd_drawchar(uint8_t ch, int x, int y) {
+  lcd_blit_bitmap(x, y, FONT_GET_WIDTH(ch), FONT_GET_HEIGHT, FONT_GET_DATA(ch));
+}
+
+#ifndef lcd_drawstring
+void lcd_drawstring(int16_t x, int16_t y, const char* str) {
+  int x_pos = x;
+  while (*str) {
+    uint8_t ch = *str++;
+    if (ch == '\n') {
+      x = x_pos;
+      y += FONT_STR_HEIGHT;
+      continue;
+    }
+    const uint8_t* char_buf = FONT_GET_DATA(ch);
+    uint16_t w = FONT_GET_WIDTH(ch);
+    lcd_blit_bitmap(x, y, w, FONT_GET_HEIGHT, char_buf);
+    x += w;
+  }
+}
+#endif
+
+typedef struct {
+  const void* vmt;
+  int16_t start_x, start_y;
+  int16_t x, y;
+  uint16_t state;
+} lcdPrintStream;
+
+static void put_normal(lcdPrintStream* ps, uint8_t ch) {
+  if (ch == '\n') {
+    ps->x = ps->start_x;
+    ps->y += FONT_STR_HEIGHT;
+    return;
+  }
+  uint16_t w = FONT_GET_WIDTH(ch);
+#if _USE_FONT_ < 3
+  lcd_blit_bitmap(ps->x, ps->y, w, FONT_GET_HEIGHT, FONT_GET_DATA(ch));
+#else
+  lcd_blit_bitmap(ps->x, ps->y, w < 9 ? 9 : w, FONT_GET_HEIGHT, FONT_GET_DATA(ch));
+#endif
+  ps->x += w;
+}
+
+#if _USE_FONT_ != _USE_SMALL_FONT_
+typedef void (*font_put_t)(lcdPrintStream* ps, uint8_t ch);
+static font_put_t put_char = put_normal;
+static void put_small(lcdPrintStream* ps, uint8_t ch) {
+  if (ch == '\n') {
+    ps->x = ps->start_x;
+    ps->y += sFONT_STR_HEIGHT;
+    return;
+  }
+  uint16_t w = sFONT_GET_WIDTH(ch);
+#if _USE_SMALL_FONT_ < 3
+  lcd_blit_bitmap(ps->x, ps->y, w, sFONT_GET_HEIGHT, sFONT_GET_DATA(ch));
+#else
+  lcd_blit_bitmap(ps->x, ps->y, w < 9 ? 9 : w, sFONT_GET_HEIGHT, sFONT_GET_DATA(ch));
+#endif
+  ps->x += w;
+}
+void lcd_set_font(int type) {
+  put_char = type == FONT_SMALL ? put_small : put_normal;
+}
+
+#else
+#define put_char put_normal
+#endif
+
+static msg_t lcd_put(void* ip, uint8_t ch) {
+  lcdPrintStream* ps = ip;
+  if (ps->state) {
+    if (ps->state == R_BGCOLOR[0])
+      lcd_set_background(ch);
+    else if (ps->state == R_FGCOLOR[0])
+      lcd_set_foreground(ch);
+    ps->state = 0;
+    return MSG_OK;
+  } else if (ch < 0x09) {
+    ps->state = ch;
+    return MSG_OK;
+  }
+  put_char(ps, ch);
+  return MSG_OK;
+}
+
+// Simple print in buffer function
+int lcd_printf_va(int16_t x, int16_t y, const char* fmt, va_list ap) {
+  struct lcd_printStreamVMT {
+    _base_sequential_stream_methods
+  } lcd_vmt = {NULL, NULL, lcd_put, NULL};
+  lcdPrintStream ps = {&lcd_vmt, x, y, x, y, 0};
+  va_list args;
+  va_copy(args, ap);
+  int retval = chvprintf((BaseSequentialStream*)(void*)&ps, fmt, args);
+  va_end(args);
+  return retval;
+}
+
+int lcd_printf(int16_t x, int16_t y, const char* fmt, ...) {
+  va_list ap;
+  va_start(ap, fmt);
+  int retval = lcd_printf_va(x, y, fmt, ap);
+  va_end(ap);
+  return retval;
+}
+
+int lcd_printf_v(int16_t x, int16_t y, const char* fmt, ...) {
+  // Init small lcd print stream
+  struct lcd_printStreamVMT {
+    _base_sequential_stream_methods
+  } lcd_vmt = {NULL, NULL, lcd_put, NULL};
+  lcdPrintStream ps = {&lcd_vmt, x, y, x, y, 0};
+  lcd_set_foreground(LCD_FG_COLOR);
+  lcd_set_background(LCD_BG_COLOR);
+  lcd_set_rotation(DISPLAY_ROTATION_270);
+  // Performing the print operation using the common code.
+  va_list ap;
+  va_start(ap, fmt);
+  int retval = chvprintf((BaseSequentialStream*)(void*)&ps, fmt, ap);
+  va_end(ap);
+  lcd_set_rotation(DISPLAY_ROTATION_0);
+  // Return number of bytes that would have been written.
+  return retval;
+}
+
+int lcd_drawchar_size(uint8_t ch, int x, int y, uint8_t size) {
+  const uint8_t* char_buf = FONT_GET_DATA(ch);
+  uint16_t w = FONT_GET_WIDTH(ch);
+  pixel_t* buf = spi_buffer;
+  for (uint32_t c = 0; c < FONT_GET_HEIGHT; c++, char_buf++) {
+    for (uint32_t i = 0; i < size; i++) {
+      uint8_t bits = *char_buf;
+      for (uint32_t r = 0; r < w; r++, bits <<= 1)
+        for (uint32_t j = 0; j < size; j++)
+          *buf++ = (0x80 & bits) ? foreground_color : background_color;
+    }
+  }
+  lcd_bulk(x, y, w * size, FONT_GET_HEIGHT * size);
+  return w * size;
+}
+
+void lcd_drawfont(uint8_t ch, int x, int y) {
+  lcd_blit_bitmap(x, y, NUM_FONT_GET_WIDTH, NUM_FONT_GET_HEIGHT, NUM_FONT_GET_DATA(ch));
+}
+
+void lcd_drawstring_size(const char* str, int x, int y, uint8_t size) {
+  while (*str)
+    x += lcd_drawchar_size(*str++, x, y, size);
+}
+
+void lcd_vector_draw(int x, int y, const vector_data* v) {
+  while (v->shift_x || v->shift_y) {
+    int x1 = x + (int)v->shift_x;
+    int y1 = y + (int)v->shift_y;
+    if (!v->transparent)
+      lcd_line(x, y, x1, y1);
+    x = x1;
+    y = y1;
+    v++;
+  }
+}
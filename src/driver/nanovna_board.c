@@ -40,6 +40,7 @@ static void board_peripherals_init(void) {
   dac_init();
 #endif
   i2c_start();
+  cycle_counter_init();
 }
 
 static void display_driver_init(void) {
@@ -72,14 +73,17 @@ static uint16_t adc_driver_read(uint32_t channel) {
 
 static void generator_driver_init(void) {
   si5351_init();
+  si5351_flush();
 }
 
 static void generator_driver_set_frequency(uint32_t frequency) {
   si5351_set_frequency(frequency, SI5351_CLK_DRIVE_STRENGTH_AUTO);
+  si5351_flush();
 }
 
 static void generator_driver_set_power(uint16_t drive_strength) {
   si5351_set_power((uint8_t)drive_strength);
+  si5351_flush();
 }
 
 static void storage_driver_init(void) {
@@ -23,6 +23,8 @@
 #include "nanovna.h"
 #include "driver/si5351.h"
 
+#include <string.h>
+
 // audio codec frequency clock
 #define CLK2_FREQUENCY AUDIO_CLOCK_REF
 
@@ -42,6 +44,40 @@ static uint8_t pending_settling_cycles = 0;
 // Use cache for this reg, not update if not change
 static uint8_t clk_cache[3] = {0, 0, 0};
 
+/*
+ * Shadow of the PLL A/B and MultiSynth 0-2 parameter blocks (registers 26-65,
+ * 8 bytes each, adjacent blocks are contiguous). A write only transmits the
+ * bytes that differ from the last written values.
+ */
+#define SI5351_BLOCK_BASE SI5351_REG_PLL_A
+#define SI5351_BLOCK_SIZE 8
+#define SI5351_BLOCK_COUNT 5
+static uint8_t reg_shadow[SI5351_BLOCK_COUNT * SI5351_BLOCK_SIZE];
+static uint8_t reg_shadow_valid = 0; // bit per block
+
+typedef struct band_strategy band_strategy_t;
+
+/*
+ * Register plan of one frequency: band and the parameter blocks that change
+ * with every point (FIXED_PLL: MultiSynth 0/1, FIXED_MULT: PLL A/B and
+ * MultiSynth 2). si5351_prepare_frequency() computes it ahead, while the
+ * previous point is still captured, so si5351_set_frequency() only has to
+ * send it. The inputs it depends on are kept to detect a stale plan.
+ */
+typedef struct {
+  uint32_t freq; // requested frequency, 0 - empty
+  uint32_t xtal;
+  uint32_t offset;
+  uint32_t threshold;
+  const band_strategy_t* bands;
+  uint32_t out_freq; // freq scaled by the R divider
+  uint8_t band;
+  uint8_t low_band; // below band 1 limit: R divider 128 and 2mA drive
+  uint8_t frac;     // bit n - block n is in fractional mode
+  uint8_t regs[3][SI5351_BLOCK_SIZE];
+} si5351_plan_t;
+static si5351_plan_t plan;
+
 static void si5351_reset_cache(void) {
   current_band = 0;
   current_freq = 0;
@@ -82,6 +118,10 @@ uint32_t si5351_get_frequency(void) {
   return current_freq;
 }
 
+uint8_t si5351_get_band(void) {
+  return current_band;
+}
+
 uint8_t si5351_take_settling_cycles(void) {
   uint8_t cycles = pending_settling_cycles;
   pending_settling_cycles = 0;
@@ -103,8 +143,19 @@ void si5351_set_power(uint8_t drive_strength) {
   si5351_set_frequency(current_freq, drive_strength);
 }
 
+// Queued, the data may still be on the bus on return (see si5351_flush)
 void si5351_bulk_write(const uint8_t* buf, int len) {
-  i2c_transfer(SI5351_I2C_ADDR, buf, len);
+  i2c_write_async(SI5351_I2C_ADDR, buf, len);
+}
+
+bool si5351_flush(void) {
+  if (i2c_flush())
+    return true;
+  // Chip registers are unknown now, force a full rewrite
+  si5351_reset_cache();
+  reg_shadow_valid = 0;
+  memset(clk_cache, 0xFF, sizeof(clk_cache));
+  return false;
 }
 
 bool si5351_bulk_read(uint8_t reg, uint8_t* buf, int len) {
@@ -223,9 +274,52 @@ void si5351_set_tcxo(uint32_t xtal) {
   si5351_reset_cache();
 }
 
-// Set PLL freq = XTALFREQ * (mult + num/denom)
-static void si5351_setup_pll(uint8_t pllSource, /* SI5351_REG_PLL_A or SI5351_REG_PLL_B */
-                             uint32_t mult, uint32_t num, uint32_t denom) {
+/*
+ * Write count parameter blocks from reg through the shadow: runs of changed
+ * bytes are sent as one transfer each, runs closer than the 2 byte cost of a
+ * new transfer (register address and restart) are merged.
+ */
+static void si5351_write_blocks(uint8_t reg, const uint8_t* data, int count) {
+  int first_block = (reg - SI5351_BLOCK_BASE) / SI5351_BLOCK_SIZE;
+  uint8_t* shadow = &reg_shadow[first_block * SI5351_BLOCK_SIZE];
+  int size = count * SI5351_BLOCK_SIZE;
+  uint8_t buf[2 * SI5351_BLOCK_SIZE + 1];
+  uint8_t valid = reg_shadow_valid >> first_block;
+  int i = 0;
+  while (i < size) {
+    if ((valid & (1U << (i / SI5351_BLOCK_SIZE))) && data[i] == shadow[i]) {
+      i++;
+      continue;
+    }
+    int first = i, last = i;
+    for (i++; i < size && i - last <= 3; i++) {
+      if (!(valid & (1U << (i / SI5351_BLOCK_SIZE))) || data[i] != shadow[i])
+        last = i;
+    }
+    int len = last - first + 1;
+    buf[0] = reg + first;
+    memcpy(&buf[1], &data[first], len);
+    si5351_bulk_write(buf, len + 1);
+    i = last + 1;
+  }
+  memcpy(shadow, data, size);
+  reg_shadow_valid |= ((1U << count) - 1U) << first_block;
+}
+
+// Encode P1/P2/P3 (18, 20, 20 bit) as a PLL or MultiSynth parameter block
+static void si5351_encode_block(uint8_t* reg, uint32_t P1, uint32_t P2, uint32_t P3, uint8_t div) {
+  reg[0] = (P3 & 0x0FF00) >> 8;                             // P3[15: 8]
+  reg[1] = (P3 & 0x000FF);                                  // P3[ 7: 0]
+  reg[2] = ((P1 & 0x30000) >> 16) | div;                    // Rx_DIV[2:0] | MSx_DIVBY4[1:0] | P1[17:16]
+  reg[3] = (P1 & 0x0FF00) >> 8;                             // P1[15: 8]
+  reg[4] = (P1 & 0x000FF);                                  // P1[ 7: 0]
+  reg[5] = ((P3 & 0xF0000) >> 12) | ((P2 & 0xF0000) >> 16); // P3[19:16] | P2[19:16]
+  reg[6] = (P2 & 0x0FF00) >> 8;                             // P2[15: 8]
+  reg[7] = (P2 & 0x000FF);                                  // P2[ 7: 0]
+}
+
+// PLL freq = XTALFREQ * (mult + num/denom)
+static void si5351_pll_regs(uint8_t* reg, uint32_t mult, uint32_t num, uint32_t denom) {
   /* Feedback Multisynth Divider Equation
    * where: a = mult, b = num and c = denom
    * P1 register is an 18-bit value using following formula:
@@ -235,7 +329,6 @@ static void si5351_setup_pll(uint8_t pllSource, /* SI5351_REG_PLL_A or SI5351_RE
    * P3 register is a 20-bit value using the following formula:
    *    P3[19:0] = denom
    */
-  /* Set the main PLL config registers */
   mult <<= 7;
   num <<= 7;
   uint32_t P1 = mult - 512; // Integer mode
@@ -246,26 +339,14 @@ static void si5351_setup_pll(uint8_t pllSource, /* SI5351_REG_PLL_A or SI5351_RE
     P2 = num % denom;
     P3 = denom;
   }
-  // Pll MSN(A|B) registers Datasheet
-  uint8_t reg[9];
-  reg[0] = pllSource;                                       // SI5351_REG_PLL_A or SI5351_REG_PLL_B
-  reg[1] = (P3 & 0x0FF00) >> 8;                             // MSN_P3[15: 8]
-  reg[2] = (P3 & 0x000FF);                                  // MSN_P3[ 7: 0]
-  reg[3] = (P1 & 0x30000) >> 16;                            // MSN_P1[17:16]
-  reg[4] = (P1 & 0x0FF00) >> 8;                             // MSN_P1[15: 8]
-  reg[5] = (P1 & 0x000FF);                                  // MSN_P1[ 7: 0]
-  reg[6] = ((P3 & 0xF0000) >> 12) | ((P2 & 0xF0000) >> 16); // MSN_P3[19:16] | MSN_P2[19:16]
-  reg[7] = (P2 & 0x0FF00) >> 8;                             // MSN_P2[15: 8]
-  reg[8] = (P2 & 0x000FF);                                  // MSN_P2[ 7: 0]
-  si5351_bulk_write(reg, 9);
+  si5351_encode_block(reg, P1, P2, P3, 0);
 }
 
-// Set Multisynth divider = (div + num/denom) * rdiv
-static void si5351_setupMultisynth(uint32_t channel,
+// Multisynth divider = (div + num/denom) * rdiv, returns true in fractional mode
+static bool si5351_multisynth_regs(uint8_t* reg,
                                    uint32_t div, // 4,6,8, 8+ ~ 900
                                    uint32_t num, uint32_t denom,
-                                   uint32_t rdiv,  // SI5351_R_DIV_1~128
-                                   uint8_t chctrl) // SI5351_REG_16_CLKX_CONTROL settings
+                                   uint32_t rdiv) // SI5351_R_DIV_1~128
 {
   /* Output Multisynth Divider Equations
    * where: a = div, b = num and c = denom
@@ -276,10 +357,10 @@ static void si5351_setupMultisynth(uint32_t channel,
    * P3 register is a 20-bit value using the following formula:
    *   P3[19:0] = c
    */
-  /* Set the main PLL config registers */
   uint32_t P1 = 0;
   uint32_t P2 = 0;
   uint32_t P3 = 1;
+  bool frac = num != 0;
   if (div == 4)
     rdiv |= SI5351_DIVBY4;
   else {
@@ -292,23 +373,16 @@ static void si5351_setupMultisynth(uint32_t channel,
       P3 = denom;
     }
   }
-  /* Set the MSx config registers */
-  uint8_t reg[9];
-  reg[0] = msreg_base[channel];           // SI5351_REG_42_MULTISYNTH0, SI5351_REG_50_MULTISYNTH1,
-                                          // SI5351_REG_58_MULTISYNTH2
-  reg[1] = (P3 & 0x0FF00) >> 8;           // MSx_P3[15: 8]
-  reg[2] = (P3 & 0x000FF);                // MSx_P3[ 7: 0]
-  reg[3] = ((P1 & 0x30000) >> 16) | rdiv; // Rx_DIV[2:0] | MSx_DIVBY4[1:0] | MSx_P1[17:16]
-  reg[4] = (P1 & 0x0FF00) >> 8;           // MSx_P1[15: 8]
-  reg[5] = (P1 & 0x000FF);                // MSx_P1[ 7: 0]
-  reg[6] = ((P3 & 0xF0000) >> 12) | ((P2 & 0xF0000) >> 16); // MSx_P3[19:16] | MSx_P2[19:16]
-  reg[7] = (P2 & 0x0FF00) >> 8;                             // MSx_P2[15: 8]
-  reg[8] = (P2 & 0x000FF);                                  // MSx_P2[ 7: 0]
-  si5351_bulk_write(reg, 9);
-
-  /* Configure the clk control and enable the output */
+  si5351_encode_block(reg, P1, P2, P3, rdiv);
+  return frac;
+}
+
+// Configure the clk control of MSx (enable the output)
+static void si5351_set_clk_control(uint32_t channel, bool frac,
+                                   uint8_t chctrl) // SI5351_REG_16_CLKX_CONTROL settings
+{
   chctrl |= SI5351_CLK_INPUT_MULTISYNTH_N;
-  if (num == 0)
+  if (!frac)
     chctrl |= SI5351_CLK_INTEGER_MODE;
   if (clk_cache[channel] != chctrl) {
     si5351_write(SI5351_REG_16_CLK0_CONTROL + channel, chctrl);
@@ -316,6 +390,27 @@ static void si5351_setupMultisynth(uint32_t channel,
   }
 }
 
+static void si5351_write_multisynth(uint32_t channel, const uint8_t* reg, bool frac, uint8_t chctrl) {
+  si5351_write_blocks(msreg_base[channel], reg, 1);
+  si5351_set_clk_control(channel, frac, chctrl);
+}
+
+// Set PLL freq = XTALFREQ * (mult + num/denom)
+static void si5351_setup_pll(uint8_t pllSource, /* SI5351_REG_PLL_A or SI5351_REG_PLL_B */
+                             uint32_t mult, uint32_t num, uint32_t denom) {
+  uint8_t reg[SI5351_BLOCK_SIZE];
+  si5351_pll_regs(reg, mult, num, denom);
+  si5351_write_blocks(pllSource, reg, 1);
+}
+
+// Set Multisynth divider = (div + num/denom) * rdiv
+static void si5351_setupMultisynth(uint32_t channel, uint32_t div, uint32_t num, uint32_t denom,
+                                   uint32_t rdiv, uint8_t chctrl) {
+  uint8_t reg[SI5351_BLOCK_SIZE];
+  bool frac = si5351_multisynth_regs(reg, div, num, denom, rdiv);
+  si5351_write_multisynth(channel, reg, frac, chctrl);
+}
+
 // Find better approximate values for n/d
 #define MAX_DENOMINATOR ((1 << 20) - 1)
 static void approximate_fraction(uint32_t* n, uint32_t* d) {
@@ -350,24 +445,31 @@ static void approximate_fraction(uint32_t* n, uint32_t* d) {
 #endif
 }
 
-// Setup Multisynth divider for get correct output freq if fixed PLL = pllfreq
-static void si5351_set_frequency_fixedpll(uint32_t channel, uint64_t pllfreq, uint32_t freq,
-                                          uint32_t rdiv, uint8_t chctrl) {
+// Multisynth divider for get correct output freq if fixed PLL = pllfreq
+static bool si5351_fixedpll_regs(uint8_t* reg, uint64_t pllfreq, uint32_t freq, uint32_t rdiv) {
   uint32_t div = pllfreq / freq; // range: 8 ~ 1800
   uint32_t num = pllfreq % freq;
   uint32_t denom = freq;
   approximate_fraction(&num, &denom);
-  si5351_setupMultisynth(channel, div, num, denom, rdiv, chctrl);
+  return si5351_multisynth_regs(reg, div, num, denom, rdiv);
 }
 
-// Setup PLL freq if Multisynth divider fixed = div (need get output =  freq/mul)
-static void si5351_setup_pll_freq(uint32_t pllSource, uint64_t pllfreq, uint32_t div) {
+// Setup Multisynth divider for get correct output freq if fixed PLL = pllfreq
+static void si5351_set_frequency_fixedpll(uint32_t channel, uint64_t pllfreq, uint32_t freq,
+                                          uint32_t rdiv, uint8_t chctrl) {
+  uint8_t reg[SI5351_BLOCK_SIZE];
+  bool frac = si5351_fixedpll_regs(reg, pllfreq, freq, rdiv);
+  si5351_write_multisynth(channel, reg, frac, chctrl);
+}
+
+// PLL freq if Multisynth divider fixed = div (need get output =  freq/mul)
+static void si5351_pll_freq_regs(uint8_t* reg, uint64_t pllfreq, uint32_t div) {
   uint32_t xtal = config._xtal_freq * div;
   uint32_t multi = pllfreq / xtal;
   uint32_t num = pllfreq % xtal;
   uint32_t denom = xtal;
   approximate_fraction(&num, &denom);
-  si5351_setup_pll(pllSource, multi, num, denom);
+  si5351_pll_regs(reg, multi, num, denom);
 }
 
 #if 0
@@ -393,7 +495,7 @@ si5351_set_frequency(int channel, uint32_t freq, uint8_t drive_strength)
 }
 #endif
 
-typedef struct {
+struct band_strategy {
   uint32_t freq;
   uint8_t mode;
   union {
@@ -407,7 +509,7 @@ typedef struct {
   uint8_t l_gain;
   uint8_t r_gain;
   uint16_t freq_align;
-} band_strategy_t;
+};
 
 #define SI5351_FIXED_PLL 1
 #define SI5351_FIXED_MULT 2
@@ -995,6 +1097,14 @@ void si5351_set_band_mode(uint16_t t) {
   band_s = bs[t];
 }
 
+uint8_t si5351_get_frequency_band(uint32_t freq) {
+  if (freq < band_s[1].freq)
+    return 1;
+  if (freq <= 1000000U)
+    return 2;
+  return si5351_get_harmonic_lvl(freq);
+}
+
 uint32_t si5351_get_harmonic_lvl(uint32_t freq) {
   uint16_t i;
   const uint32_t threshold = clamp_harmonic_threshold(config._harmonic_freq_threshold);
@@ -1021,29 +1131,30 @@ uint32_t si5351_get_harmonic_lvl(uint32_t freq) {
 #define FREQ_CHANNEL 1
 #define AUDIO_CODEC_CHANNEL 2
 
-int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
+// Select the band of freq and compute its per point register blocks
+static void si5351_plan_frequency(uint32_t freq, si5351_plan_t* p) {
   uint8_t band;
-  int delay = 0;
-  if (freq == 0)
-    return 0;
   uint32_t rdiv = SI5351_R_DIV_1;
-  uint32_t fdiv, pll_n;
   uint32_t ofreq = freq + IF_OFFSET;
+  p->freq = freq;
+  p->xtal = config._xtal_freq;
+  p->offset = IF_OFFSET;
+  p->threshold = config._harmonic_freq_threshold;
+  p->bands = band_s;
+  p->low_band = 0;
 
   // Select optimal band for prepared freq
+  band = si5351_get_frequency_band(freq);
   if (freq < band_s[1].freq) {
     rdiv = SI5351_R_DIV(7);
-    drive_strength = SI5351_CLK_DRIVE_STRENGTH_2MA; // Always use 2ma
     freq <<= 7;
     ofreq <<= 7;
-    band = 1;
+    p->low_band = 1;
   } else if (freq <= 1000000U) {
     rdiv = SI5351_R_DIV(4);
     freq <<= 4;
     ofreq <<= 4;
-    band = 2;
-  } else
-    band = si5351_get_harmonic_lvl(freq);
+  }
 
 #if 0
   uint32_t align = band_s[band].freq_align;
@@ -1053,13 +1164,56 @@ int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
     ofreq = freq + current_offset;
   }
 #endif
+  p->band = band;
+  p->out_freq = freq;
+  p->frac = 0;
+  uint32_t mul = band_s[band].mul;
+  uint32_t omul = band_s[band].omul;
+  uint32_t fdiv, pll_n;
+  switch (band_s[band].mode) {
+  case SI5351_FIXED_PLL: // CH0 and CH1 dividers from the fixed PLL A
+    pll_n = band_s[band].pll_n;
+    if (si5351_fixedpll_regs(p->regs[0], (uint64_t)omul * config._xtal_freq * pll_n, ofreq, rdiv))
+      p->frac |= 1U << 0;
+    if (si5351_fixedpll_regs(p->regs[1], (uint64_t)mul * config._xtal_freq * pll_n, freq, rdiv))
+      p->frac |= 1U << 1;
+    break;
+  case SI5351_FIXED_MULT: // PLL A and B for the fixed dividers, CH2 divider from PLL B
+    fdiv = band_s[band].div;
+    si5351_pll_freq_regs(p->regs[0], (uint64_t)ofreq * fdiv, omul); // PLLA = (ofreq/omul)*fdiv
+    si5351_pll_freq_regs(p->regs[1], (uint64_t)freq * fdiv, mul);   // PLLB = ( freq/ mul)*fdiv
+    if (si5351_fixedpll_regs(p->regs[2], (uint64_t)freq * fdiv, CLK2_FREQUENCY * mul, SI5351_R_DIV_1))
+      p->frac |= 1U << 2;
+    break;
+  }
+}
+
+static bool si5351_plan_valid(const si5351_plan_t* p, uint32_t freq) {
+  return p->freq == freq && p->xtal == config._xtal_freq && p->offset == (uint32_t)IF_OFFSET &&
+         p->threshold == config._harmonic_freq_threshold && p->bands == band_s;
+}
+
+void si5351_prepare_frequency(uint32_t freq) {
+  if (freq != 0 && !si5351_plan_valid(&plan, freq))
+    si5351_plan_frequency(freq, &plan);
+}
+
+int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
+  int delay = 0;
+  if (freq == 0)
+    return 0;
+  si5351_prepare_frequency(freq);
+  uint8_t band = plan.band;
+  if (plan.low_band)
+    drive_strength = SI5351_CLK_DRIVE_STRENGTH_2MA; // Always use 2ma
+
   // Check current power settings
   if (current_power != drive_strength) {
     si5351_reset_cache();
     current_power = drive_strength;
   }
 
-  if (freq == current_freq)
+  if (plan.out_freq == current_freq)
     return DELAY_CHANNEL_CHANGE;
 
   if (current_band != band) {
@@ -1075,17 +1229,18 @@ int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
         band_s[current_band].r_gain != band_s[band].r_gain)
       tlv320aic3204_set_gain(band_s[band].l_gain, band_s[band].r_gain);
     // Add delay - optimized for band transitions
-    if (DELAY_RESET_PLL_BEFORE)
+    if (DELAY_RESET_PLL_BEFORE) {
+      si5351_flush();
       chThdSleepMicroseconds(DELAY_RESET_PLL_BEFORE);
+    }
   }
-  uint32_t mul = band_s[band].mul;
-  uint32_t omul = band_s[band].omul;
   uint8_t ds = drive_strength;
   uint8_t ods = drive_strength;
   if (drive_strength > SI5351_CLK_DRIVE_STRENGTH_8MA) {
     ds = band_s[band].pow;
     ods = band_s[band].opow;
   }
+  uint32_t fdiv, pll_n;
   switch (band_s[band].mode) {
     // 800Hz to 10kHz   PLLN =  8
   case SI5351_FIXED_PLL: // 10kHz to 100MHz  PLLN = 32
@@ -1105,12 +1260,11 @@ int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
                                     SI5351_CLK_DRIVE_STRENGTH_2MA | SI5351_CLK_PLL_SELECT_B);
     }
     delay = DELAY_BAND_1_2;
-    // Calculate and set CH0 and CH1 divider
+    // Set CH0 and CH1 divider (contiguous, one transfer)
     // Improved sequence ordering: ensure offset frequency is set before main frequency
-    si5351_set_frequency_fixedpll(OFREQ_CHANNEL, (uint64_t)omul * config._xtal_freq * pll_n, ofreq,
-                                  rdiv, ods | SI5351_CLK_PLL_SELECT_A);
-    si5351_set_frequency_fixedpll(FREQ_CHANNEL, (uint64_t)mul * config._xtal_freq * pll_n, freq,
-                                  rdiv, ds | SI5351_CLK_PLL_SELECT_A);
+    si5351_write_blocks(SI5351_REG_42_MULTISYNTH0, plan.regs[0], 2);
+    si5351_set_clk_control(OFREQ_CHANNEL, plan.frac & (1U << 0), ods | SI5351_CLK_PLL_SELECT_A);
+    si5351_set_clk_control(FREQ_CHANNEL, plan.frac & (1U << 1), ds | SI5351_CLK_PLL_SELECT_A);
     break;
 #if 0
     case SI5351_MIXED:
@@ -1137,11 +1291,8 @@ int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
     // fdiv = 6, f 130-170   PLL 780-1050
   case SI5351_FIXED_MULT: // fdiv = 4, f 170-270   PLL 680-1080
     fdiv = band_s[band].div;
-    // Calculate and set CH0 and CH1 PLL freq
-    si5351_setup_pll_freq(SI5351_REG_PLL_A, (uint64_t)ofreq * fdiv,
-                          omul); // set PLLA freq = (ofreq/omul)*fdiv
-    si5351_setup_pll_freq(SI5351_REG_PLL_B, (uint64_t)freq * fdiv,
-                          mul); // set PLLB freq = ( freq/ mul)*fdiv
+    // Set CH0 and CH1 PLL freq (contiguous, one transfer)
+    si5351_write_blocks(SI5351_REG_PLL_A, plan.regs[0], 2);
     // Setup CH0 and CH1 constant fdiv divider at change
     if (band_s[current_band].div != band_s[band].div) {
       si5351_setupMultisynth(OFREQ_CHANNEL, fdiv, 0, 1, SI5351_R_DIV_1,
@@ -1149,10 +1300,9 @@ int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
       si5351_setupMultisynth(FREQ_CHANNEL, fdiv, 0, 1, SI5351_R_DIV_1,
                              ds | SI5351_CLK_PLL_SELECT_B);
     }
-    // Calculate CH2 freq = CLK2_FREQUENCY, depend from calculated before CH1 PLLB = (freq/mul)*fdiv
-    si5351_set_frequency_fixedpll(AUDIO_CODEC_CHANNEL, (uint64_t)freq * fdiv, CLK2_FREQUENCY * mul,
-                                  SI5351_R_DIV_1,
-                                  SI5351_CLK_DRIVE_STRENGTH_2MA | SI5351_CLK_PLL_SELECT_B);
+    // CH2 freq = CLK2_FREQUENCY, depend from calculated before CH1 PLLB = (freq/mul)*fdiv
+    si5351_write_multisynth(AUDIO_CODEC_CHANNEL, plan.regs[2], plan.frac & (1U << 2),
+                            SI5351_CLK_DRIVE_STRENGTH_2MA | SI5351_CLK_PLL_SELECT_B);
     delay = DELAY_BAND_3_4;
     break;
   }
@@ -1161,6 +1311,8 @@ int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
     //    ~(SI5351_CLK0_EN|SI5351_CLK1_EN|SI5351_CLK2_EN));
     // Possibly not need add delay now
     if (DELAY_RESET_PLL_AFTER) {
+      // Delay counts from the new dividers on the chip
+      si5351_flush();
       chThdSleepMicroseconds(DELAY_RESET_PLL_AFTER);
       si5351_reset_pll(SI5351_PLL_RESET_A | SI5351_PLL_RESET_B);
     }
@@ -1168,6 +1320,6 @@ int si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
     current_band = band;
     delay = DELAY_BANDCHANGE;
   }
-  current_freq = freq;
+  current_freq = plan.out_freq;
   return delay;
 }
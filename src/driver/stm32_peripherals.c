@@ -22,6 +22,7 @@
 #include "ch.h"
 #include "hal.h"
 #include "nanovna.h"
+#include "driver/i2c_queue.h"
 
 // Compact STM32 ADC library
 #if HAL_USE_ADC == TRUE
@@ -98,6 +99,13 @@
 #include "boards/STM32F072/dma_v1.c"
 #endif
 
+// Cycle counter for the sweep profiler
+#ifdef NANOVNA_F303
+#include "boards/STM32F303/dwt.c"
+#else
+#include "boards/STM32F072/systick.c"
+#endif
+
 // Compact STM32 EXT library
 #if HAL_USE_EXT == FALSE
 #ifdef NANOVNA_F303
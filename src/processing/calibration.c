@@ -166,6 +166,9 @@ void cal_collect(uint16_t type) {
   if (type >= ARRAY_COUNT(calibration_set))
     return;
 
+  // Calibration is stored as a linear grid, measure it on the linear sweep
+  sweep_service_segments_enable(false);
+
   // reset old calibration if frequency range/points not some
   freq_t cal_start, cal_stop;
   freq_t a = frequency0;
@@ -270,6 +273,7 @@ void cal_done(void) {
 
   cal_status |= CALSTAT_APPLY;
   lastsaveid = NO_SAVE_SLOT;
+  app_measurement_request_recorrection();
   request_to_redraw(REDRAW_BACKUP | REDRAW_CAL_STATUS);
   
   // Indicate that calibration processing is complete
@@ -157,6 +157,19 @@ static volatile acc_t acc_samp_c;
 static volatile acc_t acc_ref_s;
 static volatile acc_t acc_ref_c;
 
+#ifdef __USE_ADAPTIVE_IFBW__
+/*
+ * Online statistics of the gamma measured on each buffer (Welford), used to
+ * stop the capture once the mean of the buffers is known well enough.
+ */
+static struct {
+  acc_t last[4];  // accumulators after the previous buffer: samp_s, samp_c, ref_s, ref_c
+  uint16_t count; // buffers counted since the accumulator reset
+  float mean[2];
+  float m2;       // sum of squared deviations (real + imaginary)
+} dsp_stat;
+#endif
+
 static inline uint32_t dsp_enter_critical(void) {
   uint32_t primask = __get_PRIMASK();
   __disable_irq();
@@ -297,7 +310,57 @@ void reset_dsp_accumerator(void) {
   acc_samp_s = 0;
   acc_samp_c = 0;
   dsp_exit_critical(primask);
+#ifdef __USE_ADAPTIVE_IFBW__
+  dsp_stat.last[0] = dsp_stat.last[1] = dsp_stat.last[2] = dsp_stat.last[3] = 0;
+  dsp_stat.count = 0;
+  dsp_stat.mean[0] = dsp_stat.mean[1] = 0.0f;
+  dsp_stat.m2 = 0.0f;
+#endif
+}
+
+#ifdef __USE_ADAPTIVE_IFBW__
+// Add the buffers processed since the last call as one gamma sample
+uint16_t dsp_adaptive_update(void) {
+  acc_t acc[4];
+  dsp_snapshot(&acc[0], &acc[1], &acc[2], &acc[3]);
+  const measure_t ss = (measure_t)(acc[0] - dsp_stat.last[0]);
+  const measure_t sc = (measure_t)(acc[1] - dsp_stat.last[1]);
+  const measure_t rs = (measure_t)(acc[2] - dsp_stat.last[2]);
+  const measure_t rc = (measure_t)(acc[3] - dsp_stat.last[3]);
+  for (int i = 0; i < 4; i++)
+    dsp_stat.last[i] = acc[i];
+  const measure_t mag_sq = rc * rc + rs * rs;
+  if (mag_sq == 0.0f)
+    return dsp_stat.count;
+  // Same ratio as calculate_gamma(), on this buffer only
+  const measure_t inv_mag = 1.0f / mag_sq;
+  const float g_re = (sc * rc + ss * rs) * inv_mag;
+  const float g_im = (ss * rc - sc * rs) * inv_mag;
+  const uint16_t n = ++dsp_stat.count;
+  const float d_re = g_re - dsp_stat.mean[0];
+  const float d_im = g_im - dsp_stat.mean[1];
+  dsp_stat.mean[0] += d_re / n;
+  dsp_stat.mean[1] += d_im / n;
+  dsp_stat.m2 += d_re * (g_re - dsp_stat.mean[0]) + d_im * (g_im - dsp_stat.mean[1]);
+  return n;
+}
+
+uint16_t dsp_adaptive_count(void) {
+  return dsp_stat.count;
+}
+
+/*
+ * True when at least min_count buffers are counted and the variance of their
+ * mean is below target * |mean|^2 (target is the relative variance, 1e-4 = 1%).
+ */
+bool dsp_adaptive_converged(float target, uint16_t min_count) {
+  const uint16_t n = dsp_stat.count;
+  if (n < min_count || n < 2U)
+    return false;
+  const float mag_sq = dsp_stat.mean[0] * dsp_stat.mean[0] + dsp_stat.mean[1] * dsp_stat.mean[1];
+  return dsp_stat.m2 <= target * mag_sq * (float)((n - 1U) * n);
 }
+#endif
 
 #ifdef NANOVNA_HOST_TEST
 void set_dsp_accumulator(acc_t ss, acc_t sc, acc_t rs, acc_t rc) {
@@ -407,7 +407,7 @@ void vna_sincosf(float angle, float* pSinVal, float* pCosVal) {
   float scaled = fpart * table_size_full_circle;
   uint16_t full_index = (uint16_t)scaled;
   float fract = scaled - full_index;
-  uint8_t quad = full_index / (uint8_t)table_size_per_quarter;  
+  uint8_t quad = full_index / (uint16_t)table_size_per_quarter;  
   uint16_t in_quad_pos = full_index % (uint16_t)table_size_per_quarter;  
   float sin_interp = quadratic_interpolation(in_quad_pos + fract);
   float comp_angle = table_size_per_quarter - (in_quad_pos + fract);
@@ -456,11 +456,6 @@ static uint16_t reverse_bits(uint16_t x, int n) {
 }
 #endif
 
-/***
- * dir = forward: 0, inverse: 1
- * https://www.nayuki.io/res/free-small-fft-in-multiple-languages/fft.c
- */
-void fft(float array[][2], const uint8_t dir) {
 // FFT_SIZE = 2^FFT_N
 #if FFT_SIZE == 256
 #define FFT_N 8
@@ -471,8 +466,14 @@ void fft(float array[][2], const uint8_t dir) {
 #else
 #error "Need define FFT_N for this FFT size"
 #endif
-  const uint16_t n = FFT_SIZE;
-  const uint8_t levels = FFT_N; // log2(n)
+
+/***
+ * Radix-2 FFT of n = 2^levels points (n <= FFT_SIZE), twiddles from the FFT_SIZE table
+ * dir = forward: 0, inverse: 1
+ * https://www.nayuki.io/res/free-small-fft-in-multiple-languages/fft.c
+ */
+static void fft_radix2(float array[][2], const uint8_t levels, const uint8_t dir) {
+  const uint16_t n = 1U << levels;
   uint16_t i, j;
   for (i = 0; i < n; i++) {
     if ((j = reverse_bits(i, levels)) > i) {
@@ -480,11 +481,10 @@ void fft(float array[][2], const uint8_t dir) {
       SWAP(float, array[i][1], array[j][1]);
     }
   }
-  const uint16_t size = 2;
-  uint16_t halfsize = size / 2;
-  uint16_t tablestep = n / size;
+  uint16_t halfsize = 1;
+  uint16_t tablestep = FFT_SIZE / 2;
   // Cooley-Tukey decimation-in-time radix-2 FFT
-  for (; tablestep; tablestep >>= 1, halfsize <<= 1) {
+  for (; halfsize < n; tablestep >>= 1, halfsize <<= 1) {
     for (i = 0; i < n; i += halfsize * 2) {  
       for (j = 0; j < halfsize; j++) {        
         const uint16_t k = i + j;
@@ -503,6 +503,47 @@ void fft(float array[][2], const uint8_t dir) {
   }
 }
 
+/***
+ * dir = forward: 0, inverse: 1
+ */
+void fft(float array[][2], const uint8_t dir) {
+  fft_radix2(array, FFT_N, dir);
+}
+
+/***
+ * Inverse FFT of a Hermitian spectrum, real output (same scale as fft_inverse)
+ * Input:  array[0..FFT_SIZE/2] spectrum bins, imaginary part of bins 0 and FFT_SIZE/2 ignored
+ * Output: FFT_SIZE real samples, ((float *)array)[0..FFT_SIZE-1]
+ * Pack even/odd outputs as one complex half size sequence:
+ *   Z[k] = (X[k] + X*[N/2-k]) + j * (X[k] - X*[N/2-k]) * e^(j*2*pi*k/N)
+ * and run a FFT_SIZE/2 complex inverse FFT: z[m] = x[2m] + j * x[2m+1]
+ */
+void fft_inverse_real(float array[][2]) {
+  const uint16_t h = FFT_SIZE / 2;
+  // Bins 0 and N/2: twiddle = 1
+  const float x0 = array[0][0];
+  const float xh = array[h][0];
+  array[0][0] = x0 + xh;
+  array[0][1] = x0 - xh;
+  // Bins k and N/2-k processed in pairs: Z[N/2-k] = E* + j * O*
+  for (uint16_t k = 1; k <= h / 2; k++) {
+    const uint16_t m = h - k;
+    const float e_re = array[k][0] + array[m][0];
+    const float e_im = array[k][1] - array[m][1];
+    const float d_re = array[k][0] - array[m][0];
+    const float d_im = array[k][1] + array[m][1];
+    const float c = FFT_COS(k);
+    const float s = FFT_SIN(k);
+    const float o_re = d_re * c - d_im * s;
+    const float o_im = d_re * s + d_im * c;
+    array[k][0] = e_re - o_im;
+    array[k][1] = e_im + o_re;
+    array[m][0] = e_re + o_im;
+    array[m][1] = o_re - e_im;
+  }
+  fft_radix2(array, FFT_N - 1, 1);
+}
+
 //**********************************************************************************
 //      VNA math (Common)
 //**********************************************************************************
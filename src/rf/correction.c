@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#pragma GCC optimize("O2")
+
+#include "rf/correction.h"
+
+#include "rf/sweep.h"
+
+static void apply_ch0_error_term(float data[4], float c_data[CAL_TYPE_COUNT][2]) {
+  // S11m' = S11m - Ed
+  // S11a = S11m' / (Er + Es S11m')
+  float s11mr = data[0] - c_data[ETERM_ED][0];
+  float s11mi = data[1] - c_data[ETERM_ED][1];
+  float err = c_data[ETERM_ER][0] + s11mr * c_data[ETERM_ES][0] - s11mi * c_data[ETERM_ES][1];
+  float eri = c_data[ETERM_ER][1] + s11mr * c_data[ETERM_ES][1] + s11mi * c_data[ETERM_ES][0];
+  float sq = err*err + eri*eri;
+  if (sq != 0.0f) {
+    float inv = 1.0f / sq;
+    data[0] = (s11mr * err + s11mi * eri) * inv;
+    data[1] = (s11mi * err - s11mr * eri) * inv;
+  } else {
+    data[0] = 0.0f;
+    data[1] = 0.0f;
+  }
+}
+
+static void apply_ch1_error_term(float data[4], float c_data[CAL_TYPE_COUNT][2],
+                                 bool enhanced_response) {
+  // CAUTION: Et is inversed for efficiency
+  // S21a = (S21m - Ex) * Et
+  float s21mr = data[2] - c_data[ETERM_EX][0];
+  float s21mi = data[3] - c_data[ETERM_EX][1];
+  // Apply transmission tracking correction (ET is inverted for efficiency)
+  data[2] = s21mr * c_data[ETERM_ET][0] - s21mi * c_data[ETERM_ET][1];
+  data[3] = s21mi * c_data[ETERM_ET][0] + s21mr * c_data[ETERM_ET][1];
+
+  // Enhanced Response: S21a *= 1 - Es * S11a (if enabled)
+  if (enhanced_response) {
+    float esr = 1.0f - (c_data[ETERM_ES][0] * data[0] - c_data[ETERM_ES][1] * data[1]);
+    float esi = 0.0f - (c_data[ETERM_ES][1] * data[0] + c_data[ETERM_ES][0] * data[1]);
+    float re = data[2];
+    float im = data[3];
+    data[2] = esr * re - esi * im;
+    data[3] = esi * re + esr * im;
+  }
+}
+
+static void edelay_rotation(sweep_edelay_phasor_t* ph, float edelay, float freq_step,
+                            uint16_t idx, freq_t frequency) {
+  if (freq_step != 0.0f && ph->valid && idx == ph->next && ph->advanced < SWEEP_EDELAY_RESEED) {
+    float c = ph->rot[0] * ph->step[0] - ph->rot[1] * ph->step[1];
+    float s = ph->rot[1] * ph->step[0] + ph->rot[0] * ph->step[1];
+    ph->rot[0] = c;
+    ph->rot[1] = s;
+    ph->advanced++;
+  } else {
+    vna_sincosf(edelay * frequency, &ph->rot[1], &ph->rot[0]);
+    if (!ph->valid && freq_step != 0.0f) {
+      vna_sincosf(edelay * freq_step, &ph->step[1], &ph->step[0]);
+      ph->valid = true;
+    }
+    ph->advanced = 0;
+  }
+  ph->next = idx + 1U;
+}
+
+static void apply_edelay(const float rot[2], float data[2]) {
+  float real = data[0];
+  float imag = data[1];
+  data[0] = real * rot[0] - imag * rot[1];
+  data[1] = imag * rot[0] + real * rot[1];
+}
+
+static void apply_offset(float data[2], float offset) {
+  data[0] *= offset;
+  data[1] *= offset;
+}
+
+void sweep_correction_init(sweep_correction_t* corr, uint16_t mask, bool enhanced_response,
+                           float edelay_s11, float edelay_s21, float s21_gain,
+                           float freq_step) {
+  corr->mask = mask;
+  corr->enhanced_response = enhanced_response;
+  corr->edelay_s11 = edelay_s11;
+  corr->edelay_s21 = edelay_s21;
+  corr->s21_gain = s21_gain;
+  corr->freq_step = freq_step;
+  corr->phasor[0].valid = false;
+  corr->phasor[1].valid = false;
+}
+
+void sweep_correct_channel(sweep_correction_t* corr, uint8_t channel, uint16_t idx,
+                           freq_t frequency, float data[4], float cal[CAL_TYPE_COUNT][2]) {
+  sweep_edelay_phasor_t* ph = &corr->phasor[channel ? 1 : 0];
+  if (channel == 0U) {
+    if (corr->mask & SWEEP_APPLY_CALIBRATION)
+      apply_ch0_error_term(data, cal);
+    if (corr->mask & SWEEP_APPLY_EDELAY_S11) {
+      edelay_rotation(ph, corr->edelay_s11, corr->freq_step, idx, frequency);
+      apply_edelay(ph->rot, &data[0]);
+    }
+  } else {
+    if (corr->mask & SWEEP_APPLY_CALIBRATION)
+      apply_ch1_error_term(data, cal, corr->enhanced_response);
+    if (corr->mask & SWEEP_APPLY_EDELAY_S21) {
+      edelay_rotation(ph, corr->edelay_s21, corr->freq_step, idx, frequency);
+      apply_edelay(ph->rot, &data[2]);
+    }
+    if (corr->mask & SWEEP_APPLY_S21_OFFSET)
+      apply_offset(&data[2], corr->s21_gain);
+  }
+}
+
+#define SWEEP_BOTH_CHANNELS (SWEEP_CH0_MEASURE | SWEEP_CH1_MEASURE)
+
+static inline bool sweep_order_split(uint16_t mask) {
+  return (mask & SWEEP_CHANNEL_MAJOR) && (mask & SWEEP_BOTH_CHANNELS) == SWEEP_BOTH_CHANNELS;
+}
+
+uint8_t sweep_order_pass_count(uint16_t mask) {
+  return sweep_order_split(mask) ? 2U : 1U;
+}
+
+uint16_t sweep_order_pass_mask(uint16_t mask, uint8_t pass) {
+  if (!sweep_order_split(mask)) {
+    return mask;
+  }
+  return (uint16_t)(mask & ~(pass == 0U ? SWEEP_CH1_MEASURE : SWEEP_CH0_MEASURE));
+}
@@ -83,4 +83,8 @@ void measurement_engine_tick(measurement_engine_t* engine) {
     measurement_engine_result_t result = {.sweep_mask = mask, .completed = completed};
     engine->port->handle_result(engine->port, &result);
   }
+  if (completed) {
+    // After result handling, so readers get post-processed (time domain) data
+    sweep_service_publish_snapshot();
+  }
 }
@@ -38,18 +38,14 @@ uint16_t measurement_pipeline_active_mask(measurement_pipeline_t* pipeline) {
   return app_measurement_get_sweep_mask();
 }
 
-bool measurement_pipeline_execute(measurement_pipeline_t* pipeline, bool break_on_operation,
-                                  uint16_t channel_mask) {
-  (void)pipeline;
-  bool res = app_measurement_sweep(break_on_operation, channel_mask);
-
+static void measurement_pipeline_renormalize(uint16_t channel_mask, uint16_t first) {
 #ifdef __VNA_Z_RENORMALIZATION__
-  if (res && current_props._portz != 50.0f && current_props._portz > 1.0f) {
+  if (current_props._portz != 50.0f && current_props._portz > 1.0f) {
      float k = (current_props._portz - 50.0f) / (current_props._portz + 50.0f);
      uint16_t count = sweep_points;
      // Only renormalize CH0 (S11)
      if (channel_mask & 1) {
-       for (uint16_t i = 0; i < count; i++) {
+       for (uint16_t i = first; i < count; i++) {
          float re = measured[0][i][0];
          float im = measured[0][i][1];
          
@@ -70,6 +66,29 @@ bool measurement_pipeline_execute(measurement_pipeline_t* pipeline, bool break_o
        }
      }
   }
+#else
+  (void)channel_mask;
+  (void)first;
 #endif
+}
+
+bool measurement_pipeline_execute(measurement_pipeline_t* pipeline, bool break_on_operation,
+                                  uint16_t channel_mask) {
+  (void)pipeline;
+  bool res = app_measurement_sweep(break_on_operation, channel_mask);
+  if (res) {
+    measurement_pipeline_renormalize(channel_mask, 0);
+  }
+  return res;
+}
 
-  return res;}
+bool measurement_pipeline_recorrect(measurement_pipeline_t* pipeline, uint16_t channel_mask) {
+  (void)pipeline;
+  uint16_t unfinished = 0;
+  if (!app_measurement_recorrect(channel_mask, &unfinished)) {
+    return false;
+  }
+  // Points of an unfinished sweep get renormalized when that sweep completes
+  measurement_pipeline_renormalize(channel_mask, unfinished);
+  return true;
+}
@@ -21,6 +21,10 @@
 #pragma GCC optimize("O2")
 
 #include "rf/sweep.h"
+#include "rf/correction.h"
+#include "rf/sweep_segments.h"
+#include "rf/trace_average.h"
+#include "rf/sweep_profile.h"
 
 #include "hal.h"
 #include "driver/si5351.h"
@@ -36,8 +40,25 @@
  */
 static systime_t ready_time = 0;
 static volatile uint16_t wait_count = 0;
+static volatile uint16_t capture_bandwidth = 0; // config._bandwidth units of the running capture
 static alignas(8) audio_sample_t rx_buffer[AUDIO_BUFFER_LEN * 2];
 
+/*
+ * Deferred DSP worker. The I2S ISR only posts the index of the filled
+ * half-buffer, the worker correlates it while DMA fills the other half.
+ */
+#define DSP_JOB_NONE 0x00U
+#define DSP_JOB_HALF_MASK 0x01U
+#define DSP_JOB_READY 0x02U
+#define DSP_JOB_RESET 0x04U
+static volatile uint8_t dsp_job = DSP_JOB_NONE;
+static volatile bool dsp_busy = false;
+static volatile uint32_t dsp_overrun_count = 0;
+static volatile uint32_t dsp_job_overruns = 0; // dsp_overrun_count when the job was posted
+static thread_reference_t dsp_worker_ref = NULL;
+static thread_t* dsp_worker_thread = NULL;
+static THD_WORKING_AREA(waDspWorker, 160);
+
 #if ENABLED_DUMP_COMMAND
 static audio_sample_t* dump_buffer = NULL;
 static volatile int16_t dump_len = 0;
@@ -50,13 +71,56 @@ static int16_t dump_selection = 0;
 static volatile bool sweep_in_progress = false;
 static volatile bool sweep_copy_in_progress = false;
 static volatile uint32_t sweep_generation = 0;
+
+#ifdef __USE_MEASURED_SNAPSHOT__
+/*
+ * Published copies of complete sweeps for readers outside the sweep thread.
+ * Readers pin the front buffer until release, the sweep copies into the back
+ * one and makes it the front. A pinned buffer is never written: while the
+ * back one is still pinned by a reader of an older front the publication is
+ * skipped. Neither side ever waits for the other.
+ */
+typedef struct {
+  uint16_t points;  // 0 - nothing published yet
+  uint8_t readers;  // acquired and not yet released
+  uint32_t generation;
+} snapshot_buffer_t;
+static alignas(8) float measured_snapshot[2][2][SWEEP_POINTS_MAX][2];
+static snapshot_buffer_t snapshot_buffer[2];
+static uint8_t snapshot_front = 0;
+#endif
 static uint16_t p_sweep = 0;
+static uint8_t p_pass = 0;   // Channel pass index in channel-major order
+// Points of the synthesizer band the channel-major passes run over, all points otherwise
+static uint16_t p_segment = 0;
+static uint16_t p_segment_end = 0;
 static uint8_t sweep_state_flags = 0;
 static volatile bool sweep_cancel_request = false;
 static event_bus_t* sweep_event_bus = NULL;
 
 static uint8_t smooth_factor = 0;
+static uint16_t sweep_mode_mask = 0;
+#ifdef __USE_TRACE_AVERAGE__
+// Running mean of the complete sweeps since the last restart (see measurement_data_average)
+static alignas(8) float average_acc[2][SWEEP_POINTS_MAX][2];
+static trace_average_t trace_average;
+#endif
 static void (*volatile sample_func)(float* gamma) = NULL;
+static sweep_point_callback_t point_callback = NULL;
+
+#ifdef __USE_ADAPTIVE_IFBW__
+// Buffers needed before the variance estimate is trusted
+#define ADAPTIVE_IFBW_MIN_COUNT 4U
+// Relative variance of the mean that ends the capture (default 1e-4, -40 dB)
+static float adaptive_target = 1e-4f;
+// Buffers averaged on the last sweep per channel and point (up to 512 at the
+// narrowest IFBW). F303 keeps them in CCM after measured[], zeroed on init
+#if defined(NANOVNA_F303)
+static uint16_t if_counts[2][SWEEP_POINTS_MAX] __attribute__((section(".ccm")));
+#else
+static uint16_t if_counts[2][SWEEP_POINTS_MAX];
+#endif
+#endif
 
 void sweep_service_set_sample_function(void (*func)(float*)) {
   if (func == NULL) {
@@ -67,6 +131,10 @@ void sweep_service_set_sample_function(void (*func)(float*)) {
   osalSysUnlock();
 }
 
+void sweep_service_set_point_callback(sweep_point_callback_t callback) {
+  point_callback = callback;
+}
+
 void sweep_service_cancel_scan(void) {
   sweep_cancel_request = true;
 }
@@ -75,6 +143,59 @@ static inline bool sweep_ui_input_pending(void) {
   return sweep_cancel_request;
 }
 
+// Bumped on every frequency set change, keys the cached interpolation plan
+static uint32_t sweep_freq_generation = 0;
+
+#ifdef __USE_RAW_SWEEP_DATA__
+/*
+ * Uncorrected samples of the last sweep. Complete channels (raw_complete_mask)
+ * for the frequency set raw_freq_generation can be corrected again without a
+ * new sweep when calibration, edelay, S21 offset or port-Z settings change.
+ */
+static alignas(8) float raw_measured[2][SWEEP_POINTS_MAX][2];
+static uint32_t raw_freq_generation = 0;
+static uint8_t raw_complete_mask = 0;
+#endif
+static volatile bool recorrection_request = false;
+#ifdef __USE_TRACE_AVERAGE__
+// Bumped on every correction settings change, restarts the trace average
+static uint32_t correction_generation = 0;
+#endif
+
+/*
+ * Segmented stimulus. While active, frequency0/frequency1/sweep_points hold
+ * the segment range and total points; a linear range that differs from them
+ * (new start/stop/points, scan) switches back to the linear sweep.
+ */
+static sweep_segment_table_t sweep_segments;
+static bool segments_active = false;
+static bool segments_uniform = true;
+static freq_t segments_start, segments_stop;
+// Linear sweep restored by sweep_service_segments_enable(false)
+static freq_t linear_frequency0, linear_frequency1;
+static uint16_t linear_points;
+
+// Output power and IF bandwidth of a sweep point (segment settings or the global ones)
+static uint8_t sweep_point_power(uint16_t point) {
+  if (segments_active) {
+    uint8_t power = sweep_segments.seg[sweep_segments_find(&sweep_segments, point)].power;
+    if (power != SWEEP_SEGMENT_POWER_GLOBAL)
+      return power;
+  }
+  return current_props._power;
+}
+
+static uint16_t sweep_point_bandwidth(uint16_t point) {
+  if (segments_active) {
+    uint16_t bw = sweep_segments.seg[sweep_segments_find(&sweep_segments, point)].bandwidth;
+    if (bw != SWEEP_SEGMENT_BW_GLOBAL)
+      return bw;
+  }
+  return config._bandwidth;
+}
+
+static int sweep_set_frequency(freq_t freq, uint8_t power);
+
 #ifdef __USE_FREQ_TABLE__
 static freq_t frequencies[SWEEP_POINTS_MAX];
 #else
@@ -127,18 +248,60 @@ typedef struct {
   freq_t frequency;
   int delay;
   int st_delay;
-  int interpolation_idx;
+  bool cal_plan_ready; // Interpolated terms come from the cached plan
   uint8_t total_cycles;
   uint8_t current_cycle;
   uint8_t channel_index;
+  bool last_capture;   // Current capture closes the point (final cycle, last channel)
+  uint16_t sweep_mask; // Mask requested by the caller, ctx.mask is the current pass subset
+  uint8_t selected_channel; // Codec input already selected (channel-major order only)
+  
+  // Pipelined setup state (SWEEP_PIPELINE_SETUP)
+  bool next_prepared;  // Generator and cal terms for p_sweep + 1 already issued
+  bool cal_ready;      // sweep_cal_data[cal_slot] already holds terms for this point
+  uint8_t cal_slot;    // Active slot in sweep_cal_data, the other one is being prefetched
+  uint8_t next_cycles;
+  int next_delay;
+  freq_t next_frequency;
+  systime_t freq_set_time; // When the generator was programmed for the current point
   
   // Processing state
-  float offset;
+  sweep_correction_t correction;
   float sweep_data[4]; // S11 real, S11 imag, S21 real, S21 imag
 } rf_fsm_context_t;
 
+/*
+ * Accumulated time spent in every FSM state (in system ticks). The overlap
+ * counter holds the generator settling time that was hidden behind the
+ * previous point processing when the pipelined setup is active.
+ */
+static sweep_service_timing_t sweep_timing;
+// Cycle timing of every state run, per generator band
+static sweep_profile_t sweep_profile;
+
 static inline void sweep_reset_progress(void) {
   p_sweep = 0;
+  p_pass = 0;
+  p_segment = 0;
+  p_segment_end = 0;
+}
+
+/*
+ * End of the points from first on that share its synthesizer band. Channel-
+ * major order runs both channel passes over these points before it goes on,
+ * so a band change (PLL reset) is crossed once per sweep as in the default
+ * order, not once per pass.
+ */
+static uint16_t sweep_order_segment_end(uint16_t first, uint8_t passes) {
+  if (passes < 2U) {
+    return sweep_points;
+  }
+  uint8_t band = si5351_get_frequency_band(get_frequency(first));
+  uint16_t end = first + 1U;
+  while (end < sweep_points && si5351_get_frequency_band(get_frequency(end)) == band) {
+    end++;
+  }
+  return end;
 }
 
 static inline bool sweep_progress_enabled(void) {
@@ -214,20 +377,72 @@ static inline void sweep_prepare_led_and_progress(bool show_progress) {
   sweep_progress_begin(show_progress);
 }
 
-static void apply_edelay(float w, float data[2]) {
-  float s, c;
-  float real = data[0];
-  float imag = data[1];
-  vna_sincosf(w, &s, &c);
-  data[0] = real * c - imag * s;
-  data[1] = imag * c + real * s;
+static inline void sweep_profile_stamp(sweep_profile_stamp_t* stamp) {
+  stamp->ticks = chVTGetSystemTimeX();
+  stamp->cycles = cycle_counter_read();
 }
 
-static void apply_offset(float data[2], float offset) {
-  data[0] *= offset;
-  data[1] *= offset;
+static void sweep_timing_account(rf_state_t state, const sweep_profile_stamp_t* start) {
+  sweep_profile_stamp_t end;
+  sweep_profile_stamp(&end);
+  uint32_t ticks = end.ticks - start->ticks;
+  // SWEEP_PROFILE_* follow rf_state_t, IDLE and FAULT fall out of range and are dropped.
+  // Band is the one the generator is on when the state ends (a band switch is charged to the new band)
+  sweep_profile_add(&sweep_profile, (uint8_t)(state - RF_STATE_SETUP_FREQ), si5351_get_band(),
+                    sweep_profile_elapsed(&sweep_profile, start, &end));
+  switch (state) {
+  case RF_STATE_SETUP_FREQ:    sweep_timing.setup_freq    += ticks; break;
+  case RF_STATE_SETUP_MEASURE: sweep_timing.setup_measure += ticks; break;
+  case RF_STATE_WAIT_CAPTURE:  sweep_timing.wait_capture  += ticks; break;
+  case RF_STATE_PROCESS:       sweep_timing.process       += ticks; break;
+  default: break;
+  }
 }
 
+void sweep_service_get_timing(sweep_service_timing_t* timing) {
+  if (timing != NULL) {
+    *timing = sweep_timing;
+  }
+}
+
+void sweep_service_reset_timing(void) {
+  memset(&sweep_timing, 0, sizeof(sweep_timing));
+  sweep_profile_init(&sweep_profile, CYCLE_COUNTER_FREQ, CYCLE_COUNTER_MASK, CH_CFG_ST_FREQUENCY);
+}
+
+const sweep_profile_t* sweep_service_get_profile(void) {
+  return &sweep_profile;
+}
+
+void sweep_service_set_mode(uint16_t mode, bool enable) {
+  mode &= SWEEP_MODE_MASK;
+  if (enable) {
+    sweep_mode_mask |= mode;
+  } else {
+    sweep_mode_mask &= (uint16_t)~mode;
+  }
+}
+
+uint16_t sweep_service_get_mode(void) {
+  return sweep_mode_mask;
+}
+
+#ifdef __USE_ADAPTIVE_IFBW__
+void sweep_service_set_adaptive_target(float target) {
+  adaptive_target = target;
+}
+
+float sweep_service_get_adaptive_target(void) {
+  return adaptive_target;
+}
+
+uint16_t sweep_service_if_count(uint8_t channel, uint16_t point) {
+  if (channel > 1U || point >= SWEEP_POINTS_MAX)
+    return 0;
+  return if_counts[channel][point];
+}
+#endif
+
 #if ENABLED_DUMP_COMMAND
 static void duplicate_buffer_to_dump(audio_sample_t* p, size_t n) {
   p += dump_selection;
@@ -244,26 +459,83 @@ static void duplicate_buffer_to_dump(audio_sample_t* p, size_t n) {
 #endif
 
 void i2s_lld_serve_rx_interrupt(uint32_t flags) {
+  if (dsp_busy || dsp_job != DSP_JOB_NONE) {
+    // Worker is late: DMA already refills the half it is correlating. Drop
+    // this buffer and bump the counter, the worker sees the change and
+    // restarts the point instead of accumulating a torn buffer. Checked
+    // first, the last buffer of a point leaves no buffers to wait for
+    dsp_overrun_count++;
+    return;
+  }
   uint16_t wait = wait_count;
   if (wait == 0U || chVTGetSystemTimeX() < ready_time) {
     return;
   }
-  audio_sample_t* p = (flags & STM32_DMA_ISR_TCIF) ? rx_buffer + AUDIO_BUFFER_LEN : rx_buffer;
-  if (wait > config._bandwidth + 2U) {
+  if (wait > capture_bandwidth + 2U) {
     // More than expected buffers - this shouldn't happen, but handle gracefully
     --wait_count;
     return;
-  } else if (wait == config._bandwidth + 2U) {
+  }
+  uint8_t job = DSP_JOB_READY | ((flags & STM32_DMA_ISR_TCIF) ? 1U : 0U);
+  if (wait == capture_bandwidth + 2U) {
     // First buffer after reset - always reset accumulator to clear any initial noise
-    reset_dsp_accumerator();
-  } else {
-    // Process actual measurement data
-    dsp_process(p, AUDIO_BUFFER_LEN);
+    job |= DSP_JOB_RESET;
   }
+  dsp_job = job;
+  dsp_job_overruns = dsp_overrun_count;
+  --wait_count;
+  osalSysLockFromISR();
+  osalThreadResumeI(&dsp_worker_ref, MSG_OK);
+  osalSysUnlockFromISR();
+}
+
+static THD_FUNCTION(dsp_worker, arg) {
+  (void)arg;
+  chRegSetThreadName("dsp");
+  while (true) {
+    osalSysLock();
+    if (dsp_job == DSP_JOB_NONE) {
+      osalThreadSuspendS(&dsp_worker_ref);
+    }
+    uint8_t job = dsp_job;
+    uint32_t overruns = dsp_job_overruns;
+    dsp_busy = true;
+    dsp_job = DSP_JOB_NONE;
+    osalSysUnlock();
+
+    audio_sample_t* p = (job & DSP_JOB_HALF_MASK) ? rx_buffer + AUDIO_BUFFER_LEN : rx_buffer;
+    if (job & DSP_JOB_RESET) {
+      reset_dsp_accumerator();
+    } else {
+      dsp_process(p, AUDIO_BUFFER_LEN);
+      if (dsp_overrun_count != overruns) {
+        // Buffer was overwritten while correlated: discard the point, the next
+        // buffer starts it again with an accumulator reset
+        osalSysLock();
+        reset_dsp_accumerator();
+        wait_count = capture_bandwidth + 2U;
+        dsp_busy = false;
+        osalSysUnlock();
+        continue;
+      }
+#ifdef __USE_ADAPTIVE_IFBW__
+      dsp_adaptive_update();
+      if ((sweep_mode_mask & SWEEP_ADAPTIVE_IFBW) &&
+          dsp_adaptive_converged(adaptive_target, ADAPTIVE_IFBW_MIN_COUNT)) {
+        // Point already measured to the target uncertainty, skip the remaining buffers
+        wait_count = 0;
+      }
+#endif
+    }
 #if ENABLED_DUMP_COMMAND
-  duplicate_buffer_to_dump(p, AUDIO_BUFFER_LEN);
+    duplicate_buffer_to_dump(p, AUDIO_BUFFER_LEN);
 #endif
-  --wait_count;
+    dsp_busy = false;
+  }
+}
+
+uint32_t sweep_service_dsp_overruns(void) {
+  return dsp_overrun_count;
 }
 
 void sweep_service_init(event_bus_t* bus) {
@@ -275,7 +547,23 @@ void sweep_service_init(event_bus_t* bus) {
   sweep_cancel_request = false;
   sweep_event_bus = bus;
   smooth_factor = 0;
+  sweep_mode_mask = 0;
+#ifdef __USE_TRACE_AVERAGE__
+  trace_average_init(&trace_average);
+#endif
   sample_func = calculate_gamma;
+#ifdef __USE_ADAPTIVE_IFBW__
+  memset(if_counts, 0, sizeof(if_counts));
+#endif
+  sweep_service_reset_timing();
+  dsp_job = DSP_JOB_NONE;
+  dsp_busy = false;
+  dsp_overrun_count = 0;
+  dsp_job_overruns = 0;
+  if (dsp_worker_thread == NULL) {
+    dsp_worker_thread =
+        chThdCreateStatic(waDspWorker, sizeof(waDspWorker), NORMALPRIO + 2, dsp_worker, NULL);
+  }
 #if ENABLED_DUMP_COMMAND
   dump_buffer = NULL;
   dump_len = 0;
@@ -339,10 +627,63 @@ void sweep_service_wait_for_generation(void) {
   }
 }
 
+#ifdef __USE_MEASURED_SNAPSHOT__
+void sweep_service_publish_snapshot(void) {
+  osalSysLock();
+  uint8_t back = snapshot_front ^ 1U;
+  bool pinned = snapshot_buffer[back].readers != 0U;
+  osalSysUnlock();
+  if (pinned) {
+    return;
+  }
+  // Readers only pin the front, nobody can take the back buffer while it is copied
+  uint16_t points = sweep_points;
+  memcpy(measured_snapshot[back][0], measured[0], points * sizeof(measured[0][0]));
+  memcpy(measured_snapshot[back][1], measured[1], points * sizeof(measured[1][0]));
+  osalSysLock();
+  snapshot_buffer[back].points = points;
+  snapshot_buffer[back].generation = sweep_generation;
+  snapshot_front = back;
+  osalSysUnlock();
+}
+
+static bool sweep_snapshot_acquire_published(uint8_t channel, sweep_service_snapshot_t* snapshot) {
+  osalSysLock();
+  snapshot_buffer_t* buffer = &snapshot_buffer[snapshot_front];
+  bool published = buffer->points != 0U;
+  if (published) {
+    buffer->readers++;
+    snapshot->generation = buffer->generation;
+    snapshot->points = buffer->points;
+    snapshot->data = measured_snapshot[snapshot_front][channel];
+  }
+  osalSysUnlock();
+  return published;
+}
+
+// Published buffer holding the snapshot data, -1 for the live measured[] buffer
+static int sweep_snapshot_buffer(const sweep_service_snapshot_t* snapshot) {
+  for (int i = 0; i < 2; i++) {
+    if (snapshot->data == measured_snapshot[i][0] || snapshot->data == measured_snapshot[i][1]) {
+      return i;
+    }
+  }
+  return -1;
+}
+#else
+void sweep_service_publish_snapshot(void) {}
+#endif
+
 bool sweep_service_snapshot_acquire(uint8_t channel, sweep_service_snapshot_t* snapshot) {
   if (snapshot == NULL || channel >= 2U) {
     return false;
   }
+#ifdef __USE_MEASURED_SNAPSHOT__
+  if (sweep_snapshot_acquire_published(channel, snapshot)) {
+    return true;
+  }
+  // Nothing published yet, fall back to the live measured[] buffer
+#endif
   systime_t start_time = chVTGetSystemTimeX();
   systime_t timeout = MS2ST(2000); // 2 second timeout to prevent infinite wait
   
@@ -371,6 +712,15 @@ bool sweep_service_snapshot_acquire(uint8_t channel, sweep_service_snapshot_t* s
 bool sweep_service_snapshot_release(const sweep_service_snapshot_t* snapshot) {
   bool stable = false;
   osalSysLock();
+#ifdef __USE_MEASURED_SNAPSHOT__
+  int buffer = snapshot != NULL ? sweep_snapshot_buffer(snapshot) : -1;
+  if (buffer >= 0) {
+    // Pinned data is never overwritten
+    snapshot_buffer[buffer].readers--;
+    osalSysUnlock();
+    return true;
+  }
+#endif
   if (snapshot != NULL) {
     stable = (snapshot->generation == sweep_generation);
   }
@@ -379,15 +729,24 @@ bool sweep_service_snapshot_release(const sweep_service_snapshot_t* snapshot) {
   return stable;
 }
 
-void sweep_service_start_capture(systime_t delay_ticks) {
+static void sweep_start_capture_bw(systime_t delay_ticks, uint16_t bandwidth) {
   ready_time = chVTGetSystemTimeX() + delay_ticks;
-  wait_count = config._bandwidth + 2U;
+  capture_bandwidth = bandwidth;
+  wait_count = bandwidth + 2U;
+}
+
+void sweep_service_start_capture(systime_t delay_ticks) {
+  sweep_start_capture_bw(delay_ticks, config._bandwidth);
+}
+
+static inline bool sweep_capture_pending(void) {
+  return wait_count != 0U || dsp_job != DSP_JOB_NONE || dsp_busy;
 }
 
 bool sweep_service_wait_for_capture(void) {
   systime_t start_time = chVTGetSystemTimeX();
   systime_t timeout = MS2ST(2000); // 2000ms timeout - increased for stability
-  while (wait_count != 0U) {
+  while (sweep_capture_pending()) {
     systime_t current_time = chVTGetSystemTimeX();
     if (current_time - start_time >= timeout) {
       // Timeout occurred - break to prevent hanging
@@ -457,93 +816,57 @@ uint16_t app_measurement_get_sweep_mask(void) {
   if (s21_offset) {
     ch_mask |= SWEEP_APPLY_S21_OFFSET;
   }
+  ch_mask |= sweep_mode_mask;
   return ch_mask;
 }
 
-static void apply_ch0_error_term(float data[4], float c_data[CAL_TYPE_COUNT][2]) {
-  // S11m' = S11m - Ed
-  // S11a = S11m' / (Er + Es S11m')
-  float s11mr = data[0] - c_data[ETERM_ED][0];
-  float s11mi = data[1] - c_data[ETERM_ED][1];
-  float err = c_data[ETERM_ER][0] + s11mr * c_data[ETERM_ES][0] - s11mi * c_data[ETERM_ES][1];
-  float eri = c_data[ETERM_ER][1] + s11mr * c_data[ETERM_ES][1] + s11mi * c_data[ETERM_ES][0];
-  float sq = err*err + eri*eri;
-  if (sq != 0.0f) {
-    float inv = 1.0f / sq;
-    data[0] = (s11mr * err + s11mi * eri) * inv;
-    data[1] = (s11mi * err - s11mr * eri) * inv;
-  } else {
-    data[0] = 0.0f;
-    data[1] = 0.0f;
+static void cal_copy_terms(uint16_t idx, float data[CAL_TYPE_COUNT][2]) {
+  for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
+    data[eterm][0] = cal_data[eterm][idx][0];
+    data[eterm][1] = cal_data[eterm][idx][1];
   }
 }
 
-static void apply_ch1_error_term(float data[4], float c_data[CAL_TYPE_COUNT][2]) {
-  // CAUTION: Et is inversed for efficiency
-  // S21a = (S21m - Ex) * Et
-  float s21mr = data[2] - c_data[ETERM_EX][0];
-  float s21mi = data[3] - c_data[ETERM_EX][1];
-  // Apply transmission tracking correction (ET is inverted for efficiency)
-  data[2] = s21mr * c_data[ETERM_ET][0] - s21mi * c_data[ETERM_ET][1];
-  data[3] = s21mi * c_data[ETERM_ET][0] + s21mr * c_data[ETERM_ET][1];
-  
-  // Enhanced Response: S21a *= 1 - Es * S11a (if enabled)
-  if (cal_status & CALSTAT_ENHANCED_RESPONSE) {
-    float esr = 1.0f - (c_data[ETERM_ES][0] * data[0] - c_data[ETERM_ES][1] * data[1]);
-    float esi = 0.0f - (c_data[ETERM_ES][1] * data[0] + c_data[ETERM_ES][0] * data[1]);
-    float re = data[2];
-    float im = data[3];
-    data[2] = esr * re - esi * im;
-    data[3] = esi * re + esr * im;
+// k == 0 means a direct copy of the source point (also used at the table edges)
+static void cal_apply_weight(uint16_t idx, float k, float data[CAL_TYPE_COUNT][2]) {
+  if (k == 0.0f) {
+    cal_copy_terms(idx, data);
+    return;
+  }
+  for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
+    data[eterm][0] = cal_data[eterm][idx][0] + k * (cal_data[eterm][idx+1][0] - cal_data[eterm][idx][0]);
+    data[eterm][1] = cal_data[eterm][idx][1] + k * (cal_data[eterm][idx+1][1] - cal_data[eterm][idx][1]);
   }
 }
 
-static void cal_interpolate(int idx, freq_t f, float data[CAL_TYPE_COUNT][2]) {
+/*
+ * Find source calibration point and interpolation weight for frequency f.
+ */
+static float cal_interpolate_weight(freq_t f, uint16_t* src_idx) {
   uint16_t src_points = cal_sweep_points - 1;
-  if (idx >= 0) {
-    // Direct point copy if index provided
-    for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
-      data[eterm][0] = cal_data[eterm][idx][0];
-      data[eterm][1] = cal_data[eterm][idx][1];
-    }
-    return;
-  }
-  
   if (f <= cal_frequency0) {
-    idx = 0;
-    for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
-      data[eterm][0] = cal_data[eterm][0][0];
-      data[eterm][1] = cal_data[eterm][0][1];
-    }
-    return;
+    *src_idx = 0;
+    return 0.0f;
   }
-  
   if (f >= cal_frequency1) {
-    idx = src_points;
-    for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
-      data[eterm][0] = cal_data[eterm][src_points][0];
-      data[eterm][1] = cal_data[eterm][src_points][1];
-    }
-    return;
+    *src_idx = src_points;
+    return 0.0f;
   }
-  
+
   // Calculate k for linear interpolation
   freq_t span = cal_frequency1 - cal_frequency0;
-  idx = (uint64_t)(f - cal_frequency0) * (uint64_t)src_points / span;
+  uint32_t idx = (uint64_t)(f - cal_frequency0) * (uint64_t)src_points / span;
   uint64_t v = (uint64_t)span * idx + src_points/2;
   freq_t src_f0 = cal_frequency0 + (v       ) / src_points;
   freq_t src_f1 = cal_frequency0 + (v + span) / src_points;
-  
+
   freq_t delta = src_f1 - src_f0;
+  *src_idx = idx;
   // Not need interpolate
   if (f == src_f0) {
-    for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
-      data[eterm][0] = cal_data[eterm][idx][0];
-      data[eterm][1] = cal_data[eterm][idx][1];
-    }
-    return;
+    return 0.0f;
   }
-  
+
   float k = (delta == 0) ? 0.0f : (float)(f - src_f0) / delta;
 
   // avoid glitch between freqs in different harmonics mode
@@ -552,49 +875,123 @@ static void cal_interpolate(int idx, freq_t f, float data[CAL_TYPE_COUNT][2]) {
     // f in prev harmonic, need extrapolate from prev 2 points
     if (hf0 == si5351_get_harmonic_lvl(f)){
       if (idx < 1) {
-         // point limit, direct copy (matches copy logic above)
-        for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
-          data[eterm][0] = cal_data[eterm][idx][0];
-          data[eterm][1] = cal_data[eterm][idx][1];
-        }
-        return;
+        // point limit, direct copy
+        return 0.0f;
       }
-      idx--;
+      *src_idx = idx - 1;
       k+= 1.0f;
     }
     // f in next harmonic, need extrapolate from next 2 points
     else {
-      if (idx >= src_points - 1) {
+      if (idx >= src_points - 1U) {
         // point limit (cannot extrapolate from next), direct copy current
-        for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
-          data[eterm][0] = cal_data[eterm][idx][0];
-          data[eterm][1] = cal_data[eterm][idx][1];
-        }
-        return;
+        return 0.0f;
       }
-      idx++;
+      *src_idx = idx + 1;
       k-= 1.0f;
     }
   }
+  return k;
+}
 
-  // Interpolate by k
-  for (uint16_t eterm = 0; eterm < CAL_TYPE_COUNT; eterm++) {
-    data[eterm][0] = cal_data[eterm][idx][0] + k * (cal_data[eterm][idx+1][0] - cal_data[eterm][idx][0]);
-    data[eterm][1] = cal_data[eterm][idx][1] + k * (cal_data[eterm][idx+1][1] - cal_data[eterm][idx][1]);
+static void cal_interpolate(freq_t f, float data[CAL_TYPE_COUNT][2]) {
+  uint16_t src_idx;
+  float k = cal_interpolate_weight(f, &src_idx);
+  cal_apply_weight(src_idx, k, data);
+}
+
+#ifdef __USE_CAL_INTERP_PLAN__
+/*
+ * Interpolation plan: source index and weight for every sweep point. Built on
+ * the first interpolated sweep after the frequency set, the calibration range
+ * or the harmonic layout changes; sweeps then only do a lookup and a lerp.
+ */
+typedef struct {
+  uint32_t freq_generation;
+  freq_t cal_f0;
+  freq_t cal_f1;
+  uint32_t threshold;
+  uint16_t cal_points;
+  uint16_t points;
+  uint16_t band_mode;
+} cal_plan_key_t;
+
+static uint16_t cal_plan_idx[SWEEP_POINTS_MAX];
+static float cal_plan_k[SWEEP_POINTS_MAX];
+static cal_plan_key_t cal_plan_key;
+static bool cal_plan_valid = false;
+
+static bool cal_plan_prepare(void) {
+  cal_plan_key_t key;
+  memset(&key, 0, sizeof(key));
+  key.freq_generation = sweep_freq_generation;
+  key.cal_f0 = cal_frequency0;
+  key.cal_f1 = cal_frequency1;
+  key.threshold = config._harmonic_freq_threshold;
+  key.cal_points = cal_sweep_points;
+  key.points = sweep_points;
+  key.band_mode = config._band_mode;
+  if (cal_plan_valid && memcmp(&key, &cal_plan_key, sizeof(key)) == 0) {
+    return true;
+  }
+  if (key.cal_points == 0U || key.points > SWEEP_POINTS_MAX) {
+    cal_plan_valid = false;
+    return false;
   }
+  for (uint16_t i = 0; i < key.points; i++) {
+    cal_plan_k[i] = cal_interpolate_weight(get_frequency(i), &cal_plan_idx[i]);
+  }
+  cal_plan_key = key;
+  cal_plan_valid = true;
+  return true;
 }
+#endif
 
 // Static buffers to reduce stack usage in app_measurement_sweep
-static float sweep_cal_data[CAL_TYPE_COUNT][2];
+// Two slots: the pipelined setup interpolates terms for the next point while
+// the current one is still being corrected
+static float sweep_cal_data[2][CAL_TYPE_COUNT][2];
 // FSM State Handlers
 
+static void sweep_cal_terms(const rf_fsm_context_t* ctx, uint16_t point, freq_t f,
+                            float data[CAL_TYPE_COUNT][2]) {
+  if ((ctx->mask & SWEEP_USE_INTERPOLATION) == 0U) {
+    cal_copy_terms(point, data);
+    return;
+  }
+#ifdef __USE_CAL_INTERP_PLAN__
+  if (ctx->cal_plan_ready) {
+    cal_apply_weight(cal_plan_idx[point], cal_plan_k[point], data);
+    return;
+  }
+#endif
+  cal_interpolate(f, data);
+}
+
 static void fsm_setup_freq(rf_fsm_context_t* ctx) {
-  ctx->frequency = get_frequency(p_sweep);
   uint8_t extra_cycles = 0U;
-  if (ctx->mask & (SWEEP_CH0_MEASURE | SWEEP_CH1_MEASURE)) {
-    ctx->delay = app_measurement_set_frequency(ctx->frequency);
-    ctx->interpolation_idx = (ctx->mask & SWEEP_USE_INTERPOLATION) ? -1 : (int)p_sweep;
-    extra_cycles = si5351_take_settling_cycles();
+  if (ctx->next_prepared) {
+    // Generator and calibration terms already issued while the previous point was processed
+    ctx->next_prepared = false;
+    ctx->frequency = ctx->next_frequency;
+    ctx->delay = ctx->next_delay;
+    ctx->cal_slot ^= 1U;
+    ctx->cal_ready = (ctx->mask & SWEEP_APPLY_CALIBRATION) != 0U;
+    extra_cycles = ctx->next_cycles;
+  } else {
+    ctx->frequency = get_frequency(p_sweep);
+    ctx->cal_ready = false;
+    if (ctx->mask & (SWEEP_CH0_MEASURE | SWEEP_CH1_MEASURE)) {
+      ctx->delay = sweep_set_frequency(ctx->frequency, sweep_point_power(p_sweep));
+      si5351_flush();
+      ctx->freq_set_time = chVTGetSystemTimeX();
+      extra_cycles = si5351_take_settling_cycles();
+    }
+  }
+  if (p_pass != 0U) {
+    // Channel 1 pass: enhanced response needs the corrected S11 of this point
+    ctx->sweep_data[0] = measured[0][p_sweep][0];
+    ctx->sweep_data[1] = measured[0][p_sweep][1];
   }
   ctx->total_cycles = extra_cycles + 1U;
   ctx->current_cycle = 0;
@@ -602,6 +999,30 @@ static void fsm_setup_freq(rf_fsm_context_t* ctx) {
   ctx->state = RF_STATE_SETUP_MEASURE;
 }
 
+/*
+ * Pipelined setup: the capture of the current point is closed, so program the
+ * generator for the next point and interpolate its calibration terms before the
+ * current point is corrected. The register writes are queued, so the bus shifts
+ * them out while the terms are interpolated; PLL settling then runs in parallel
+ * with fsm_process().
+ */
+static void fsm_prefetch_next(rf_fsm_context_t* ctx) {
+  uint16_t next = p_sweep + 1U;
+  if (next >= p_segment_end || ctx->processed + 1U >= ctx->batch_budget) {
+    return;
+  }
+  ctx->next_frequency = get_frequency(next);
+  ctx->next_delay = sweep_set_frequency(ctx->next_frequency, sweep_point_power(next));
+  ctx->next_cycles = si5351_take_settling_cycles();
+  if (ctx->mask & SWEEP_APPLY_CALIBRATION) {
+    sweep_cal_terms(ctx, next, ctx->next_frequency, sweep_cal_data[ctx->cal_slot ^ 1U]);
+  }
+  // Settling counts from the registers on the chip
+  si5351_flush();
+  ctx->freq_set_time = chVTGetSystemTimeX();
+  ctx->next_prepared = true;
+}
+
 static void fsm_setup_measure(rf_fsm_context_t* ctx) {
   if (ctx->current_cycle >= ctx->total_cycles) {
     ctx->state = RF_STATE_NEXT_STEP;
@@ -618,20 +1039,44 @@ static void fsm_setup_measure(rf_fsm_context_t* ctx) {
      return;
   }
   
-  tlv320aic3204_select(ctx->channel_index);
+  if (ctx->selected_channel != ctx->channel_index) {
+    tlv320aic3204_select(ctx->channel_index);
+    if (ctx->sweep_mask & SWEEP_CHANNEL_MAJOR) {
+      // Input stays selected for the whole pass, pay the mux settling once
+      ctx->selected_channel = ctx->channel_index;
+      if (ctx->delay < (int)DELAY_CHANNEL_CHANGE)
+        ctx->delay = (int)DELAY_CHANNEL_CHANGE;
+    }
+  }
   
   int cycle_delay = ctx->delay;
   int cycle_st_delay = (ctx->current_cycle == 0U) ? ctx->st_delay : 0;
   
   if (ctx->channel_index == 1 && (ctx->mask & SWEEP_CH0_MEASURE)) {
      cycle_delay = DELAY_CHANNEL_CHANGE;
+  } else if ((ctx->mask & SWEEP_PIPELINE_SETUP) && ctx->current_cycle == 0U) {
+     // Generator settling already elapsed partially while the previous point was processed
+     systime_t elapsed = chVTTimeElapsedSinceX(ctx->freq_set_time);
+     if (elapsed >= (systime_t)cycle_delay) {
+       sweep_timing.overlap += (uint32_t)cycle_delay;
+       cycle_delay = 0;
+     } else {
+       sweep_timing.overlap += elapsed;
+       cycle_delay -= (int)elapsed;
+     }
   }
   
-  sweep_service_start_capture(cycle_delay + cycle_st_delay);
+  sweep_start_capture_bw(cycle_delay + cycle_st_delay, sweep_point_bandwidth(p_sweep));
   
   bool final_cycle = (ctx->current_cycle == ctx->total_cycles - 1U);
-  if (final_cycle && (ctx->mask & SWEEP_APPLY_CALIBRATION)) {
-     cal_interpolate(ctx->interpolation_idx, ctx->frequency, sweep_cal_data); 
+  if (final_cycle && (ctx->mask & SWEEP_APPLY_CALIBRATION) && !ctx->cal_ready) {
+     sweep_cal_terms(ctx, p_sweep, ctx->frequency, sweep_cal_data[ctx->cal_slot]);
+  }
+  ctx->last_capture = final_cycle &&
+                      (ctx->channel_index == 1 || (ctx->mask & SWEEP_CH1_MEASURE) == 0U);
+  if (ctx->last_capture && p_sweep + 1U < p_segment_end) {
+     // Synthesizer registers of the next point are computed while this capture runs
+     si5351_prepare_frequency(get_frequency(p_sweep + 1U));
   }
 
   ctx->state = RF_STATE_WAIT_CAPTURE;
@@ -645,51 +1090,79 @@ static void fsm_process(rf_fsm_context_t* ctx) {
     sample_cb(&ctx->sweep_data[data_idx]);
     
     if (final_cycle) {
-        if (ctx->mask & SWEEP_APPLY_CALIBRATION) {
-            if (ctx->channel_index == 0)
-                apply_ch0_error_term(ctx->sweep_data, sweep_cal_data);
-            else {
-                apply_ch1_error_term(ctx->sweep_data, sweep_cal_data);
-            }
+#ifdef __USE_RAW_SWEEP_DATA__
+        if (raw_freq_generation != sweep_freq_generation) {
+            raw_freq_generation = sweep_freq_generation;
+            raw_complete_mask = 0;
         }
-        
-        if (ctx->channel_index == 0) {
-            if (ctx->mask & SWEEP_APPLY_EDELAY_S11)
-                apply_edelay(electrical_delayS11 * ctx->frequency, &ctx->sweep_data[0]);
-        } else {
-            if (ctx->mask & SWEEP_APPLY_EDELAY_S21)
-                apply_edelay(electrical_delayS21 * ctx->frequency, &ctx->sweep_data[2]);
-            if (ctx->mask & SWEEP_APPLY_S21_OFFSET)
-                apply_offset(&ctx->sweep_data[2], ctx->offset);
-        }
-
+        raw_measured[ctx->channel_index][p_sweep][0] = ctx->sweep_data[data_idx];
+        raw_measured[ctx->channel_index][p_sweep][1] = ctx->sweep_data[data_idx+1];
+#endif
+        sweep_correct_channel(&ctx->correction, ctx->channel_index, p_sweep, ctx->frequency,
+                              ctx->sweep_data, sweep_cal_data[ctx->cal_slot]);
         measured[ctx->channel_index][p_sweep][0] = ctx->sweep_data[data_idx];
         measured[ctx->channel_index][p_sweep][1] = ctx->sweep_data[data_idx+1];
+#ifdef __USE_ADAPTIVE_IFBW__
+        uint16_t count = dsp_adaptive_count();
+        if_counts[ctx->channel_index][p_sweep] = count;
+#endif
     }
 
     ctx->channel_index++;
     ctx->state = RF_STATE_SETUP_MEASURE;
 }
 
+/*
+ * Capture the correction settings for one sweep call. The electrical delay
+ * phasor steps by the exact (fractional) linear step, segmented sweeps are
+ * not uniform and evaluate it at every point.
+ */
+static void sweep_correction_setup(sweep_correction_t* corr, uint16_t mask) {
+  float s21_gain = 1.0f;
+  if (mask & SWEEP_APPLY_S21_OFFSET) {
+    s21_gain = vna_expf(s21_offset * (logf(10.0f) / 20.0f));
+  }
+  float freq_step = 0.0f;
+  if (!segments_active && sweep_points > 1U) {
+    freq_t steps = sweep_points - 1U;
+    freq_t span = get_frequency(steps) - get_frequency(0);
+    freq_step = (float)(span / steps) + (float)(span % steps) / (float)steps;
+  }
+  sweep_correction_init(corr, mask, (cal_status & CALSTAT_ENHANCED_RESPONSE) != 0U,
+                        electrical_delayS11, electrical_delayS21, s21_gain, freq_step);
+}
+
 bool app_measurement_sweep(bool break_on_operation, uint16_t mask) {
   rf_fsm_context_t ctx;
   ctx.state = RF_STATE_SETUP_FREQ;
   ctx.break_on_operation = break_on_operation;
-  ctx.mask = mask;
+  ctx.sweep_mask = mask;
   ctx.batch_budget = sweep_points_budget(break_on_operation);
   ctx.processed = 0;
   ctx.slice_start = break_on_operation ? chVTGetSystemTimeX() : 0;
-  ctx.offset = 1.0f;
   ctx.channel_index = 0;
+  ctx.selected_channel = 0xFFU;
+  ctx.last_capture = false;
+  ctx.next_prepared = false;
+  ctx.cal_ready = false;
+  ctx.cal_slot = 0;
+  ctx.freq_set_time = chVTGetSystemTimeX();
   
-  if (mask & SWEEP_APPLY_S21_OFFSET) {
-     ctx.offset = vna_expf(s21_offset * (logf(10.0f) / 20.0f));
+  sweep_correction_setup(&ctx.correction, mask);
+  uint8_t passes = sweep_order_pass_count(mask);
+  ctx.cal_plan_ready = false;
+#ifdef __USE_CAL_INTERP_PLAN__
+  if ((mask & (SWEEP_APPLY_CALIBRATION | SWEEP_USE_INTERPOLATION)) ==
+      (SWEEP_APPLY_CALIBRATION | SWEEP_USE_INTERPOLATION)) {
+    ctx.cal_plan_ready = cal_plan_prepare();
   }
+#endif
   
   sweep_in_progress = true;
   sweep_service_wait_for_copy_release();
   
-  if (p_sweep >= sweep_points || !break_on_operation) {
+  if ((p_sweep >= sweep_points && p_pass + 1U >= passes) || p_pass >= passes ||
+      !break_on_operation) {
     sweep_reset_progress();
     sweep_progress_end();
     sweep_led_end();
@@ -699,13 +1172,34 @@ bool app_measurement_sweep(bool break_on_operation, uint16_t mask) {
      goto exit_failure;
   }
 
-  if (p_sweep == 0U) {
+  ctx.mask = sweep_order_pass_mask(mask, p_pass);
+
+  if (p_sweep == 0U && p_pass == 0U) {
+    p_segment_end = sweep_order_segment_end(0, passes);
     sweep_prepare_led_and_progress(config._bandwidth >= BANDWIDTH_100);
   }
 
   while (ctx.state != RF_STATE_IDLE && ctx.state != RF_STATE_FAULT) {
+     rf_state_t timed_state = ctx.state;
+     sweep_profile_stamp_t state_start;
+     sweep_profile_stamp(&state_start);
      switch (ctx.state) {
         case RF_STATE_SETUP_FREQ:
+           if (p_sweep >= p_segment_end && passes > 1U &&
+               (p_pass == 0U || p_sweep < sweep_points)) {
+               // Channel-major order: first channel of the band done, restart its points for
+               // the next one, or go on with the first channel of the next band
+               if (p_pass == 0U) {
+                   p_pass = 1;
+                   p_sweep = p_segment;
+               } else {
+                   p_pass = 0;
+                   p_segment = p_sweep;
+                   p_segment_end = sweep_order_segment_end(p_sweep, passes);
+               }
+               ctx.mask = sweep_order_pass_mask(mask, p_pass);
+               ctx.channel_index = 0;
+           }
            if (ctx.processed >= ctx.batch_budget || 
               (break_on_operation && sweep_ui_input_pending()) ||
               sweep_timeslice_expired(ctx.slice_start)) {
@@ -727,6 +1221,9 @@ bool app_measurement_sweep(bool break_on_operation, uint16_t mask) {
            if (!sweep_service_wait_for_capture()) {
                ctx.state = RF_STATE_FAULT;
            } else {
+               if (ctx.last_capture && (ctx.mask & SWEEP_PIPELINE_SETUP)) {
+                   fsm_prefetch_next(&ctx);
+               }
                ctx.state = RF_STATE_PROCESS;
            }
            break;
@@ -737,15 +1234,23 @@ bool app_measurement_sweep(bool break_on_operation, uint16_t mask) {
            
         case RF_STATE_NEXT_STEP:
             if (config._bandwidth >= BANDWIDTH_100 && sweep_points > 1U) {
-                 uint16_t current_bar = (uint16_t)(((uint32_t)p_sweep * WIDTH) / (sweep_points - 1U));
-                sweep_progress_update(current_bar);
+                uint32_t total = (uint32_t)passes * sweep_points - 1U;
+                // Channel-major order: both passes of the bands before are done
+                uint32_t done = p_sweep;
+                if (passes > 1U)
+                    done += (p_pass != 0U) ? p_segment_end : p_segment;
+                sweep_progress_update((uint16_t)((done * WIDTH) / total));
             }
             #ifndef NANOVNA_HOST_TEST
             wdgReset(&WDGD1);
             #endif
             
+            if (point_callback != NULL && p_pass + 1U >= passes) {
+                point_callback(p_sweep);
+            }
             p_sweep++;
             ctx.processed++;
+            sweep_timing.points++;
             ctx.state = RF_STATE_SETUP_FREQ;
             break;
             
@@ -756,6 +1261,7 @@ bool app_measurement_sweep(bool break_on_operation, uint16_t mask) {
             ctx.state = RF_STATE_FAULT;
             break;
      }
+     sweep_timing_account(timed_state, &state_start);
   }
 
 exit_loop:
@@ -763,8 +1269,12 @@ exit_loop:
       goto exit_failure;
   }
   
-  bool completed = (p_sweep >= sweep_points);
+  bool completed = (p_sweep >= sweep_points) && (p_pass + 1U >= passes);
   if (completed) {
+#ifdef __USE_RAW_SWEEP_DATA__
+      if (raw_freq_generation == sweep_freq_generation)
+          raw_complete_mask |= (uint8_t)(mask & (SWEEP_CH0_MEASURE | SWEEP_CH1_MEASURE));
+#endif
       sweep_progress_end();
       sweep_led_end();
   }
@@ -785,6 +1295,91 @@ void sweep_wait_for_idle(void) {
   }
 }
 
+bool app_measurement_sweep_settled(uint16_t mask) {
+  // measured[] holds no partially measured sweep
+  return (p_sweep == 0U && p_pass == 0U) ||
+         (p_sweep >= sweep_points && p_pass + 1U >= sweep_order_pass_count(mask));
+}
+
+void app_measurement_request_recorrection(void) {
+  recorrection_request = true;
+#ifdef __USE_TRACE_AVERAGE__
+  correction_generation++;
+#endif
+}
+
+bool app_measurement_recorrection_pending(void) {
+  return recorrection_request;
+}
+
+/*
+ * Recompute measured[] from raw_measured[] with the current correction
+ * settings. *unfinished_points receives the number of leading channel 0 points
+ * written by a sweep that is still in progress (the caller post-processing
+ * for those runs again on its completion).
+ */
+bool app_measurement_recorrect(uint16_t mask, uint16_t* unfinished_points) {
+  recorrection_request = false;
+  *unfinished_points = 0;
+#ifdef __USE_RAW_SWEEP_DATA__
+  if (raw_freq_generation != sweep_freq_generation) {
+    return false;
+  }
+  uint8_t channels = raw_complete_mask & (uint8_t)(mask & (SWEEP_CH0_MEASURE | SWEEP_CH1_MEASURE));
+  if (channels == 0U) {
+    return false;
+  }
+  rf_fsm_context_t ctx;
+  ctx.mask = mask;
+  ctx.cal_plan_ready = false;
+#ifdef __USE_CAL_INTERP_PLAN__
+  if ((mask & (SWEEP_APPLY_CALIBRATION | SWEEP_USE_INTERPOLATION)) ==
+      (SWEEP_APPLY_CALIBRATION | SWEEP_USE_INTERPOLATION)) {
+    ctx.cal_plan_ready = cal_plan_prepare();
+  }
+#endif
+  sweep_correction_setup(&ctx.correction, mask);
+
+  if (!app_measurement_sweep_settled(mask)) {
+    *unfinished_points = (p_pass != 0U) ? p_segment_end : p_sweep;
+  }
+  sweep_service_wait_for_copy_release();
+  sweep_in_progress = true;
+  for (uint16_t i = 0; i < sweep_points; i++) {
+    freq_t f = get_frequency(i);
+    float* data = ctx.sweep_data;
+    data[0] = raw_measured[0][i][0];
+    data[1] = raw_measured[0][i][1];
+    data[2] = raw_measured[1][i][0];
+    data[3] = raw_measured[1][i][1];
+    if (mask & SWEEP_APPLY_CALIBRATION) {
+      sweep_cal_terms(&ctx, i, f, sweep_cal_data[0]);
+    }
+    // Channel 0 first: enhanced response correction of S21 uses corrected S11
+    if (raw_complete_mask & SWEEP_CH0_MEASURE) {
+      sweep_correct_channel(&ctx.correction, 0, i, f, data, sweep_cal_data[0]);
+    } else {
+      data[0] = measured[0][i][0];
+      data[1] = measured[0][i][1];
+    }
+    if (channels & SWEEP_CH0_MEASURE) {
+      measured[0][i][0] = data[0];
+      measured[0][i][1] = data[1];
+    }
+    if (channels & SWEEP_CH1_MEASURE) {
+      sweep_correct_channel(&ctx.correction, 1, i, f, data, sweep_cal_data[0]);
+      measured[1][i][0] = data[2];
+      measured[1][i][1] = data[3];
+    }
+  }
+  sweep_in_progress = false;
+  return true;
+#else
+  (void)mask;
+  return false;
+#endif
+}
+
 void app_measurement_reset(void) {
   sweep_reset_progress();
 }
@@ -838,11 +1433,66 @@ uint8_t get_smooth_factor(void) {
   return smooth_factor;
 }
 
-int app_measurement_set_frequency(freq_t freq) {
+#ifdef __USE_TRACE_AVERAGE__
+/*
+ * Stimulus and correction a sweep was measured with: frequency set and
+ * correction generations (16 bits, only a change matters), IF bandwidth
+ * (9 bits) and output power (7 bits, auto is 0x7F).
+ */
+static uint32_t average_key(void) {
+  uint32_t generation = sweep_freq_generation + correction_generation;
+  return (generation & 0xFFFFU) | ((uint32_t)(config._bandwidth & 0x1FFU) << 16) |
+         ((uint32_t)(current_props._power & 0x7FU) << 25);
+}
+
+/*
+ * Fold the complete sweep in measured[] into the trace average and replace it
+ * with the average. Any frequency set, correction (calibration included),
+ * IF bandwidth or power change starts it again.
+ */
+bool measurement_data_average(uint16_t ch_mask) {
+  float weight;
+  osalSysLock();
+  bool active = trace_average_next(&trace_average, average_key(),
+                                   ch_mask & (uint16_t)~SWEEP_MODE_MASK, &weight);
+  bool complete = trace_average_complete(&trace_average);
+  osalSysUnlock();
+  if (!active) {
+    return false;
+  }
+  for (int ch = 0; ch < 2; ch++, ch_mask >>= 1) {
+    if (ch_mask & 1U) {
+      trace_average_fold(average_acc[ch], measured[ch], sweep_points, weight);
+    }
+  }
+  return complete;
+}
+
+bool sweep_service_set_average(uint8_t mode, uint16_t factor) {
+  osalSysLock();
+  bool ok = trace_average_configure(&trace_average, mode, factor);
+  osalSysUnlock();
+  return ok;
+}
+
+void sweep_service_restart_average(void) {
+  osalSysLock();
+  trace_average_restart(&trace_average);
+  osalSysUnlock();
+}
+
+void sweep_service_get_average(trace_average_t* state) {
+  osalSysLock();
+  *state = trace_average;
+  osalSysUnlock();
+}
+#endif
+
+static int sweep_set_frequency(freq_t freq, uint8_t power) {
   // Use dynamic delay returned by si5351_set_frequency which accounts for PLL settling time
   // Different values are returned based on frequency range changes, PLL resets, etc.
   // This ensures proper synchronization between frequency setting and measurement
-  int delay = si5351_set_frequency(freq, current_props._power);
+  int delay = si5351_set_frequency(freq, power);
   
   // Use the original delay calculation from DiSlord firmware for proper timing
   // If no specific delay returned, use default channel change delay
@@ -853,8 +1503,28 @@ int app_measurement_set_frequency(freq_t freq) {
   return delay;
 }
 
+int app_measurement_set_frequency(freq_t freq) {
+  int delay = sweep_set_frequency(freq, current_props._power);
+  si5351_flush();
+  return delay;
+}
+
+// A linear range other than the segment one leaves segment mode
+static void sweep_segments_check_linear(freq_t start, freq_t stop, uint16_t points) {
+  if (segments_active &&
+      (start != segments_start || stop != segments_stop || points != sweep_segments.points))
+    segments_active = false;
+}
+
 #ifdef __USE_FREQ_TABLE__
 void app_measurement_set_frequencies(freq_t start, freq_t stop, uint16_t points) {
+  sweep_segments_check_linear(start, stop, points);
+  if (segments_active) {
+    for (uint16_t i = 0; i < SWEEP_POINTS_MAX; i++)
+      frequencies[i] = i < points ? sweep_segments_frequency(&sweep_segments, i) : 0;
+    sweep_freq_generation++;
+    return;
+  }
   freq_t step = points - 1U;
   freq_t span = stop - start;
   freq_t delta = span / step;
@@ -872,6 +1542,7 @@ void app_measurement_set_frequencies(freq_t start, freq_t stop, uint16_t points)
   for (; i < SWEEP_POINTS_MAX; i++) {
     frequencies[i] = 0;
   }
+  sweep_freq_generation++;
 }
 
 freq_t get_frequency(uint16_t idx) {
@@ -886,137 +1557,81 @@ freq_t get_frequency_step(void) {
 }
 #else
 void app_measurement_set_frequencies(freq_t start, freq_t stop, uint16_t points) {
+  sweep_segments_check_linear(start, stop, points);
   freq_t span = stop - start;
   _f_start = start;
   _f_points = points - 1U;
   _f_delta = span / _f_points;
   _f_error = span % _f_points;
+  sweep_freq_generation++;
 }
 
 freq_t get_frequency(uint16_t idx) {
+  if (segments_active)
+    return sweep_segments_frequency(&sweep_segments, idx);
   return _f_start + _f_delta * idx + (_f_points / 2U + _f_error * idx) / _f_points;
 }
 
 freq_t get_frequency_step(void) {
+  if (segments_active) {
+    // Step of the first segment
+    const sweep_segment_t* seg = &sweep_segments.seg[0];
+    return seg->points > 1U ? (seg->stop - seg->start) / (seg->points - 1U) : 0;
+  }
   return _f_delta;
 }
 #endif
 
-float bessel_i0_ext(float z) {
-#define BESSEL_SIZE 12
-  int i = BESSEL_SIZE - 1;
-  static const float besseli0_k[BESSEL_SIZE - 1] = {
-      2.5000000000000000000000000000000e-01f, 2.7777777777777777777777777777778e-02f,
-      1.7361111111111111111111111111111e-03f, 6.9444444444444444444444444444444e-05f,
-      1.9290123456790123456790123456790e-06f, 3.9367598891408415217939027462837e-08f,
-      6.1511873267825648778029730410683e-10f, 7.5940584281266233059295963469979e-12f,
-      7.5940584281266233059295963469979e-14f, 6.2760813455591928148178482206594e-16f,
-      4.3583898233049950102901723754579e-18f};
-  float term = z;
-  float ret = 1.0f + z;
-  do {
-    term *= z;
-    ret += term * besseli0_k[BESSEL_SIZE - 1 - i];
-  } while (--i);
-  return ret;
-}
-
-static float kaiser_window_ext(uint32_t k, uint32_t n, uint16_t beta) {
-  if (beta == 0U) {
-    return 1.0f;
-  }
-  n = n - 1U;
-  k = k * (n - k) * beta * beta;
-  n = n * n;
-  return bessel_i0_ext((float)k / n);
-}
-
-void app_measurement_transform_domain(uint16_t ch_mask) {
-  uint16_t offset = 0;
-  uint8_t is_lowpass = FALSE;
-  switch (domain_func) {
-  case TD_FUNC_LOWPASS_IMPULSE:
-  case TD_FUNC_LOWPASS_STEP:
-    is_lowpass = TRUE;
-    offset = sweep_points;
-    break;
-  default:
-    break;
-  }
-  uint16_t window_size = sweep_points + offset;
-  uint16_t beta = 0;
-  switch (domain_window) {
-  case TD_WINDOW_NORMAL:
-    beta = 6;
-    break;
-  case TD_WINDOW_MAXIMUM:
-    beta = 13;
-    break;
-  default:
-    beta = 0;
-    break;
-  }
-  static float window_scale = 0.0f;
-  static uint16_t td_cache = 0;
-  uint16_t td_check = (props_mode & (TD_WINDOW | TD_FUNC)) | (sweep_points << 5);
-  if (td_cache != td_check) {
-    td_cache = td_check;
-    if (domain_func == TD_FUNC_LOWPASS_STEP) {
-      window_scale = FFT_SIZE * bessel_i0_ext(beta * beta / 4.0f);
-    } else {
-      window_scale = 0.0f;
-      for (int i = 0; i < sweep_points; i++) {
-        window_scale += kaiser_window_ext(i + offset, window_size, beta);
-      }
-      if (domain_func == TD_FUNC_LOWPASS_IMPULSE) {
-        window_scale *= 2.0f;
-      }
-    }
-    window_scale = 1.0f / window_scale;
-#ifdef USE_FFT_WINDOW_BUFFER
-    static float kaiser_data[FFT_SIZE];
-    for (int i = 0; i < sweep_points; i++) {
-      kaiser_data[i] = kaiser_window_ext(i + offset, window_size, beta) * window_scale;
-    }
-#endif
-  }
-  for (int ch = 0; ch < 2; ch++, ch_mask >>= 1) {
-    if ((ch_mask & 1U) == 0U) {
-      continue;
-    }
-    float* tmp = (float*)spi_buffer;
-    float* data = measured[ch][0];
-    int i;
-    for (i = 0; i < sweep_points; i++) {
-#ifdef USE_FFT_WINDOW_BUFFER
-      float w = kaiser_data[i];
-#else
-      float w = kaiser_window_ext(i + offset, window_size, beta) * window_scale;
-#endif
-      tmp[i * 2 + 0] = data[i * 2 + 0] * w;
-      tmp[i * 2 + 1] = data[i * 2 + 1] * w;
-    }
-    for (; i < FFT_SIZE; i++) {
-      tmp[i * 2 + 0] = 0.0f;
-      tmp[i * 2 + 1] = 0.0f;
-    }
-    if (is_lowpass) {
-      for (i = 1; i < sweep_points; i++) {
-        tmp[(FFT_SIZE - i) * 2 + 0] = tmp[i * 2 + 0];
-        tmp[(FFT_SIZE - i) * 2 + 1] = -tmp[i * 2 + 1];
-      }
-    }
-    fft_inverse((float (*)[2])tmp);
-    if (is_lowpass) {
-      for (i = 0; i < sweep_points; i++) {
-        tmp[i * 2 + 1] = 0.0f;
-      }
-    }
-    if (domain_func == TD_FUNC_LOWPASS_STEP) {
-      for (i = 1; i < sweep_points; i++) {
-        tmp[i * 2 + 0] += tmp[(i - 1) * 2 + 0];
-      }
+const sweep_segment_table_t* sweep_service_segments(void) {
+  return &sweep_segments;
+}
+
+bool sweep_service_segments_active(void) {
+  return segments_active;
+}
+
+bool sweep_service_uniform_spacing(void) {
+  return !segments_active || segments_uniform;
+}
+
+bool sweep_service_segments_add(const sweep_segment_t* segment) {
+  if (!sweep_segments_add(&sweep_segments, segment, SWEEP_POINTS_MAX))
+    return false;
+  if (segments_active)
+    sweep_service_segments_enable(true);
+  return true;
+}
+
+void sweep_service_segments_clear(void) {
+  sweep_service_segments_enable(false);
+  sweep_segments_clear(&sweep_segments);
+}
+
+bool sweep_service_segments_enable(bool enable) {
+  if (enable) {
+    if (sweep_segments.count == 0U)
+      return false;
+    if (!segments_active) {
+      linear_frequency0 = frequency0;
+      linear_frequency1 = frequency1;
+      linear_points = sweep_points;
     }
-    memcpy(measured[ch], tmp, sizeof(measured[0]));
+    sweep_segments_range(&sweep_segments, &segments_start, &segments_stop);
+    segments_uniform = sweep_segments_uniform(&sweep_segments);
+    frequency0 = segments_start;
+    frequency1 = segments_stop;
+    sweep_points = sweep_segments.points;
+    segments_active = true;
+  } else {
+    if (!segments_active)
+      return true;
+    segments_active = false;
+    frequency0 = linear_frequency0;
+    frequency1 = linear_frequency1;
+    sweep_points = linear_points;
   }
+  app_measurement_update_frequencies();
+  sweep_service_reset_progress();
+  return true;
 }
+
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "rf/sweep_profile.h"
+
+#include <string.h>
+
+void sweep_profile_init(sweep_profile_t* profile, uint32_t clock_hz, uint32_t clock_mask,
+                        uint32_t tick_hz) {
+  profile->clock_hz = clock_hz;
+  profile->clock_mask = clock_mask;
+  profile->tick_hz = tick_hz;
+  uint64_t wrap = ((uint64_t)clock_mask + 1U) * tick_hz / clock_hz;
+  profile->wrap_ticks = wrap > UINT32_MAX ? UINT32_MAX : (uint32_t)wrap;
+  sweep_profile_reset(profile);
+}
+
+void sweep_profile_reset(sweep_profile_t* profile) {
+  memset(profile->stat, 0, sizeof(profile->stat));
+}
+
+uint32_t sweep_profile_elapsed(const sweep_profile_t* profile, const sweep_profile_stamp_t* start,
+                               const sweep_profile_stamp_t* end) {
+  uint32_t ticks = end->ticks - start->ticks;
+  // The tick count may lag the real interval by one tick
+  if (ticks + 1U < profile->wrap_ticks)
+    return (end->cycles - start->cycles) & profile->clock_mask;
+  uint64_t cycles = (uint64_t)ticks * profile->clock_hz / profile->tick_hz;
+  return cycles > UINT32_MAX ? UINT32_MAX : (uint32_t)cycles;
+}
+
+void sweep_profile_add(sweep_profile_t* profile, uint8_t state, uint8_t band, uint32_t cycles) {
+  if (state >= SWEEP_PROFILE_STATES)
+    return;
+  if (band >= SWEEP_PROFILE_BANDS)
+    band = SWEEP_PROFILE_BANDS - 1;
+  sweep_profile_stat_t* s = &profile->stat[state][band];
+  if (s->count == 0U || cycles < s->min)
+    s->min = cycles;
+  if (cycles > s->max)
+    s->max = cycles;
+  s->count++;
+  s->total += cycles;
+}
+
+void sweep_profile_get(const sweep_profile_t* profile, uint8_t state, uint8_t band,
+                       sweep_profile_stat_t* stat) {
+  memset(stat, 0, sizeof(*stat));
+  if (state >= SWEEP_PROFILE_STATES)
+    return;
+  uint8_t first = 0, last = SWEEP_PROFILE_BANDS - 1;
+  if (band != SWEEP_PROFILE_ALL_BANDS) {
+    if (band >= SWEEP_PROFILE_BANDS)
+      return;
+    first = last = band;
+  }
+  for (uint8_t b = first; b <= last; b++) {
+    const sweep_profile_stat_t* s = &profile->stat[state][b];
+    if (s->count == 0U)
+      continue;
+    if (stat->count == 0U || s->min < stat->min)
+      stat->min = s->min;
+    if (s->max > stat->max)
+      stat->max = s->max;
+    stat->count += s->count;
+    stat->total += s->total;
+  }
+}
+
+uint32_t sweep_profile_cycles_to_us(const sweep_profile_t* profile, uint64_t cycles) {
+  uint64_t us = cycles * 1000000U / profile->clock_hz;
+  return us > UINT32_MAX ? UINT32_MAX : (uint32_t)us;
+}
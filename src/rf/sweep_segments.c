@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "rf/sweep_segments.h"
+
+void sweep_segments_clear(sweep_segment_table_t* table) {
+  table->count = 0;
+  table->points = 0;
+}
+
+bool sweep_segments_add(sweep_segment_table_t* table, const sweep_segment_t* segment,
+                        uint16_t max_points) {
+  if (table->count >= SWEEP_SEGMENTS_MAX || segment->points == 0U ||
+      segment->stop < segment->start)
+    return false;
+  if ((uint32_t)table->points + segment->points > max_points)
+    return false;
+  table->seg[table->count] = *segment;
+  table->first[table->count] = table->points;
+  table->points += segment->points;
+  table->count++;
+  return true;
+}
+
+uint8_t sweep_segments_find(const sweep_segment_table_t* table, uint16_t idx) {
+  uint8_t s = 0;
+  while (s + 1U < table->count && idx >= table->first[s + 1U])
+    s++;
+  return s;
+}
+
+// Same spread as the linear sweep: start + i * span / steps, rounded
+static freq_t linear_frequency(freq_t start, freq_t span, freq_t steps, freq_t i) {
+  return start + (span / steps) * i + (steps / 2U + (span % steps) * i) / steps;
+}
+
+freq_t sweep_segments_frequency(const sweep_segment_table_t* table, uint16_t idx) {
+  const uint8_t s = sweep_segments_find(table, idx);
+  const sweep_segment_t* seg = &table->seg[s];
+  const freq_t i = idx - table->first[s];
+  if (seg->points < 2U)
+    return seg->start;
+  return linear_frequency(seg->start, seg->stop - seg->start, seg->points - 1U, i);
+}
+
+void sweep_segments_range(const sweep_segment_table_t* table, freq_t* start, freq_t* stop) {
+  freq_t lo = table->count ? table->seg[0].start : 0;
+  freq_t hi = table->count ? table->seg[0].stop : 0;
+  for (uint8_t s = 1; s < table->count; s++) {
+    if (table->seg[s].start < lo)
+      lo = table->seg[s].start;
+    if (table->seg[s].stop > hi)
+      hi = table->seg[s].stop;
+  }
+  *start = lo;
+  *stop = hi;
+}
+
+bool sweep_segments_uniform(const sweep_segment_table_t* table) {
+  if (table->points < 3U)
+    return true;
+  const freq_t steps = table->points - 1U;
+  const freq_t first = sweep_segments_frequency(table, 0);
+  const freq_t last = sweep_segments_frequency(table, steps);
+  if (last < first)
+    return false;
+  for (uint16_t i = 1; i < steps; i++) {
+    const freq_t f = sweep_segments_frequency(table, i);
+    const freq_t linear = linear_frequency(first, last - first, steps, i);
+    if (f + 1U < linear || f > linear + 1U)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "rf/trace_average.h"
+
+void trace_average_init(trace_average_t* avg) {
+  avg->mode = TRACE_AVERAGE_OFF;
+  avg->factor = 0;
+  avg->count = 0;
+  avg->mask = 0;
+  avg->key = 0;
+}
+
+bool trace_average_configure(trace_average_t* avg, uint8_t mode, uint16_t factor) {
+  switch (mode) {
+  case TRACE_AVERAGE_OFF:
+    factor = 0;
+    break;
+  case TRACE_AVERAGE_EXP:
+    if (factor < 1U || factor > TRACE_AVERAGE_EXP_MAX)
+      return false;
+    break;
+  case TRACE_AVERAGE_BLOCK:
+    if (factor < 2U || factor > TRACE_AVERAGE_BLOCK_MAX)
+      return false;
+    break;
+  default:
+    return false;
+  }
+  avg->mode = mode;
+  avg->factor = factor;
+  avg->count = 0;
+  return true;
+}
+
+void trace_average_restart(trace_average_t* avg) {
+  avg->count = 0;
+}
+
+uint16_t trace_average_target(const trace_average_t* avg) {
+  switch (avg->mode) {
+  case TRACE_AVERAGE_EXP:
+    return (uint16_t)(1U << avg->factor);
+  case TRACE_AVERAGE_BLOCK:
+    return avg->factor;
+  default:
+    return 0;
+  }
+}
+
+bool trace_average_complete(const trace_average_t* avg) {
+  return avg->mode == TRACE_AVERAGE_BLOCK && avg->count >= avg->factor;
+}
+
+bool trace_average_next(trace_average_t* avg, uint32_t key, uint16_t mask, float* weight) {
+  uint16_t target = trace_average_target(avg);
+  if (target == 0U)
+    return false;
+  bool block_done = avg->mode == TRACE_AVERAGE_BLOCK && avg->count >= target;
+  if (avg->count == 0U || block_done || avg->key != key || avg->mask != mask) {
+    avg->key = key;
+    avg->mask = mask;
+    avg->count = 1;
+    *weight = 1.0f;
+    return true;
+  }
+  if (avg->count >= target) {
+    // Exponential steady state weight 2^-k
+    *weight = 1.0f / target;
+    return true;
+  }
+  avg->count++;
+  *weight = 1.0f / avg->count;
+  return true;
+}
+
+void trace_average_fold(float (*acc)[2], float (*data)[2], uint16_t points, float weight) {
+  if (weight == 1.0f) {
+    for (uint16_t i = 0; i < points; i++) {
+      acc[i][0] = data[i][0];
+      acc[i][1] = data[i][1];
+    }
+    return;
+  }
+  for (uint16_t i = 0; i < points; i++) {
+    float re = acc[i][0] + (data[i][0] - acc[i][0]) * weight;
+    float im = acc[i][1] + (data[i][1] - acc[i][1]) * weight;
+    acc[i][0] = re;
+    acc[i][1] = im;
+    data[i][0] = re;
+    data[i][1] = im;
+  }
+}
@@ -0,0 +1,146 @@
+/*
+ * Time domain transform of the measured data (Kaiser window + inverse FFT).
+ *
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#pragma GCC optimize("O2")
+
+#include "nanovna.h"
+#include "rf/sweep.h"
+
+#include <string.h>
+
+float bessel_i0_ext(float z) {
+#define BESSEL_SIZE 12
+  int i = BESSEL_SIZE - 1;
+  static const float besseli0_k[BESSEL_SIZE - 1] = {
+      2.5000000000000000000000000000000e-01f, 2.7777777777777777777777777777778e-02f,
+      1.7361111111111111111111111111111e-03f, 6.9444444444444444444444444444444e-05f,
+      1.9290123456790123456790123456790e-06f, 3.9367598891408415217939027462837e-08f,
+      6.1511873267825648778029730410683e-10f, 7.5940584281266233059295963469979e-12f,
+      7.5940584281266233059295963469979e-14f, 6.2760813455591928148178482206594e-16f,
+      4.3583898233049950102901723754579e-18f};
+  float term = z;
+  float ret = 1.0f + z;
+  do {
+    term *= z;
+    ret += term * besseli0_k[BESSEL_SIZE - 1 - i];
+  } while (--i);
+  return ret;
+}
+
+static float kaiser_window_ext(uint32_t k, uint32_t n, uint16_t beta) {
+  if (beta == 0U) {
+    return 1.0f;
+  }
+  n = n - 1U;
+  k = k * (n - k) * beta * beta;
+  n = n * n;
+  return bessel_i0_ext((float)k / n);
+}
+
+void app_measurement_transform_domain(uint16_t ch_mask) {
+  uint16_t offset = 0;
+  uint8_t is_lowpass = FALSE;
+  switch (domain_func) {
+  case TD_FUNC_LOWPASS_IMPULSE:
+  case TD_FUNC_LOWPASS_STEP:
+    is_lowpass = TRUE;
+    offset = sweep_points;
+    break;
+  default:
+    break;
+  }
+  uint16_t window_size = sweep_points + offset;
+  uint16_t beta = 0;
+  switch (domain_window) {
+  case TD_WINDOW_NORMAL:
+    beta = 6;
+    break;
+  case TD_WINDOW_MAXIMUM:
+    beta = 13;
+    break;
+  default:
+    beta = 0;
+    break;
+  }
+  static float window_scale = 0.0f;
+  static uint16_t td_cache = 0;
+  uint16_t td_check = (props_mode & (TD_WINDOW | TD_FUNC)) | (sweep_points << 5);
+  if (td_cache != td_check) {
+    td_cache = td_check;
+    if (domain_func == TD_FUNC_LOWPASS_STEP) {
+      window_scale = FFT_SIZE * bessel_i0_ext(beta * beta / 4.0f);
+    } else {
+      window_scale = 0.0f;
+      for (int i = 0; i < sweep_points; i++) {
+        window_scale += kaiser_window_ext(i + offset, window_size, beta);
+      }
+      if (domain_func == TD_FUNC_LOWPASS_IMPULSE) {
+        window_scale *= 2.0f;
+      }
+    }
+    window_scale = 1.0f / window_scale;
+#ifdef USE_FFT_WINDOW_BUFFER
+    static float kaiser_data[FFT_SIZE];
+    for (int i = 0; i < sweep_points; i++) {
+      kaiser_data[i] = kaiser_window_ext(i + offset, window_size, beta) * window_scale;
+    }
+#endif
+  }
+  for (int ch = 0; ch < 2; ch++, ch_mask >>= 1) {
+    if ((ch_mask & 1U) == 0U) {
+      continue;
+    }
+    float* tmp = (float*)spi_buffer;
+    float* data = measured[ch][0];
+    // Low pass spectrum is Hermitian, the real output inverse FFT only needs bins 0..FFT_SIZE/2
+    const int fft_points = is_lowpass ? FFT_SIZE / 2 + 1 : FFT_SIZE;
+    int i;
+    for (i = 0; i < sweep_points && i < fft_points; i++) {
+#ifdef USE_FFT_WINDOW_BUFFER
+      float w = kaiser_data[i];
+#else
+      float w = kaiser_window_ext(i + offset, window_size, beta) * window_scale;
+#endif
+      tmp[i * 2 + 0] = data[i * 2 + 0] * w;
+      tmp[i * 2 + 1] = data[i * 2 + 1] * w;
+    }
+    for (; i < fft_points; i++) {
+      tmp[i * 2 + 0] = 0.0f;
+      tmp[i * 2 + 1] = 0.0f;
+    }
+    if (is_lowpass) {
+      fft_inverse_real((float (*)[2])tmp);
+      // Real samples in tmp[], step response is the running sum of the impulse response
+      float step = 0.0f;
+      for (i = 0; i < sweep_points; i++) {
+        float v = tmp[i];
+        if (domain_func == TD_FUNC_LOWPASS_STEP)
+          v = step += v;
+        data[i * 2 + 0] = v;
+        data[i * 2 + 1] = 0.0f;
+      }
+      continue;
+    }
+    fft_inverse((float (*)[2])tmp);
+    memcpy(measured[ch], tmp, sizeof(measured[0]));
+  }
+}
@@ -30,6 +30,7 @@
 #include "nanovna.h"
 #include "sys/shell_service.h"
 #include "sys/shell_commands.h"
+#include "sys/remote_stream.h"
 #include "driver/usbcfg.h"
 #include "driver/platform_hal.h"
 #include "sys/config_service.h"
@@ -112,6 +113,10 @@ static measurement_engine_port_t measurement_engine_port;
   usb_port.api->parse_command((line), (argc), (argv), (name_out))
 #define shell_request_deferred_execution(command, argc, argv)                                      \
   usb_port.api->request_deferred_execution((command), (argc), (argv))
+#define shell_queue_deferred_execution(command, argc, argv)                                        \
+  usb_port.api->queue_deferred_execution((command), (argc), (argv))
+#define shell_wait_deferred_commands() usb_port.api->wait_deferred_commands()
+#define shell_print_prompt() usb_port.api->print_prompt()
 #define vna_shell_read_line(line, max_size) usb_port.api->read_line((line), (max_size))
 #define vna_shell_execute_cmd_line(line) usb_port.api->execute_cmd_line((line))
 #define shell_attach_bus(bus) usb_port.api->attach_event_bus((bus))
@@ -250,15 +255,45 @@ static void app_measurement_handle_result(measurement_engine_port_t* port,
   if (result == NULL || !result->completed) {
     return;
   }
-  if ((props_mode & DOMAIN_MODE) == DOMAIN_TIME) {
+#ifdef __USE_TRACE_AVERAGE__
+  // Block average complete: stop on its mean like a single sweep, resume takes the next block
+  if (measurement_data_average(result->sweep_mask)) {
+    sweep_mode &= (uint8_t)~SWEEP_ENABLE;
+  }
+#endif
+  if ((props_mode & DOMAIN_MODE) == DOMAIN_TIME && sweep_service_uniform_spacing()) {
     app_measurement_transform_domain(result->sweep_mask);
   }
   request_to_redraw(REDRAW_PLOT);
 }
 
+static void app_measurement_apply_recorrection(void) {
+  if (!app_measurement_recorrection_pending()) {
+    return;
+  }
+  uint16_t mask = app_measurement_get_sweep_mask();
+  bool time_domain = (props_mode & DOMAIN_MODE) == DOMAIN_TIME && sweep_service_uniform_spacing();
+  // Time domain data is transformed in place, wait for the running sweep to complete
+  if (time_domain && !app_measurement_sweep_settled(mask)) {
+    return;
+  }
+  if (!measurement_pipeline_recorrect(&measurement_engine.pipeline, mask)) {
+    return;
+  }
+  if (time_domain) {
+    app_measurement_transform_domain(mask);
+  }
+  sweep_service_increment_generation();
+  if (app_measurement_sweep_settled(mask)) {
+    sweep_service_publish_snapshot();
+  }
+  request_to_redraw(REDRAW_PLOT);
+}
+
 static void app_measurement_service_loop(measurement_engine_port_t* port) {
   (void)port;
   shell_service_pending_commands();
+  app_measurement_apply_recorrection();
   sweep_mode |= SWEEP_UI_MODE;
   ui_port.api->process();
   sweep_mode &= (uint8_t)~SWEEP_UI_MODE;
@@ -396,6 +431,9 @@ void set_sweep_points(uint16_t points) {
  * Frequency list functions
  */
 bool need_interpolate(freq_t start, freq_t stop, uint16_t points) {
+  // Segment points never match the linear calibration grid
+  if (sweep_service_segments_active())
+    return true;
   return start != cal_frequency0 || stop != cal_frequency1 || points != cal_sweep_points;
 }
 
@@ -487,6 +525,7 @@ void set_electrical_delay(int ch, float seconds) {
   if (current_props._electrical_delay[ch] == seconds)
     return;
   current_props._electrical_delay[ch] = seconds;
+  app_measurement_request_recorrection();
   request_to_redraw(REDRAW_MARKER);
 }
 
@@ -500,6 +539,7 @@ float get_electrical_delay(void) {
 void set_s21_offset(float offset) {
   if (s21_offset != offset) {
     s21_offset = offset;
+    app_measurement_request_recorrection();
     request_to_redraw(REDRAW_MARKER);
   }
 }
@@ -625,6 +665,12 @@ static void vna_shell_execute_line(char* line) {
     if ((cmd_flag & CMD_RUN_IN_UI) && (sweep_mode & SWEEP_UI_MODE)) {
       cmd_flag &= (uint16_t)~CMD_WAIT_MUTEX;
     }
+    // Batch behind the deferred commands still running, the sweep stays paused meanwhile
+    if ((cmd_flag & CMD_WAIT_MUTEX) && shell_queue_deferred_execution(cmd, argc, argv)) {
+      return;
+    }
+    // Everything else runs in order after them
+    shell_wait_deferred_commands();
     if (cmd_flag & CMD_BREAK_SWEEP) {
       if (sweep_mode & SWEEP_ENABLE) {
         auto_resume = true;
@@ -638,15 +684,19 @@ static void vna_shell_execute_line(char* line) {
       } else {
         shell_set_auto_resume(false);
       }
-      shell_request_deferred_execution(cmd, argc, argv);
+      if (!shell_request_deferred_execution(cmd, argc, argv) && auto_resume) {
+        resume_sweep();
+      }
     } else {
       cmd->sc_function((int)argc, argv);
       if (auto_resume && !(cmd_flag & CMD_NO_AUTO_RESUME)) {
         resume_sweep();
       }
     }
-  } else if (command_name && *command_name) {
-    shell_printf("%s?" VNA_SHELL_NEWLINE_STR, command_name);
+  } else {
+    shell_wait_deferred_commands();
+    if (command_name && *command_name)
+      shell_printf("%s?" VNA_SHELL_NEWLINE_STR, command_name);
   }
 }
 
@@ -706,7 +756,7 @@ THD_FUNCTION(myshellThread, p) {
   (void)p;
   chRegSetThreadName("shell");
   while (true) {
-    shell_printf(VNA_SHELL_PROMPT_STR);
+    shell_print_prompt();
     if (vna_shell_read_line(shell_line, VNA_SHELL_MAX_LENGTH))
       vna_shell_execute_line(shell_line);
     else // Putting a delay in order to avoid an endless loop trying to read an unavailable stream.
@@ -895,7 +945,7 @@ int runtime_main(void) {
       chThdWait(shelltp);
 #else
     do {
-      shell_printf(VNA_SHELL_PROMPT_STR);
+      shell_print_prompt();
       if (vna_shell_read_line(shell_line, VNA_SHELL_MAX_LENGTH))
         vna_shell_execute_line(shell_line);
       else
@@ -1022,10 +1072,19 @@ void set_active_trace(int t) {
 #ifdef __REMOTE_DESKTOP__
 void send_region(remote_region_t* rd, uint8_t* buf, uint16_t size) {
   if (SDU1.config->usbp->state == USB_ACTIVE) {
+    if (remote_stream_enabled()) {
+      if (rd->new_str[0] == 'f')
+        remote_stream_fill(rd->x, rd->y, rd->w, rd->h, *(pixel_t*)buf);
+      else
+        remote_stream_bulk(rd->x, rd->y, rd->w, rd->h, (const pixel_t*)buf);
+      return;
+    }
     shell_stream_write(rd, sizeof(remote_region_t));
     shell_stream_write(buf, size);
     shell_stream_write(VNA_SHELL_PROMPT_STR VNA_SHELL_NEWLINE_STR, 6);
-  } else
+  } else {
+    remote_stream_stop();
     sweep_mode &= ~SWEEP_REMOTE;
+  }
 }
 #endif
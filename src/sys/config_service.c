@@ -24,8 +24,10 @@
 #include "nanovna.h"
 #include "sys/config_service.h"
 #include "sys/event_bus.h"
+#include "sys/settings_journal.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <string.h>
 
 // Semaphore to protect flash operations from concurrent access
@@ -53,6 +55,34 @@ static void config_on_configuration_changed(const event_bus_message_t* message,
   (void)config_save();
 }
 
+/*
+ * Settings autosave journal. The properties_t fields in front of the
+ * calibration data (stimulus, traces, markers, delays, ...) are appended as
+ * journal records, the slot itself is only rewritten when the calibration
+ * data changes. Slot recall applies the newest record of the slot.
+ */
+#define SETTINGS_OFFSET offsetof(properties_t, _frequency0)
+#define SETTINGS_SIZE (offsetof(properties_t, _cal_data) - SETTINGS_OFFSET)
+_Static_assert(SETTINGS_SIZE + sizeof(settings_journal_record_t) <= FLASH_PAGESIZE,
+               "Settings record does not fit a journal page");
+
+static void journal_erase_page(uintptr_t address) {
+  flash_erase_pages(address, FLASH_PAGESIZE);
+}
+
+static void journal_program(uintptr_t address, const void* data, uint32_t size) {
+  flash_program_half_words((uint16_t*)address, (const uint16_t*)data, size);
+}
+
+static const settings_journal_flash_t journal_flash = {
+    SAVE_JOURNAL_ADDR, FLASH_PAGESIZE, SAVE_JOURNAL_SIZE / FLASH_PAGESIZE, journal_erase_page,
+    journal_program};
+static settings_journal_t journal;
+
+static inline const uint8_t* settings_of(const properties_t* props) {
+  return (const uint8_t*)props + SETTINGS_OFFSET;
+}
+
 static uint32_t calibration_slot_area(int id) {
   return SAVE_PROP_CONFIG_ADDR + id * SAVE_PROP_CONFIG_SIZE;
 }
@@ -109,6 +139,24 @@ static int config_recall_impl(void) {
   return 0;
 }
 
+// Write the whole slot, call with the flash semaphore taken
+static void caldata_write(uint32_t id) {
+  // Apply magic word and calculate checksum
+  current_props.magic = PROPERTIES_MAGIC;
+  current_props.checksum =
+      checksum(&current_props, sizeof current_props - sizeof current_props.checksum);
+
+  // write to flash
+  uint16_t* dst = (uint16_t*)calibration_slot_area(id);
+  flash_program_half_word_buffer(dst, (uint16_t*)&current_props, sizeof(properties_t));
+
+  // Records of older content with the same checksum would apply on recall, supersede them
+  if (settings_journal_find(&journal, id, current_props.checksum, SETTINGS_SIZE) != NULL)
+    settings_journal_append(&journal, id, current_props.checksum, settings_of(&current_props),
+                            SETTINGS_SIZE);
+  lastsaveid = id;
+}
+
 static int caldata_save_impl(uint32_t id) {
   if (id >= SAVEAREA_MAX)
     return -1;
@@ -123,17 +171,8 @@ static int caldata_save_impl(uint32_t id) {
   if (msg != MSG_OK)
     return -1;
 
-  // Apply magic word and calculate checksum
-  current_props.magic = PROPERTIES_MAGIC;
-  current_props.checksum =
-      checksum(&current_props, sizeof current_props - sizeof current_props.checksum);
-
-  // write to flash
-  uint16_t* dst = (uint16_t*)calibration_slot_area(id);
-  flash_program_half_word_buffer(dst, (uint16_t*)&current_props, sizeof(properties_t));
+  caldata_write(id);
 
-  lastsaveid = id;
-  
   chSemSignal(&flash_operation_semaphore);
   return 0;
 }
@@ -174,11 +213,43 @@ static int caldata_recall_impl(uint32_t id) {
   lastsaveid = id;
   // duplicated saved data onto sram to be able to modify marker/trace
   memcpy(&current_props, src, sizeof(properties_t));
+  // replay autosaved settings
+  const void* settings = settings_journal_find(&journal, id, src->checksum, SETTINGS_SIZE);
+  if (settings != NULL)
+    memcpy((uint8_t*)&current_props + SETTINGS_OFFSET, settings, SETTINGS_SIZE);
   
   chSemSignal(&flash_operation_semaphore);
   return 0;
 }
 
+static int caldata_autosave_impl(uint32_t id) {
+  if (id >= SAVEAREA_MAX || calibration_in_progress)
+    return -1;
+
+  msg_t msg = chSemWaitTimeout(&flash_operation_semaphore, MS2ST(500));
+  if (msg != MSG_OK)
+    return -1;
+
+  const properties_t* src = get_properties(id);
+  if (src == NULL ||
+      memcmp(src->_cal_data, current_props._cal_data, sizeof(current_props._cal_data)) != 0) {
+    // Empty slot or new calibration data
+    caldata_write(id);
+  } else {
+    const void* saved = settings_journal_find(&journal, id, src->checksum, SETTINGS_SIZE);
+    if (saved == NULL)
+      saved = settings_of(src);
+    if (memcmp(saved, settings_of(&current_props), SETTINGS_SIZE) != 0 &&
+        !settings_journal_append(&journal, id, src->checksum, settings_of(&current_props),
+                                 SETTINGS_SIZE))
+      caldata_write(id);
+    lastsaveid = id;
+  }
+
+  chSemSignal(&flash_operation_semaphore);
+  return 0;
+}
+
 static void clear_all_config_prop_data_impl(void) {
   // Wait for exclusive access to flash operations with timeout
   msg_t msg = chSemWaitTimeout(&flash_operation_semaphore, MS2ST(2000)); // 2 second timeout for erase operation
@@ -192,6 +263,7 @@ static void clear_all_config_prop_data_impl(void) {
   checksum_ok = 0;
   // unlock and erase flash pages
   flash_erase_pages(SAVE_PROP_CONFIG_ADDR, SAVE_FULL_AREA_SIZE);
+  settings_journal_erase(&journal);
   
   // Release the semaphore
   chSemSignal(&flash_operation_semaphore);
@@ -206,6 +278,7 @@ static const config_service_api_t api = {
     .load_configuration = config_recall_impl,
     .save_calibration = caldata_save_impl,
     .load_calibration = caldata_recall_impl,
+    .autosave_calibration = caldata_autosave_impl,
     .erase_calibration = clear_all_config_prop_data_impl,
 };
 
@@ -217,6 +290,7 @@ static void config_service_init_semaphore(void) {
 
 void config_service_init(void) {
   config_service_init_semaphore();
+  settings_journal_init(&journal, &journal_flash);
   initialized = true;
 }
 
@@ -260,6 +334,11 @@ int caldata_save(uint32_t id) {
   return instance ? instance->save_calibration(id) : -1;
 }
 
+int caldata_autosave(uint32_t id) {
+  const config_service_api_t* instance = require_api();
+  return instance ? instance->autosave_calibration(id) : -1;
+}
+
 int caldata_recall(uint32_t id) {
   const config_service_api_t* instance = require_api();
   return instance ? instance->load_calibration(id) : -1;
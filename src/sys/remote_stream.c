@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "sys/remote_stream.h"
+
+#include <string.h>
+
+#if defined(__REMOTE_DESKTOP__) || defined(NANOVNA_HOST_TEST)
+
+#define REMOTE_STREAM_END "ch> \r\n"
+
+static remote_stream_write_t stream_write;
+// Palette used by the client for "pack" regions
+static pixel_t sent_palette[REMOTE_PACK_PALETTE_SIZE];
+static bool palette_valid;
+// Content hash of grid cells as last sent, size == 0 if unknown
+static uint32_t cell_hash[REMOTE_GRID_ROWS][REMOTE_GRID_COLS];
+static uint16_t cell_size[REMOTE_GRID_ROWS][REMOTE_GRID_COLS];
+
+void remote_stream_start(remote_stream_write_t write) {
+  stream_write = write;
+  palette_valid = false;
+  memset(cell_size, 0, sizeof(cell_size));
+}
+
+void remote_stream_stop(void) {
+  stream_write = NULL;
+}
+
+bool remote_stream_enabled(void) {
+  return stream_write != NULL;
+}
+
+static void send_message(const char* tag, int16_t x, int16_t y, int16_t w, int16_t h,
+                         const void* data, size_t size) {
+  remote_region_t rd = {{0}, x, y, w, h};
+  memcpy(rd.new_str, tag, sizeof(rd.new_str));
+  stream_write(&rd, sizeof(rd));
+  if (size)
+    stream_write(data, size);
+}
+
+static void send_end(void) {
+  stream_write(REMOTE_STREAM_END, sizeof(REMOTE_STREAM_END) - 1);
+}
+
+static void update_palette(void) {
+  if (palette_valid && memcmp(sent_palette, config._lcd_palette, sizeof(sent_palette)) == 0)
+    return;
+  // New palette: cells already sent stay valid, they are decoded on the client
+  memcpy(sent_palette, config._lcd_palette, sizeof(sent_palette));
+  palette_valid = true;
+  send_message("palt\r\n", 0, 0, REMOTE_PACK_PALETTE_SIZE, 0, sent_palette, sizeof(sent_palette));
+  send_end();
+}
+
+static uint32_t pixels_hash(const pixel_t* pixels, uint32_t count) {
+  // FNV-1a over pixels
+  uint32_t hash = 2166136261U;
+  while (count--)
+    hash = (hash ^ *pixels++) * 16777619U;
+  return hash;
+}
+
+static uint8_t palette_index(pixel_t color) {
+  for (uint8_t i = 0; i < REMOTE_PACK_PALETTE_SIZE; i++)
+    if (sent_palette[i] == color)
+      return i;
+  return REMOTE_PACK_LITERAL;
+}
+
+/*
+ * Encode pixels, return encoded size. Output is written (in small chunks) only if send
+ * is set, so the same code measures the size for the raw/pack decision.
+ */
+static uint32_t pack_pixels(const pixel_t* pixels, uint32_t count, bool send) {
+  uint8_t buf[64];
+  uint32_t n = 0, total = 0;
+  pixel_t last_color = 0;
+  uint8_t last_index = palette_index(last_color);
+  while (count) {
+    pixel_t color = *pixels;
+    uint32_t run = 1;
+    while (run < count && run < REMOTE_PACK_RUN_MAX && pixels[run] == color)
+      run++;
+    pixels += run;
+    count -= run;
+    if (color != last_color) {
+      last_color = color;
+      last_index = palette_index(color);
+    }
+    if (run < REMOTE_PACK_RUN_SHORT + 1)
+      buf[n++] = (uint8_t)(((run - 1) << 5) | last_index);
+    else {
+      buf[n++] = (uint8_t)((REMOTE_PACK_RUN_SHORT << 5) | last_index);
+      buf[n++] = (uint8_t)(run - (REMOTE_PACK_RUN_SHORT + 1));
+    }
+    if (last_index == REMOTE_PACK_LITERAL) {
+      memcpy(&buf[n], &color, sizeof(pixel_t));
+      n += sizeof(pixel_t);
+    }
+    // Flush if next token may not fit
+    if (n > sizeof(buf) - 2 - sizeof(pixel_t)) {
+      if (send)
+        stream_write(buf, n);
+      total += n;
+      n = 0;
+    }
+  }
+  if (send && n)
+    stream_write(buf, n);
+  return total + n;
+}
+
+// Forget grid cells overlapped by a region sent outside the cell cache
+static void invalidate_cells(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int c0 = (x - OFFSETX) / CELLWIDTH, c1 = (x + w - 1 - OFFSETX) / CELLWIDTH;
+  int r0 = (y - OFFSETY) / CELLHEIGHT, r1 = (y + h - 1 - OFFSETY) / CELLHEIGHT;
+  if (x + w <= OFFSETX || y + h <= OFFSETY)
+    return;
+  if (c0 < 0)
+    c0 = 0;
+  if (r0 < 0)
+    r0 = 0;
+  if (c1 >= REMOTE_GRID_COLS)
+    c1 = REMOTE_GRID_COLS - 1;
+  if (r1 >= REMOTE_GRID_ROWS)
+    r1 = REMOTE_GRID_ROWS - 1;
+  for (int r = r0; r <= r1; r++)
+    for (int c = c0; c <= c1; c++)
+      cell_size[r][c] = 0;
+}
+
+bool remote_stream_bulk(int16_t x, int16_t y, int16_t w, int16_t h, const pixel_t* pixels) {
+  const uint32_t count = (uint32_t)w * h;
+  const int col = (x - OFFSETX) / CELLWIDTH, row = (y - OFFSETY) / CELLHEIGHT;
+  if (x >= OFFSETX && y >= OFFSETY && (x - OFFSETX) % CELLWIDTH == 0 &&
+      (y - OFFSETY) % CELLHEIGHT == 0 && w <= CELLWIDTH && h <= CELLHEIGHT &&
+      col < REMOTE_GRID_COLS && row < REMOTE_GRID_ROWS) {
+    // Grid cell: skip if the client already shows the same content
+    uint32_t hash = pixels_hash(pixels, count);
+    uint16_t size = (uint16_t)((w << 8) | h);
+    if (cell_size[row][col] == size && cell_hash[row][col] == hash)
+      return false;
+    cell_hash[row][col] = hash;
+    cell_size[row][col] = size;
+  } else
+    invalidate_cells(x, y, w, h);
+  update_palette();
+  if (pack_pixels(pixels, count, false) < count * sizeof(pixel_t)) {
+    send_message("pack\r\n", x, y, w, h, NULL, 0);
+    pack_pixels(pixels, count, true);
+  } else
+    send_message("bulk\r\n", x, y, w, h, pixels, count * sizeof(pixel_t));
+  send_end();
+  return true;
+}
+
+void remote_stream_fill(int16_t x, int16_t y, int16_t w, int16_t h, pixel_t color) {
+  invalidate_cells(x, y, w, h);
+  send_message("fill\r\n", x, y, w, h, &color, sizeof(pixel_t));
+  send_end();
+}
+
+#endif // __REMOTE_DESKTOP__
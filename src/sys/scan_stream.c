@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "sys/scan_stream.h"
+
+#include <string.h>
+
+// CRC-16/CCITT-FALSE, poly 0x1021, bitwise (no table, records are short)
+uint16_t scan_stream_crc16(uint16_t crc, const uint8_t* data, size_t size) {
+  while (size--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (int i = 0; i < 8; i++)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+size_t scan_stream_record_size(uint16_t mask) {
+  size_t size = SCAN_STREAM_HEADER_SIZE + SCAN_STREAM_CRC_SIZE;
+  if (mask & SCAN_MASK_OUT_FREQ)
+    size += sizeof(freq_t);
+  if (mask & SCAN_MASK_OUT_DATA0)
+    size += 2 * sizeof(float);
+  if (mask & SCAN_MASK_OUT_DATA1)
+    size += 2 * sizeof(float);
+  return size;
+}
+
+size_t scan_stream_encode(uint8_t* buffer, uint16_t mask, uint8_t seq, uint16_t index,
+                          freq_t frequency, const float s11[2], const float s21[2]) {
+  size_t n = 0;
+  buffer[n++] = SCAN_STREAM_SYNC;
+  buffer[n++] = seq;
+  buffer[n++] = (uint8_t)index;
+  buffer[n++] = (uint8_t)(index >> 8);
+  if (mask & SCAN_MASK_OUT_FREQ) {
+    memcpy(&buffer[n], &frequency, sizeof(freq_t));
+    n += sizeof(freq_t);
+  }
+  if (mask & SCAN_MASK_OUT_DATA0) {
+    memcpy(&buffer[n], s11, 2 * sizeof(float));
+    n += 2 * sizeof(float);
+  }
+  if (mask & SCAN_MASK_OUT_DATA1) {
+    memcpy(&buffer[n], s21, 2 * sizeof(float));
+    n += 2 * sizeof(float);
+  }
+  uint16_t crc = scan_stream_crc16(SCAN_STREAM_CRC_INIT, buffer, n);
+  buffer[n++] = (uint8_t)crc;
+  buffer[n++] = (uint8_t)(crc >> 8);
+  return n;
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "sys/settings_journal.h"
+
+#include <string.h>
+
+#define RECORD_HEADER_SIZE sizeof(settings_journal_record_t)
+#define RECORD_ALIGN(size) (((size) + 3U) & ~3U)
+#define FNV_OFFSET 0x811C9DC5U
+#define FNV_PRIME 0x01000193U
+
+static uint32_t fnv1a(uint32_t hash, const void* data, size_t size) {
+  const uint8_t* p = (const uint8_t*)data;
+  while (size--)
+    hash = (hash ^ *p++) * FNV_PRIME;
+  return hash;
+}
+
+static uint32_t record_hash(const settings_journal_record_t* record, const void* payload) {
+  uint32_t hash = fnv1a(FNV_OFFSET, record, offsetof(settings_journal_record_t, hash));
+  return fnv1a(hash, payload, record->size);
+}
+
+static uintptr_t page_start(const settings_journal_flash_t* flash, uint16_t page) {
+  return flash->address + (uintptr_t)page * flash->page_size;
+}
+
+// Newer in serial number arithmetic (seq wraps)
+static inline bool seq_newer(uint16_t a, uint16_t b) {
+  return (int16_t)(a - b) > 0;
+}
+
+/*
+ * Walk the records of one page. Calls visit for each valid record and returns
+ * the first free address, or the page end if the page holds unknown data.
+ */
+typedef void (*record_visit_t)(const settings_journal_record_t* record, void* ctx);
+
+static uintptr_t page_walk(const settings_journal_flash_t* flash, uint16_t page,
+                           record_visit_t visit, void* ctx) {
+  uintptr_t addr = page_start(flash, page);
+  const uintptr_t end = addr + flash->page_size;
+  while (addr + RECORD_HEADER_SIZE <= end) {
+    const settings_journal_record_t* record = (const settings_journal_record_t*)addr;
+    if (record->magic == 0xFFFFU)
+      return addr; // erased, free space starts here
+    uintptr_t next = addr + RECORD_HEADER_SIZE + RECORD_ALIGN(record->size);
+    if (record->magic != SETTINGS_JOURNAL_MAGIC || next > end)
+      break;
+    if (visit && record_hash(record, record + 1) == record->hash)
+      visit(record, ctx);
+    addr = next;
+  }
+  return end;
+}
+
+typedef struct {
+  const settings_journal_record_t* newest;
+  uint16_t page;
+  uint16_t newest_page;
+} scan_ctx_t;
+
+static void scan_visit(const settings_journal_record_t* record, void* ctx) {
+  scan_ctx_t* scan = (scan_ctx_t*)ctx;
+  if (scan->newest == NULL || seq_newer(record->seq, scan->newest->seq)) {
+    scan->newest = record;
+    scan->newest_page = scan->page;
+  }
+}
+
+void settings_journal_init(settings_journal_t* journal, const settings_journal_flash_t* flash) {
+  scan_ctx_t scan = {NULL, 0, 0};
+  journal->flash = flash;
+  for (scan.page = 0; scan.page < flash->pages; scan.page++)
+    page_walk(flash, scan.page, scan_visit, &scan);
+  // Append after the newest record (page 0 on an empty journal)
+  journal->seq = scan.newest ? (uint16_t)(scan.newest->seq + 1U) : 0;
+  journal->page = scan.newest_page;
+  journal->write = page_walk(flash, journal->page, NULL, NULL);
+}
+
+typedef struct {
+  const settings_journal_record_t* found;
+  uint32_t base;
+  uint16_t size;
+  uint8_t slot;
+} find_ctx_t;
+
+static void find_visit(const settings_journal_record_t* record, void* ctx) {
+  find_ctx_t* find = (find_ctx_t*)ctx;
+  if (record->slot != find->slot || record->base != find->base || record->size != find->size)
+    return;
+  if (find->found == NULL || seq_newer(record->seq, find->found->seq))
+    find->found = record;
+}
+
+const void* settings_journal_find(const settings_journal_t* journal, uint8_t slot, uint32_t base,
+                                  uint16_t size) {
+  find_ctx_t find = {NULL, base, size, slot};
+  for (uint16_t page = 0; page < journal->flash->pages; page++)
+    page_walk(journal->flash, page, find_visit, &find);
+  return find.found ? (const void*)(find.found + 1) : NULL;
+}
+
+typedef struct {
+  const settings_journal_record_t* newest;
+  uint8_t slot;
+} slot_ctx_t;
+
+static void slot_visit(const settings_journal_record_t* record, void* ctx) {
+  slot_ctx_t* find = (slot_ctx_t*)ctx;
+  if (record->slot != find->slot)
+    return;
+  if (find->newest == NULL || seq_newer(record->seq, find->newest->seq))
+    find->newest = record;
+}
+
+/*
+ * A record is live while it is the newest of its slot: a slot only has newer
+ * records of another base after it was rewritten, so older records can no
+ * longer match its checksum.
+ */
+static bool record_live(const settings_journal_t* journal, const settings_journal_record_t* record) {
+  slot_ctx_t find = {NULL, record->slot};
+  for (uint16_t page = 0; page < journal->flash->pages; page++)
+    page_walk(journal->flash, page, slot_visit, &find);
+  return find.newest == record;
+}
+
+typedef struct {
+  const settings_journal_t* journal;
+  uint32_t bytes;
+  uint16_t skip_slot; // slot superseded by the record being appended, 0xFFFF none
+} live_ctx_t;
+
+static void live_visit(const settings_journal_record_t* record, void* ctx) {
+  live_ctx_t* live = (live_ctx_t*)ctx;
+  if (record->slot != live->skip_slot && record_live(live->journal, record))
+    live->bytes += RECORD_HEADER_SIZE + RECORD_ALIGN(record->size);
+}
+
+static uint32_t page_live_bytes(const settings_journal_t* journal, uint16_t page,
+                                uint16_t skip_slot) {
+  live_ctx_t live = {journal, 0, skip_slot};
+  page_walk(journal->flash, page, live_visit, &live);
+  return live.bytes;
+}
+
+static void record_write(settings_journal_t* journal, uint8_t slot, uint32_t base,
+                         const void* data, uint16_t size) {
+  const settings_journal_flash_t* flash = journal->flash;
+  settings_journal_record_t record = {
+      SETTINGS_JOURNAL_MAGIC, journal->seq, slot, 0xFF, size, base, 0};
+  record.hash = record_hash(&record, data);
+  flash->program(journal->write, &record, RECORD_HEADER_SIZE);
+  flash->program(journal->write + RECORD_HEADER_SIZE, data, size & ~1U);
+  if (size & 1U) {
+    // Last odd byte, the pad byte stays erased (little endian half word)
+    uint16_t tail = (uint16_t)(0xFF00U | ((const uint8_t*)data)[size - 1]);
+    flash->program(journal->write + RECORD_HEADER_SIZE + (size & ~1U), &tail, sizeof(tail));
+  }
+  journal->write += RECORD_HEADER_SIZE + RECORD_ALIGN(size);
+  journal->seq++;
+}
+
+static void carry_visit(const settings_journal_record_t* record, void* ctx) {
+  live_ctx_t* live = (live_ctx_t*)ctx;
+  if (record->slot != live->skip_slot && record_live(live->journal, record))
+    record_write((settings_journal_t*)live->journal, record->slot, record->base, record + 1,
+                 record->size);
+}
+
+bool settings_journal_append(settings_journal_t* journal, uint8_t slot, uint32_t base,
+                             const void* data, uint16_t size) {
+  const settings_journal_flash_t* flash = journal->flash;
+  const uint32_t total = RECORD_HEADER_SIZE + RECORD_ALIGN(size);
+  if (total > flash->page_size)
+    return false;
+  uint16_t next = (uint16_t)(journal->page + 1U < flash->pages ? journal->page + 1U : 0U);
+  const uintptr_t end = page_start(flash, journal->page) + flash->page_size;
+  // The tail of the page is kept for the live records of the next page
+  if (journal->write + total + page_live_bytes(journal, next, 0xFFFF) > end) {
+    if (next == journal->page)
+      return false;
+    // Copy the live records of the next page forward before it is erased
+    if (journal->write + page_live_bytes(journal, next, slot) > end)
+      return false;
+    live_ctx_t carry = {journal, 0, slot};
+    page_walk(flash, next, carry_visit, &carry);
+    journal->page = next;
+    journal->write = page_start(flash, next);
+    flash->erase_page(journal->write);
+  }
+  record_write(journal, slot, base, data, size);
+  return true;
+}
+
+void settings_journal_erase(settings_journal_t* journal) {
+  const settings_journal_flash_t* flash = journal->flash;
+  for (uint16_t page = 0; page < flash->pages; page++)
+    flash->erase_page(page_start(flash, page));
+  journal->page = 0;
+  journal->write = flash->address;
+  journal->seq = 0;
+}
@@ -32,6 +32,8 @@
 #include "sys/state_manager.h"
 #include "sys/ui_port.h"
 #include "sys/processing_port.h"
+#include "sys/scan_stream.h"
+#include "sys/remote_stream.h"
 #include "sys/usb_command_server_port.h"
 #include "version_info.h"
 #include "runtime/runtime_entry.h" // For globals if needed, but nanovna.h should suffice
@@ -75,6 +77,11 @@ void set_power(uint8_t value) {
 
 
 
+// ST2US() is 32 bit and wraps after ~43 ms at 100 kHz, accumulated times do not fit
+static uint32_t ticks_to_us(uint32_t ticks) {
+  return (uint32_t)((uint64_t)ticks * 1000000U / CH_CFG_ST_FREQUENCY);
+}
+
 // Implementations
 
 VNA_SHELL_FUNCTION(cmd_power) {
@@ -178,14 +185,61 @@ VNA_SHELL_FUNCTION(cmd_measure) {
 #endif
 }
 
-// Copied from shell_commands.c (previous)
-#define SCAN_MASK_OUT_FREQ 0b00000001
-#define SCAN_MASK_OUT_DATA0 0b00000010
-#define SCAN_MASK_OUT_DATA1 0b00000100
-#define SCAN_MASK_NO_CALIBRATION 0b00001000
-#define SCAN_MASK_NO_EDELAY 0b00010000
-#define SCAN_MASK_NO_S21OFFS 0b00100000
-#define SCAN_MASK_BINARY 0b10000000
+// Text export: complex value as two round-trip safe floats "re im"
+static char* export_complex(char* p, const float v[2]) {
+  p = my_ftoa(p, v[0], MY_FTOA_DIGITS, DIGIT_SEPARATOR);
+  *p++ = ' ';
+  return my_ftoa(p, v[1], MY_FTOA_DIGITS, DIGIT_SEPARATOR);
+}
+
+// Longest text export line: "freq re im re im\r\n"
+#define EXPORT_LINE_MAX (10 + 4 * (MY_FTOA_MAX_SIZE + 1) + 2)
+
+/*
+ * Batch of text export lines, kept off the small shell and sweep thread stacks.
+ * data runs on the shell thread only after the deferred commands (scan) are done.
+ */
+static char export_buffer[3 * EXPORT_LINE_MAX + 1];
+
+// Returns false if the host stopped reading, the export is abandoned then
+static bool export_flush(size_t size) {
+  if (!shell_stream_write(export_buffer, size))
+    return false;
+#ifndef NANOVNA_HOST_TEST
+  wdgReset(&WDGD1);
+#endif
+  // Yield to allow USB processing
+  chThdYield();
+  return true;
+}
+
+static void export_complex_array(const float (*data)[2], uint16_t points) {
+  size_t buffer_len = 0;
+  for (uint16_t i = 0; i < points; i++) {
+    if (buffer_len + EXPORT_LINE_MAX >= sizeof(export_buffer)) {
+      if (!export_flush(buffer_len))
+        return;
+      buffer_len = 0;
+    }
+    char* p = export_complex(export_buffer + buffer_len, data[i]);
+    *p++ = '\r';
+    *p++ = '\n';
+    buffer_len = p - export_buffer;
+  }
+  if (buffer_len > 0)
+    shell_stream_write(export_buffer, buffer_len);
+}
+
+// Streaming scan: one framed record per point, sent as soon as the sweep completes it
+static uint16_t scan_stream_mask;
+static uint8_t scan_stream_seq;
+
+static void scan_stream_point(uint16_t point) {
+  uint8_t record[SCAN_STREAM_RECORD_MAX];
+  size_t n = scan_stream_encode(record, scan_stream_mask, scan_stream_seq++, point,
+                                get_frequency(point), measured[0][point], measured[1][point]);
+  shell_stream_write(record, n);
+}
 
 VNA_SHELL_FUNCTION(cmd_scan) {
   freq_t start, stop;
@@ -260,17 +314,33 @@ VNA_SHELL_FUNCTION(cmd_scan) {
 
   if (need_interpolate(start, stop, sweep_points))
     sweep_ch |= SWEEP_USE_INTERPOLATION;
+  sweep_ch |= sweep_service_get_mode();
 
   sweep_points = points;
   app_measurement_set_frequencies(start, stop, points);
 
+  bool stream = (mask & SCAN_MASK_STREAM) != 0;
+  if (stream) {
+    mask |= SCAN_MASK_BINARY;
+    scan_stream_mask = mask;
+    shell_stream_write(&mask, sizeof(uint16_t));
+    shell_stream_write(&points, sizeof(uint16_t));
+  }
+
   if (sweep_ch & (SWEEP_CH0_MEASURE | SWEEP_CH1_MEASURE)) {
     app_measurement_reset();
+    if (stream)
+      sweep_service_set_point_callback(scan_stream_point);
     app_measurement_sweep(false, sweep_ch);
+    sweep_service_set_point_callback(NULL);
+  } else if (stream) {
+    // Nothing to measure, frequency-only records
+    for (uint16_t i = 0; i < points; i++)
+      scan_stream_point(i);
   }
   pause_sweep();
   
-  if (mask) {
+  if (mask && !stream) {
     if (mask & SCAN_MASK_BINARY) {
       shell_stream_write(&mask, sizeof(uint16_t));
       shell_stream_write(&points, sizeof(uint16_t));
@@ -285,71 +355,38 @@ VNA_SHELL_FUNCTION(cmd_scan) {
           shell_stream_write(&measured[1][i][0], sizeof(float) * 2);
       }
     } else {
-      char buffer[256];
       size_t buffer_len = 0;
-      
       for (int i = 0; i < points; i++) {
-        char line[64];
-        int n = 0;
-        
-        // Use chsnprintf to format locally instead of shell_printf
-        switch (mask & (SCAN_MASK_OUT_FREQ | SCAN_MASK_OUT_DATA0 | SCAN_MASK_OUT_DATA1)) {
-          case (SCAN_MASK_OUT_FREQ | SCAN_MASK_OUT_DATA0 | SCAN_MASK_OUT_DATA1):
-            n = chsnprintf(line, sizeof(line), VNA_FREQ_FMT_STR " %f %f %f %f" VNA_SHELL_NEWLINE_STR,
-                         get_frequency(i),
-                         measured[0][i][0], measured[0][i][1],
-                         measured[1][i][0], measured[1][i][1]);
-            break;
-          case (SCAN_MASK_OUT_FREQ | SCAN_MASK_OUT_DATA0):
-            n = chsnprintf(line, sizeof(line), VNA_FREQ_FMT_STR " %f %f" VNA_SHELL_NEWLINE_STR,
-                         get_frequency(i),
-                         measured[0][i][0], measured[0][i][1]);
-            break;
-          case (SCAN_MASK_OUT_DATA0 | SCAN_MASK_OUT_DATA1):
-            n = chsnprintf(line, sizeof(line), "%f %f %f %f" VNA_SHELL_NEWLINE_STR,
-                         measured[0][i][0], measured[0][i][1],
-                         measured[1][i][0], measured[1][i][1]);
-            break;
-          case SCAN_MASK_OUT_FREQ:
-            n = chsnprintf(line, sizeof(line), VNA_FREQ_FMT_STR VNA_SHELL_NEWLINE_STR, get_frequency(i));
-            break;
-          case SCAN_MASK_OUT_DATA0:
-            n = chsnprintf(line, sizeof(line), "%f %f" VNA_SHELL_NEWLINE_STR, measured[0][i][0], measured[0][i][1]);
-            break;
-          case SCAN_MASK_OUT_DATA1:
-             n = chsnprintf(line, sizeof(line), "%f %f" VNA_SHELL_NEWLINE_STR, measured[1][i][0], measured[1][i][1]);
-            break;
-          default:
-            // Fallback for uncommon combinations
-             n = 0;
-             if (mask & SCAN_MASK_OUT_FREQ) n += chsnprintf(line + n, sizeof(line) - n, VNA_FREQ_FMT_STR " ", get_frequency(i));
-             if (mask & SCAN_MASK_OUT_DATA0) n += chsnprintf(line + n, sizeof(line) - n, "%f %f ", measured[0][i][0], measured[0][i][1]);
-             if (mask & SCAN_MASK_OUT_DATA1) n += chsnprintf(line + n, sizeof(line) - n, "%f %f ", measured[1][i][0], measured[1][i][1]);
-             n += chsnprintf(line + n, sizeof(line) - n, VNA_SHELL_NEWLINE_STR);
+        // Flush if next line would overflow
+        if (buffer_len + EXPORT_LINE_MAX >= sizeof(export_buffer)) {
+          bool sent = export_flush(buffer_len);
+          buffer_len = 0;
+          if (!sent)
             break;
         }
-
-        // Flush if buffer would overflow
-        if (buffer_len + n >= sizeof(buffer)) {
-           shell_stream_write(buffer, buffer_len);
-           buffer_len = 0;
-           #ifndef NANOVNA_HOST_TEST
-           wdgReset(&WDGD1);
-           #endif
-           // Yield to allow USB processing
-           chThdYield();
+        char* p = export_buffer + buffer_len;
+        if (mask & SCAN_MASK_OUT_FREQ) {
+          p = my_utoa(p, get_frequency(i));
+          *p++ = ' ';
+        }
+        if (mask & SCAN_MASK_OUT_DATA0) {
+          p = export_complex(p, measured[0][i]);
+          *p++ = ' ';
         }
-        
-        // Append to buffer
-        if (n > 0 && (size_t)n < sizeof(line)) {
-           memcpy(buffer + buffer_len, line, n);
-           buffer_len += n;
+        if (mask & SCAN_MASK_OUT_DATA1) {
+          p = export_complex(p, measured[1][i]);
+          *p++ = ' ';
         }
+        // Replace last space by line end
+        if (p != export_buffer + buffer_len)
+          p--;
+        *p++ = '\r';
+        *p++ = '\n';
+        buffer_len = p - export_buffer;
       }
-      
       // Flush remaining
       if (buffer_len > 0) {
-        shell_stream_write(buffer, buffer_len);
+        shell_stream_write(export_buffer, buffer_len);
       }
     }
   }
@@ -489,13 +526,7 @@ VNA_SHELL_FUNCTION(cmd_data) {
         chThdSleepMilliseconds(1);
         continue;
       }
-      for (uint16_t i = 0; i < snapshot.points; i++) {
-        if (!shell_printf("%f %f" VNA_SHELL_NEWLINE_STR, snapshot.data[i][0], snapshot.data[i][1])) break;
-        if ((i & 12) == 12) {
-          wdgReset(&WDGD1);
-          chThdYield();
-        }
-      }
+      export_complex_array(snapshot.data, snapshot.points);
       if (sweep_service_snapshot_release(&snapshot)) return;
       chThdYield();
     }
@@ -506,13 +537,7 @@ VNA_SHELL_FUNCTION(cmd_data) {
     osalSysUnlock();
   }
 
-  for (uint16_t i = 0; i < points; i++) {
-    if (!shell_printf("%f %f" VNA_SHELL_NEWLINE_STR, array[i][0], array[i][1])) break;
-    if ((i & 12) == 12) {
-      wdgReset(&WDGD1);
-      chThdYield();
-    }
-  }
+  export_complex_array(array, points);
 }
 
 VNA_SHELL_FUNCTION(cmd_threshold) {
@@ -589,9 +614,9 @@ VNA_SHELL_FUNCTION(cmd_cal) {
   case 3: cal_collect(CAL_THRU); return;
   case 4: cal_collect(CAL_ISOLN); return;
   case 5: cal_done(); return;
-  case 6: cal_status |= CALSTAT_APPLY; return;
-  case 7: cal_status &= ~CALSTAT_APPLY; return;
-  case 8: cal_status = 0; return;
+  case 6: cal_status |= CALSTAT_APPLY; app_measurement_request_recorrection(); return;
+  case 7: cal_status &= ~CALSTAT_APPLY; app_measurement_request_recorrection(); return;
+  case 8: cal_status = 0; app_measurement_request_recorrection(); return;
   }
 }
 
@@ -767,6 +792,10 @@ VNA_SHELL_FUNCTION(cmd_transform) {
   for (i = 0; i < argc; i++) {
     switch (get_str_index(argv[i], cmd_transform_list)) {
     case 0:
+      if (!sweep_service_uniform_spacing()) {
+        shell_printf("error: segments are not evenly spaced" VNA_SHELL_NEWLINE_STR);
+        return;
+      }
       set_domain_mode(DOMAIN_TIME);
       break;
     case 1:
@@ -850,15 +879,27 @@ VNA_SHELL_FUNCTION(cmd_tcxo) {
 
 // Remote desktop commands are only available on F303 due to driver support
 #if defined(__REMOTE_DESKTOP__) && defined(NANOVNA_F303)
+// Delta frames are best effort, a lost host is noticed by the session check
+static void remote_stream_write(const void* data, size_t size) {
+  (void)shell_stream_write(data, size);
+}
+
 VNA_SHELL_FUNCTION(cmd_refresh) {
-  static const char cmd_enable_list[] = "on|off";
+  static const char cmd_enable_list[] = "on|off|delta";
   if (argc != 1)
     return;
   int enable = get_str_index(argv[0], cmd_enable_list);
-  if (enable == 0)
+  if (enable == 0 || enable == 2) {
+    // delta: send only changed cells, palette/RLE encoded
+    if (enable == 2)
+      remote_stream_start(remote_stream_write);
+    else
+      remote_stream_stop();
     sweep_mode |= SWEEP_REMOTE;
-  else if (enable == 1)
+  } else if (enable == 1) {
+    remote_stream_stop();
     sweep_mode &= (uint8_t)~SWEEP_REMOTE;
+  }
   request_to_redraw(REDRAW_FREQUENCY | REDRAW_CAL_STATUS | REDRAW_AREA | REDRAW_BATTERY);
 }
 
@@ -930,7 +971,7 @@ VNA_SHELL_FUNCTION(cmd_sd_read) {
   uint32_t filesize = f_size(file);
   shell_stream_write(&filesize, 4);
   UINT size = 0;
-  while (f_read(file, buf, 512, &size) == FR_OK && size > 0)
+  while (f_read(file, buf, SPI_BUFFER_SIZE * sizeof(pixel_t), &size) == FR_OK && size > 0)
     shell_stream_write(buf, size);
   f_close(file);
 }
@@ -946,10 +987,32 @@ VNA_SHELL_FUNCTION(cmd_sd_delete) {
   const FRESULT res = f_unlink(filename);
   shell_printf("delete: %s %s" VNA_SHELL_NEWLINE_STR, filename, res == FR_OK ? "OK" : "err");
 }
+
+static void sd_stat_print(const char* name, uint32_t calls, uint32_t multi, uint32_t sectors,
+                          uint32_t time) {
+  uint32_t us = ticks_to_us(time);
+  uint32_t speed = us ? (uint32_t)((uint64_t)sectors * 512U * 1000000U / us) : 0;
+  shell_printf("%s calls %u multi %u sectors %u time %u us speed %u B/s" VNA_SHELL_NEWLINE_STR,
+               name, calls, multi, sectors, us, speed);
+}
+
+VNA_SHELL_FUNCTION(cmd_sd_stat) {
+  if (argc == 1 && get_str_index(argv[0], "reset") == 0) {
+    sd_card_reset_stats();
+    return;
+  }
+  sd_card_stats_t stats;
+  sd_card_get_stats(&stats);
+  sd_stat_print("read", stats.read_calls, stats.read_multi, stats.read_sectors, stats.read_time);
+  sd_stat_print("write", stats.write_calls, stats.write_multi, stats.write_sectors,
+                stats.write_time);
+  shell_printf("errors %u" VNA_SHELL_NEWLINE_STR, stats.errors);
+}
 #else
 VNA_SHELL_FUNCTION(cmd_sd_list) {}
 VNA_SHELL_FUNCTION(cmd_sd_read) {}
 VNA_SHELL_FUNCTION(cmd_sd_delete) {}
+VNA_SHELL_FUNCTION(cmd_sd_stat) {}
 #endif
 
 VNA_SHELL_FUNCTION(cmd_port) {}
@@ -987,6 +1050,217 @@ VNA_SHELL_FUNCTION(cmd_smooth) {
 VNA_SHELL_FUNCTION(cmd_smooth) {}
 #endif
 
+#ifdef __USE_TRACE_AVERAGE__
+VNA_SHELL_FUNCTION(cmd_average) {
+  static const char average_mode_list[] = "off|exp|block";
+  int mode = argc > 0 ? get_str_index(argv[0], average_mode_list) : -2;
+  if (mode == -2) {
+    // Mode, factor and progress: sweeps averaged / sweeps to complete
+    trace_average_t state;
+    sweep_service_get_average(&state);
+    static const char* const average_mode_name[] = {"off", "exp", "block"};
+    shell_printf("%s %u %u/%u" VNA_SHELL_NEWLINE_STR, average_mode_name[state.mode],
+                 state.factor, state.count, trace_average_target(&state));
+    return;
+  }
+  if (argc == 1 && get_str_index(argv[0], "restart") == 0) {
+    sweep_service_restart_average();
+    return;
+  }
+  if (mode == TRACE_AVERAGE_OFF && argc == 1) {
+    sweep_service_set_average(TRACE_AVERAGE_OFF, 0);
+    return;
+  }
+  if (mode > TRACE_AVERAGE_OFF && argc == 2 &&
+      sweep_service_set_average((uint8_t)mode, my_atoui(argv[1])))
+    return;
+  CLI_PRINT_USAGE("usage: average [off|restart|exp {1-%u}|block {2-%u}]" VNA_SHELL_NEWLINE_STR,
+                  TRACE_AVERAGE_EXP_MAX, TRACE_AVERAGE_BLOCK_MAX);
+}
+#endif
+
+#if ENABLE_SWEEPMODE_COMMAND
+VNA_SHELL_FUNCTION(cmd_sweepmode) {
+  static const char sweep_mode_list[] = "pipeline|chmajor"
+#ifdef __USE_ADAPTIVE_IFBW__
+                                         "|adaptive"
+#endif
+      ;
+  static const uint16_t sweep_mode_bits[] = {SWEEP_PIPELINE_SETUP, SWEEP_CHANNEL_MAJOR,
+#ifdef __USE_ADAPTIVE_IFBW__
+                                             SWEEP_ADAPTIVE_IFBW,
+#endif
+  };
+  int idx;
+  if (argc == 2 && (idx = get_str_index(argv[0], sweep_mode_list)) >= 0) {
+    int state = get_str_index(argv[1], "off|on");
+    if (state >= 0) {
+      sweep_service_set_mode(sweep_mode_bits[idx], state == 1);
+      return;
+    }
+  }
+  uint16_t mode = sweep_service_get_mode();
+  CLI_PRINT_USAGE("usage: sweepmode {%s} {off|on}" VNA_SHELL_NEWLINE_STR, sweep_mode_list);
+  shell_printf("pipeline: %s" VNA_SHELL_NEWLINE_STR,
+               (mode & SWEEP_PIPELINE_SETUP) ? "on" : "off");
+  shell_printf("chmajor: %s" VNA_SHELL_NEWLINE_STR,
+               (mode & SWEEP_CHANNEL_MAJOR) ? "on" : "off");
+#ifdef __USE_ADAPTIVE_IFBW__
+  shell_printf("adaptive: %s" VNA_SHELL_NEWLINE_STR,
+               (mode & SWEEP_ADAPTIVE_IFBW) ? "on" : "off");
+#endif
+}
+
+#ifdef __USE_ADAPTIVE_IFBW__
+VNA_SHELL_FUNCTION(cmd_ifcount) {
+  if (argc == 0) {
+    // Buffers averaged per point on the last sweep: ch0 ch1
+    for (uint16_t i = 0; i < sweep_points; i++)
+      shell_printf("%u %u" VNA_SHELL_NEWLINE_STR, sweep_service_if_count(0, i),
+                   sweep_service_if_count(1, i));
+    return;
+  }
+  if (get_str_index(argv[0], "target") == 0) {
+    if (argc == 2) {
+      // Relative uncertainty of the point in dB (variance of the mean / |gamma|^2)
+      float db = my_atof(argv[1]);
+      if (db < 0.0f) {
+        // 10^(dB/10) = e^(dB * ln(10) / 10)
+        sweep_service_set_adaptive_target(vna_expf(db * (2.30258509f / 10.0f)));
+        return;
+      }
+    } else if (argc == 1) {
+      shell_printf("target %.1f dB" VNA_SHELL_NEWLINE_STR,
+                   vna_log10f_x_10(sweep_service_get_adaptive_target()));
+      return;
+    }
+  }
+  CLI_PRINT_USAGE("usage: ifcount [target [{dB}]]" VNA_SHELL_NEWLINE_STR);
+}
+#endif
+
+VNA_SHELL_FUNCTION(cmd_segment) {
+  static const char segment_cmd[] = "add|clear|on|off";
+  int type = argc > 0 ? get_str_index(argv[0], segment_cmd) : -2;
+  switch (type) {
+  case -2: {
+    // List: start stop points bw power ('-' uses the global setting)
+    const sweep_segment_table_t* table = sweep_service_segments();
+    for (uint8_t i = 0; i < table->count; i++) {
+      const sweep_segment_t* seg = &table->seg[i];
+      shell_printf(VNA_FREQ_FMT_STR " " VNA_FREQ_FMT_STR " %u", seg->start, seg->stop,
+                   seg->points);
+      if (seg->bandwidth == SWEEP_SEGMENT_BW_GLOBAL)
+        shell_printf(" -");
+      else
+        shell_printf(" %u", seg->bandwidth);
+      if (seg->power == SWEEP_SEGMENT_POWER_GLOBAL)
+        shell_printf(" -" VNA_SHELL_NEWLINE_STR);
+      else
+        shell_printf(" %u" VNA_SHELL_NEWLINE_STR, seg->power);
+    }
+    shell_printf("segments %u points %u %s%s" VNA_SHELL_NEWLINE_STR, table->count, table->points,
+                 sweep_service_segments_active() ? "on" : "off",
+                 sweep_segments_uniform(table) ? "" : " uneven");
+    return;
+  }
+  case 0: {
+    if (argc < 4 || argc > 6)
+      break;
+    sweep_segment_t seg = {.start = my_atoui(argv[1]),
+                           .stop = my_atoui(argv[2]),
+                           .points = my_atoui(argv[3]),
+                           .bandwidth = SWEEP_SEGMENT_BW_GLOBAL,
+                           .power = SWEEP_SEGMENT_POWER_GLOBAL};
+    if (seg.start < FREQUENCY_MIN || seg.stop > FREQUENCY_MAX) {
+      shell_printf("error: frequency out of range" VNA_SHELL_NEWLINE_STR);
+      return;
+    }
+    if (argc > 4 && argv[4][0] != '-') {
+      uint16_t bw = my_atoui(argv[4]);
+      seg.bandwidth = bw > 511 ? 511 : bw;
+    }
+    if (argc > 5 && argv[5][0] != '-') {
+      uint8_t power = my_atoui(argv[5]);
+      if (power > SI5351_CLK_DRIVE_STRENGTH_8MA && power != SI5351_CLK_DRIVE_STRENGTH_AUTO)
+        power = SI5351_CLK_DRIVE_STRENGTH_AUTO;
+      seg.power = power;
+    }
+    if (!sweep_service_segments_add(&seg))
+      shell_printf("error: segment rejected" VNA_SHELL_NEWLINE_STR);
+    return;
+  }
+  case 1:
+    sweep_service_segments_clear();
+    return;
+  case 2:
+  case 3:
+    if (!sweep_service_segments_enable(type == 2))
+      shell_printf("error: no segments" VNA_SHELL_NEWLINE_STR);
+    return;
+  default:
+    break;
+  }
+  CLI_PRINT_USAGE("usage: segment [add {start(Hz)} {stop(Hz)} {points} [bw|-] [power|-]]|"
+                  "[clear]|[on|off]" VNA_SHELL_NEWLINE_STR);
+}
+
+VNA_SHELL_FUNCTION(cmd_sweeptime) {
+  if (argc == 1 && get_str_index(argv[0], "reset") == 0) {
+    sweep_service_reset_timing();
+    return;
+  }
+  sweep_service_timing_t timing;
+  sweep_service_get_timing(&timing);
+  shell_printf("points %u" VNA_SHELL_NEWLINE_STR, timing.points);
+  shell_printf("setup_freq %u us" VNA_SHELL_NEWLINE_STR, ticks_to_us(timing.setup_freq));
+  shell_printf("setup_measure %u us" VNA_SHELL_NEWLINE_STR, ticks_to_us(timing.setup_measure));
+  shell_printf("wait_capture %u us" VNA_SHELL_NEWLINE_STR, ticks_to_us(timing.wait_capture));
+  shell_printf("process %u us" VNA_SHELL_NEWLINE_STR, ticks_to_us(timing.process));
+  shell_printf("overlap %u us" VNA_SHELL_NEWLINE_STR, ticks_to_us(timing.overlap));
+  shell_printf("dsp_overruns %u" VNA_SHELL_NEWLINE_STR, sweep_service_dsp_overruns());
+}
+
+static void sweepprof_print(const sweep_profile_t* profile, const char* state, uint8_t band,
+                            const sweep_profile_stat_t* s) {
+  if (band == SWEEP_PROFILE_ALL_BANDS)
+    shell_printf("%-13s all", state);
+  else
+    shell_printf("%-13s %3u", state, band);
+  shell_printf(" %8u %7u %7u %7u" VNA_SHELL_NEWLINE_STR, s->count,
+               sweep_profile_cycles_to_us(profile, s->min),
+               sweep_profile_cycles_to_us(profile, s->total / s->count),
+               sweep_profile_cycles_to_us(profile, s->max));
+}
+
+VNA_SHELL_FUNCTION(cmd_sweepprof) {
+  static const char* const state_names[SWEEP_PROFILE_STATES] = {
+      "setup_freq", "setup_measure", "wait_capture", "process", "next_step"};
+  if (argc == 1 && get_str_index(argv[0], "reset") == 0) {
+    sweep_service_reset_timing();
+    return;
+  }
+  if (argc != 0) {
+    CLI_PRINT_USAGE("usage: sweepprof [reset]" VNA_SHELL_NEWLINE_STR);
+    return;
+  }
+  const sweep_profile_t* profile = sweep_service_get_profile();
+  shell_printf("state         band    count  min_us  avg_us  max_us" VNA_SHELL_NEWLINE_STR);
+  for (uint8_t state = 0; state < SWEEP_PROFILE_STATES; state++) {
+    sweep_profile_stat_t s;
+    sweep_profile_get(profile, state, SWEEP_PROFILE_ALL_BANDS, &s);
+    if (s.count == 0U)
+      continue;
+    sweepprof_print(profile, state_names[state], SWEEP_PROFILE_ALL_BANDS, &s);
+    for (uint8_t band = 0; band < SWEEP_PROFILE_BANDS; band++) {
+      sweep_profile_get(profile, state, band, &s);
+      if (s.count != 0U)
+        sweepprof_print(profile, state_names[state], band, &s);
+    }
+  }
+}
+#endif
+
 #if ENABLE_CONFIG_COMMAND
 VNA_SHELL_FUNCTION(cmd_config) {
   static const char cmd_mode_list[] = "auto"
@@ -1172,6 +1446,7 @@ const vna_shell_command commands[] = {
     {"sd_list", cmd_sd_list, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_RUN_IN_UI},
     {"sd_read", cmd_sd_read, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_RUN_IN_UI},
     {"sd_delete", cmd_sd_delete, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_RUN_IN_UI},
+    {"sd_stat", cmd_sd_stat, CMD_RUN_IN_UI},
 #endif
 #if ENABLED_DUMP_COMMAND
     {"dump", cmd_dump, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP},
@@ -1220,6 +1495,18 @@ const vna_shell_command commands[] = {
 #ifdef __USE_SMOOTH__
     {"smooth", cmd_smooth, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_RUN_IN_UI | CMD_RUN_IN_LOAD},
 #endif
+#ifdef __USE_TRACE_AVERAGE__
+    {"average", cmd_average, CMD_RUN_IN_LOAD},
+#endif
+#if ENABLE_SWEEPMODE_COMMAND
+    {"sweepmode", cmd_sweepmode, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_RUN_IN_UI | CMD_RUN_IN_LOAD},
+    {"sweeptime", cmd_sweeptime, CMD_RUN_IN_LOAD},
+    {"sweepprof", cmd_sweepprof, CMD_RUN_IN_LOAD},
+#ifdef __USE_ADAPTIVE_IFBW__
+    {"ifcount", cmd_ifcount, CMD_RUN_IN_LOAD},
+#endif
+    {"segment", cmd_segment, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_RUN_IN_UI | CMD_RUN_IN_LOAD},
+#endif
 #if ENABLE_CONFIG_COMMAND
     {"config", cmd_config, CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_RUN_IN_UI | CMD_RUN_IN_LOAD},
 #endif
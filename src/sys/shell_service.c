@@ -48,9 +48,28 @@ static BaseSequentialStream* shell_stream = NULL;
 static threads_queue_t shell_thread;
 static char* shell_args[VNA_SHELL_MAX_ARGUMENTS + 1];
 static uint16_t shell_nargs;
-static volatile const vna_shell_command* pending_command = NULL;
-static uint16_t pending_argc = 0;
-static char** pending_argv = NULL;
+
+/*
+ * Deferred command ring. The shell thread appends, the sweep thread executes
+ * from the head and releases the slot afterwards, so deferred_count != 0
+ * while any command is queued or still running. Arguments are copied, the
+ * shell thread reuses its line buffer for the next command meanwhile.
+ */
+#define SHELL_DEFERRED_AUTO_RESUME 0x01 // resume the sweep paused for this command
+#define SHELL_DEFERRED_QUEUED      0x02 // queued behind running commands, sweep state decided on run
+#define SHELL_DEFERRED_ECHO        0x04 // line was read without echo, echo it before running
+typedef struct {
+  const vna_shell_command* command;
+  uint8_t flags;
+  uint8_t argc;
+  char args[VNA_SHELL_MAX_LENGTH]; // argc zero terminated strings
+} shell_deferred_entry_t;
+
+static shell_deferred_entry_t deferred_queue[SHELL_DEFERRED_QUEUE_SIZE];
+static uint8_t deferred_head = 0;
+static volatile uint8_t deferred_count = 0;
+static bool shell_prompt_deferred = false; // last command prints its prompt from the sweep thread
+static bool shell_echo_pending = false;    // last line was read without echo
 static bool shell_skip_linefeed = false;
 static event_bus_t* shell_event_bus = NULL;
 static shell_session_callback_t shell_session_start_cb = NULL;
@@ -192,8 +211,8 @@ int serial_shell_printf(const char* fmt, ...) {
 }
 #endif
 
-void shell_stream_write(const void* buffer, size_t size) {
-  shell_write(buffer, size);
+bool shell_stream_write(const void* buffer, size_t size) {
+  return shell_io_write((const uint8_t*)buffer, size);
 }
 
 // Function to wake up all shell threads, must be called from ISR or locked context
@@ -360,49 +379,159 @@ const vna_shell_command* shell_parse_command(char* line, uint16_t* argc, char***
   return NULL;
 }
 
-void shell_request_deferred_execution(const vna_shell_command* command, uint16_t argc, char** argv) {
-  pending_command = command;
-  pending_argc = argc;
-  pending_argv = argv;
+static void shell_echo_args(const char* name, uint16_t argc, char* const* argv) {
+  shell_printf("%s", name);
+  for (uint16_t i = 0; i < argc; i++) {
+    shell_printf(" %s", argv[i]);
+  }
+  shell_printf(VNA_SHELL_NEWLINE_STR);
+}
+
+static void shell_fill_deferred(shell_deferred_entry_t* entry, const vna_shell_command* command,
+                                uint16_t argc, char** argv, uint8_t flags) {
+  size_t used = 0;
+  uint8_t count = 0;
+  for (; count < argc; count++) {
+    size_t len = strlen(argv[count]) + 1U;
+    if (used + len > sizeof(entry->args)) {
+      break;
+    }
+    memcpy(&entry->args[used], argv[count], len);
+    used += len;
+  }
+  entry->command = command;
+  entry->argc = count;
+  entry->flags = flags;
+  if (shell_echo_pending) {
+    entry->flags |= SHELL_DEFERRED_ECHO;
+    shell_echo_pending = false;
+  }
+}
+
+typedef enum {
+  SHELL_DEFERRED_APPENDED,
+  SHELL_DEFERRED_IDLE,
+  SHELL_DEFERRED_DROPPED
+} shell_deferred_result_t;
+
+// Append to the ring; with only_behind set only if commands are still queued or running
+static shell_deferred_result_t shell_append_deferred(const vna_shell_command* command,
+                                                     uint16_t argc, char** argv, uint8_t flags,
+                                                     bool only_behind) {
   osalSysLock();
-  osalThreadEnqueueTimeoutS(&shell_thread, SHELL_DEFERRED_EXECUTION_TIMEOUT);
+  while (deferred_count >= SHELL_DEFERRED_QUEUE_SIZE) {
+    if (osalThreadEnqueueTimeoutS(&shell_thread, SHELL_DEFERRED_EXECUTION_TIMEOUT) != MSG_OK) {
+      // Sweep thread stalled or session reset, drop the command and tell the host
+      osalSysUnlock();
+      shell_printf("error: command queue full, %s dropped" VNA_SHELL_NEWLINE_STR,
+                   command->sc_name);
+      return SHELL_DEFERRED_DROPPED;
+    }
+  }
+  if (only_behind && deferred_count == 0U) {
+    osalSysUnlock();
+    return SHELL_DEFERRED_IDLE;
+  }
+  // The tail slot is not touched by the sweep thread until it is counted
+  shell_deferred_entry_t* entry =
+      &deferred_queue[(deferred_head + deferred_count) % SHELL_DEFERRED_QUEUE_SIZE];
+  shell_fill_deferred(entry, command, argc, argv, flags);
+  deferred_count++;
   osalSysUnlock();
+  shell_prompt_deferred = true;
   if (shell_event_bus != NULL) {
     event_bus_publish(shell_event_bus, EVENT_USB_COMMAND_PENDING, NULL);
   }
+  return SHELL_DEFERRED_APPENDED;
+}
+
+bool shell_request_deferred_execution(const vna_shell_command* command, uint16_t argc, char** argv) {
+  uint8_t flags = shell_auto_resume ? SHELL_DEFERRED_AUTO_RESUME : 0U;
+  shell_auto_resume = false;
+  return shell_append_deferred(command, argc, argv, flags, false) == SHELL_DEFERRED_APPENDED;
+}
+
+bool shell_queue_deferred_execution(const vna_shell_command* command, uint16_t argc,
+                                    char** argv) {
+  // A dropped command is done with: its error line replaces the output
+  return shell_append_deferred(command, argc, argv, SHELL_DEFERRED_QUEUED, true) !=
+         SHELL_DEFERRED_IDLE;
+}
+
+bool shell_deferred_pending(void) {
+  return deferred_count != 0U;
+}
+
+void shell_wait_deferred_commands(void) {
+  osalSysLock();
+  while (deferred_count != 0U) {
+    if (osalThreadEnqueueTimeoutS(&shell_thread, SHELL_DEFERRED_EXECUTION_TIMEOUT) != MSG_OK) {
+      break;
+    }
+  }
+  osalSysUnlock();
+  if (shell_echo_pending) {
+    shell_echo_pending = false;
+    if (shell_nargs == 0) {
+      shell_printf(VNA_SHELL_NEWLINE_STR);
+    } else {
+      shell_echo_args(shell_args[0], shell_nargs - 1, &shell_args[1]);
+    }
+  }
+}
+
+void shell_print_prompt(void) {
+  // A deferred command prints its prompt after its output
+  if (shell_prompt_deferred) {
+    shell_prompt_deferred = false;
+    return;
+  }
+  shell_printf(VNA_SHELL_PROMPT_STR);
 }
 
 void shell_service_pending_commands(void) {
   while (true) {
     osalSysLock();
-    const vna_shell_command* command = (const vna_shell_command*)pending_command;
-    uint16_t argc = pending_argc;
-    char** argv = pending_argv;
-    if (command == NULL) {
+    if (deferred_count == 0U) {
       osalSysUnlock();
       break;
     }
-    pending_command = NULL;
+    shell_deferred_entry_t* entry = &deferred_queue[deferred_head];
     osalSysUnlock();
 
+    const vna_shell_command* command = entry->command;
+    char* argv[VNA_SHELL_MAX_ARGUMENTS + 1];
+    char* arg = entry->args;
+    for (uint8_t i = 0; i < entry->argc; i++) {
+      argv[i] = arg;
+      arg += strlen(arg) + 1U;
+    }
+    argv[entry->argc] = NULL;
+    if (entry->flags & SHELL_DEFERRED_ECHO) {
+      shell_echo_args(command->sc_name, entry->argc, argv);
+    }
+
+    bool auto_resume = (entry->flags & SHELL_DEFERRED_AUTO_RESUME) != 0U;
     if ((command->flags & CMD_BREAK_SWEEP) || (command->flags & CMD_WAIT_MUTEX)) {
+      // Queued commands see the sweep state left by the ones before them
+      if ((entry->flags & SHELL_DEFERRED_QUEUED) && (command->flags & CMD_BREAK_SWEEP) &&
+          (sweep_mode & SWEEP_ENABLE)) {
+        auto_resume = true;
+      }
       pause_sweep();
     }
-    command->sc_function(argc, argv);
-    
+    command->sc_function(entry->argc, argv);
+
     // Auto-resume sweep if it was running and command allows it
-    if (shell_auto_resume) {
-      if (!(command->flags & CMD_NO_AUTO_RESUME)) {
-        resume_sweep();
-      }
-      shell_auto_resume = false;
+    if (auto_resume && !(command->flags & CMD_NO_AUTO_RESUME)) {
+      resume_sweep();
     }
-
+    shell_printf(VNA_SHELL_PROMPT_STR);
 
     osalSysLock();
-    // In the real system, we would check if threads are waiting before dequeuing
-    // For safety, we assume a thread is waiting and proceed with dequeue
-    // In test environment, this is simplified
+    deferred_head = (deferred_head + 1U) % SHELL_DEFERRED_QUEUE_SIZE;
+    deferred_count--;
+    // Wake the shell thread waiting for a free slot or for the queue to drain
     osalThreadDequeueNextI(&shell_thread, MSG_OK);
     osalSysUnlock();
   }
@@ -445,6 +574,7 @@ static const char backspace[] = {0x08, 0x20, 0x08, 0x00};
 int vna_shell_read_line(char* line, int max_size) {
   uint8_t c;
   uint16_t j = 0;
+  bool echo = false;
   while (shell_read(&c, 1)) {
     if (shell_skip_linefeed) {
       shell_skip_linefeed = false;
@@ -452,23 +582,33 @@ int vna_shell_read_line(char* line, int max_size) {
         continue;
       }
     }
+    // Echo would overtake the output of queued commands, hold it until they are done
+    if (!echo && !shell_deferred_pending()) {
+      echo = true;
+      shell_write(line, j);
+    }
     if (c == 0x08 || c == 0x7f) {
       if (j > 0) {
-        shell_write(backspace, sizeof backspace);
+        if (echo)
+          shell_write(backspace, sizeof backspace);
         j--;
       }
       continue;
     }
     if (c == '\r' || c == '\n') {
       shell_skip_linefeed = (c == '\r');
-      shell_printf(VNA_SHELL_NEWLINE_STR);
+      if (echo)
+        shell_printf(VNA_SHELL_NEWLINE_STR);
+      else
+        shell_echo_pending = true;
       line[j] = 0;
       return 1;
     }
     if (c < ' ' || j >= max_size - 1) {
       continue;
     }
-    shell_write(&c, 1);
+    if (echo)
+      shell_write(&c, 1);
     line[j++] = (char)c;
   }
   return 0;
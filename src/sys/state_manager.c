@@ -184,7 +184,7 @@ void state_manager_force_save(void) {
 #ifdef __USE_BACKUP__
   // Don't save during calibration to avoid conflicts with measurement process
   if (!calibration_in_progress) {
-    caldata_save(active_calibration_slot());
+    caldata_autosave(active_calibration_slot());
   }
   
   sweep_state_dirty = false;
@@ -29,6 +29,9 @@ const usb_command_server_port_api_t usb_command_server_port_api = {
     .init_connection = shell_init_connection,
     .parse_command = shell_parse_command,
     .request_deferred_execution = shell_request_deferred_execution,
+    .queue_deferred_execution = shell_queue_deferred_execution,
+    .wait_deferred_commands = shell_wait_deferred_commands,
+    .print_prompt = shell_print_prompt,
     .service_pending_commands = shell_service_pending_commands,
     .read_line = vna_shell_read_line,
     .execute_cmd_line = vna_shell_execute_cmd_line,
@@ -520,9 +520,7 @@ static void plot_into_index(void) {
   markmap_all_markers();
   //  START_PROFILE;
   // Cache trace data indexes, and mark plot area for update
-  for (int t = 0; t < TRACES_MAX; t++)
-    if (trace[t].enabled)
-      trace_into_index(t);
+  traces_into_index();
   //  STOP_PROFILE;
   // Marker track on data update
   if (props_mode & TD_MARKER_TRACK)
@@ -28,6 +28,46 @@
 uint16_t trace_index_x[TRACE_INDEX_COUNT][SWEEP_POINTS_MAX];
 trace_coord_t trace_index_y[TRACE_INDEX_COUNT][SWEEP_POINTS_MAX];
 
+#ifdef __USE_TRACE_CELL_INDEX__
+// Per trace and plot cell: bit b set if a segment of block b touches the cell
+typedef uint16_t trace_cell_map_t;
+#define TRACE_CELL_BLOCKS (sizeof(trace_cell_map_t) * 8)
+static trace_cell_map_t trace_cell_index[TRACE_INDEX_COUNT][MAX_MARKMAP_Y][MAX_MARKMAP_X];
+
+// Segments per block for the current sweep
+static inline uint16_t trace_cell_block(void) {
+  return (uint16_t)((sweep_points - 2) / TRACE_CELL_BLOCKS + 1);
+}
+
+static inline uint16_t cell_clamp(uint16_t cell, uint16_t max) {
+  return cell < max ? cell : (uint16_t)(max - 1);
+}
+
+/*
+ * Segment i touches only cells inside the bounding box of its end points (the
+ * line is drawn pixel by pixel between them), so mark every cell of the box.
+ */
+static void trace_cell_index_build(int t, trace_index_const_table_t index) {
+  trace_cell_map_t(*map)[MAX_MARKMAP_X] = trace_cell_index[t];
+  const uint16_t block = trace_cell_block();
+  memset(map, 0, sizeof(trace_cell_index[0]));
+  for (uint16_t i = 0; i + 1 < sweep_points; i++) {
+    uint16_t cx0 = TRACE_X(index, i) / CELLWIDTH, cx1 = TRACE_X(index, i + 1) / CELLWIDTH;
+    uint16_t cy0 = TRACE_Y(index, i) / CELLHEIGHT, cy1 = TRACE_Y(index, i + 1) / CELLHEIGHT;
+    if (cx0 > cx1)
+      SWAP(uint16_t, cx0, cx1);
+    if (cy0 > cy1)
+      SWAP(uint16_t, cy0, cy1);
+    cx1 = cell_clamp(cx1, MAX_MARKMAP_X);
+    cy1 = cell_clamp(cy1, MAX_MARKMAP_Y);
+    const trace_cell_map_t bit = (trace_cell_map_t)(1U << (i / block));
+    for (uint16_t cy = cy0; cy <= cy1; cy++)
+      for (uint16_t cx = cx0; cx <= cx1; cx++)
+        map[cy][cx] |= bit;
+  }
+}
+#endif
+
 // Internal helpers
 static void mark_line(uint16_t x1, uint16_t y1, uint16_t x2, uint16_t y2) {
   uint16_t cell_x1 = (uint16_t)(x1 / CELLWIDTH);
@@ -91,8 +131,14 @@ float groupdelay(const float* v, const float* w, uint32_t deltaf) {
 float groupdelay_from_array(int i, const float* v) {
   int bottom = (i == 0) ? 0 : -1;
   int top = (i == sweep_points - 1) ? 0 : 1;
-  freq_t deltaf = get_sweep_frequency(ST_SPAN) / ((sweep_points - 1) / (top - bottom));
-  return groupdelay(&v[2 * bottom], &v[2 * top], deltaf);
+  // Spacing of the neighbours themselves, segments change the step
+  freq_t f_bottom = get_frequency(i + bottom);
+  freq_t f_top = get_frequency(i + top);
+  if (f_top > f_bottom)
+    return groupdelay(&v[2 * bottom], &v[2 * top], f_top - f_bottom);
+  if (f_top < f_bottom)
+    return groupdelay(&v[2 * top], &v[2 * bottom], f_bottom - f_top);
+  return 0.0f;
 }
 
 float real(int i, const float* v) {
@@ -323,70 +369,302 @@ static inline void cartesian_scale(const float* v, int16_t* xp, int16_t* yp, flo
   *yp = y;
 }
 
-// ... (existing trace_into_index)
-// ... (existing trace_into_index)
-void trace_into_index(int t) {
-  uint16_t start = 0, stop = sweep_points - 1, i;
-  float (*array)[2] = measured[trace[t].channel];
-  trace_index_table_t index = trace_index_table(t);
-  uint32_t type = 1 << trace[t].type;
-  get_value_cb_t c = trace_info_list[trace[t].type].get_value_cb;
-  float refpos = HEIGHT - (get_trace_refpos(t)) * GRIDY + 0.5f; 
-  float scale = get_trace_scale(t);
-  MarkLineState line_state = {0};
-  if (type & RECTANGULAR_GRID_MASK) { 
-    const float dscale = GRIDY / scale;
-    if (type & (1 << TRC_SWR))
-      refpos += dscale; 
-    uint32_t dx = ((WIDTH) << 16) / (sweep_points - 1),
-             x = (CELLOFFSETX << 16) + dx * start + 0x8000;
-    int32_t y;
-    for (i = start; i <= stop; i++, x += dx) {
-      float v = c ? c(i, array[i]) : 0.0f; 
-      if (v == infinityf()) {
-        y = 0;
-      } else {
-        y = refpos - v * dscale;
-        if (y < 0)
-          y = 0;
-        else if (y > HEIGHT)
-          y = HEIGHT;
-      }
-      mark_set_index(index, i, (uint16_t)(x >> 16), (uint16_t)y, &line_state);
+//**************************************************************************************
+//            Batched trace values
+//**************************************************************************************
+// Trace types reading the angular frequency of the point
+#define TRACE_W_MASK ((1 << TRC_Cs) | (1 << TRC_Ls) | (1 << TRC_Cp) | (1 << TRC_Lp))
+
+// |1 - S|^2 and |1 + S|^2, not expanded over |S|^2: that cancels out near |S| = 1
+static inline float get_l_minus(float re, float im) { return get_l(1.0f - re, im); }
+static inline float get_l_plus(float re, float im) { return get_l(1.0f + re, im); }
+
+static void trace_batch_l(const float (*array)[2], uint16_t first, uint16_t count, float* l) {
+  for (uint16_t k = 0; k < count; k++)
+    l[k] = get_l(array[first + k][0], array[first + k][1]);
+}
+
+static void trace_batch_w(uint16_t first, uint16_t count, float* w) {
+  for (uint16_t k = 0; k < count; k++)
+    w[k] = get_w(first + k);
+}
+
+/*
+ * Convert count (<= TRACE_BATCH_POINTS) points starting at first, one loop per
+ * type instead of a callback per point. l[] holds |S|^2 of the points, w[] the
+ * angular frequency (read only for TRACE_W_MASK types). Each case is the
+ * callback of trace_info_list written on top of l.
+ */
+static void trace_batch_values(uint8_t type, const float (*array)[2], uint16_t first,
+                               uint16_t count, const float* l, const float* w, float* out) {
+  const float (*v)[2] = &array[first];
+  const float z0 = PORT_Z;
+  uint16_t k;
+  switch (type) {
+  case TRC_LOGMAG:
+    for (k = 0; k < count; k++)
+      out[k] = vna_log10f_x_10(l[k]);
+    break;
+  case TRC_PHASE:
+    for (k = 0; k < count; k++)
+      out[k] = (180.0f / VNA_PI) * vna_atan2f(v[k][1], v[k][0]);
+    break;
+  case TRC_LINEAR:
+    for (k = 0; k < count; k++)
+      out[k] = vna_sqrtf(l[k]);
+    break;
+  case TRC_SWR:
+    for (k = 0; k < count; k++) {
+      float x = vna_sqrtf(l[k]);
+      out[k] = x > 0.99f ? infinityf() : (1.0f + x) / (1.0f - x);
     }
-    return;
+    break;
+  case TRC_REAL:
+    for (k = 0; k < count; k++)
+      out[k] = v[k][0];
+    break;
+  case TRC_IMAG:
+    for (k = 0; k < count; k++)
+      out[k] = v[k][1];
+    break;
+  case TRC_R:
+    for (k = 0; k < count; k++)
+      out[k] = get_s11_r_l(1.0f - v[k][0], get_l_minus(v[k][0], v[k][1]), z0);
+    break;
+  case TRC_X:
+    for (k = 0; k < count; k++)
+      out[k] = get_s11_x_l(1.0f - v[k][0], -v[k][1], get_l_minus(v[k][0], v[k][1]), z0);
+    break;
+  case TRC_Ls:
+    for (k = 0; k < count; k++)
+      out[k] = get_s11_x_l(1.0f - v[k][0], -v[k][1], get_l_minus(v[k][0], v[k][1]), z0) / w[k];
+    break;
+  case TRC_Cs:
+    for (k = 0; k < count; k++)
+      out[k] = -1.0f / (w[k] * get_s11_x_l(1.0f - v[k][0], -v[k][1],
+                                           get_l_minus(v[k][0], v[k][1]), z0));
+    break;
+  case TRC_Z:
+  case TRC_Y:
+    for (k = 0; k < count; k++)
+      out[k] = z0 * vna_sqrtf(get_l_plus(v[k][0], v[k][1]) / get_l_minus(v[k][0], v[k][1]));
+    if (type == TRC_Y)
+      for (k = 0; k < count; k++)
+        out[k] = 1.0f / out[k];
+    break;
+  case TRC_ZPHASE:
+    for (k = 0; k < count; k++)
+      out[k] = (180.0f / VNA_PI) * vna_atan2f(2.0f * v[k][1], 1.0f - l[k]);
+    break;
+  case TRC_Q:
+    for (k = 0; k < count; k++)
+      out[k] = vna_fabsf(2.0f * v[k][1] / (1.0f - l[k]));
+    break;
+  case TRC_G:
+  case TRC_Rp:
+    for (k = 0; k < count; k++)
+      out[k] = get_s11_r_l(1.0f + v[k][0], get_l_plus(v[k][0], v[k][1]), 1.0f / z0);
+    if (type == TRC_Rp)
+      for (k = 0; k < count; k++)
+        out[k] = 1.0f / out[k];
+    break;
+  case TRC_B:
+  case TRC_Cp:
+    for (k = 0; k < count; k++)
+      out[k] = get_s11_x_l(1.0f + v[k][0], v[k][1], get_l_plus(v[k][0], v[k][1]), 1.0f / z0);
+    if (type == TRC_Cp)
+      for (k = 0; k < count; k++)
+        out[k] /= w[k];
+    break;
+  case TRC_Xp:
+  case TRC_Lp:
+    for (k = 0; k < count; k++)
+      out[k] = -1.0f /
+               get_s11_x_l(1.0f + v[k][0], v[k][1], get_l_plus(v[k][0], v[k][1]), 1.0f / z0);
+    if (type == TRC_Lp)
+      for (k = 0; k < count; k++)
+        out[k] /= w[k];
+    break;
+  case TRC_Rser:
+    for (k = 0; k < count; k++)
+      out[k] = get_s21_r_l(l[k], 2.0f * z0);
+    break;
+  case TRC_Xser:
+    for (k = 0; k < count; k++)
+      out[k] = get_s21_x_l(v[k][1], l[k], 2.0f * z0);
+    break;
+  case TRC_Zser:
+    for (k = 0; k < count; k++)
+      out[k] = 2.0f * z0 * vna_sqrtf(get_l_minus(v[k][0], v[k][1]) / l[k]);
+    break;
+  case TRC_Rsh:
+    for (k = 0; k < count; k++)
+      out[k] = get_s21_r_l(get_l_minus(v[k][0], v[k][1]), 0.5f * z0);
+    break;
+  case TRC_Xsh:
+    for (k = 0; k < count; k++)
+      out[k] = get_s21_x_l(-v[k][1], get_l_minus(v[k][0], v[k][1]), 0.5f * z0);
+    break;
+  case TRC_Zsh:
+    for (k = 0; k < count; k++)
+      out[k] = 0.5f * z0 * vna_sqrtf(l[k] / get_l_minus(v[k][0], v[k][1]));
+    break;
+  case TRC_Qs21:
+    for (k = 0; k < count; k++)
+      out[k] = vna_fabsf(v[k][1] / (v[k][0] - l[k]));
+    break;
+  default: {
+    // Types reading neighbour points (DELAY) or without a value
+    get_value_cb_t c = type < MAX_TRACE_TYPE ? trace_info_list[type].get_value_cb : NULL;
+    for (k = 0; k < count; k++)
+      out[k] = c ? c(first + k, array[first + k]) : 0.0f;
+    break;
+  }
   }
-  if (type & ROUND_GRID_MASK) { 
-    const float rscale = P_RADIUS / scale;
-    int16_t y, x;
-    for (i = start; i <= stop; i++) {
-      if (trace[t].type == TRC_SMITH) {
-        float real = array[i][0];
-        float imag = array[i][1];
-        float mag2 = real*real + imag*imag;
-        float denominator = 1.0f + mag2;
-        if (denominator > 0.001f) { 
-          x = P_CENTER_X + float2int((2.0f * real / denominator) * rscale);
-          y = P_CENTER_Y - float2int((2.0f * imag / denominator) * rscale);
+}
+
+void trace_get_values(uint8_t type, const float (*array)[2], uint16_t first, uint16_t count,
+                      float* out) {
+  float l[TRACE_BATCH_POINTS], w[TRACE_BATCH_POINTS];
+  const bool need_w = type < MAX_TRACE_TYPE && ((1 << type) & TRACE_W_MASK);
+  while (count) {
+    uint16_t n = count < TRACE_BATCH_POINTS ? count : TRACE_BATCH_POINTS;
+    trace_batch_l(array, first, n, l);
+    if (need_w)
+      trace_batch_w(first, n, w);
+    trace_batch_values(type, array, first, n, l, w, out);
+    first += n;
+    out += n;
+    count -= n;
+  }
+}
+
+/*
+ * Rectangular traces in mask, converted batch by batch: |S|^2 (and w) once per channel.
+ * Only the sweep thread draws, the batch state is static to keep it off its stack.
+ */
+static void rectangular_traces_into_index(uint16_t mask) {
+  static float refpos[TRACES_MAX], dscale[TRACES_MAX];
+  static MarkLineState line_state[TRACES_MAX];
+  static float l[2][TRACE_BATCH_POINTS], w[TRACE_BATCH_POINTS], value[TRACE_BATCH_POINTS];
+  uint32_t types = 0;
+  uint8_t channels = 0;
+  int t;
+  for (t = 0; t < TRACES_MAX; t++) {
+    if (!(mask & (1 << t)))
+      continue;
+    line_state[t] = (MarkLineState){0};
+    dscale[t] = GRIDY / get_trace_scale(t);
+    refpos[t] = HEIGHT - (get_trace_refpos(t)) * GRIDY + 0.5f;
+    if (trace[t].type == TRC_SWR)
+      refpos[t] += dscale[t];
+    types |= 1 << trace[t].type;
+    channels |= 1 << trace[t].channel;
+  }
+  const uint32_t dx = ((WIDTH) << 16) / (sweep_points - 1);
+  uint32_t x = (CELLOFFSETX << 16) + 0x8000;
+  for (uint16_t first = 0; first < sweep_points; first += TRACE_BATCH_POINTS) {
+    uint16_t count = sweep_points - first;
+    if (count > TRACE_BATCH_POINTS)
+      count = TRACE_BATCH_POINTS;
+    for (uint8_t ch = 0; ch < 2; ch++)
+      if (channels & (1 << ch))
+        trace_batch_l(measured[ch], first, count, l[ch]);
+    if (types & TRACE_W_MASK)
+      trace_batch_w(first, count, w);
+    for (t = 0; t < TRACES_MAX; t++) {
+      if (!(mask & (1 << t)))
+        continue;
+      const uint8_t ch = trace[t].channel;
+      trace_batch_values(trace[t].type, measured[ch], first, count, l[ch], w, value);
+      trace_index_table_t index = trace_index_table(t);
+      uint32_t xi = x;
+      for (uint16_t k = 0; k < count; k++, xi += dx) {
+        int32_t y;
+        if (value[k] == infinityf()) {
+          y = 0;
         } else {
-          x = P_CENTER_X;
-          y = P_CENTER_Y;
+          y = refpos[t] - value[k] * dscale[t];
+          if (y < 0)
+            y = 0;
+          else if (y > HEIGHT)
+            y = HEIGHT;
         }
-        if (x < CELLOFFSETX)
-          x = CELLOFFSETX;
-        else if (x > CELLOFFSETX + WIDTH)
-          x = CELLOFFSETX + WIDTH;
-        if (y < 0)
-          y = 0;
-        else if (y > HEIGHT)
-          y = HEIGHT;
+        mark_set_index(index, first + k, (uint16_t)(xi >> 16), (uint16_t)y, &line_state[t]);
+      }
+    }
+    x += dx * count;
+  }
+#ifdef __USE_TRACE_CELL_INDEX__
+  for (t = 0; t < TRACES_MAX; t++)
+    if (mask & (1 << t))
+      trace_cell_index_build(t, trace_index_const_table(t));
+#endif
+}
+
+static void round_trace_into_index(int t) {
+  uint16_t i;
+  float (*array)[2] = measured[trace[t].channel];
+  trace_index_table_t index = trace_index_table(t);
+  const float rscale = P_RADIUS / get_trace_scale(t);
+  MarkLineState line_state = {0};
+  int16_t y, x;
+  for (i = 0; i < sweep_points; i++) {
+    if (trace[t].type == TRC_SMITH) {
+      float real = array[i][0];
+      float imag = array[i][1];
+      float mag2 = real*real + imag*imag;
+      float denominator = 1.0f + mag2;
+      if (denominator > 0.001f) { 
+        x = P_CENTER_X + float2int((2.0f * real / denominator) * rscale);
+        y = P_CENTER_Y - float2int((2.0f * imag / denominator) * rscale);
       } else {
-        cartesian_scale(array[i], &x, &y, rscale);
+        x = P_CENTER_X;
+        y = P_CENTER_Y;
       }
-      mark_set_index(index, i, (uint16_t)x, (uint16_t)y, &line_state);
+      if (x < CELLOFFSETX)
+        x = CELLOFFSETX;
+      else if (x > CELLOFFSETX + WIDTH)
+        x = CELLOFFSETX + WIDTH;
+      if (y < 0)
+        y = 0;
+      else if (y > HEIGHT)
+        y = HEIGHT;
+    } else {
+      cartesian_scale(array[i], &x, &y, rscale);
     }
-    return;
+    mark_set_index(index, i, (uint16_t)x, (uint16_t)y, &line_state);
+  }
+#ifdef __USE_TRACE_CELL_INDEX__
+  trace_cell_index_build(t, trace_index_const_table(t));
+#endif
+}
+
+static void traces_into_index_mask(uint16_t mask) {
+  uint16_t rectangular = 0;
+  for (int t = 0; t < TRACES_MAX; t++) {
+    if (!(mask & (1 << t)))
+      continue;
+    uint32_t type = 1 << trace[t].type;
+    if (type & RECTANGULAR_GRID_MASK)
+      rectangular |= 1 << t;
+    else if (type & ROUND_GRID_MASK)
+      round_trace_into_index(t);
   }
+  if (rectangular)
+    rectangular_traces_into_index(rectangular);
+}
+
+void trace_into_index(int t) {
+  traces_into_index_mask(1 << t);
+}
+
+void traces_into_index(void) {
+  uint16_t mask = 0;
+  for (int t = 0; t < TRACES_MAX; t++)
+    if (trace[t].enabled)
+      mask |= 1 << t;
+  traces_into_index_mask(mask);
 }
 
 // plot_into_index logic is in plot.c
@@ -428,6 +706,10 @@ void toggle_stored_trace(int idx) {
     return;
   memcpy(trace_index_x[TRACES_MAX + idx], trace_index_x[current_trace], sizeof(trace_index_x[0]));
   memcpy(trace_index_y[TRACES_MAX + idx], trace_index_y[current_trace], sizeof(trace_index_y[0]));
+#ifdef __USE_TRACE_CELL_INDEX__
+  memcpy(trace_cell_index[TRACES_MAX + idx], trace_cell_index[current_trace],
+         sizeof(trace_cell_index[0]));
+#endif
   enabled_store_trace |= mask;
 }
 uint8_t get_stored_traces(void) { return enabled_store_trace; }
@@ -491,6 +773,17 @@ TraceIndexRange search_index_range_x(uint16_t x_start, uint16_t x_end,
   return range;
 }
 
+static void draw_trace_segments(RenderCellCtx* rcx, trace_index_const_table_t index,
+                                uint16_t first, uint16_t last, pixel_t color) {
+  for (uint16_t i = first; i < last; ++i) {
+    int x1 = (int)TRACE_X(index, i) - rcx->x0;
+    int y1 = (int)TRACE_Y(index, i) - rcx->y0;
+    int x2 = (int)TRACE_X(index, i + 1) - rcx->x0;
+    int y2 = (int)TRACE_Y(index, i + 1) - rcx->y0;
+    cell_drawline(rcx, x1, y1, x2, y2, color);
+  }
+}
+
 void render_traces_in_cell(RenderCellCtx* rcx) {
   if (sweep_points < 2) return;
   for (int t = TRACE_INDEX_COUNT - 1; t >= 0; --t) {
@@ -504,18 +797,28 @@ void render_traces_in_cell(RenderCellCtx* rcx) {
     if (rectangular && !get_stored_traces() && sweep_points > 30) {
       range = search_index_range_x(rcx->x0, rcx->x0 + rcx->w, index);
     }
+#ifdef __USE_TRACE_CELL_INDEX__
+    else {
+      // Only the segment blocks that touch this cell
+      const uint16_t block = trace_cell_block();
+      uint32_t bits = trace_cell_index[t][rcx->y0 / CELLHEIGHT][rcx->x0 / CELLWIDTH];
+      while (bits) {
+        uint16_t first = (uint16_t)(__builtin_ctz(bits) * block);
+        uint16_t last = (uint16_t)(first + block);
+        if (last > sweep_points - 1)
+          last = (uint16_t)(sweep_points - 1);
+        draw_trace_segments(rcx, index, first, last, color);
+        bits &= bits - 1;
+      }
+      continue;
+    }
+#endif
     uint16_t start = range.found ? range.i0 : 0u;
     uint16_t stop = range.found ? range.i1 : (uint16_t)(sweep_points - 1);
     uint16_t first_segment = (start > 0) ? (uint16_t)(start - 1) : 0u;
     uint16_t last_segment = (stop < (uint16_t)(sweep_points - 1)) ? (uint16_t)(stop + 1)
                                                                    : (uint16_t)(sweep_points - 1);
     if (last_segment <= first_segment) continue;
-    for (uint16_t i = first_segment; i < last_segment; ++i) {
-      int x1 = (int)TRACE_X(index, i) - rcx->x0;
-      int y1 = (int)TRACE_Y(index, i) - rcx->y0;
-      int x2 = (int)TRACE_X(index, i + 1) - rcx->x0;
-      int y2 = (int)TRACE_Y(index, i + 1) - rcx->y0;
-      cell_drawline(rcx, x1, y1, x2, y2, color);
-    }
+    draw_trace_segments(rcx, index, first_segment, last_segment, color);
   }
 }
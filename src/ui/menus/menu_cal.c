@@ -25,6 +25,7 @@
 #include "ui/core/ui_keypad.h"
 #include "sys/config_service.h"
 #include "driver/si5351.h"
+#include "rf/sweep.h"
 #include "core/config_macros.h"
 
 // ===================================
@@ -87,6 +88,7 @@ static UI_FUNCTION_ADV_CALLBACK(menu_cal_enh_acb) {
   }
   // toggle applying correction
   cal_status ^= CALSTAT_ENHANCED_RESPONSE;
+  app_measurement_request_recorrection();
   request_to_redraw(REDRAW_CAL_STATUS);
 }
 
@@ -111,6 +113,7 @@ static UI_FUNCTION_CALLBACK(menu_cal_reset_cb) {
   // RESET
   cal_status &= CALSTAT_ENHANCED_RESPONSE; // leave ER state
   lastsaveid = NO_SAVE_SLOT;
+  app_measurement_request_recorrection();
   // set_power(SI5351_CLK_DRIVE_STRENGTH_AUTO);
   request_to_redraw(REDRAW_CAL_STATUS);
 }
@@ -142,6 +145,7 @@ static UI_FUNCTION_ADV_CALLBACK(menu_cal_apply_acb) {
   }
   // toggle applying correction
   cal_status ^= CALSTAT_APPLY;
+  app_measurement_request_recorrection();
   request_to_redraw(REDRAW_CAL_STATUS);
 }
 
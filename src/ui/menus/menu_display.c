@@ -24,6 +24,8 @@
 #include "ui/core/ui_core.h"
 #include "ui/core/ui_keypad.h" // For KM_* definitions
 #include "sys/config_service.h"
+#include "rf/sweep.h"
+#include "ui/draw/traces.h"
 
 // ===================================
 // Callbacks
@@ -148,27 +150,34 @@ static UI_FUNCTION_CALLBACK(menu_auto_scale_cb) {
   if (current_trace == TRACE_INVALID || sweep_points == 0)
     return;
   int type = trace[current_trace].type;
-  get_value_cb_t c = trace_info_list[type].get_value_cb; // Get callback for value calculation
-  if (c == NULL)
-    return; // No callback, skip
+  if (trace_info_list[type].get_value_cb == NULL)
+    return; // No value for this type, skip
 
   float (*array)[2] = measured[trace[current_trace].channel];
-  float min_val, max_val;
-
-  // Initialize with the first point
-  float v = c(0, array[0]);
-  if (vna_fabsf(v) == infinityf())
-      v = 0; // fallback if infinite
-  min_val = max_val = v;
-
-  for (uint16_t i = 1; i < sweep_points; i++) {
-    v = c(i, array[i]);
-    if (vna_fabsf(v) == infinityf())
-      continue;
-    if (v < min_val)
-      min_val = v;
-    if (v > max_val)
-      max_val = v;
+  float values[TRACE_BATCH_POINTS];
+  float min_val = 0.0f, max_val = 0.0f;
+
+  for (uint16_t first = 0; first < sweep_points; first += TRACE_BATCH_POINTS) {
+    uint16_t count = sweep_points - first;
+    if (count > TRACE_BATCH_POINTS)
+      count = TRACE_BATCH_POINTS;
+    trace_get_values(type, (const float (*)[2])array, first, count, values);
+    for (uint16_t k = 0; k < count; k++) {
+      float v = values[k];
+      if (first + k == 0) {
+        // Initialize with the first point
+        if (vna_fabsf(v) == infinityf())
+          v = 0; // fallback if infinite
+        min_val = max_val = v;
+        continue;
+      }
+      if (vna_fabsf(v) == infinityf())
+        continue;
+      if (v < min_val)
+        min_val = v;
+      if (v > max_val)
+        max_val = v;
+    }
   }
 
   // If signal is flat
@@ -311,6 +320,7 @@ UI_KEYBOARD_CALLBACK(input_portz) {
     current_props._cal_load_r = keyboard_get_float();
   else
     current_props._portz = keyboard_get_float();
+  app_measurement_request_recorrection();
 }
 #endif
 
@@ -502,6 +512,10 @@ static UI_FUNCTION_ADV_CALLBACK(menu_transform_acb) {
   ui_cycle_option(&state, transform_state_options, ARRAY_COUNT(transform_state_options), b);
   if (b)
     return;
+  if (state && !sweep_service_uniform_spacing()) {
+    ui_message_box("TRANSFORM", "Segments not evenly spaced", 2000);
+    return;
+  }
   props_mode = (props_mode & (uint16_t)~DOMAIN_TIME) | state;
   select_lever_mode(LM_MARKER);
   request_to_redraw(REDRAW_FREQUENCY | REDRAW_AREA);
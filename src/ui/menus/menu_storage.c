@@ -58,29 +58,52 @@ typedef const char* (*file_load_cb_t)(FIL* f, FILINFO* fno, uint8_t format);
 static const char s1_file_header[] = "!File created by NanoVNA\r\n"
                                      "# Hz S RI R 50\r\n";
 
-static const char s1_file_param[] = "%u % f % f\r\n";
-
 static const char s2_file_header[] = "!File created by NanoVNA\r\n"
                                      "# Hz S RI R 50\r\n";
 
-static const char s2_file_param[] = "%u % f % f % f % f 0 0 0 0\r\n";
+// S2P tail: S12 and S22 are not measured
+static const char s2_file_tail[] = " 0 0 0 0\r\n";
+
+// Longest data line: "freq  re  im  re  im 0 0 0 0\r\n"
+#define SNP_LINE_MAX (10 + 4 * (MY_FTOA_MAX_SIZE + 2) + sizeof(s2_file_tail))
+
+// Value with a leading space, non negative values get one more (same as "% f")
+static char* snp_value(char* p, float value) {
+  *p++ = ' ';
+  if (!signbit(value))
+    *p++ = ' ';
+  return my_ftoa(p, value, MY_FTOA_DIGITS, DIGIT_SEPARATOR);
+}
 
 static FILE_SAVE_CALLBACK(save_snp) {
-  const char* s_file_format;
   char* buf_8 = (char*)spi_buffer;
+  const UINT buffer_size = sizeof(spi_buffer);
+  UINT length = 0;
   FRESULT res;
   UINT size;
-  if (format == FMT_S1P_FILE) {
-    s_file_format = s1_file_param;
+  if (format == FMT_S1P_FILE)
     res = f_write(f, s1_file_header, sizeof(s1_file_header) - 1, &size);
-  } else {
-    s_file_format = s2_file_param;
+  else
     res = f_write(f, s2_file_header, sizeof(s2_file_header) - 1, &size);
-  }
+  // Collect lines and write them in large blocks
   for (int i = 0; i < sweep_points && res == FR_OK; i++) {
-    size = plot_printf(buf_8, 128, s_file_format, get_frequency(i), measured[0][i][0],
-                       measured[0][i][1], measured[1][i][0], measured[1][i][1]);
-    res = f_write(f, buf_8, size, &size);
+    char* p = my_utoa(buf_8 + length, get_frequency(i));
+    p = snp_value(p, measured[0][i][0]);
+    p = snp_value(p, measured[0][i][1]);
+    if (format == FMT_S1P_FILE) {
+      *p++ = '\r';
+      *p++ = '\n';
+    } else {
+      p = snp_value(p, measured[1][i][0]);
+      p = snp_value(p, measured[1][i][1]);
+      memcpy(p, s2_file_tail, sizeof(s2_file_tail) - 1);
+      p += sizeof(s2_file_tail) - 1;
+    }
+    length = p - buf_8;
+    if (length + SNP_LINE_MAX > buffer_size || i == sweep_points - 1) {
+      res = f_write(f, buf_8, length, &size);
+      length = 0;
+    }
   }
   return res;
 }
@@ -163,12 +186,19 @@ static FILE_SAVE_CALLBACK(save_bmp) {
   UINT size;
   uint16_t* buf_16 = (uint16_t*)spi_buffer;
   FRESULT res = f_write(f, bmp_header_v4, sizeof(bmp_header_v4), &size);
+  // Write several rows per call so FatFs passes whole sector runs to the card (multi-block write).
+  // The last row is read as up to 3 bytes per pixel before conversion, keep room for it
+  const int rows = (SPI_BUFFER_SIZE * sizeof(pixel_t) - LCD_WIDTH) / (LCD_WIDTH * sizeof(uint16_t));
   lcd_set_background(LCD_SWEEP_LINE_COLOR);
-  for (int y = LCD_HEIGHT - 1; y >= 0 && res == FR_OK; y--) {
-    lcd_read_memory(0, y, LCD_WIDTH, 1, buf_16);
-    swap_bytes(buf_16, LCD_WIDTH);
-    res = f_write(f, buf_16, LCD_WIDTH * sizeof(uint16_t), &size);
-    lcd_fill(LCD_WIDTH - 1, y, 1, 1);
+  for (int y = LCD_HEIGHT - 1; y >= 0 && res == FR_OK;) {
+    int n;
+    for (n = 0; n < rows && y >= 0; n++, y--) {
+      uint16_t* row = buf_16 + n * LCD_WIDTH;
+      lcd_read_memory(0, y, LCD_WIDTH, 1, row);
+      swap_bytes(row, LCD_WIDTH);
+      lcd_fill(LCD_WIDTH - 1, y, 1, 1);
+    }
+    res = f_write(f, buf_16, n * LCD_WIDTH * sizeof(uint16_t), &size);
   }
   return res;
 }
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Shared helpers for the host benchmarks under tests/bench/.
+ *
+ * Every benchmark prints one machine readable line per kernel:
+ *   BENCH <name> ns/call=<float> points/s=<float>
+ * "points" is the number of sweep points (or values) one call processes, so
+ * points/s stays comparable when a kernel changes its batch size.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t bench_now_ns(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void bench_report(const char* name, uint64_t elapsed_ns, uint32_t calls,
+                                uint32_t points_per_call) {
+  double ns_per_call = (double)elapsed_ns / (double)calls;
+  double points_per_s = (double)points_per_call * 1e9 / ns_per_call;
+  printf("BENCH %s ns/call=%.1f points/s=%.0f\n", name, ns_per_call, points_per_s);
+}
+
+// Repeat body until at least ~100ms elapsed, then report one line
+#define BENCH_RUN(name, points, body)                                                              \
+  do {                                                                                             \
+    uint32_t calls = 0;                                                                            \
+    uint64_t start = bench_now_ns(), elapsed;                                                      \
+    do {                                                                                           \
+      for (int _n = 0; _n < 64; _n++, calls++) {                                                   \
+        body;                                                                                      \
+      }                                                                                            \
+      elapsed = bench_now_ns() - start;                                                            \
+    } while (elapsed < 100000000ULL);                                                              \
+    bench_report(name, elapsed, calls, points);                                                    \
+  } while (0)
+
+// Keep the optimizer from discarding benchmark results
+static volatile uint32_t bench_sink;
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host benchmark for the measurement hot kernels.
+ *
+ * Drives synthetic I2S captures and sweep arrays through the production
+ * dsp_process(), calculate_gamma(), fft(), vna_math approximations and
+ * app_measurement_transform_domain(). Absolute numbers only describe the
+ * host, compare runs of the same machine to catch regressions.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "nanovna.h"
+#include "rf/sweep.h"
+
+void dsp_process(audio_sample_t* capture, size_t length);
+void calculate_gamma(float* gamma);
+void reset_dsp_accumerator(void);
+
+uint16_t sweep_points;
+alignas(8) float measured[2][SWEEP_POINTS_MAX][2];
+alignas(8) pixel_t spi_buffer[SPI_BUFFER_SIZE];
+config_t config;
+properties_t current_props;
+
+#define BENCH_POINTS SWEEP_POINTS_MAX
+
+static audio_sample_t capture[AUDIO_BUFFER_LEN];
+static float values[BENCH_POINTS];
+static float values2[BENCH_POINTS];
+static alignas(8) float fft_source[FFT_SIZE][2];
+static alignas(8) float fft_buffer[FFT_SIZE][2];
+
+static void fill_capture(void) {
+  // Reference and sample at the IF, sample attenuated and phase shifted
+  for (int i = 0; i < AUDIO_SAMPLES_COUNT; i++) {
+    float w = 2.0f * VNA_PI * (float)(i * FREQUENCY_OFFSET) / (float)AUDIO_ADC_FREQ;
+    capture[i * 2 + 0] = (audio_sample_t)(16000.0f * sinf(w));
+    capture[i * 2 + 1] = (audio_sample_t)(8000.0f * sinf(w + 0.7f));
+  }
+}
+
+static void fill_sweep(void) {
+  srand(1);
+  sweep_points = BENCH_POINTS;
+  for (int i = 0; i < BENCH_POINTS; i++) {
+    values[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+    values2[i] = (float)rand() / (float)RAND_MAX * 2.0f - 1.0f;
+  }
+}
+
+static void fill_measured(void) {
+  // Reflection of a delayed mismatch: rotating phasor
+  for (int i = 0; i < BENCH_POINTS; i++) {
+    float s, c;
+    vna_sincosf((float)i * 0.013f, &s, &c);
+    measured[0][i][0] = measured[1][i][0] = 0.5f * c;
+    measured[0][i][1] = measured[1][i][1] = 0.5f * s;
+  }
+}
+
+static void bench_dsp(void) {
+  float gamma[2];
+  fill_capture();
+  reset_dsp_accumerator();
+  // One call processes one capture of a sweep point
+  BENCH_RUN("dsp_process", 1, dsp_process(capture, AUDIO_BUFFER_LEN));
+  BENCH_RUN("calculate_gamma", 1, calculate_gamma(gamma); bench_sink += (uint32_t)gamma[0]);
+}
+
+static void bench_fft(void) {
+  for (int i = 0; i < FFT_SIZE; i++) {
+    fft_source[i][0] = (float)(i & 7);
+    fft_source[i][1] = 0.0f;
+  }
+  // Restart from the same input, repeated transforms would overflow
+  BENCH_RUN("fft_forward", FFT_SIZE, {
+    memcpy(fft_buffer, fft_source, sizeof(fft_buffer));
+    fft_forward(fft_buffer);
+  });
+  BENCH_RUN("fft_inverse", FFT_SIZE, {
+    memcpy(fft_buffer, fft_source, sizeof(fft_buffer));
+    fft_inverse(fft_buffer);
+  });
+  // Half size complex FFT + post twiddle, FFT_SIZE real samples out
+  BENCH_RUN("fft_inverse_real", FFT_SIZE, {
+    memcpy(fft_buffer, fft_source, sizeof(fft_buffer));
+    fft_inverse_real(fft_buffer);
+  });
+}
+
+static void bench_math(void) {
+  float s, c, acc = 0.0f;
+  BENCH_RUN("vna_sincosf", BENCH_POINTS, for (int i = 0; i < BENCH_POINTS; i++) {
+    vna_sincosf(values[i] * 10.0f, &s, &c);
+    acc += s + c;
+  });
+  BENCH_RUN("vna_atan2f", BENCH_POINTS, for (int i = 0; i < BENCH_POINTS; i++) {
+    acc += vna_atan2f(values[i], values2[i]);
+  });
+  BENCH_RUN("vna_log10f_x_10", BENCH_POINTS, for (int i = 0; i < BENCH_POINTS; i++) {
+    acc += vna_log10f_x_10(values[i] * values[i] + 1e-6f);
+  });
+  bench_sink += (uint32_t)acc;
+}
+
+static void bench_transform(const char* name, uint16_t func) {
+  props_mode = (uint16_t)(TD_WINDOW_NORMAL | func);
+  // transform works in place, restore sweep data on every call (timed too, it is a memcpy)
+  BENCH_RUN(name, BENCH_POINTS, {
+    fill_measured();
+    app_measurement_transform_domain(1U);
+  });
+}
+
+int main(void) {
+  fill_sweep();
+  bench_dsp();
+  bench_fft();
+  bench_math();
+  bench_transform("transform_lowpass_impulse", TD_FUNC_LOWPASS_IMPULSE);
+  bench_transform("transform_lowpass_step", TD_FUNC_LOWPASS_STEP);
+  bench_transform("transform_bandpass", TD_FUNC_BANDPASS);
+  return 0;
+}
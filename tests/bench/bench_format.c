@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host benchmark for the text export formatters.
+ *
+ * Builds a 401 point S2P file body (frequency + S11 + S21, the Touchstone
+ * line written by save_snp) twice: once through the generic chprintf "%f"
+ * path used before (plot_printf), once through my_utoa/my_ftoa. Both paths
+ * are the production sources; only the time per sweep differs.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "chprintf.h"
+#include "memstreams.h"
+#include "nanovna.h"
+
+#define BENCH_POINTS 401
+
+char* my_utoa(char* p, uint32_t value);
+char* my_ftoa(char* p, float value, int digits, char separator);
+
+static uint32_t frequency[BENCH_POINTS];
+static float data[2][BENCH_POINTS][2];
+static char line[128];
+
+// chsnprintf() in chprintf.c needs a memory stream, implement the put method only
+static msg_t ms_put(void* instance, uint8_t b) {
+  MemoryStream* ms = instance;
+  if (ms->eos >= ms->size)
+    return MSG_TIMEOUT;
+  ms->buffer[ms->eos++] = b;
+  return MSG_OK;
+}
+
+static const struct BaseSequentialStreamVMT ms_vmt = {NULL, NULL, ms_put, NULL};
+
+void msObjectInit(MemoryStream* msp, uint8_t* buffer, size_t size, size_t eos) {
+  msp->vmt = (void*)&ms_vmt;
+  msp->buffer = buffer;
+  msp->size = size;
+  msp->eos = eos;
+}
+
+static uint32_t sweep_chprintf(void) {
+  uint32_t bytes = 0;
+  for (int i = 0; i < BENCH_POINTS; i++)
+    bytes += plot_printf(line, sizeof(line), "%u % f % f % f % f 0 0 0 0\r\n", frequency[i],
+                         data[0][i][0], data[0][i][1], data[1][i][0], data[1][i][1]);
+  return bytes;
+}
+
+static char* value_space(char* p, float value) {
+  *p++ = ' ';
+  if (!signbit(value))
+    *p++ = ' ';
+  return my_ftoa(p, value, MY_FTOA_DIGITS, '.');
+}
+
+static uint32_t sweep_ftoa(void) {
+  uint32_t bytes = 0;
+  for (int i = 0; i < BENCH_POINTS; i++) {
+    char* p = my_utoa(line, frequency[i]);
+    p = value_space(p, data[0][i][0]);
+    p = value_space(p, data[0][i][1]);
+    p = value_space(p, data[1][i][0]);
+    p = value_space(p, data[1][i][1]);
+    memcpy(p, " 0 0 0 0\r\n", 10);
+    bytes += (uint32_t)(p + 10 - line);
+  }
+  return bytes;
+}
+
+int main(void) {
+  srand(1);
+  for (int i = 0; i < BENCH_POINTS; i++) {
+    frequency[i] = 50000U + (uint32_t)i * 7499875U;
+    for (int ch = 0; ch < 2; ch++) {
+      float mag = (float)rand() / (float)RAND_MAX;
+      float phase = 6.2831853f * (float)rand() / (float)RAND_MAX;
+      data[ch][i][0] = mag * cosf(phase);
+      data[ch][i][1] = mag * sinf(phase);
+    }
+  }
+  // One call writes a full sweep, points/s is S2P lines per second
+  BENCH_RUN("s2p_sweep_chprintf", BENCH_POINTS, bench_sink += sweep_chprintf());
+  BENCH_RUN("s2p_sweep_ftoa", BENCH_POINTS, bench_sink += sweep_ftoa());
+  return 0;
+}
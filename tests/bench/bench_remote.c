@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Byte count benchmark for the remote desktop stream.
+ *
+ * Simulates sweeps redrawing the plot cells a noisy trace passes through (old
+ * and new position, as the plot markmap does) and counts the bytes sent by
+ * the raw "refresh on" stream and by the delta "refresh delta" stream for the
+ * same draw calls. Cell geometry comes from the host stubs.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "sys/remote_stream.h"
+
+config_t config;
+
+#define BENCH_SWEEPS 100
+#define PLOT_WIDTH   (REMOTE_GRID_COLS * CELLWIDTH)
+#define PLOT_HEIGHT  (REMOTE_GRID_ROWS * CELLHEIGHT)
+
+static uint32_t delta_bytes;
+static int16_t trace_y[2][PLOT_WIDTH];
+static uint8_t redraw[REMOTE_GRID_ROWS][REMOTE_GRID_COLS];
+
+static void count_bytes(const void* data, size_t size) {
+  (void)data;
+  delta_bytes += size;
+}
+
+static void render_cell(pixel_t* buf, int cx, int cy, int w, int h, const int16_t* trace) {
+  const pixel_t* pal = config._lcd_palette;
+  for (int y = 0; y < h; y++)
+    for (int x = 0; x < w; x++) {
+      int px = cx + x, py = cy + y;
+      pixel_t c = pal[0];
+      if (px % 40 == 0 || py % 40 == 0)
+        c = pal[2];
+      if (abs(trace[px] - py) <= 1)
+        c = pal[6];
+      buf[y * w + x] = c;
+    }
+}
+
+static void mark_trace(const int16_t* trace) {
+  for (int x = 0; x < PLOT_WIDTH; x++) {
+    int y = trace[x];
+    if (y >= 0 && y < PLOT_HEIGHT)
+      redraw[y / CELLHEIGHT][x / CELLWIDTH] = 1;
+  }
+}
+
+int main(void) {
+  static pixel_t cell[CELLWIDTH * CELLHEIGHT];
+  uint32_t raw_bytes = 0;
+  uint32_t cells = 0;
+  for (int i = 0; i < MAX_PALETTE; i++)
+    config._lcd_palette[i] = (pixel_t)(0x0841U * i);
+  remote_stream_start(count_bytes);
+  srand(1);
+  memset(redraw, 1, sizeof(redraw)); // first frame: everything
+  for (int sweep = 0; sweep <= BENCH_SWEEPS; sweep++) {
+    int16_t* trace = trace_y[sweep & 1];
+    for (int x = 0; x < PLOT_WIDTH; x++)
+      trace[x] = (int16_t)(PLOT_HEIGHT / 2 + (PLOT_HEIGHT / 3) * ((x * 7) % 100 - 50) / 50 / 4 +
+                           rand() % 3 - 1);
+    mark_trace(trace);
+    for (int r = 0; r < REMOTE_GRID_ROWS; r++)
+      for (int c = 0; c < REMOTE_GRID_COLS; c++) {
+        if (!redraw[r][c])
+          continue;
+        redraw[r][c] = 0;
+        render_cell(cell, c * CELLWIDTH, r * CELLHEIGHT, CELLWIDTH, CELLHEIGHT, trace);
+        raw_bytes += sizeof(remote_region_t) + CELLWIDTH * CELLHEIGHT * sizeof(pixel_t) + 6;
+        remote_stream_bulk(OFFSETX + c * CELLWIDTH, OFFSETY + r * CELLHEIGHT, CELLWIDTH, CELLHEIGHT,
+                           cell);
+        cells++;
+      }
+    // Cells of this trace are redrawn on the next sweep (old position is erased)
+    mark_trace(trace);
+  }
+  printf("BENCH remote_stream_raw bytes/sweep=%u cells/sweep=%u\n", raw_bytes / (BENCH_SWEEPS + 1),
+         cells / (BENCH_SWEEPS + 1));
+  printf("BENCH remote_stream_delta bytes/sweep=%u ratio=%.3f\n", delta_bytes / (BENCH_SWEEPS + 1),
+         (double)delta_bytes / (double)raw_bytes);
+  return 0;
+}
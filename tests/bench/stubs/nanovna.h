@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Benchmark extension of tests/stubs/nanovna.h: sweep state used by
+ * src/rf/transform.c. The benchmark owns the variables, the same way
+ * test_legacy_measure.c provides sweep_points and measured[].
+ */
+
+#pragma once
+
+#include <stdalign.h>
+
+#include "../../stubs/nanovna.h"
+
+// ChibiOS boolean constants
+#ifndef FALSE
+#define FALSE 0
+#define TRUE  1
+#endif
+
+#define props_mode    current_props._mode
+#define domain_window (props_mode & TD_WINDOW)
+#define domain_func   (props_mode & TD_FUNC)
+
+// FFT work buffer, FFT_SIZE complex floats
+#define SPI_BUFFER_SIZE (FFT_SIZE * 2 * sizeof(float) / sizeof(pixel_t))
+
+extern uint16_t sweep_points;
+extern alignas(8) float measured[2][SWEEP_POINTS_MAX][2];
+extern alignas(8) pixel_t spi_buffer[SPI_BUFFER_SIZE];
@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host sweep simulator: the production sweep engine, DSP, calibration and
+ * si5351/tlv320 drivers run on a virtual clock against simulated buses and a
+ * simulated I2S DMA source that synthesises the codec input from a DUT model.
+ *
+ * sim_kernel.c - virtual time, cooperative threads, free running I2S DMA
+ * sim_board.c  - I2C devices, firmware globals and the glue normally in runtime_entry.c
+ * sim_dut.c    - DUT models (RLC, Touchstone), error box and waveform synthesis
+ */
+
+#pragma once
+
+#include <complex.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "nanovna.h"
+
+/*
+ * Virtual time, in ns. It advances only when the firmware sleeps, waits for
+ * an interrupt or occupies the I2C bus, so it is the device time of a sweep
+ * without the CPU time of the firmware itself.
+ */
+uint64_t sim_now_ns(void);
+void sim_advance_ns(uint64_t ns);
+// Host monotonic clock, ns, for the cost of running the firmware code
+uint64_t sim_host_now_ns(void);
+// Start the I2S DMA: one half buffer every AUDIO_SAMPLES_COUNT / AUDIO_ADC_FREQ seconds
+void sim_kernel_init(void);
+/*
+ * Hold every n-th DSP job (0 - none) until after the next DMA half, whose
+ * refill then corrupts the buffer the worker correlates: a late worker.
+ */
+void sim_kernel_set_late_worker(uint32_t every);
+// Jobs held back since sim_kernel_set_late_worker()
+uint32_t sim_kernel_late_workers(void);
+
+// Bus traffic since sim_board_init(): bytes on the wire and time the bus was busy
+typedef struct {
+  uint32_t si5351_bytes;
+  uint32_t tlv320_bytes;
+  uint64_t busy_ns;
+} sim_i2c_stats_t;
+
+void sim_board_init(void);
+void sim_board_get_i2c_stats(sim_i2c_stats_t* stats);
+
+// Generator retunes and codec input selects, in the order the sweep made them
+typedef enum {
+  SIM_CALL_FREQUENCY,
+  SIM_CALL_CHANNEL,
+} sim_call_kind_t;
+
+typedef struct {
+  sim_call_kind_t kind;
+  uint32_t value; // Hz or channel
+} sim_driver_call_t;
+
+// Record into log (up to size calls, NULL stops), returns the calls recorded so far
+void sim_board_record_calls(sim_driver_call_t* log, uint32_t size);
+uint32_t sim_board_recorded_calls(void);
+
+// Display framebuffer (sim_lcd.c) and the SPI traffic lcd.c would send for it
+typedef struct {
+  uint32_t cells;   // plot cells sent by lcd_bulk_continue()
+  uint32_t windows; // address windows set (CASET/RASET/RAMWR)
+  uint64_t bytes;   // commands and pixel data
+} sim_lcd_stats_t;
+
+extern pixel_t sim_framebuffer[LCD_HEIGHT][LCD_WIDTH];
+void sim_lcd_get_stats(sim_lcd_stats_t* stats);
+void sim_lcd_reset_stats(void);
+uint32_t sim_lcd_checksum(void);
+// Binary PPM (P6) of the framebuffer
+bool sim_lcd_write_ppm(const char* path);
+
+/*
+ * Device under test. LOAD terminates port 1, SERIES and SHUNT place the RLC
+ * element in or across the line between the ports, FILE interpolates a
+ * Touchstone file. The calibration standards are ideal.
+ */
+typedef enum {
+  SIM_DUT_LOAD,
+  SIM_DUT_SERIES,
+  SIM_DUT_SHUNT,
+  SIM_DUT_FILE,
+  SIM_STD_OPEN,
+  SIM_STD_SHORT,
+  SIM_STD_MATCH,
+  SIM_STD_THRU,
+  SIM_STD_ISOLATION,
+} sim_dut_kind_t;
+
+// Series R + jwL + 1/(jwC), c == 0 - no capacitor
+typedef struct {
+  double r;
+  double l;
+  double c;
+} sim_rlc_t;
+
+typedef struct {
+  uint32_t points;
+  double* freq;
+  double complex (*s)[2]; // S11, S21 (S21 = 0 for .s1p)
+} sim_touchstone_t;
+
+// Returns false with a message on stderr if the file can not be used
+bool sim_touchstone_load(sim_touchstone_t* ts, const char* path);
+void sim_touchstone_free(sim_touchstone_t* ts);
+
+typedef struct {
+  double amplitude;   // reference level at the ADC, LSB (fundamental bands)
+  double noise;       // ADC noise, LSB rms
+  double phase_noise; // sample to reference phase jitter, rad rms
+  double settle_eps;  // relative response error right after a frequency change
+  double settle_tau;  // its time constant, s
+  bool error_box;     // false - ideal bridge and receivers
+  bool fixed_phase;   // every buffer starts at IF phase 0: captures depend on the stimulus only
+  uint32_t seed;
+} sim_signal_t;
+
+void sim_dut_init(const sim_signal_t* signal);
+void sim_dut_select(sim_dut_kind_t kind, const sim_rlc_t* rlc, const sim_touchstone_t* ts);
+// True S11/S21 of the selected DUT at freq
+void sim_dut_response(double freq, double complex s[2]);
+
+// Driver hooks (sim_board.c wraps the production drivers)
+void sim_dut_set_stimulus(uint32_t freq);
+void sim_dut_set_channel(uint8_t channel);
+// I2S DMA source: fill one half buffer that ends at the current virtual time
+void sim_dut_fill(audio_sample_t* buffer, uint32_t samples);
@@ -0,0 +1,302 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Simulated board: register level I2C devices with bus timing, the firmware
+ * globals and the runtime glue the sweep engine calls into. The production
+ * si5351/tlv320 drivers are linked unmodified; the linker wraps their entry
+ * points used by the sweep (-Wl,--wrap) to tell the DUT model what the
+ * generator and the codec input mux are set to.
+ */
+
+#include <string.h>
+
+#include "nanovna.h"
+#include "chprintf.h"
+#include "memstreams.h"
+#include "driver/si5351.h"
+#include "rf/sweep.h"
+#include "sim.h"
+#include "ui/draw/render.h"
+
+#define SI5351_I2C_ADDR 0x60
+#define AIC3204_I2C_ADDR 0x18
+// Start or stop plus 8 data bits and ACK per byte
+#define I2C_BYTE_NS (9ULL * 1000000ULL / STM32_I2C_SPEED)
+
+typedef struct {
+  uint8_t addr;
+  uint8_t regs[256];
+  uint32_t bytes;
+} sim_i2c_device_t;
+
+static sim_i2c_device_t i2c_devices[] = {
+    {.addr = SI5351_I2C_ADDR},
+    {.addr = AIC3204_I2C_ADDR},
+};
+static uint64_t i2c_busy_ns;
+
+// Firmware globals (runtime_entry.c, config_service.c)
+config_t config;
+alignas(8) properties_t current_props;
+alignas(8) float measured[2][SWEEP_POINTS_MAX][2];
+volatile bool calibration_in_progress = false;
+uint16_t lastsaveid = 0;
+
+GPIO_TypeDef sim_gpio[3];
+RTC_TypeDef sim_rtc;
+WDGDriver WDGD1;
+
+static sim_i2c_device_t* i2c_find(uint8_t addr) {
+  for (size_t i = 0; i < ARRAY_COUNT(i2c_devices); i++) {
+    if (i2c_devices[i].addr == addr)
+      return &i2c_devices[i];
+  }
+  return NULL;
+}
+
+static void i2c_account(sim_i2c_device_t* dev, size_t bytes) {
+  dev->bytes += bytes;
+  i2c_busy_ns += bytes * I2C_BYTE_NS;
+  sim_advance_ns(bytes * I2C_BYTE_NS);
+}
+
+// Register writes auto-increment from the first byte (register address)
+bool i2c_transfer(uint8_t addr, const uint8_t* w, size_t wn) {
+  sim_i2c_device_t* dev = i2c_find(addr);
+  if (dev == NULL)
+    return false;
+  if (wn > 1U) {
+    uint8_t reg = w[0];
+    for (size_t i = 1; i < wn; i++)
+      dev->regs[reg++] = w[i];
+  }
+  i2c_account(dev, 1U + wn);
+  return true;
+}
+
+bool i2c_receive(uint8_t addr, const uint8_t* w, size_t wn, uint8_t* r, size_t rn) {
+  sim_i2c_device_t* dev = i2c_find(addr);
+  if (dev == NULL)
+    return false;
+  uint8_t reg = wn ? w[0] : 0U;
+  for (size_t i = 0; i < rn; i++, reg++) {
+    // si5351 device status: SYS_INIT and PLL loss of lock always clear
+    r[i] = (addr == SI5351_I2C_ADDR && reg == 0U) ? 0U : dev->regs[reg];
+  }
+  i2c_account(dev, 2U + wn + rn);
+  return true;
+}
+
+// Queued writes land at once: the virtual clock does not model CPU time to overlap
+bool i2c_write_async(uint8_t addr, const uint8_t* w, size_t wn) {
+  return i2c_transfer(addr, w, wn);
+}
+
+bool i2c_flush(void) {
+  return true;
+}
+
+void sim_board_get_i2c_stats(sim_i2c_stats_t* stats) {
+  stats->si5351_bytes = i2c_find(SI5351_I2C_ADDR)->bytes;
+  stats->tlv320_bytes = i2c_find(AIC3204_I2C_ADDR)->bytes;
+  stats->busy_ns = i2c_busy_ns;
+}
+
+static sim_driver_call_t* call_log;
+static uint32_t call_log_size;
+static uint32_t call_count;
+
+void sim_board_record_calls(sim_driver_call_t* log, uint32_t size) {
+  call_log = log;
+  call_log_size = size;
+  call_count = 0;
+}
+
+uint32_t sim_board_recorded_calls(void) {
+  return call_count;
+}
+
+static void record_call(sim_call_kind_t kind, uint32_t value) {
+  if (call_log == NULL)
+    return;
+  if (call_count < call_log_size)
+    call_log[call_count] = (sim_driver_call_t){kind, value};
+  call_count++;
+}
+
+int __real_si5351_set_frequency(uint32_t freq, uint8_t drive_strength);
+int __wrap_si5351_set_frequency(uint32_t freq, uint8_t drive_strength) {
+  int delay = __real_si5351_set_frequency(freq, drive_strength);
+  sim_dut_set_stimulus(freq);
+  record_call(SIM_CALL_FREQUENCY, freq);
+  return delay;
+}
+
+void __real_tlv320aic3204_select(uint8_t channel);
+void __wrap_tlv320aic3204_select(uint8_t channel) {
+  __real_tlv320aic3204_select(channel);
+  sim_dut_set_channel(channel);
+  record_call(SIM_CALL_CHANNEL, channel);
+}
+
+/*
+ * Runtime glue, same behaviour as runtime_entry.c for the parts the sweep,
+ * calibration and renderer use; event bus notifications are dropped.
+ */
+bool need_interpolate(freq_t start, freq_t stop, uint16_t points) {
+  if (sweep_service_segments_active())
+    return true;
+  return start != cal_frequency0 || stop != cal_frequency1 || points != cal_sweep_points;
+}
+
+void app_measurement_update_frequencies(void) {
+  freq_t start = frequency0 <= frequency1 ? frequency0 : frequency1;
+  freq_t stop = frequency0 <= frequency1 ? frequency1 : frequency0;
+  app_measurement_set_frequencies(start, stop, sweep_points);
+  update_grid(start, stop);
+  if (need_interpolate(start, stop, sweep_points))
+    cal_status |= CALSTAT_INTERPOLATED;
+  else
+    cal_status &= (uint16_t)~CALSTAT_INTERPOLATED;
+  request_to_redraw(REDRAW_PLOT | REDRAW_CAL_STATUS | REDRAW_FREQUENCY | REDRAW_AREA);
+  sweep_service_reset_progress();
+}
+
+uint32_t get_bandwidth_frequency(uint16_t bw_freq) {
+  return (AUDIO_ADC_FREQ / AUDIO_SAMPLES_COUNT) / (bw_freq + 1);
+}
+
+bool event_bus_publish(event_bus_t* bus, event_bus_topic_t topic, const void* payload) {
+  (void)bus;
+  (void)topic;
+  (void)payload;
+  return true;
+}
+
+void set_marker_index(int m, int idx) {
+  if (idx < 0)
+    idx = 0;
+  if (idx >= sweep_points)
+    idx = sweep_points - 1;
+  if (markers[m].enabled)
+    request_to_draw_marker(markers[m].index);
+  markers[m].index = idx;
+  markers[m].frequency = get_frequency(idx);
+  request_to_redraw(REDRAW_MARKER);
+}
+
+freq_t get_marker_frequency(int marker) {
+  return markers[marker].frequency;
+}
+
+float get_electrical_delay(void) {
+  if (current_trace == TRACE_INVALID)
+    return 0.0f;
+  return current_props._electrical_delay[trace[current_trace].channel];
+}
+
+const char* get_trace_chname(int t) {
+  static const char* const channel_name[] = {"S11", "S21"};
+  return channel_name[trace[t].channel & 1];
+}
+
+void update_backup_data(void) {}
+
+// Battery voltage in mV, fixed so the status icon renders the same every time
+int16_t adc_vbat_read(void) {
+  return 3700;
+}
+
+// DWT cycle counter on the virtual clock: only blocking waits take time
+uint32_t cycle_counter_read(void) {
+  return (uint32_t)(sim_now_ns() * (CYCLE_COUNTER_FREQ / 1000000U) / 1000U);
+}
+
+// chsnprintf() memory stream, put method only
+static msg_t ms_put(void* instance, uint8_t b) {
+  MemoryStream* ms = instance;
+  if (ms->eos >= ms->size)
+    return MSG_TIMEOUT;
+  ms->buffer[ms->eos++] = b;
+  return MSG_OK;
+}
+
+static const struct BaseSequentialStreamVMT ms_vmt = {NULL, NULL, ms_put, NULL};
+
+void msObjectInit(MemoryStream* msp, uint8_t* buffer, size_t size, size_t eos) {
+  msp->vmt = &ms_vmt;
+  msp->buffer = buffer;
+  msp->size = size;
+  msp->eos = eos;
+}
+
+// Power on defaults of config (runtime_entry.c) and properties (state_manager.c)
+static void sim_load_defaults(void) {
+  static const config_t config_defaults = {
+      .magic = CONFIG_MAGIC,
+      ._harmonic_freq_threshold = FREQUENCY_THRESHOLD,
+      ._IF_freq = FREQUENCY_OFFSET,
+      ._vna_mode = (1 << VNA_MODE_SHOW_GRID) | (1 << VNA_MODE_DOT_GRID),
+      ._bandwidth = BANDWIDTH_1000,
+      ._lcd_palette = LCD_DEFAULT_PALETTE,
+      ._xtal_freq = XTALFREQ,
+      ._lever_mode = LM_MARKER,
+      ._band_mode = 0,
+  };
+  config = config_defaults;
+
+  memset(&current_props, 0, sizeof(current_props));
+  current_props.magic = PROPERTIES_MAGIC;
+  current_props._frequency0 = 50000;
+  current_props._frequency1 = 900000000U;
+  current_props._sweep_points = POINTS_COUNT_DEFAULT;
+  current_props._cal_frequency0 = 50000;
+  current_props._cal_frequency1 = 900000000U;
+  current_props._cal_sweep_points = POINTS_COUNT_DEFAULT;
+  current_props._trace[0] = (trace_t){true, TRC_LOGMAG, 0, MS_RX, 10.0f, NGRIDY - 1};
+  current_props._trace[1] = (trace_t){true, TRC_LOGMAG, 1, MS_REIM, 10.0f, NGRIDY - 1};
+  current_props._trace[2] = (trace_t){true, TRC_SMITH, 0, MS_RX, 1.0f, 0};
+  current_props._trace[3] = (trace_t){true, TRC_PHASE, 1, MS_REIM, 90.0f, NGRIDY / 2};
+  for (int i = 0; i < MARKERS_MAX; i++) {
+    current_props._markers[i].enabled = (i == 0);
+    current_props._markers[i].index = (int16_t)(10 * (i + 1) * SWEEP_POINTS_MAX / 100 - 1);
+  }
+  current_props._velocity_factor = 70;
+  current_props._previous_marker = MARKER_INVALID;
+  current_props._portz = 50.0f;
+  current_props._cal_load_r = 50.0f;
+  current_props._power = SI5351_CLK_DRIVE_STRENGTH_AUTO;
+  current_props._cal_power = SI5351_CLK_DRIVE_STRENGTH_AUTO;
+}
+
+// Same order as the firmware start up: generator, IF table, codec, I2S, sweep service
+void sim_board_init(void) {
+  sim_load_defaults();
+  si5351_init();
+  si5351_set_frequency_offset(IF_OFFSET);
+  tlv320aic3204_init();
+  sim_kernel_init();
+  sweep_service_init(NULL);
+  app_measurement_update_frequencies();
+  for (size_t i = 0; i < ARRAY_COUNT(i2c_devices); i++)
+    i2c_devices[i].bytes = 0;
+  i2c_busy_ns = 0;
+}
@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * DUT and front end model of the simulator.
+ *
+ * The codec sees the reference and the selected receiver at the IF. With
+ * gamma = S11m (channel 0) or S21m (channel 1) the sample input is
+ *   ref = A cos(wt + p), sample = A |gamma| cos(wt + p - arg(gamma))
+ * which calculate_gamma() turns back into gamma. S11m/S21m are the true
+ * S-parameters seen through a frequency dependent error box:
+ *   S11m = Ed + Er S11 / (1 - Es S11)
+ *   S21m = Ex + Et S21 / (1 - Es S11)
+ * the one-port plus enhanced response model the firmware calibration solves.
+ */
+
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "sim.h"
+
+#define SIM_Z0 50.0
+
+static sim_signal_t signal;
+static sim_dut_kind_t dut_kind = SIM_STD_MATCH;
+static sim_rlc_t dut_rlc;
+static const sim_touchstone_t* dut_file;
+
+static uint32_t stimulus_freq;
+static uint64_t stimulus_set_ns;
+static double stimulus_phase; // IF phase after the last generator change, turns
+static uint8_t channel;
+static double complex channel_gain[2]; // S11m, S21m at stimulus_freq
+static double harmonic_gain;
+
+static uint64_t rng_state;
+static bool gauss_cached;
+static double gauss_next;
+
+static double sim_uniform(void) {
+  // xorshift64*, 53 bit mantissa in (0, 1)
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return ((rng_state * 0x2545F4914F6CDD1DULL >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static double sim_gauss(void) {
+  if (gauss_cached) {
+    gauss_cached = false;
+    return gauss_next;
+  }
+  double r = sqrt(-2.0 * log(sim_uniform()));
+  double a = 2.0 * M_PI * sim_uniform();
+  gauss_next = r * sin(a);
+  gauss_cached = true;
+  return r * cos(a);
+}
+
+static double complex rlc_impedance(double freq) {
+  double complex jw = I * 2.0 * M_PI * freq;
+  double complex z = dut_rlc.r + jw * dut_rlc.l;
+  if (dut_rlc.c > 0.0)
+    z += 1.0 / (jw * dut_rlc.c);
+  return z;
+}
+
+static void touchstone_response(const sim_touchstone_t* ts, double freq, double complex s[2]) {
+  uint32_t hi = 0;
+  while (hi < ts->points && ts->freq[hi] < freq)
+    hi++;
+  if (hi == 0 || hi == ts->points) {
+    uint32_t i = hi ? ts->points - 1U : 0U;
+    s[0] = ts->s[i][0];
+    s[1] = ts->s[i][1];
+    return;
+  }
+  uint32_t lo = hi - 1U;
+  double k = (freq - ts->freq[lo]) / (ts->freq[hi] - ts->freq[lo]);
+  for (int n = 0; n < 2; n++)
+    s[n] = ts->s[lo][n] + (ts->s[hi][n] - ts->s[lo][n]) * k;
+}
+
+void sim_dut_response(double freq, double complex s[2]) {
+  double complex z;
+  switch (dut_kind) {
+  case SIM_DUT_LOAD:
+    z = rlc_impedance(freq);
+    s[0] = (z - SIM_Z0) / (z + SIM_Z0);
+    s[1] = 0.0;
+    break;
+  case SIM_DUT_SERIES:
+    z = rlc_impedance(freq);
+    s[0] = z / (z + 2.0 * SIM_Z0);
+    s[1] = 2.0 * SIM_Z0 / (z + 2.0 * SIM_Z0);
+    break;
+  case SIM_DUT_SHUNT:
+    z = rlc_impedance(freq);
+    s[0] = -SIM_Z0 / (2.0 * z + SIM_Z0);
+    s[1] = 2.0 * z / (2.0 * z + SIM_Z0);
+    break;
+  case SIM_DUT_FILE:
+    touchstone_response(dut_file, freq, s);
+    break;
+  case SIM_STD_OPEN:
+    s[0] = 1.0;
+    s[1] = 0.0;
+    break;
+  case SIM_STD_SHORT:
+    s[0] = -1.0;
+    s[1] = 0.0;
+    break;
+  case SIM_STD_THRU:
+    s[0] = 0.0;
+    s[1] = 1.0;
+    break;
+  case SIM_STD_MATCH:
+  case SIM_STD_ISOLATION:
+  default:
+    s[0] = 0.0;
+    s[1] = 0.0;
+    break;
+  }
+}
+
+// Bridge directivity/match/tracking with some cable delay and HF roll-off
+static void error_box(double freq, double complex s[2]) {
+  if (!signal.error_box)
+    return;
+  double w = 2.0 * M_PI * freq;
+  double rolloff = 1.0 / (1.0 + freq / 2e9);
+  double complex ed = 0.05 * cexp(-I * (w * 0.2e-9 + 0.3));
+  double complex es = 0.10 * cexp(-I * (w * 0.4e-9 - 0.5));
+  double complex er = 0.90 * rolloff * cexp(-I * w * 0.6e-9);
+  double complex et = 0.80 * rolloff * cexp(-I * w * 1.0e-9);
+  double complex ex = 0.001;
+  double complex den = 1.0 - es * s[0];
+  double complex s21 = ex + et * s[1] / den;
+  s[0] = ed + er * s[0] / den;
+  s[1] = s21;
+}
+
+// CLK outputs are square waves: harmonic bands see 1/3 and 1/5 of the level
+static double harmonic_level(uint32_t freq) {
+  uint32_t threshold = config._harmonic_freq_threshold;
+  if (freq <= threshold)
+    return 1.0;
+  return freq <= 3ULL * threshold ? 1.0 / 3.0 : 1.0 / 5.0;
+}
+
+static void update_gain(void) {
+  double complex s[2];
+  sim_dut_response(stimulus_freq, s);
+  error_box(stimulus_freq, s);
+  channel_gain[0] = s[0];
+  channel_gain[1] = s[1];
+  harmonic_gain = stimulus_freq ? harmonic_level(stimulus_freq) : 0.0;
+}
+
+void sim_dut_init(const sim_signal_t* sig) {
+  signal = *sig;
+  rng_state = 0x9E3779B97F4A7C15ULL ^ signal.seed;
+  gauss_cached = false;
+  stimulus_freq = 0;
+  channel = 0;
+  update_gain();
+}
+
+void sim_dut_select(sim_dut_kind_t kind, const sim_rlc_t* rlc, const sim_touchstone_t* ts) {
+  dut_kind = kind;
+  if (rlc != NULL)
+    dut_rlc = *rlc;
+  dut_file = ts;
+  update_gain();
+}
+
+void sim_dut_set_stimulus(uint32_t freq) {
+  if (freq == stimulus_freq)
+    return;
+  stimulus_freq = freq;
+  stimulus_set_ns = sim_now_ns();
+  // PLL reprogrammed: the IF restarts at an arbitrary phase
+  stimulus_phase = sim_uniform();
+  update_gain();
+}
+
+void sim_dut_set_channel(uint8_t ch) {
+  channel = ch ? 1U : 0U;
+}
+
+static audio_sample_t adc_clip(double v) {
+  if (v > 32767.0)
+    return 32767;
+  if (v < -32768.0)
+    return -32768;
+  return (audio_sample_t)lrint(v);
+}
+
+void sim_dut_fill(audio_sample_t* buffer, uint32_t samples) {
+  const double fs = AUDIO_ADC_FREQ;
+  const double fif = IF_OFFSET;
+  double t0 = sim_now_ns() * 1e-9 - samples / fs;
+  double turns = signal.fixed_phase ? 0.0 : fif * t0 + stimulus_phase;
+  turns -= floor(turns);
+  double complex z = signal.amplitude * harmonic_gain * cexp(I * 2.0 * M_PI * turns);
+  double complex rot = cexp(I * 2.0 * M_PI * fif / fs);
+  double complex g = conj(channel_gain[channel]);
+  double settle_t = t0 - stimulus_set_ns * 1e-9;
+  for (uint32_t k = 0; k < samples; k++, z *= rot) {
+    double complex gk = g;
+    if (signal.settle_eps != 0.0)
+      gk *= 1.0 + signal.settle_eps * exp(-(settle_t + k / fs) / signal.settle_tau);
+    if (signal.phase_noise != 0.0)
+      gk *= cexp(I * signal.phase_noise * sim_gauss());
+    double ref = creal(z);
+    double smp = creal(z * gk);
+    if (signal.noise != 0.0) {
+      ref += signal.noise * sim_gauss();
+      smp += signal.noise * sim_gauss();
+    }
+    buffer[2 * k + 0] = adc_clip(ref);
+    buffer[2 * k + 1] = adc_clip(smp);
+  }
+}
+
+/*
+ * Touchstone 1.x reader (.s1p/.s2p): "# <unit> S <RI|MA|DB> R 50" option
+ * line, '!' comments, data points may wrap over several lines.
+ */
+static bool touchstone_option(char* line, double* unit, int* format) {
+  for (char* tok = strtok(line + 1, " \t\r\n"); tok != NULL; tok = strtok(NULL, " \t\r\n")) {
+    if (!strcasecmp(tok, "HZ"))
+      *unit = 1.0;
+    else if (!strcasecmp(tok, "KHZ"))
+      *unit = 1e3;
+    else if (!strcasecmp(tok, "MHZ"))
+      *unit = 1e6;
+    else if (!strcasecmp(tok, "GHZ"))
+      *unit = 1e9;
+    else if (!strcasecmp(tok, "RI") || !strcasecmp(tok, "MA") || !strcasecmp(tok, "DB"))
+      *format = toupper((unsigned char)tok[0]);
+    else if (!strcasecmp(tok, "R")) {
+      tok = strtok(NULL, " \t\r\n");
+      if (tok == NULL || strtod(tok, NULL) != SIM_Z0)
+        return false;
+    } else if (strcasecmp(tok, "S"))
+      return false;
+  }
+  return true;
+}
+
+static double complex touchstone_value(int format, double a, double b) {
+  switch (format) {
+  case 'R':
+    return a + I * b;
+  case 'D':
+    a = pow(10.0, a / 20.0);
+    /* fall through */
+  default:
+    return a * cexp(I * b * (M_PI / 180.0));
+  }
+}
+
+bool sim_touchstone_load(sim_touchstone_t* ts, const char* path) {
+  memset(ts, 0, sizeof(*ts));
+  const char* ext = strrchr(path, '.');
+  int ports = (ext && !strcasecmp(ext, ".s1p")) ? 1 : (ext && !strcasecmp(ext, ".s2p")) ? 2 : 0;
+  FILE* f = fopen(path, "r");
+  if (ports == 0 || f == NULL) {
+    fprintf(stderr, "sim: %s: need a readable .s1p or .s2p file\n", path);
+    if (f)
+      fclose(f);
+    return false;
+  }
+  const int per_point = 1 + 2 * ports * ports;
+  double unit = 1e9; // Touchstone defaults: GHz, MA
+  int format = 'M';
+  double values[9];
+  int count = 0;
+  uint32_t capacity = 0;
+  char line[512];
+  bool ok = true;
+  while (ok && fgets(line, sizeof(line), f)) {
+    char* comment = strchr(line, '!');
+    if (comment)
+      *comment = '\0';
+    if (line[0] == '#') {
+      ok = touchstone_option(line, &unit, &format);
+      continue;
+    }
+    char* p = line;
+    char* end;
+    for (double v = strtod(p, &end); end != p; v = strtod(p, &end)) {
+      p = end;
+      values[count++] = v;
+      if (count < per_point)
+        continue;
+      count = 0;
+      if (ts->points == capacity) {
+        capacity = capacity ? capacity * 2U : 64U;
+        ts->freq = realloc(ts->freq, capacity * sizeof(*ts->freq));
+        ts->s = realloc(ts->s, capacity * sizeof(*ts->s));
+      }
+      double freq = values[0] * unit;
+      if (ts->points && freq <= ts->freq[ts->points - 1U]) {
+        ok = false;
+        break;
+      }
+      ts->freq[ts->points] = freq;
+      ts->s[ts->points][0] = touchstone_value(format, values[1], values[2]);
+      ts->s[ts->points][1] = ports == 2 ? touchstone_value(format, values[3], values[4]) : 0.0;
+      ts->points++;
+    }
+  }
+  fclose(f);
+  if (!ok || count != 0 || ts->points == 0) {
+    fprintf(stderr, "sim: %s: unsupported options (S-parameters, R 50) or bad data\n", path);
+    sim_touchstone_free(ts);
+    return false;
+  }
+  return true;
+}
+
+void sim_touchstone_free(sim_touchstone_t* ts) {
+  free(ts->freq);
+  free(ts->s);
+  memset(ts, 0, sizeof(*ts));
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * ChibiOS subset on a virtual clock. The main program is the sweep thread;
+ * firmware threads (the DSP worker) are ucontext coroutines that run as soon
+ * as an interrupt resumes them and give the CPU back when they suspend, the
+ * way the higher priority worker preempts the sweep thread on the target.
+ * sim_kernel_set_late_worker() holds some of them back past the next DMA half
+ * to exercise the overrun path.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "rf/sweep.h"
+#include "sim.h"
+
+// Host stack per thread, the firmware working areas are sized for the target ABI
+#define SIM_THREAD_STACK (256U * 1024U)
+#define SIM_THREADS_MAX 4
+
+#define SIM_NS_PER_TICK (1000000000ULL / CH_CFG_ST_FREQUENCY)
+#define SIM_DMA_HALF_NS (1000000000ULL * AUDIO_SAMPLES_COUNT / AUDIO_ADC_FREQ)
+
+struct sim_thread {
+  ucontext_t context;
+  void* stack;
+  tfunc_t entry;
+  void* arg;
+  bool ready;
+  msg_t message;
+};
+
+static thread_t main_thread;
+static thread_t* current = &main_thread;
+static thread_t* threads[SIM_THREADS_MAX];
+static uint32_t thread_count;
+
+static uint64_t now_ns;
+static uint64_t dma_next_ns = UINT64_MAX; // DMA stopped until sim_kernel_init()
+static uint8_t dma_half;
+
+static uint32_t late_worker_every; // hold back every n-th DSP job, 0 - never
+static uint32_t late_worker_jobs;
+static uint32_t late_worker_count;
+static bool late_worker_pending;
+
+static void sim_fatal(const char* message) {
+  fprintf(stderr, "sim: %s\n", message);
+  exit(2);
+}
+
+static void sim_run_ready(void) {
+  bool ran;
+  do {
+    ran = false;
+    for (uint32_t i = 0; i < thread_count; i++) {
+      thread_t* tp = threads[i];
+      if (!tp->ready)
+        continue;
+      tp->ready = false;
+      current = tp;
+      swapcontext(&main_thread.context, &tp->context);
+      current = &main_thread;
+      ran = true;
+    }
+  } while (ran);
+}
+
+static bool sim_thread_ready(void) {
+  for (uint32_t i = 0; i < thread_count; i++) {
+    if (threads[i]->ready)
+      return true;
+  }
+  return false;
+}
+
+static void sim_dma_event(void) {
+  audio_sample_t* rx = (audio_sample_t*)sweep_service_rx_buffer();
+  audio_sample_t* half = rx + dma_half * AUDIO_BUFFER_LEN;
+  sim_dut_fill(half, AUDIO_SAMPLES_COUNT);
+  i2s_lld_serve_rx_interrupt(dma_half ? STM32_DMA_ISR_TCIF : STM32_DMA_ISR_HTIF);
+  dma_half ^= 1U;
+  if (late_worker_pending) {
+    // The DMA now refills the half the late worker is about to correlate:
+    // it reads inverted samples if it uses the buffer anyway
+    half = rx + dma_half * AUDIO_BUFFER_LEN;
+    for (uint32_t i = 0; i < AUDIO_BUFFER_LEN; i++)
+      half[i] = (audio_sample_t)~half[i];
+    late_worker_pending = false;
+  } else if (late_worker_every != 0U && sim_thread_ready() &&
+             ++late_worker_jobs % late_worker_every == 0U) {
+    // Worker stays ready until after the next half
+    late_worker_pending = true;
+    late_worker_count++;
+    return;
+  }
+  sim_run_ready();
+}
+
+void sim_advance_ns(uint64_t ns) {
+  if (current != &main_thread)
+    sim_fatal("only the sweep thread may wait");
+  uint64_t target = now_ns + ns;
+  while (dma_next_ns <= target) {
+    now_ns = dma_next_ns;
+    dma_next_ns += SIM_DMA_HALF_NS;
+    sim_dma_event();
+  }
+  now_ns = target;
+}
+
+uint64_t sim_now_ns(void) {
+  return now_ns;
+}
+
+uint64_t sim_host_now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+void sim_kernel_init(void) {
+  dma_half = 0;
+  dma_next_ns = now_ns + SIM_DMA_HALF_NS;
+}
+
+void sim_kernel_set_late_worker(uint32_t every) {
+  late_worker_every = every;
+  late_worker_jobs = 0;
+  late_worker_count = 0;
+}
+
+uint32_t sim_kernel_late_workers(void) {
+  return late_worker_count;
+}
+
+void sim_wait_for_interrupt(void) {
+  sim_advance_ns(dma_next_ns - now_ns);
+}
+
+systime_t chVTGetSystemTimeX(void) {
+  return (systime_t)(now_ns / SIM_NS_PER_TICK);
+}
+
+static void sim_thread_start(void) {
+  current->entry(current->arg);
+  sim_fatal("thread returned");
+}
+
+thread_t* chThdCreateStatic(void* warea, size_t size, tprio_t prio, tfunc_t entry, void* arg) {
+  (void)warea;
+  (void)size;
+  (void)prio;
+  if (thread_count >= SIM_THREADS_MAX)
+    sim_fatal("too many threads");
+  thread_t* tp = calloc(1, sizeof(*tp));
+  if (tp == NULL || (tp->stack = malloc(SIM_THREAD_STACK)) == NULL)
+    sim_fatal("out of memory");
+  getcontext(&tp->context);
+  tp->context.uc_stack.ss_sp = tp->stack;
+  tp->context.uc_stack.ss_size = SIM_THREAD_STACK;
+  tp->context.uc_link = NULL;
+  makecontext(&tp->context, sim_thread_start, 0);
+  tp->entry = entry;
+  tp->arg = arg;
+  tp->ready = true;
+  threads[thread_count++] = tp;
+  // Higher priority than the creator: runs until it blocks
+  sim_run_ready();
+  return tp;
+}
+
+thread_t* chThdGetSelfX(void) {
+  return current;
+}
+
+void chThdSleep(systime_t ticks) {
+  sim_advance_ns((uint64_t)ticks * SIM_NS_PER_TICK);
+}
+
+void chThdYield(void) {
+  if (current == &main_thread)
+    sim_run_ready();
+}
+
+msg_t osalThreadSuspendS(thread_reference_t* trp) {
+  thread_t* self = current;
+  if (self == &main_thread)
+    sim_fatal("the sweep thread may not suspend");
+  *trp = self;
+  swapcontext(&self->context, &main_thread.context);
+  return self->message;
+}
+
+void osalThreadResumeI(thread_reference_t* trp, msg_t msg) {
+  thread_t* tp = *trp;
+  if (tp == NULL)
+    return;
+  *trp = NULL;
+  tp->message = msg;
+  tp->ready = true;
+}
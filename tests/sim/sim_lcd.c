@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Display panel in RAM: the primitives lcd.c drives over SPI write into a
+ * framebuffer, the panel independent drawing (lcd_draw.c) and the renderer
+ * run unmodified on top. The framebuffer holds the image in logical
+ * coordinates, rotation and flip only change the panel scan direction.
+ * Traffic is counted as lcd.c would put it on the SPI bus.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "nanovna.h"
+#include "sim.h"
+
+// CASET + RASET (command and 4 bytes each) + memory write/read command
+#define LCD_WINDOW_BYTES (5 + 5 + 1)
+
+pixel_t sim_framebuffer[LCD_HEIGHT][LCD_WIDTH];
+static sim_lcd_stats_t lcd_stats;
+
+static void lcd_account(uint32_t pixels) {
+  lcd_stats.windows++;
+  lcd_stats.bytes += LCD_WINDOW_BYTES + (uint64_t)pixels * sizeof(pixel_t);
+}
+
+static inline void lcd_put_pixel(int x, int y, pixel_t c) {
+  if ((unsigned)x < LCD_WIDTH && (unsigned)y < LCD_HEIGHT)
+    sim_framebuffer[y][x] = c;
+}
+
+static void lcd_bulk_buffer(int x, int y, int w, int h, const pixel_t* buffer) {
+  lcd_account((uint32_t)(w * h));
+  for (int j = 0; j < h; j++)
+    for (int i = 0; i < w; i++)
+      lcd_put_pixel(x + i, y + j, *buffer++);
+}
+
+void sim_lcd_get_stats(sim_lcd_stats_t* stats) {
+  *stats = lcd_stats;
+}
+
+void sim_lcd_reset_stats(void) {
+  memset(&lcd_stats, 0, sizeof(lcd_stats));
+}
+
+// FNV-1a over the pixels, row by row
+uint32_t sim_lcd_checksum(void) {
+  uint32_t hash = 2166136261U;
+  const uint8_t* p = (const uint8_t*)sim_framebuffer;
+  for (size_t i = 0; i < sizeof(sim_framebuffer); i++)
+    hash = (hash ^ p[i]) * 16777619U;
+  return hash;
+}
+
+bool sim_lcd_write_ppm(const char* path) {
+  FILE* f = fopen(path, "wb");
+  if (f == NULL)
+    return false;
+  fprintf(f, "P6\n%d %d\n255\n", LCD_WIDTH, LCD_HEIGHT);
+  for (int y = 0; y < LCD_HEIGHT; y++)
+    for (int x = 0; x < LCD_WIDTH; x++) {
+      // pixel_t is byte swapped RGB565, as the panel expects it
+      uint16_t c = (uint16_t)((sim_framebuffer[y][x] << 8) | (sim_framebuffer[y][x] >> 8));
+      uint8_t rgb[3] = {(uint8_t)((c >> 8) & 0xF8), (uint8_t)((c >> 3) & 0xFC),
+                        (uint8_t)(c << 3)};
+      fwrite(rgb, 1, sizeof(rgb), f);
+    }
+  return fclose(f) == 0;
+}
+
+//******************************************************************************
+// Panel primitives (lcd.c)
+//******************************************************************************
+#ifndef lcd_get_cell_buffer
+static uint8_t lcd_buffer_index;
+
+pixel_t* lcd_get_cell_buffer(void) {
+  return &spi_buffer[lcd_buffer_index ? SPI_BUFFER_SIZE / 2 : 0];
+}
+#endif
+
+void lcd_init(void) {
+  lcd_clear_screen();
+}
+
+uint32_t lcd_send_register(uint8_t cmd, uint8_t len, const uint8_t* data) {
+  (void)cmd;
+  (void)data;
+  lcd_stats.bytes += 1U + len + 4U;
+  return 0; // no display ID, as ILI9341
+}
+
+void lcd_set_rotation(uint8_t r) {
+  (void)r;
+}
+
+void lcd_set_flip(bool flip) {
+  lcd_set_rotation(flip ? DISPLAY_ROTATION_180 : DISPLAY_ROTATION_0);
+}
+
+void lcd_read_memory(int x, int y, int w, int h, uint16_t* out) {
+  lcd_account(0);
+  // Dummy clock plus RGB888 per pixel
+  lcd_stats.bytes += 1U + (uint64_t)w * h * 3U;
+  for (int j = 0; j < h; j++)
+    for (int i = 0; i < w; i++) {
+      int px = x + i, py = y + j;
+      *out++ = ((unsigned)px < LCD_WIDTH && (unsigned)py < LCD_HEIGHT) ? sim_framebuffer[py][px] : 0;
+    }
+}
+
+#ifndef lcd_bulk_finish
+void lcd_bulk_finish(void) {}
+#endif
+
+#ifndef lcd_bulk_continue
+void lcd_bulk_continue(int x, int y, int w, int h) {
+  lcd_stats.cells++;
+  lcd_bulk_buffer(x, y, w, h, lcd_get_cell_buffer());
+  lcd_buffer_index ^= 1;
+}
+#endif
+
+void lcd_bulk(int x, int y, int w, int h) {
+  lcd_bulk_buffer(x, y, w, h, spi_buffer);
+}
+
+void lcd_fill(int x, int y, int w, int h) {
+  lcd_account((uint32_t)(w * h));
+  for (int j = 0; j < h; j++)
+    for (int i = 0; i < w; i++)
+      lcd_put_pixel(x + i, y + j, background_color);
+}
+
+// Same walk as lcd.c: a new window for every horizontal run
+void lcd_line(int x0, int y0, int x1, int y1) {
+  if (x1 < x0) {
+    SWAP(int, x0, x1);
+    SWAP(int, y0, y1);
+  }
+  int dx = -(x1 - x0), sx = 1;
+  int dy = (y1 - y0), sy = 1;
+  if (dy < 0) {
+    dy = -dy;
+    sy = -1;
+  }
+  int err = -((dx + dy) < 0 ? dx : dy) / 2;
+  while (1) {
+    lcd_account(0);
+    while (1) {
+      lcd_stats.bytes += sizeof(pixel_t);
+      lcd_put_pixel(x0, y0, foreground_color);
+      if (x0 == x1 && y0 == y1)
+        return;
+      int e2 = err;
+      if (e2 > dx) {
+        err -= dy;
+        x0 += sx;
+      }
+      if (e2 < dy) {
+        err -= dx;
+        y0 += sy;
+        break;
+      }
+    }
+  }
+}
+
+void lcd_blit_bitmap_scale(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t size,
+                           const uint8_t* b) {
+  lcd_account((uint32_t)(w * size) * (h * size));
+  for (int c = 0; c < h; c++) {
+    const uint8_t* ptr = b;
+    for (int i = 0; i < size; i++) {
+      uint8_t bits = 0;
+      ptr = b;
+      for (int r = 0; r < w; r++, bits <<= 1) {
+        if ((r & 7) == 0)
+          bits = *ptr++;
+        for (int j = 0; j < size; j++)
+          lcd_put_pixel(x + r * size + j, y + c * size + i,
+                        (0x80 & bits) ? foreground_color : background_color);
+      }
+    }
+    b = ptr;
+  }
+}
@@ -0,0 +1,734 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * nanovna_sim: calibrate and sweep a simulated DUT through the production
+ * sweep engine, then report throughput and the error against the true DUT.
+ *
+ *   SIM <name> points=<n> bw=<Hz> sweeps=<n> host_ms/sweep=<x> points/s=<x>
+ *       device_ms/sweep=<x> i2c_bytes/sweep=<n> err_s11=<x> err_s21=<x>
+ *
+ * host_ms/points/s is how fast the host runs the firmware code (regressions of
+ * the sweep path); device_ms is the virtual sweep time the firmware schedules
+ * (settling, captures and I2C traffic, without CPU time); err_* is the largest
+ * complex error of the last sweep.
+ *
+ * --profile adds the sweep profiler readout of the measured sweeps (the same
+ * statistics as the sweepprof shell command, on the virtual clock):
+ *
+ *   PROFILE <state> band=<n|all> count=<n> min_us=<n> avg_us=<n> max_us=<n>
+ *
+ * --average-check averages sweeps after the report and checks that a new
+ * calibration, a power and an IF bandwidth change each restart the average:
+ *
+ *   AVERAGE cal=<ok|FAIL> power=<ok|FAIL> ifbw=<ok|FAIL>
+ *
+ * --order-check sweeps once in the default and once in the channel-major
+ * order, checks the recorded generator retunes and codec input selects of
+ * each, that channel-major crosses no more band changes and takes no more
+ * device time than the default order and that both measure the same data:
+ *
+ *   ORDER default retunes=<n> selects=<n> bands=<n> ms=<x> chmajor retunes=<n> selects=<n>
+ *         bands=<n> ms=<x> max_diff=<x> <ok|FAIL>
+ *
+ * --snapshot-check holds a published snapshot across further sweeps and
+ * checks that it is never overwritten, that a second reader gets the newest
+ * published sweep and that both releases report stable data:
+ *
+ *   SNAPSHOT held=<ok|FAIL> newest=<ok|FAIL> skipped=<ok|FAIL> release=<ok|FAIL>
+ *
+ * --late-worker N holds every N-th DSP job of the measured sweeps past the
+ * next DMA half, which corrupts the buffer it correlates. Each must count one
+ * overrun and restart its point; --check then shows that no corrupted buffer
+ * was accumulated:
+ *
+ *   LATE held=<n> overruns=<n> <ok|FAIL>
+ *
+ * --recorrect-check sweeps with a changed electrical delay, S21 offset and
+ * calibration apply setting in turn, corrects the raw data of each sweep
+ * again with the previous and then the changed setting and checks that the
+ * result equals the data the sweep corrected, bit for bit:
+ *
+ *   RECORRECT edelay=<ok|FAIL> offset=<ok|FAIL> apply=<ok|FAIL>
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "processing/calibration.h"
+#include "rf/sweep.h"
+#include "driver/si5351.h"
+#include "sim.h"
+
+typedef struct {
+  const char* name;
+  const char* dut;
+  freq_t start;
+  freq_t stop;
+  uint16_t points;
+  uint32_t bandwidth;
+  uint16_t modes;
+  uint32_t sweeps;
+  double check;
+  bool profile;
+  bool average_check;
+  bool order_check;
+  bool snapshot_check;
+  bool recorrect_check;
+  uint32_t late_worker;
+  const char* out;
+  sim_signal_t signal;
+} sim_options_t;
+
+static void usage(void) {
+  fprintf(stderr,
+          "usage: nanovna_sim [options]\n"
+          "  --dut load:R,L,C | series:R,L,C | shunt:R,L,C | file:PATH.s1p|.s2p\n"
+          "                     (series RLC, C = 0 - no capacitor; default load:50,0,0)\n"
+          "  --start HZ --stop HZ --points N   stimulus (default 50k..900M, 101)\n"
+          "  --bw HZ            IF bandwidth (default 1000)\n"
+          "  --mode M[,M]       sweep modes: pipeline, channel, adaptive\n"
+          "  --sweeps N         measured sweeps to time (default 1)\n"
+          "  --amplitude LSB    reference level at the ADC (default 8000)\n"
+          "  --noise LSB        ADC noise rms (default 0)\n"
+          "  --phase-noise RAD  sample to reference jitter rms (default 0)\n"
+          "  --settle EPS,US    response error EPS after a frequency change, decays in US\n"
+          "  --ideal            no error box and no calibration\n"
+          "  --profile          print the sweep profiler statistics per state and band\n"
+          "  --average-check    check that calibration, power and IFBW restart averaging\n"
+          "  --order-check      check the driver call order of both channel orders\n"
+          "  --snapshot-check   check that a held data snapshot survives new sweeps\n"
+          "  --late-worker N    hold every N-th DSP job past the next DMA half\n"
+          "  --recorrect-check  check raw data recorrection against corrected sweeps\n"
+          "  --seed N           noise seed\n"
+          "  --name NAME        report name (default the DUT)\n"
+          "  --out FILE         write the last sweep as Touchstone .s2p\n"
+          "  --check TOL        exit 1 when an error exceeds TOL\n");
+  exit(2);
+}
+
+static uint16_t parse_modes(char* list) {
+  uint16_t modes = 0;
+  for (char* tok = strtok(list, ","); tok != NULL; tok = strtok(NULL, ",")) {
+    if (!strcmp(tok, "pipeline"))
+      modes |= SWEEP_PIPELINE_SETUP;
+    else if (!strcmp(tok, "channel"))
+      modes |= SWEEP_CHANNEL_MAJOR;
+    else if (!strcmp(tok, "adaptive"))
+      modes |= SWEEP_ADAPTIVE_IFBW;
+    else
+      usage();
+  }
+  return modes;
+}
+
+static void parse_options(int argc, char** argv, sim_options_t* o) {
+  for (int i = 1; i < argc; i++) {
+    const char* opt = argv[i];
+    if (!strcmp(opt, "--ideal")) {
+      o->signal.error_box = false;
+      continue;
+    }
+    if (!strcmp(opt, "--profile")) {
+      o->profile = true;
+      continue;
+    }
+    if (!strcmp(opt, "--average-check")) {
+      o->average_check = true;
+      continue;
+    }
+    if (!strcmp(opt, "--order-check")) {
+      o->order_check = true;
+      continue;
+    }
+    if (!strcmp(opt, "--snapshot-check")) {
+      o->snapshot_check = true;
+      continue;
+    }
+    if (!strcmp(opt, "--recorrect-check")) {
+      o->recorrect_check = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      usage();
+    char* arg = argv[++i];
+    if (!strcmp(opt, "--dut"))
+      o->dut = arg;
+    else if (!strcmp(opt, "--start"))
+      o->start = (freq_t)strtod(arg, NULL);
+    else if (!strcmp(opt, "--stop"))
+      o->stop = (freq_t)strtod(arg, NULL);
+    else if (!strcmp(opt, "--points"))
+      o->points = (uint16_t)atoi(arg);
+    else if (!strcmp(opt, "--bw"))
+      o->bandwidth = (uint32_t)atoi(arg);
+    else if (!strcmp(opt, "--mode"))
+      o->modes = parse_modes(arg);
+    else if (!strcmp(opt, "--sweeps"))
+      o->sweeps = (uint32_t)atoi(arg);
+    else if (!strcmp(opt, "--late-worker"))
+      o->late_worker = (uint32_t)atoi(arg);
+    else if (!strcmp(opt, "--amplitude"))
+      o->signal.amplitude = strtod(arg, NULL);
+    else if (!strcmp(opt, "--noise"))
+      o->signal.noise = strtod(arg, NULL);
+    else if (!strcmp(opt, "--phase-noise"))
+      o->signal.phase_noise = strtod(arg, NULL);
+    else if (!strcmp(opt, "--settle")) {
+      if (sscanf(arg, "%lf,%lf", &o->signal.settle_eps, &o->signal.settle_tau) != 2)
+        usage();
+      o->signal.settle_tau *= 1e-6;
+    } else if (!strcmp(opt, "--seed"))
+      o->signal.seed = (uint32_t)strtoul(arg, NULL, 0);
+    else if (!strcmp(opt, "--name"))
+      o->name = arg;
+    else if (!strcmp(opt, "--out"))
+      o->out = arg;
+    else if (!strcmp(opt, "--check"))
+      o->check = strtod(arg, NULL);
+    else
+      usage();
+  }
+  if (o->points < 2 || o->points > SWEEP_POINTS_MAX || o->start >= o->stop || o->sweeps == 0 ||
+      o->bandwidth == 0)
+    usage();
+}
+
+static bool select_dut(const char* spec, sim_touchstone_t* ts) {
+  sim_rlc_t rlc = {0};
+  static const struct {
+    const char* prefix;
+    sim_dut_kind_t kind;
+  } rlc_kinds[] = {
+      {"load:", SIM_DUT_LOAD},
+      {"series:", SIM_DUT_SERIES},
+      {"shunt:", SIM_DUT_SHUNT},
+  };
+  if (!strncmp(spec, "file:", 5)) {
+    if (!sim_touchstone_load(ts, spec + 5))
+      return false;
+    sim_dut_select(SIM_DUT_FILE, NULL, ts);
+    return true;
+  }
+  for (size_t i = 0; i < ARRAY_COUNT(rlc_kinds); i++) {
+    size_t len = strlen(rlc_kinds[i].prefix);
+    if (strncmp(spec, rlc_kinds[i].prefix, len))
+      continue;
+    if (sscanf(spec + len, "%lf,%lf,%lf", &rlc.r, &rlc.l, &rlc.c) != 3)
+      break;
+    sim_dut_select(rlc_kinds[i].kind, &rlc, NULL);
+    return true;
+  }
+  fprintf(stderr, "sim: bad DUT '%s'\n", spec);
+  return false;
+}
+
+// SOLT on the linear grid, same sequence as the calibration menu
+static void calibrate(void) {
+  static const struct {
+    sim_dut_kind_t standard;
+    uint16_t type;
+  } steps[] = {
+      {SIM_STD_MATCH, CAL_LOAD},  {SIM_STD_OPEN, CAL_OPEN},       {SIM_STD_SHORT, CAL_SHORT},
+      {SIM_STD_THRU, CAL_THRU}, {SIM_STD_ISOLATION, CAL_ISOLN},
+  };
+  for (size_t i = 0; i < ARRAY_COUNT(steps); i++) {
+    sim_dut_select(steps[i].standard, NULL, NULL);
+    cal_collect(steps[i].type);
+  }
+  cal_done();
+  cal_status |= CALSTAT_ENHANCED_RESPONSE;
+}
+
+static double max_error(uint8_t ch) {
+  double err = 0.0;
+  for (uint16_t i = 0; i < sweep_points; i++) {
+    double complex s[2];
+    sim_dut_response(get_frequency(i), s);
+    double complex m = measured[ch][i][0] + I * measured[ch][i][1];
+    double e = cabs(m - s[ch]);
+    if (e > err)
+      err = e;
+  }
+  return err;
+}
+
+static void print_profile_line(const char* state, uint8_t band, const sweep_profile_stat_t* s) {
+  const sweep_profile_t* profile = sweep_service_get_profile();
+  char band_name[8];
+  if (band == SWEEP_PROFILE_ALL_BANDS)
+    strcpy(band_name, "all");
+  else
+    snprintf(band_name, sizeof(band_name), "%u", band);
+  printf("PROFILE %s band=%s count=%u min_us=%u avg_us=%u max_us=%u\n", state, band_name,
+         s->count, sweep_profile_cycles_to_us(profile, s->min),
+         sweep_profile_cycles_to_us(profile, s->total / s->count),
+         sweep_profile_cycles_to_us(profile, s->max));
+}
+
+static void print_profile(void) {
+  static const char* const names[SWEEP_PROFILE_STATES] = {"setup_freq", "setup_measure",
+                                                          "wait_capture", "process", "next_step"};
+  const sweep_profile_t* profile = sweep_service_get_profile();
+  for (uint8_t state = 0; state < SWEEP_PROFILE_STATES; state++) {
+    sweep_profile_stat_t s;
+    sweep_profile_get(profile, state, SWEEP_PROFILE_ALL_BANDS, &s);
+    if (s.count == 0U)
+      continue;
+    print_profile_line(names[state], SWEEP_PROFILE_ALL_BANDS, &s);
+    for (uint8_t band = 0; band < SWEEP_PROFILE_BANDS; band++) {
+      sweep_profile_get(profile, state, band, &s);
+      if (s.count != 0U)
+        print_profile_line(names[state], band, &s);
+    }
+  }
+}
+
+// Sweep and fold into the average as the measurement result handler does
+static uint16_t average_sweep(uint16_t mask) {
+  trace_average_t avg;
+  if (app_measurement_sweep(false, mask))
+    measurement_data_average(mask);
+  sweep_service_get_average(&avg);
+  return avg.count;
+}
+
+static void average_change_cal(void) {
+  cal_done();
+}
+
+static void average_change_power(void) {
+  current_props._power = current_props._power == SI5351_CLK_DRIVE_STRENGTH_2MA
+                             ? SI5351_CLK_DRIVE_STRENGTH_4MA
+                             : SI5351_CLK_DRIVE_STRENGTH_2MA;
+}
+
+static void average_change_ifbw(void) {
+  config._bandwidth = config._bandwidth ? config._bandwidth - 1U : 1U;
+}
+
+// After two averaged sweeps each change must start the average again
+static bool check_average_restart(uint16_t mask) {
+  static const struct {
+    const char* name;
+    void (*change)(void);
+  } changes[] = {
+      {"cal", average_change_cal},
+      {"power", average_change_power},
+      {"ifbw", average_change_ifbw},
+  };
+  bool ok = true;
+  sweep_service_set_average(TRACE_AVERAGE_EXP, 4);
+  printf("AVERAGE");
+  for (size_t i = 0; i < ARRAY_COUNT(changes); i++) {
+    sweep_service_restart_average();
+    average_sweep(mask);
+    bool pass = average_sweep(mask) == 2U;
+    changes[i].change();
+    pass &= average_sweep(mask) == 1U;
+    printf(" %s=%s", changes[i].name, pass ? "ok" : "FAIL");
+    ok &= pass;
+  }
+  printf("\n");
+  sweep_service_set_average(TRACE_AVERAGE_OFF, 0);
+  return ok;
+}
+
+#define ORDER_LOG_SIZE (6 * SWEEP_POINTS_MAX)
+static sim_driver_call_t order_log[ORDER_LOG_SIZE];
+static float order_measured[2][SWEEP_POINTS_MAX][2];
+
+// One sweep in the given channel order, returns the driver calls it made and its device time
+static uint32_t order_sweep(bool channel_major, double* ms) {
+  sweep_service_set_mode(SWEEP_CHANNEL_MAJOR, channel_major);
+  sim_board_record_calls(order_log, ORDER_LOG_SIZE);
+  uint64_t t0 = sim_now_ns();
+  app_measurement_sweep(false, app_measurement_get_sweep_mask());
+  *ms = (sim_now_ns() - t0) * 1e-6;
+  uint32_t n = sim_board_recorded_calls();
+  sim_board_record_calls(NULL, 0);
+  return n <= ORDER_LOG_SIZE ? n : 0U;
+}
+
+// Synthesizer band changes (PLL resets) between the recorded retunes
+static uint32_t order_band_changes(uint32_t n) {
+  uint32_t changes = 0;
+  uint8_t band = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (order_log[i].kind != SIM_CALL_FREQUENCY)
+      continue;
+    uint8_t b = si5351_get_frequency_band(order_log[i].value);
+    changes += band != 0U && b != band;
+    band = b;
+  }
+  return changes;
+}
+
+// Retune to every point in order, from the first call on
+static bool order_retunes_in_sequence(uint32_t n, uint32_t* retunes) {
+  uint16_t point = 0;
+  *retunes = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (order_log[i].kind != SIM_CALL_FREQUENCY)
+      continue;
+    if (point >= sweep_points || order_log[i].value != get_frequency(point))
+      return false;
+    point++;
+    (*retunes)++;
+  }
+  return n != 0U && order_log[0].kind == SIM_CALL_FREQUENCY;
+}
+
+/*
+ * Default order: after each retune the codec input goes 0, 1 (repeated for
+ * the settling cycles). Channel-major: per synthesizer band one pass of
+ * retunes per channel, the input selected once at the first point of its pass.
+ */
+static bool order_check_default(uint32_t n, uint32_t* retunes, uint32_t* selects) {
+  if (!order_retunes_in_sequence(n, retunes) || *retunes != sweep_points)
+    return false;
+  uint32_t run = 0;
+  *selects = 0;
+  for (uint32_t i = 1; i <= n; i++) {
+    if (i == n || order_log[i].kind == SIM_CALL_FREQUENCY) {
+      if (run == 0U || (run & 1U))
+        return false;
+      run = 0;
+      continue;
+    }
+    if (order_log[i].value != (run & 1U))
+      return false;
+    run++;
+    (*selects)++;
+  }
+  return true;
+}
+
+// Points from first on in the band of first
+static uint16_t order_band_end(uint16_t first) {
+  uint8_t band = si5351_get_frequency_band(get_frequency(first));
+  uint16_t end = first + 1U;
+  while (end < sweep_points && si5351_get_frequency_band(get_frequency(end)) == band)
+    end++;
+  return end;
+}
+
+static bool order_check_channel_major(uint32_t n, uint32_t* retunes, uint32_t* selects) {
+  uint16_t first = 0, end = order_band_end(0), point = 0;
+  uint8_t pass = 0;
+  bool selected = false;
+  *retunes = 0;
+  *selects = 0;
+  for (uint32_t i = 0; i < n; i++) {
+    if (order_log[i].kind == SIM_CALL_CHANNEL) {
+      // Input of the pass selected once, right after its first retune
+      if (selected || order_log[i].value != pass || point != first + 1U)
+        return false;
+      selected = true;
+      (*selects)++;
+      continue;
+    }
+    if (first >= sweep_points || order_log[i].value != get_frequency(point))
+      return false;
+    (*retunes)++;
+    if (++point < end)
+      continue;
+    if (!selected)
+      return false;
+    selected = false;
+    if (pass == 0U) {
+      pass = 1;
+      point = first;
+    } else {
+      pass = 0;
+      first = point = end;
+      if (end < sweep_points)
+        end = order_band_end(end);
+    }
+  }
+  return first == sweep_points && *retunes == 2U * sweep_points;
+}
+
+// Both orders drive the drivers as documented and measure the same data
+static bool check_sweep_order(void) {
+  uint32_t retunes[2] = {0}, selects[2] = {0}, bands[2];
+  double ms[2];
+  uint16_t saved = sweep_service_get_mode() & SWEEP_CHANNEL_MAJOR;
+  uint32_t n = order_sweep(false, &ms[0]);
+  bool ok = order_check_default(n, &retunes[0], &selects[0]);
+  bands[0] = order_band_changes(n);
+  memcpy(order_measured, measured, sizeof(order_measured));
+  n = order_sweep(true, &ms[1]);
+  ok &= order_check_channel_major(n, &retunes[1], &selects[1]);
+  bands[1] = order_band_changes(n);
+  ok &= bands[1] <= bands[0] && ms[1] <= ms[0];
+  double diff = 0.0;
+  for (uint8_t ch = 0; ch < 2; ch++)
+    for (uint16_t i = 0; i < sweep_points; i++) {
+      double e = hypot(measured[ch][i][0] - order_measured[ch][i][0],
+                       measured[ch][i][1] - order_measured[ch][i][1]);
+      if (e > diff)
+        diff = e;
+    }
+  sweep_service_set_mode(SWEEP_CHANNEL_MAJOR, saved != 0U);
+  // Data agrees within the sweep to sweep spread of the simulated captures
+  printf("ORDER default retunes=%u selects=%u bands=%u ms=%.1f chmajor retunes=%u selects=%u "
+         "bands=%u ms=%.1f max_diff=%.2e %s\n",
+         retunes[0], selects[0], bands[0], ms[0], retunes[1], selects[1], bands[1], ms[1], diff,
+         ok ? "ok" : "FAIL");
+  return ok && diff < 1e-3;
+}
+
+#ifdef __USE_MEASURED_SNAPSHOT__
+static float snapshot_copy[SWEEP_POINTS_MAX][2];
+
+// Sweep and publish as the measurement engine does after a completed sweep
+static void snapshot_sweep(uint16_t mask) {
+  if (app_measurement_sweep(false, mask)) {
+    sweep_service_increment_generation();
+    sweep_service_publish_snapshot();
+  }
+}
+
+static bool snapshot_matches(const sweep_service_snapshot_t* s, const float (*data)[2]) {
+  return s->points == sweep_points && memcmp(s->data, data, s->points * sizeof(data[0])) == 0;
+}
+
+/*
+ * The data command holds a snapshot while it streams, meanwhile the sweep
+ * goes on. The held data must stay as acquired, a reader acquiring later
+ * gets the newest publication, and a publication that would have to write
+ * into a still held buffer is skipped.
+ */
+static bool check_snapshot(uint16_t mask) {
+  sweep_service_snapshot_t first, second;
+  snapshot_sweep(mask);
+  bool held = sweep_service_snapshot_acquire(0, &first) && snapshot_matches(&first, measured[0]);
+  memcpy(snapshot_copy, first.data, first.points * sizeof(snapshot_copy[0]));
+  // Noise makes every sweep differ, the new one is published into the other buffer
+  snapshot_sweep(mask);
+  bool newest = sweep_service_snapshot_acquire(0, &second) &&
+                snapshot_matches(&second, measured[0]) && second.data != first.data &&
+                second.generation != first.generation;
+  // Both buffers held: this publication must be dropped
+  snapshot_sweep(mask);
+  held &= snapshot_matches(&first, snapshot_copy);
+  sweep_service_snapshot_t third;
+  bool skipped = sweep_service_snapshot_acquire(0, &third) && third.data == second.data;
+  bool release = sweep_service_snapshot_release(&third) &&
+                 sweep_service_snapshot_release(&second) &&
+                 sweep_service_snapshot_release(&first);
+  // Released: the next sweep is published again
+  snapshot_sweep(mask);
+  skipped &= sweep_service_snapshot_acquire(1, &third) && snapshot_matches(&third, measured[1]);
+  release &= sweep_service_snapshot_release(&third);
+  printf("SNAPSHOT held=%s newest=%s skipped=%s release=%s\n", held ? "ok" : "FAIL",
+         newest ? "ok" : "FAIL", skipped ? "ok" : "FAIL", release ? "ok" : "FAIL");
+  return held && newest && skipped && release;
+}
+#else
+static bool check_snapshot(uint16_t mask) {
+  (void)mask;
+  printf("SNAPSHOT not built (__USE_MEASURED_SNAPSHOT__)\n");
+  return false;
+}
+#endif
+
+#ifdef __USE_RAW_SWEEP_DATA__
+static float recorrect_swept[2][SWEEP_POINTS_MAX][2];
+
+static void recorrect_change_edelay(bool changed) {
+  electrical_delayS11 = changed ? 1.5e-9f : 0.0f;
+  electrical_delayS21 = changed ? -0.7e-9f : 0.0f;
+}
+
+static void recorrect_change_offset(bool changed) {
+  s21_offset = changed ? 6.0f : 0.0f;
+}
+
+static void recorrect_change_apply(bool changed) {
+  if (changed)
+    cal_status &= ~CALSTAT_APPLY;
+  else
+    cal_status |= CALSTAT_APPLY;
+}
+
+static bool recorrect_matches_sweep(void) {
+  for (uint8_t ch = 0; ch < 2; ch++) {
+    if (memcmp(measured[ch], recorrect_swept[ch], sweep_points * sizeof(measured[ch][0])) != 0)
+      return false;
+  }
+  return true;
+}
+
+static bool recorrect(void) {
+  uint16_t unfinished;
+  return app_measurement_recorrect(app_measurement_get_sweep_mask(), &unfinished) &&
+         unfinished == 0U;
+}
+
+/*
+ * Sweep with the setting changed, then recorrect the raw data of that sweep
+ * with the setting restored (must differ) and changed again (must give the
+ * swept data): the recorrection depends on the raw data and the current
+ * settings only, as a fresh sweep does.
+ */
+static bool check_recorrect_case(void (*change)(bool changed)) {
+  change(true);
+  bool ok = app_measurement_sweep(false, app_measurement_get_sweep_mask());
+  memcpy(recorrect_swept, measured, sizeof(recorrect_swept));
+  change(false);
+  ok &= recorrect() && !recorrect_matches_sweep();
+  change(true);
+  ok &= recorrect() && recorrect_matches_sweep();
+  change(false);
+  return ok;
+}
+
+static bool check_recorrect(void) {
+  bool edelay = check_recorrect_case(recorrect_change_edelay);
+  bool offset = check_recorrect_case(recorrect_change_offset);
+  bool apply = check_recorrect_case(recorrect_change_apply);
+  printf("RECORRECT edelay=%s offset=%s apply=%s\n", edelay ? "ok" : "FAIL", offset ? "ok" : "FAIL",
+         apply ? "ok" : "FAIL");
+  return edelay && offset && apply;
+}
+#else
+static bool check_recorrect(void) {
+  printf("RECORRECT not built (__USE_RAW_SWEEP_DATA__)\n");
+  return false;
+}
+#endif
+
+static void write_touchstone(const char* path) {
+  FILE* f = fopen(path, "w");
+  if (f == NULL) {
+    fprintf(stderr, "sim: can not write %s\n", path);
+    return;
+  }
+  fprintf(f, "! nanovna_sim\n# Hz S RI R 50\n");
+  for (uint16_t i = 0; i < sweep_points; i++)
+    fprintf(f, "%u %.7e %.7e %.7e %.7e 0 0 0 0\n", (unsigned)get_frequency(i), measured[0][i][0],
+            measured[0][i][1], measured[1][i][0], measured[1][i][1]);
+  fclose(f);
+}
+
+int main(int argc, char** argv) {
+  sim_options_t o = {
+      .dut = "load:50,0,0",
+      .start = 50000,
+      .stop = 900000000U,
+      .points = 101,
+      .bandwidth = 1000,
+      .sweeps = 1,
+      .signal = {.amplitude = 8000.0, .settle_tau = 1e-6, .error_box = true, .seed = 1},
+  };
+  parse_options(argc, argv, &o);
+
+  sim_touchstone_t ts = {0};
+  sim_dut_init(&o.signal);
+  sim_board_init();
+  frequency0 = o.start;
+  frequency1 = o.stop;
+  sweep_points = o.points;
+  // Same Hz to IF buffer count translation as the bandwidth command
+  uint32_t bw = ((AUDIO_ADC_FREQ + AUDIO_SAMPLES_COUNT / 2) / AUDIO_SAMPLES_COUNT) / o.bandwidth;
+  config._bandwidth = bw > 512U ? 511U : bw ? bw - 1U : 0U;
+  app_measurement_update_frequencies();
+  sweep_service_set_mode(o.modes, true);
+
+  if (o.signal.error_box)
+    calibrate();
+  if (!select_dut(o.dut, &ts))
+    return 2;
+
+  uint16_t mask = app_measurement_get_sweep_mask();
+  sim_i2c_stats_t i2c0, i2c1;
+  sim_board_get_i2c_stats(&i2c0);
+  sweep_service_reset_timing();
+  uint64_t host0 = sim_host_now_ns();
+  uint64_t dev0 = sim_now_ns();
+  uint32_t overruns0 = sweep_service_dsp_overruns();
+  sim_kernel_set_late_worker(o.late_worker);
+  bool completed = true;
+  for (uint32_t n = 0; n < o.sweeps; n++)
+    completed &= app_measurement_sweep(false, mask);
+  uint32_t late_held = sim_kernel_late_workers();
+  uint32_t late_overruns = sweep_service_dsp_overruns() - overruns0;
+  sim_kernel_set_late_worker(0);
+  double host_ms = (sim_host_now_ns() - host0) * 1e-6 / o.sweeps;
+  double dev_ms = (sim_now_ns() - dev0) * 1e-6 / o.sweeps;
+  sim_board_get_i2c_stats(&i2c1);
+  uint32_t i2c_bytes = (i2c1.si5351_bytes - i2c0.si5351_bytes) + (i2c1.tlv320_bytes - i2c0.tlv320_bytes);
+
+  double err_s11 = max_error(0);
+  double err_s21 = max_error(1);
+  printf("SIM %s points=%u bw=%luHz sweeps=%u host_ms/sweep=%.2f points/s=%.0f "
+         "device_ms/sweep=%.1f i2c_bytes/sweep=%u err_s11=%.2e err_s21=%.2e\n",
+         o.name ? o.name : o.dut, sweep_points, (unsigned long)get_bandwidth_frequency(config._bandwidth),
+         o.sweeps, host_ms, host_ms > 0.0 ? sweep_points * 1e3 / host_ms : 0.0, dev_ms,
+         i2c_bytes / o.sweeps, err_s11, err_s21);
+  bool late_ok = true;
+  if (o.late_worker != 0U) {
+    late_ok = late_held != 0U && late_overruns == late_held;
+    printf("LATE held=%u overruns=%u %s\n", late_held, late_overruns, late_ok ? "ok" : "FAIL");
+  }
+  if (o.profile)
+    print_profile();
+  if (o.out)
+    write_touchstone(o.out);
+  bool average_ok = !o.average_check || check_average_restart(mask);
+  bool order_ok = !o.order_check || check_sweep_order();
+  bool snapshot_ok = !o.snapshot_check || check_snapshot(mask);
+  bool recorrect_ok = !o.recorrect_check || check_recorrect();
+  sim_touchstone_free(&ts);
+
+  if (!completed) {
+    printf("[FAIL] sweep did not complete\n");
+    return 1;
+  }
+  if (o.check > 0.0 && (err_s11 > o.check || err_s21 > o.check)) {
+    printf("[FAIL] error above %.2e\n", o.check);
+    return 1;
+  }
+  if (!average_ok) {
+    printf("[FAIL] average did not restart\n");
+    return 1;
+  }
+  if (!order_ok) {
+    printf("[FAIL] sweep order\n");
+    return 1;
+  }
+  if (!snapshot_ok) {
+    printf("[FAIL] data snapshot\n");
+    return 1;
+  }
+  if (!late_ok) {
+    printf("[FAIL] late DSP worker\n");
+    return 1;
+  }
+  if (!recorrect_ok) {
+    printf("[FAIL] recorrection\n");
+    return 1;
+  }
+  return 0;
+}
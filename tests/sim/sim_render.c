@@ -0,0 +1,348 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * nanovna_render: draw representative screens with the production renderer
+ * (plot.c, grid.c, traces.c, render.c) into the framebuffer of sim_lcd.c and
+ * report the cost of a full frame redraw.
+ *
+ *   RENDER <scene> frames=<n> cells/frame=<n> cells/s=<x> frame_ms=<x>
+ *       bytes/frame=<n> windows/frame=<n> crc=<hex>
+ *
+ * cells/s and frame_ms are host time (regressions of the render path),
+ * bytes/frame is the SPI traffic the frame costs on the target. crc is the
+ * checksum of the first frame of the scene; --golden compares it with a
+ * reference list, --dump writes the frames as PPM images to diff them.
+ * Scenes always run in the same order, the battery icon and other state
+ * only drawn on a change carry over from one scene to the next.
+ *
+ * Before the scenes the batched trace conversion (trace_get_values) is
+ * checked against the trace_info_list callbacks the marker readouts use,
+ * on points close to |S| = 1 where the impedance formulas are ill-conditioned:
+ *
+ *   VALUES types=<n> points=<n> max_rel_err=<x>
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rf/sweep.h"
+#include "ui/draw/traces.h"
+#include "sim.h"
+
+#define GOLDEN_MAX 16
+
+typedef struct {
+  const char* name;
+  void (*setup)(void);
+} render_scene_t;
+
+typedef struct {
+  char name[32];
+  uint32_t crc;
+} golden_t;
+
+static sim_touchstone_t lowpass;
+
+static void usage(void) {
+  fprintf(stderr, "usage: nanovna_render [options]\n"
+                  "  --frames N         full redraws to time per scene (default 50)\n"
+                  "  --data DIR         simulator data directory (default tests/sim/data)\n"
+                  "  --golden FILE      compare the frame checksums, exit 1 on a mismatch\n"
+                  "  --update           rewrite the --golden file from this run\n"
+                  "  --dump DIR         write DIR/<scene>.ppm\n");
+  exit(2);
+}
+
+static void set_stimulus(freq_t start, freq_t stop, uint16_t points) {
+  frequency0 = start;
+  frequency1 = stop;
+  sweep_points = points;
+  app_measurement_update_frequencies();
+}
+
+// Exact DUT response in place of a sweep, the image only depends on the renderer
+static void fill_measured(void) {
+  for (uint16_t i = 0; i < sweep_points; i++) {
+    double complex s[2];
+    sim_dut_response(get_frequency(i), s);
+    measured[0][i][0] = (float)creal(s[0]);
+    measured[0][i][1] = (float)cimag(s[0]);
+    measured[1][i][0] = (float)creal(s[1]);
+    measured[1][i][1] = (float)cimag(s[1]);
+  }
+}
+
+// Reflection coefficients on circles close to the Smith chart edge
+static void fill_edge_points(void) {
+  static const float radius[] = {0.9f, 0.999f, 0.99995f};
+  uint16_t n = 0;
+  for (size_t r = 0; r < ARRAY_COUNT(radius); r++) {
+    for (int a = 0; a < 16; a++) {
+      float phi = (float)(2.0 * M_PI * (a + 0.01) / 16.0);
+      measured[0][n][0] = radius[r] * cosf(phi);
+      measured[0][n][1] = radius[r] * sinf(phi);
+      n++;
+    }
+  }
+  // Open and short ends, the cancellation case of both impedance term signs
+  measured[0][n][0] = 0.99995f;
+  measured[0][n++][1] = 0.0005f;
+  measured[0][n][0] = -0.99995f;
+  measured[0][n++][1] = 0.0005f;
+  while (n < sweep_points) {
+    measured[0][n][0] = 0.5f;
+    measured[0][n++][1] = -0.25f;
+  }
+}
+
+static int check_trace_values(void) {
+  set_stimulus(1000000U, 900000000U, 64);
+  fill_edge_points();
+  float out[TRACE_BATCH_POINTS];
+  double max_err = 0.0;
+  int types = 0, failed = 0;
+  for (uint8_t type = 0; type < MAX_TRACE_TYPE; type++) {
+    get_value_cb_t c = trace_info_list[type].get_value_cb;
+    if (c == NULL)
+      continue;
+    types++;
+    for (uint16_t first = 0; first < sweep_points; first += TRACE_BATCH_POINTS) {
+      uint16_t count = sweep_points - first;
+      if (count > TRACE_BATCH_POINTS)
+        count = TRACE_BATCH_POINTS;
+      trace_get_values(type, (const float(*)[2])measured[0], first, count, out);
+      for (uint16_t k = 0; k < count; k++) {
+        double ref = c(first + k, measured[0][first + k]);
+        double v = out[k];
+        if (isinf(ref) && v == ref)
+          continue;
+        double err = fabs(v - ref) / fmax(fabs(ref), 1e-6);
+        if (!(err <= 1e-3)) {
+          printf("[FAIL] %s point %u: batch %g callback %g\n", get_trace_typename(type, 0),
+                 first + k, v, ref);
+          failed++;
+        }
+        if (err > max_err)
+          max_err = err;
+      }
+    }
+  }
+  printf("VALUES types=%d points=%u max_rel_err=%.2e\n", types, sweep_points, max_err);
+  return failed;
+}
+
+static void set_markers(int count) {
+  for (int m = 0; m < MARKERS_MAX; m++) {
+    markers[m].enabled = m < count;
+    set_marker_index(m, (m + 1) * sweep_points / (count + 1));
+  }
+  active_marker = 0;
+  previous_marker = MARKER_INVALID;
+}
+
+// 4 traces of 401 points on the rectangular grid
+static void scene_traces(void) {
+  sim_dut_select(SIM_DUT_FILE, NULL, &lowpass);
+  set_stimulus(1000000U, 900000000U, 401);
+  props_mode = DOMAIN_FREQ;
+  trace[0] = (trace_t){true, TRC_LOGMAG, 0, MS_RX, 10.0f, NGRIDY - 1};
+  trace[1] = (trace_t){true, TRC_LOGMAG, 1, MS_REIM, 10.0f, NGRIDY - 1};
+  trace[2] = (trace_t){true, TRC_PHASE, 1, MS_REIM, 90.0f, NGRIDY / 2};
+  trace[3] = (trace_t){true, TRC_SWR, 0, MS_REIM, 1.0f, 0};
+  current_trace = 0;
+  fill_measured();
+  set_markers(4);
+}
+
+// Smith chart of a series RLC with S21 magnitude
+static void scene_smith(void) {
+  sim_rlc_t rlc = {.r = 20.0, .l = 40e-9, .c = 8e-12};
+  sim_dut_select(SIM_DUT_SERIES, &rlc, NULL);
+  set_stimulus(50000U, 900000000U, 401);
+  props_mode = DOMAIN_FREQ;
+  trace[0] = (trace_t){true, TRC_SMITH, 0, MS_RX, 1.0f, 0};
+  trace[1] = (trace_t){true, TRC_LOGMAG, 1, MS_REIM, 10.0f, NGRIDY - 1};
+  trace[2].enabled = false;
+  trace[3].enabled = false;
+  current_trace = 0;
+  fill_measured();
+  set_markers(2);
+}
+
+// Low pass impulse response: the stimulus is a harmonic grid, as the menu sets it
+static void scene_time_domain(void) {
+  sim_dut_select(SIM_DUT_FILE, NULL, &lowpass);
+  set_stimulus(2250000U, 900000000U, 401);
+  props_mode = DOMAIN_TIME | TD_FUNC_LOWPASS_IMPULSE | TD_WINDOW_NORMAL;
+  trace[0] = (trace_t){true, TRC_REAL, 0, MS_REIM, 0.25f, NGRIDY / 2};
+  trace[1] = (trace_t){true, TRC_LINEAR, 1, MS_REIM, 0.25f, 0};
+  trace[2].enabled = false;
+  trace[3].enabled = false;
+  current_trace = 0;
+  fill_measured();
+  app_measurement_transform_domain(3);
+  set_markers(1);
+}
+
+static const render_scene_t scenes[] = {
+    {"traces_4x401", scene_traces},
+    {"smith", scene_smith},
+    {"time_domain", scene_time_domain},
+};
+
+static int load_golden(const char* path, golden_t* golden) {
+  FILE* f = fopen(path, "r");
+  if (f == NULL)
+    return -1;
+  int count = 0;
+  char line[128];
+  while (count < GOLDEN_MAX && fgets(line, sizeof(line), f)) {
+    if (line[0] == '#')
+      continue;
+    if (sscanf(line, "%31s %x", golden[count].name, &golden[count].crc) == 2)
+      count++;
+  }
+  fclose(f);
+  return count;
+}
+
+static bool save_golden(const char* path, const golden_t* golden, int count) {
+  FILE* f = fopen(path, "w");
+  if (f == NULL)
+    return false;
+  fprintf(f, "# nanovna_render frame checksums, regenerate with --update\n");
+  for (int i = 0; i < count; i++)
+    fprintf(f, "%s %08x\n", golden[i].name, golden[i].crc);
+  return fclose(f) == 0;
+}
+
+static const golden_t* find_golden(const golden_t* golden, int count, const char* name) {
+  for (int i = 0; i < count; i++)
+    if (!strcmp(golden[i].name, name))
+      return &golden[i];
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  uint32_t frames = 50;
+  const char* data_dir = "tests/sim/data";
+  const char* golden_path = NULL;
+  const char* dump_dir = NULL;
+  bool update = false;
+  for (int i = 1; i < argc; i++) {
+    const char* opt = argv[i];
+    if (!strcmp(opt, "--update")) {
+      update = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      usage();
+    const char* arg = argv[++i];
+    if (!strcmp(opt, "--frames"))
+      frames = (uint32_t)atoi(arg);
+    else if (!strcmp(opt, "--data"))
+      data_dir = arg;
+    else if (!strcmp(opt, "--golden"))
+      golden_path = arg;
+    else if (!strcmp(opt, "--dump"))
+      dump_dir = arg;
+    else
+      usage();
+  }
+  if (frames == 0 || (update && golden_path == NULL))
+    usage();
+
+  char path[256];
+  snprintf(path, sizeof(path), "%s/lowpass_100m.s2p", data_dir);
+  if (!sim_touchstone_load(&lowpass, path))
+    return 2;
+  golden_t golden[GOLDEN_MAX];
+  int golden_count = 0;
+  if (golden_path != NULL && !update) {
+    golden_count = load_golden(golden_path, golden);
+    if (golden_count < 0) {
+      fprintf(stderr, "render: can not read %s\n", golden_path);
+      return 2;
+    }
+  }
+
+  sim_signal_t signal = {.amplitude = 8000.0, .error_box = false};
+  sim_dut_init(&signal);
+  sim_board_init();
+  lcd_init();
+  plot_init();
+
+  int failed = check_trace_values();
+  for (size_t s = 0; s < ARRAY_COUNT(scenes); s++) {
+    const render_scene_t* scene = &scenes[s];
+    scene->setup();
+    request_to_redraw(REDRAW_PLOT | REDRAW_ALL | REDRAW_MARKER);
+    draw_all();
+    uint32_t crc = sim_lcd_checksum();
+
+    sim_lcd_stats_t stats;
+    sim_lcd_reset_stats();
+    uint64_t host0 = sim_host_now_ns();
+    for (uint32_t n = 0; n < frames; n++) {
+      request_to_redraw(REDRAW_PLOT | REDRAW_AREA | REDRAW_FREQUENCY | REDRAW_CAL_STATUS);
+      draw_all();
+    }
+    double host_ms = (sim_host_now_ns() - host0) * 1e-6;
+    sim_lcd_get_stats(&stats);
+    printf("RENDER %s frames=%u cells/frame=%u cells/s=%.0f frame_ms=%.3f bytes/frame=%lu "
+           "windows/frame=%u crc=%08x\n",
+           scene->name, frames, stats.cells / frames,
+           host_ms > 0.0 ? stats.cells * 1e3 / host_ms : 0.0, host_ms / frames,
+           (unsigned long)(stats.bytes / frames), stats.windows / frames, crc);
+
+    if (dump_dir != NULL) {
+      snprintf(path, sizeof(path), "%s/%s.ppm", dump_dir, scene->name);
+      if (!sim_lcd_write_ppm(path))
+        fprintf(stderr, "render: can not write %s\n", path);
+    }
+    // A full redraw of unchanged data must give the same image
+    if (sim_lcd_checksum() != crc) {
+      printf("[FAIL] %s redraw differs from the first frame\n", scene->name);
+      failed++;
+    }
+    if (update) {
+      if (golden_count < GOLDEN_MAX) {
+        snprintf(golden[golden_count].name, sizeof(golden[0].name), "%s", scene->name);
+        golden[golden_count++].crc = crc;
+      }
+    } else if (golden_path != NULL) {
+      const golden_t* g = find_golden(golden, golden_count, scene->name);
+      if (g == NULL || g->crc != crc) {
+        printf("[FAIL] %s crc=%08x golden=%s\n", scene->name, crc, g ? "mismatch" : "missing");
+        failed++;
+      }
+    }
+  }
+  sim_touchstone_free(&lowpass);
+
+  if (update && !save_golden(golden_path, golden, golden_count)) {
+    fprintf(stderr, "render: can not write %s\n", golden_path);
+    return 2;
+  }
+  return failed ? 1 : 0;
+}
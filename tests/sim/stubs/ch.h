@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/*
+ * ChibiOS/RT subset for the host sweep simulator. Time is virtual (system
+ * ticks of CH_CFG_ST_FREQUENCY) and only advances when a thread sleeps or
+ * waits for an interrupt. Threads are cooperative coroutines scheduled by
+ * tests/sim/sim_kernel.c, a resumed thread runs before the caller continues
+ * (all firmware threads that get resumed have a higher priority).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CH_CFG_ST_FREQUENCY 100000
+#define CH_CFG_USE_WAITEXIT FALSE
+#define CH_CFG_USE_REGISTRY FALSE
+
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef TRUE
+#define TRUE 1
+#endif
+
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+typedef int32_t msg_t;
+typedef int tprio_t;
+
+#define MSG_OK 0
+#define MSG_TIMEOUT (-1)
+#define MSG_RESET (-2)
+#define TIME_IMMEDIATE ((systime_t)0)
+#define TIME_INFINITE ((systime_t)-1)
+
+#define NORMALPRIO 128
+#define HIGHPRIO 255
+
+#define S2ST(sec) ((systime_t)((uint32_t)(sec) * CH_CFG_ST_FREQUENCY))
+#define MS2ST(msec) \
+  ((systime_t)(((uint32_t)(msec) * (uint32_t)CH_CFG_ST_FREQUENCY + 999U) / 1000U))
+#define US2ST(usec) \
+  ((systime_t)(((uint32_t)(usec) * (uint32_t)CH_CFG_ST_FREQUENCY + 999999U) / 1000000U))
+#define TIME_MS2I(msec) MS2ST(msec)
+#define TIME_US2I(usec) US2ST(usec)
+#define ST2US(n) ((uint32_t)(((uint64_t)(n) * 1000000U) / CH_CFG_ST_FREQUENCY))
+
+typedef struct BaseSequentialStream {
+  void* vmt;
+} BaseSequentialStream;
+
+typedef struct sim_thread thread_t;
+typedef thread_t* thread_reference_t;
+typedef void (*tfunc_t)(void* arg);
+
+#define THD_FUNCTION(name, arg) void name(void* arg)
+#define THD_WORKING_AREA(name, size) uint8_t name[(size) + 64]
+
+// Only the layout is needed (sys/event_bus.h), the simulator has no mailboxes
+typedef struct {
+  msg_t* buffer;
+  size_t length;
+} mailbox_t;
+
+// Virtual clock
+systime_t chVTGetSystemTimeX(void);
+#define chVTGetSystemTime() chVTGetSystemTimeX()
+#define chVTTimeElapsedSinceX(start) ((systime_t)(chVTGetSystemTimeX() - (start)))
+
+// Critical sections are no-ops: threads only switch at blocking calls
+#define chSysLock() ((void)0)
+#define chSysUnlock() ((void)0)
+#define chSysLockFromISR() ((void)0)
+#define chSysUnlockFromISR() ((void)0)
+#define osalSysLock() ((void)0)
+#define osalSysUnlock() ((void)0)
+#define osalSysLockFromISR() ((void)0)
+#define osalSysUnlockFromISR() ((void)0)
+#define chSchRescheduleS() ((void)0)
+#define chDbgAssert(cond, msg) ((void)(cond))
+#define osalDbgAssert(cond, msg) ((void)(cond))
+#define chRegSetThreadName(name) ((void)(name))
+
+thread_t* chThdCreateStatic(void* warea, size_t size, tprio_t prio, tfunc_t entry, void* arg);
+thread_t* chThdGetSelfX(void);
+void chThdSleep(systime_t ticks);
+#define chThdSleepMilliseconds(ms) chThdSleep(MS2ST(ms))
+#define chThdSleepMicroseconds(us) chThdSleep(US2ST(us))
+#define chThdSleepS(ticks) chThdSleep(ticks)
+void chThdYield(void);
+
+msg_t osalThreadSuspendS(thread_reference_t* trp);
+void osalThreadResumeI(thread_reference_t* trp, msg_t msg);
+#define osalThreadResumeS(trp, msg) osalThreadResumeI(trp, msg)
+
+// Device registers and CMSIS helpers, pulled in by the port on the target
+#include "stm32_sim.h"
@@ -0,0 +1,56 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/*
+ * chprintf.h of the host sweep simulator: the stream VMT layout the
+ * production src/sys/chprintf.c and the display print streams write
+ * through, plus the newlib infinityf() extension.
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ch.h"
+
+#define CHPRINTF_USE_FLOAT 1
+
+#define infinityf() INFINITY
+
+#define _base_sequential_stream_methods                                                            \
+  size_t (*write)(void* instance, const uint8_t* bp, size_t n);                                    \
+  size_t (*read)(void* instance, uint8_t* bp, size_t n);                                           \
+  msg_t (*put)(void* instance, uint8_t b);                                                         \
+  msg_t (*get)(void* instance);
+
+struct BaseSequentialStreamVMT {
+  _base_sequential_stream_methods
+};
+
+#define streamPut(ip, b)                                                                           \
+  (((const struct BaseSequentialStreamVMT*)((BaseSequentialStream*)(ip))->vmt)->put(ip, b))
+
+int chvprintf(BaseSequentialStream* chp, const char* fmt, va_list ap);
+int chprintf(BaseSequentialStream* chp, const char* fmt, ...);
+int chsnprintf(char* str, size_t size, const char* fmt, ...);
+int plot_printf(char* str, int size, const char* fmt, ...);
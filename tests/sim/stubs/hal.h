@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/*
+ * STM32 HAL/CMSIS subset for the host sweep simulator. Peripheral registers
+ * and CMSIS helpers come with ch.h, as on the target port.
+ */
+
+#include "ch.h"
+#include "halconf.h"
+
+#define STM32_DMA_ISR_HTIF (1U << 2)
+#define STM32_DMA_ISR_TCIF (1U << 1)
+
+typedef struct {
+  int state;
+} WDGDriver;
+extern WDGDriver WDGD1;
+#define wdgReset(wdgp) ((void)(wdgp))
+
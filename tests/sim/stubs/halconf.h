@@ -0,0 +1,32 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * HAL subsystems of the host sweep simulator (none of the ChibiOS drivers).
+ */
+
+#pragma once
+
+#include "mcuconf.h"
+
+#define HAL_USE_EXT FALSE
+#define HAL_USE_GPT FALSE
+#define HAL_USE_SERIAL FALSE
+#define HAL_USE_SERIAL_USB FALSE
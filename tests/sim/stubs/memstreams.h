@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/*
+ * ChibiOS memory stream used by chsnprintf(), sim_board.c implements it.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "chprintf.h"
+
+typedef struct {
+  const struct BaseSequentialStreamVMT* vmt;
+  uint8_t* buffer;
+  size_t size;
+  size_t eos;
+} MemoryStream;
+
+void msObjectInit(MemoryStream* msp, uint8_t* buffer, size_t size, size_t eos);
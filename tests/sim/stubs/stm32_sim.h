@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#pragma once
+
+/*
+ * CMSIS device subset of the host sweep simulator: peripheral registers are
+ * plain RAM, __WFI() hands control to the simulated I2S DMA (the only
+ * interrupt source the sweep waits for).
+ */
+
+#include <stdint.h>
+
+#define __STATIC_INLINE static inline
+
+typedef struct {
+  volatile uint32_t MODER, OTYPER, OSPEEDR, PUPDR, IDR, ODR, BSRR, LCKR, AFRL, AFRH, BRR;
+} GPIO_TypeDef;
+
+typedef struct {
+  volatile uint32_t CR1, CR2, SMCR, DIER, SR, EGR, CCMR1, CCMR2, CCER, CNT, PSC, ARR;
+} TIM_TypeDef;
+
+typedef struct {
+  volatile uint32_t TR, DR, CR, ISR, PRER, WUTR, CALR, BKP0R, BKP1R, BKP2R, BKP3R, BKP4R;
+} RTC_TypeDef;
+
+extern GPIO_TypeDef sim_gpio[3];
+extern RTC_TypeDef sim_rtc;
+#define GPIOA (&sim_gpio[0])
+#define GPIOB (&sim_gpio[1])
+#define GPIOC (&sim_gpio[2])
+#define RTC (&sim_rtc)
+#define RTC_CR_COE (1U << 23)
+
+#define GPIOC_LED 13
+
+// The sweep only sleeps in __WFI() while an I2S capture is pending
+void sim_wait_for_interrupt(void);
+#define __WFI() sim_wait_for_interrupt()
+#define __NOP() ((void)0)
+
+static inline int16_t __REVSH(int16_t value) {
+  return (int16_t)(((uint16_t)value << 8) | ((uint16_t)value >> 8));
+}
+
+static inline uint32_t __get_PRIMASK(void) {
+  return 0U;
+}
+static inline void __disable_irq(void) {}
+static inline void __enable_irq(void) {}
+static inline void __set_PRIMASK(uint32_t primask) {
+  (void)primask;
+}
@@ -66,6 +66,7 @@ typedef struct thread {
 } thread_t;
 
 typedef int tprio_t;
+typedef thread_t* thread_reference_t;
 
 typedef struct {
   int dummy;
@@ -88,8 +89,10 @@ void chSysUnlockFromISR(void);
 void osalSysLock(void);
 void osalSysUnlock(void);
 void osalThreadQueueObjectInit(threads_queue_t* queue);
-void osalThreadEnqueueTimeoutS(threads_queue_t* queue, systime_t timeout);
+msg_t osalThreadEnqueueTimeoutS(threads_queue_t* queue, systime_t timeout);
 msg_t osalThreadDequeueNextI(threads_queue_t* queue, msg_t msg);
+msg_t osalThreadSuspendS(thread_reference_t* trp);
+void osalThreadResumeI(thread_reference_t* trp, msg_t msg);
 thread_t* chThdCreateStatic(void* warea, size_t size, tprio_t prio, tfunc_t entry, void* arg);
 void chThdExit(msg_t msg);
 void chThdTerminate(thread_t* tp);
@@ -45,6 +45,9 @@
 // 4. Globals
 extern properties_t current_props;
 extern config_t config;
+extern uint8_t sweep_mode;
+
+#define SWEEP_ENABLE  0x01
 
 #define velocity_factor     current_props._velocity_factor
 #define markers             current_props._markers
@@ -116,6 +119,11 @@ freq_t get_sweep_frequency(uint16_t idx);
 
 int parse_line(char* line, char* args[], int max_cnt);
 int get_str_index(const char* value, const char* list);
+// Fast number to text for data export, return end of string (not null terminated)
+#define MY_FTOA_DIGITS   9  // significant digits needed to read back the same float
+#define MY_FTOA_MAX_SIZE 15 // "-1.23456789e-38"
+char* my_utoa(char* p, uint32_t value);
+char* my_ftoa(char* p, float value, int digits, char separator);
 
 // 9. VNA Math (must be after VNA_PI and __USE_VNA_MATH__ are available)
 #include "processing/vna_math.h"
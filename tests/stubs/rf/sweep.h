@@ -25,10 +25,24 @@
 
 #include "sys/event_bus.h"
 
+#define SWEEP_CH0_MEASURE (1U << 0)
+#define SWEEP_CH1_MEASURE (1U << 1)
+#define SWEEP_APPLY_EDELAY_S11 (1U << 2)
+#define SWEEP_APPLY_EDELAY_S21 (1U << 3)
+#define SWEEP_APPLY_S21_OFFSET (1U << 4)
+#define SWEEP_APPLY_CALIBRATION (1U << 5)
+#define SWEEP_USE_INTERPOLATION (1U << 6)
+#define SWEEP_USE_RENORMALIZATION (1U << 7)
+#define SWEEP_PIPELINE_SETUP (1U << 8)
+#define SWEEP_CHANNEL_MAJOR (1U << 9)
+
 uint16_t app_measurement_get_sweep_mask(void);
 bool app_measurement_sweep(bool break_on_operation, uint16_t mask);
+bool app_measurement_recorrect(uint16_t mask, uint16_t* unfinished_points);
+void app_measurement_transform_domain(uint16_t ch_mask);
 void sweep_service_init(event_bus_t* bus);
 void sweep_service_wait_for_copy_release(void);
 void sweep_service_begin_measurement(void);
 void sweep_service_end_measurement(void);
 uint32_t sweep_service_increment_generation(void);
+void sweep_service_publish_snapshot(void);
@@ -0,0 +1,155 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host-side coverage for the calibration interpolation plan of src/rf/sweep.c.
+ *
+ * The plan caches the source index and weight of every sweep point. The
+ * terms it gives must be bitwise the terms cal_interpolate() computes for the
+ * point frequency, including the extrapolation next to a harmonic band edge,
+ * after a change of the sweep, the calibration range, the harmonic threshold
+ * or the band mode. The file includes sweep.c to reach its static helpers and
+ * links the rest of the simulator (tests/sim) for the drivers and globals.
+ */
+
+#include "rf/sweep.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sim.h"
+
+#ifndef __USE_CAL_INTERP_PLAN__
+#error "build with -D__USE_CAL_INTERP_PLAN__"
+#endif
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+// Distinct, curved terms so a wrong source point or weight changes the result
+static void fill_cal_data(void) {
+  for (uint16_t e = 0; e < CAL_TYPE_COUNT; e++) {
+    for (uint16_t i = 0; i < SWEEP_POINTS_MAX; i++) {
+      float x = (float)i * 0.05f;
+      cal_data[e][i][0] = (float)(e + 1) * x * x - 0.3f * x;
+      cal_data[e][i][1] = 1.0f / (1.0f + x) - (float)e * 0.1f;
+    }
+  }
+}
+
+static void set_calibration(freq_t start, freq_t stop, uint16_t points) {
+  cal_frequency0 = start;
+  cal_frequency1 = stop;
+  cal_sweep_points = points;
+}
+
+static void set_sweep(freq_t start, freq_t stop, uint16_t points) {
+  frequency0 = start;
+  frequency1 = stop;
+  sweep_points = points;
+  app_measurement_update_frequencies();
+}
+
+/*
+ * Compares the plan with cal_interpolate() for every point. Counts the points
+ * the plan extrapolates from the previous and the next source interval, the
+ * harmonic band edges the case must cover.
+ */
+static void check_plan(uint16_t* from_prev, uint16_t* from_next) {
+  *from_prev = 0;
+  *from_next = 0;
+  CHECK(cal_plan_prepare());
+  int mismatches = 0;
+  freq_t span = cal_frequency1 - cal_frequency0;
+  for (uint16_t i = 0; i < sweep_points; i++) {
+    float planned[CAL_TYPE_COUNT][2], direct[CAL_TYPE_COUNT][2];
+    freq_t f = get_frequency(i);
+    cal_apply_weight(cal_plan_idx[i], cal_plan_k[i], planned);
+    cal_interpolate(f, direct);
+    if (memcmp(planned, direct, sizeof(direct)) != 0 && mismatches++ == 0)
+      fprintf(stderr, "[FAIL] point %u (%u Hz): plan differs\n", i, (unsigned)f);
+    if (f > cal_frequency0 && f < cal_frequency1) {
+      uint32_t idx = (uint64_t)(f - cal_frequency0) * (uint64_t)(cal_sweep_points - 1U) / span;
+      *from_prev += cal_plan_idx[i] + 1U == idx;
+      *from_next += cal_plan_idx[i] == idx + 1U;
+    }
+  }
+  CHECK(mismatches == 0);
+}
+
+static void test_plan_matches_across_harmonics(void) {
+  uint16_t from_prev, from_next;
+  // Coarse calibration, the sweep runs past both ends and through the band edges
+  set_calibration(100000000U, 2000000000U, 23);
+  set_sweep(50000000U, 2100000000U, SWEEP_POINTS_MAX);
+  check_plan(&from_prev, &from_next);
+  CHECK(from_prev > 0U);
+  CHECK(from_next > 0U);
+}
+
+static void test_plan_follows_changes(void) {
+  uint16_t from_prev, from_next;
+  set_calibration(100000000U, 2000000000U, 23);
+  set_sweep(50000000U, 2100000000U, SWEEP_POINTS_MAX);
+  check_plan(&from_prev, &from_next);
+
+  // Each change moves the source points or the band edges, the plan follows
+  set_sweep(250000000U, 1000000000U, 77);
+  check_plan(&from_prev, &from_next);
+  CHECK(from_prev + from_next > 0U);
+
+  set_calibration(200000000U, 1100000000U, 11);
+  check_plan(&from_prev, &from_next);
+  CHECK(from_prev + from_next > 0U);
+
+  config._harmonic_freq_threshold = 290000000U;
+  check_plan(&from_prev, &from_next);
+  CHECK(from_prev + from_next > 0U);
+
+  config._band_mode = 1;
+  si5351_set_band_mode(config._band_mode);
+  check_plan(&from_prev, &from_next);
+  CHECK(from_prev + from_next > 0U);
+
+  config._band_mode = 0;
+  si5351_set_band_mode(config._band_mode);
+  config._harmonic_freq_threshold = FREQUENCY_THRESHOLD;
+}
+
+int main(void) {
+  sim_board_init();
+  fill_cal_data();
+  test_plan_matches_across_harmonics();
+  test_plan_follows_changes();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_cal_plan");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
@@ -45,6 +45,8 @@ extern bool strcmpi(const char* lhs, const char* rhs);
 extern int parse_line(char* line, char* args[], int max_cnt);
 extern void swap_bytes(uint16_t* buf, int size);
 extern int packbits(char* source, char* dest, int size);
+extern char* my_utoa(char* p, uint32_t value);
+extern char* my_ftoa(char* p, float value, int digits, char separator);
 
 static int g_failures = 0;
 
@@ -185,6 +187,71 @@ static void test_packbits_roundtrip(void) {
   CHECK(memcmp(restored, payload, strlen(payload)) == 0);
 }
 
+static const char* ftoa_str(char* buf, float value, int digits) {
+  char* end = my_ftoa(buf, value, digits, '.');
+  *end = 0;
+  return buf;
+}
+
+static void test_my_utoa(void) {
+  /* Frequencies and point indices go through my_utoa in the export paths. */
+  char buf[16];
+  *my_utoa(buf, 0) = 0;
+  CHECK(strcmp(buf, "0") == 0);
+  *my_utoa(buf, 2700000000U) = 0;
+  CHECK(strcmp(buf, "2700000000") == 0);
+  *my_utoa(buf, 4294967295U) = 0;
+  CHECK(strcmp(buf, "4294967295") == 0);
+}
+
+static void test_my_ftoa(void) {
+  /*
+   * my_ftoa feeds scan/data/Touchstone export.  Output must match the C
+   * library's correctly rounded "%.*e" digit for digit, and 9 significant
+   * digits must read back to the identical float, otherwise exported
+   * S-parameters silently lose precision.
+   */
+  char buf[32];
+  char ref[32];
+  CHECK(strcmp(ftoa_str(buf, 0.0f, 9), "0.00000000e+00") == 0);
+  CHECK(strcmp(ftoa_str(buf, -0.0f, 9), "-0.00000000e+00") == 0);
+  CHECK(strcmp(ftoa_str(buf, 1.0f, 9), "1.00000000e+00") == 0);
+  CHECK(strcmp(ftoa_str(buf, -0.5f, 3), "-5.00e-01") == 0);
+  CHECK(strcmp(ftoa_str(buf, 9.9999f, 2), "1.0e+01") == 0); /* rounding carries into exponent */
+  CHECK(strcmp(ftoa_str(buf, 1e-40f, 9), "9.99994610e-41") == 0); /* denormal */
+  CHECK(strcmp(ftoa_str(buf, 3.0e9f, 1), "3e+09") == 0);
+  CHECK(strcmp(ftoa_str(buf, INFINITY, 9), "inf") == 0);
+  CHECK(strcmp(ftoa_str(buf, -INFINITY, 9), "-inf") == 0);
+  CHECK(strcmp(ftoa_str(buf, NAN, 9), "nan") == 0);
+  *my_ftoa(buf, 0.25f, 3, ',') = 0;
+  CHECK(strcmp(buf, "2,50e-01") == 0);
+
+  int mismatches = 0;
+  int roundtrip_errors = 0;
+  uint32_t seed = 12345u;
+  for (int i = 0; i < 200000; i++) {
+    seed = seed * 1664525u + 1013904223u;
+    union {
+      uint32_t u;
+      float f;
+    } v = {.u = seed};
+    /* Skip inf/nan and denormals (the host build uses -ffast-math, flushes them) */
+    if ((v.u & 0x7F800000u) == 0x7F800000u || (v.u & 0x7F800000u) == 0)
+      continue;
+    int digits = 1 + (int)((seed >> 7) % 9);
+    ftoa_str(buf, v.f, digits);
+    snprintf(ref, sizeof(ref), "%.*e", digits - 1, (double)v.f);
+    if (strcmp(buf, ref) != 0 && mismatches++ < 5)
+      fprintf(stderr, "  my_ftoa(%a, %d) = %s, expected %s\n", (double)v.f, digits, buf, ref);
+    if (strlen(ftoa_str(buf, v.f, 9)) > 15)
+      mismatches++;
+    if (strtof(buf, NULL) != v.f)
+      roundtrip_errors++;
+  }
+  CHECK_WITH_MSG(mismatches == 0, "%d outputs differ from %%.*e", mismatches);
+  CHECK_WITH_MSG(roundtrip_errors == 0, "%d values do not read back", roundtrip_errors);
+}
+
 int main(void) {
   test_my_atoi();
   test_my_atoui();
@@ -194,6 +261,8 @@ int main(void) {
   test_parse_line();
   test_swap_bytes();
   test_packbits_roundtrip();
+  test_my_utoa();
+  test_my_ftoa();
 
   if (g_failures == 0) {
     puts("[PASS] tests/unit/test_common");
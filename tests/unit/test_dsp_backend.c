@@ -39,6 +39,11 @@ void dsp_process(audio_sample_t* capture, size_t length);
 void fetch_amplitude(float* gamma);
 void fetch_amplitude_ref(float* gamma);
 extern void reset_dsp_accumerator(void);
+#ifdef __USE_ADAPTIVE_IFBW__
+uint16_t dsp_adaptive_update(void);
+uint16_t dsp_adaptive_count(void);
+bool dsp_adaptive_converged(float target, uint16_t min_count);
+#endif
 
 static int g_failures = 0;
 
@@ -151,12 +156,100 @@ static void test_calculate_gamma_sign(void) {
   }
 }
 
+#ifdef __USE_ADAPTIVE_IFBW__
+static uint32_t lcg_state = 1;
+static int32_t lcg_noise(int32_t amplitude) {
+  lcg_state = lcg_state * 1664525u + 1013904223u;
+  return (int32_t)((lcg_state >> 16) % (2u * amplitude + 1u)) - amplitude;
+}
+
+/*
+ * Feed buffers with sample = 0.5 * ref plus noise until the estimator reports
+ * convergence for target, return the number of buffers used (max if never).
+ */
+static uint16_t adaptive_run(int32_t noise, float target, uint16_t max) {
+  audio_sample_t capture[2 * AUDIO_SAMPLES_COUNT];
+  reset_dsp_accumerator();
+  for (uint16_t n = 1; n <= max; ++n) {
+    for (size_t i = 0; i < AUDIO_SAMPLES_COUNT; ++i) {
+      float phase = (2.0f * VNA_PI * 3 * i) / AUDIO_SAMPLES_COUNT;
+      int32_t ref = (int32_t)(8000.0f * sinf(phase) + 6000.0f * cosf(phase * 2.0f / 3.0f));
+      capture[i * 2 + 0] = ref;
+      capture[i * 2 + 1] = ref / 2 + lcg_noise(noise);
+    }
+    dsp_process(capture, sizeof(capture) / sizeof(capture[0]));
+    if (dsp_adaptive_update() != n) {
+      ++g_failures;
+      fprintf(stderr, "[FAIL] adaptive count %u expected %u\n", dsp_adaptive_count(), n);
+    }
+    if (dsp_adaptive_converged(target, 4))
+      return n;
+  }
+  return max;
+}
+
+static void test_adaptive_clean_signal_stops_at_minimum(void) {
+  uint16_t n = adaptive_run(0, 1e-6f, 200);
+  if (n != 4) {
+    ++g_failures;
+    fprintf(stderr, "[FAIL] noise free point used %u buffers, expected 4\n", n);
+  }
+  extern void calculate_gamma(float* gamma);
+  float gamma[2];
+  calculate_gamma(gamma);
+  expect_close(0.5f, gamma[0], 0.01f, "adaptive clean gamma real");
+  expect_close(0.0f, gamma[1], 0.01f, "adaptive clean gamma imag");
+}
+
+static void test_adaptive_noise_extends_capture(void) {
+  lcg_state = 1;
+  uint16_t loose = adaptive_run(2000, 1e-4f, 1000);
+  lcg_state = 1;
+  uint16_t tight = adaptive_run(2000, 1e-5f, 1000);
+  // Variance of the mean falls as 1/n: 10x tighter target, about 10x more buffers
+  if (!(loose > 4 && tight > 5 * loose && tight < 1000)) {
+    ++g_failures;
+    fprintf(stderr, "[FAIL] noisy point buffers loose=%u tight=%u\n", loose, tight);
+  }
+  // Deep notch: almost no signal, the relative target is never met
+  audio_sample_t capture[2 * AUDIO_SAMPLES_COUNT];
+  reset_dsp_accumerator();
+  lcg_state = 7;
+  for (int n = 0; n < 50; ++n) {
+    for (size_t i = 0; i < AUDIO_SAMPLES_COUNT; ++i) {
+      float phase = (2.0f * VNA_PI * 3 * i) / AUDIO_SAMPLES_COUNT;
+      capture[i * 2 + 0] = (int32_t)(8000.0f * sinf(phase) + 6000.0f * cosf(phase * 2.0f / 3.0f));
+      capture[i * 2 + 1] = lcg_noise(200);
+    }
+    dsp_process(capture, sizeof(capture) / sizeof(capture[0]));
+    dsp_adaptive_update();
+  }
+  if (dsp_adaptive_converged(1e-4f, 4)) {
+    ++g_failures;
+    fprintf(stderr, "[FAIL] noise only point converged\n");
+  }
+}
+
+static void test_adaptive_reset(void) {
+  adaptive_run(0, 1e-6f, 200);
+  reset_dsp_accumerator();
+  if (dsp_adaptive_count() != 0 || dsp_adaptive_converged(1.0f, 0)) {
+    ++g_failures;
+    fprintf(stderr, "[FAIL] adaptive statistics not cleared by reset\n");
+  }
+}
+#endif
 
 int main(void) {
   test_dc_signal();
   test_in_phase_sine();
   test_quadrature_sine();
   test_calculate_gamma_sign();
+#ifdef __USE_ADAPTIVE_IFBW__
+  test_adaptive_clean_signal_stops_at_minimum();
+  test_adaptive_noise_extends_capture();
+  test_adaptive_reset();
+#endif
 
   if (g_failures == 0) {
     puts("[PASS] tests/unit/test_dsp_backend");
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host-side coverage for src/driver/i2c_queue.c.
+ *
+ * A mock bus backend records every transaction it is asked to start and ends
+ * them on demand, or from the thread suspend stub (the interrupt firing while
+ * the writer sleeps). The tests pin the FIFO order, the data copy, blocking on
+ * a full ring, NACK reporting through callbacks and flush, and a backend that
+ * completes synchronously from start.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "driver/i2c_queue.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+#define LOG_MAX 16
+
+typedef struct {
+  uint8_t addr;
+  uint8_t len;
+  uint8_t data[I2C_QUEUE_DATA_SIZE];
+} transaction_t;
+
+static i2c_queue_t queue;
+static transaction_t g_log[LOG_MAX];
+static size_t g_log_count = 0;
+static const i2c_request_t* g_active = NULL;
+static uint32_t g_nack_mask = 0; // bit per logged transaction
+static bool g_sync_bus = false;
+static bool g_locked = false;
+static int g_suspends = 0;
+static int g_resumes = 0;
+
+typedef struct {
+  int calls;
+  bool ok[LOG_MAX];
+} done_log_t;
+
+static void mock_finish(void) {
+  bool ok = (g_nack_mask & (1U << (g_log_count - 1U))) == 0U;
+  g_active = NULL;
+  i2c_queue_complete_i(&queue, ok);
+}
+
+static void mock_start(const i2c_request_t* req) {
+  CHECK(g_locked);
+  CHECK(g_active == NULL);
+  if (g_log_count < LOG_MAX) {
+    transaction_t* t = &g_log[g_log_count++];
+    t->addr = req->addr;
+    t->len = req->len;
+    memcpy(t->data, req->data, req->len);
+  }
+  g_active = req;
+  if (g_sync_bus)
+    mock_finish();
+}
+
+void osalSysLock(void) {
+  CHECK(!g_locked);
+  g_locked = true;
+}
+
+void osalSysUnlock(void) {
+  CHECK(g_locked);
+  g_locked = false;
+}
+
+// The writer sleeps: the bus interrupt ends the transfer in progress
+msg_t osalThreadSuspendS(thread_reference_t* trp) {
+  static thread_t self;
+  CHECK(g_locked);
+  g_suspends++;
+  *trp = &self;
+  CHECK(g_active != NULL);
+  if (g_active != NULL)
+    mock_finish();
+  CHECK(*trp == NULL);
+  return MSG_OK;
+}
+
+void osalThreadResumeI(thread_reference_t* trp, msg_t msg) {
+  (void)msg;
+  if (*trp != NULL) {
+    g_resumes++;
+    *trp = NULL;
+  }
+}
+
+static void done_cb(void* arg, bool ok) {
+  done_log_t* log = arg;
+  if (log->calls < LOG_MAX)
+    log->ok[log->calls] = ok;
+  log->calls++;
+}
+
+static void reset_mock(void) {
+  i2c_queue_init(&queue, mock_start);
+  memset(g_log, 0, sizeof(g_log));
+  g_log_count = 0;
+  g_active = NULL;
+  g_nack_mask = 0;
+  g_sync_bus = false;
+  g_suspends = 0;
+  g_resumes = 0;
+}
+
+static void test_fifo_order(void) {
+  reset_mock();
+  uint8_t buf[3] = {42, 1, 2};
+  CHECK(i2c_queue_write(&queue, 0x60, buf, 3, NULL, NULL));
+  buf[0] = 50;
+  buf[1] = 3;
+  CHECK(i2c_queue_write(&queue, 0x60, buf, 2, NULL, NULL));
+  buf[0] = 1;
+  CHECK(i2c_queue_write(&queue, 0x18, buf, 1, NULL, NULL));
+  // Only the head is on the bus, the rest waits in the ring
+  CHECK(g_log_count == 1U);
+  CHECK(!i2c_queue_idle(&queue));
+  CHECK(g_suspends == 0);
+
+  g_locked = true;
+  mock_finish();
+  CHECK(g_log_count == 2U);
+  mock_finish();
+  CHECK(g_log_count == 3U);
+  mock_finish();
+  g_locked = false;
+  CHECK(i2c_queue_idle(&queue));
+
+  CHECK(g_log[0].addr == 0x60 && g_log[0].len == 3U);
+  CHECK(g_log[0].data[0] == 42 && g_log[0].data[1] == 1 && g_log[0].data[2] == 2);
+  CHECK(g_log[1].addr == 0x60 && g_log[1].len == 2U);
+  CHECK(g_log[1].data[0] == 50 && g_log[1].data[1] == 3);
+  CHECK(g_log[2].addr == 0x18 && g_log[2].len == 1U && g_log[2].data[0] == 1);
+  // Nothing left: flush returns without sleeping
+  CHECK(i2c_queue_flush(&queue));
+  CHECK(g_suspends == 0);
+}
+
+static void test_full_ring_blocks(void) {
+  reset_mock();
+  for (uint8_t i = 0; i < I2C_QUEUE_LENGTH; i++)
+    CHECK(i2c_queue_write(&queue, 0x60, &i, 1, NULL, NULL));
+  CHECK(g_suspends == 0);
+  // The ring wraps: the writer sleeps until the transfer on the bus ends
+  uint8_t last = I2C_QUEUE_LENGTH;
+  CHECK(i2c_queue_write(&queue, 0x60, &last, 1, NULL, NULL));
+  CHECK(g_suspends == 1);
+  CHECK(g_resumes == 1);
+  CHECK(i2c_queue_flush(&queue));
+  CHECK(g_suspends == 1 + I2C_QUEUE_LENGTH);
+  CHECK(i2c_queue_idle(&queue));
+  CHECK(g_log_count == I2C_QUEUE_LENGTH + 1U);
+  for (size_t i = 0; i < g_log_count; i++)
+    CHECK(g_log[i].data[0] == i);
+}
+
+static void test_nack_reported(void) {
+  reset_mock();
+  done_log_t log = {0};
+  g_nack_mask = 1U << 1;
+  uint8_t buf[2] = {16, 0x80};
+  for (int i = 0; i < 3; i++)
+    CHECK(i2c_queue_write(&queue, 0x60, buf, 2, done_cb, &log));
+  // A failed transfer does not stop the queue, each request gets its status
+  CHECK(!i2c_queue_flush(&queue));
+  CHECK(log.calls == 3);
+  CHECK(log.ok[0] && !log.ok[1] && log.ok[2]);
+  CHECK(g_log_count == 3U);
+  // The error is reported once
+  CHECK(i2c_queue_flush(&queue));
+  CHECK(i2c_queue_write(&queue, 0x60, buf, 2, done_cb, &log));
+  CHECK(i2c_queue_flush(&queue));
+  CHECK(log.calls == 4 && log.ok[3]);
+}
+
+static void test_rejects_bad_length(void) {
+  reset_mock();
+  uint8_t buf[I2C_QUEUE_DATA_SIZE + 1] = {0};
+  CHECK(!i2c_queue_write(&queue, 0x60, buf, 0, NULL, NULL));
+  CHECK(!i2c_queue_write(&queue, 0x60, buf, sizeof(buf), NULL, NULL));
+  CHECK(i2c_queue_write(&queue, 0x60, buf, I2C_QUEUE_DATA_SIZE, NULL, NULL));
+  CHECK(g_log_count == 1U && g_log[0].len == I2C_QUEUE_DATA_SIZE);
+  CHECK(i2c_queue_flush(&queue));
+}
+
+static void test_synchronous_backend(void) {
+  reset_mock();
+  done_log_t log = {0};
+  g_sync_bus = true;
+  g_nack_mask = 1U << 0;
+  for (uint8_t i = 0; i < 2U * I2C_QUEUE_LENGTH; i++) {
+    CHECK(i2c_queue_write(&queue, 0x60, &i, 1, done_cb, &log));
+    CHECK(i2c_queue_idle(&queue));
+  }
+  CHECK(log.calls == 2 * I2C_QUEUE_LENGTH);
+  CHECK(!log.ok[0] && log.ok[1]);
+  CHECK(!i2c_queue_flush(&queue));
+  CHECK(g_suspends == 0);
+}
+
+int main(void) {
+  test_fifo_order();
+  test_full_ring_blocks();
+  test_nack_reported();
+  test_rejects_bad_length();
+  test_synchronous_backend();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_i2c_queue");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
@@ -28,16 +28,22 @@
  * flag, and the sweep service simply records call counts.  These tests ensure
  * EVENT_SWEEP_{STARTED,COMPLETED} fire in the right order, that break flags
  * propagate down to the pipeline, and that results always reach the port even
- * when a sweep aborts.
+ * when a sweep aborts.  The sweep order test checks the pass layout of the
+ * default and channel-major orders; the simulator (make sim, --order-check)
+ * runs both through the sweep FSM and checks the driver calls they make, and
+ * test_sweep_order.c compares the data both orders measure bit for bit.
  */
 
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "rf/correction.h"
 #include "rf/measurement.h"
+#include "rf/sweep.h"
 
 /* ------------------------------------------------------------------------- */
 /*                         Stubbed sweep service hooks                        */
@@ -47,8 +53,10 @@ static int g_sweep_wait_calls;
 static int g_sweep_begin_calls;
 static int g_sweep_end_calls;
 static int g_sweep_generation_calls;
+static int g_sweep_publish_calls;
 
-void sweep_service_init(void) {
+void sweep_service_init(event_bus_t* bus) {
+  (void)bus;
   ++g_sweep_init_calls;
 }
 
@@ -69,6 +77,10 @@ uint32_t sweep_service_increment_generation(void) {
   return (uint32_t)g_sweep_generation_calls;
 }
 
+void sweep_service_publish_snapshot(void) {
+  ++g_sweep_publish_calls;
+}
+
 /* ------------------------------------------------------------------------- */
 /*                         Measurement pipeline stubs                         */
 
@@ -87,6 +99,12 @@ bool app_measurement_sweep(bool break_on_operation, uint16_t channel_mask) {
   return g_pipeline_result;
 }
 
+bool app_measurement_recorrect(uint16_t mask, uint16_t* unfinished_points) {
+  (void)mask;
+  *unfinished_points = 0;
+  return false;
+}
+
 /* ------------------------------------------------------------------------- */
 /*                             Event bus stubs                                */
 
@@ -165,6 +183,7 @@ static void reset_stubs(void) {
   g_sweep_begin_calls = 0;
   g_sweep_end_calls = 0;
   g_sweep_generation_calls = 0;
+  g_sweep_publish_calls = 0;
   g_active_mask = 0x0Fu;
   g_pipeline_result = true;
   g_last_break_flag = false;
@@ -243,6 +262,7 @@ static void test_tick_completed_sweep_publishes_events(void) {
   CHECK(g_sweep_begin_calls == 1, "sweep begin must run");
   CHECK(g_sweep_end_calls == 1, "sweep end must run");
   CHECK(g_sweep_generation_calls == 1, "generation counter must increment");
+  CHECK(g_sweep_publish_calls == 1, "completed sweep must be published to snapshot readers");
   CHECK(g_recorded_event_count == 2, "two events expected for a completed sweep");
   CHECK(g_recorded_events[0].topic == EVENT_SWEEP_STARTED, "first event must be STARTED");
   CHECK(g_recorded_events[1].topic == EVENT_SWEEP_COMPLETED, "second event must be COMPLETED");
@@ -272,16 +292,103 @@ static void test_tick_incomplete_sweep_skips_completed_event(void) {
   CHECK(g_recorded_event_count == 1, "only STARTED event should fire on failure");
   CHECK(g_recorded_events[0].topic == EVENT_SWEEP_STARTED, "first event must be STARTED");
   CHECK(g_sweep_generation_calls == 0, "generation must not bump on failure");
+  CHECK(g_sweep_publish_calls == 0, "incomplete sweep must not be published");
   CHECK(state.last_result.completed == false, "port must learn about the failure");
   CHECK(state.last_result.sweep_mask == g_active_mask, "result mask should still propagate");
 }
 
+/* ------------------------------------------------------------------------- */
+/*                         Sweep order equivalence                            */
+
+static void test_sweep_order_pass_layout(void) {
+  const uint16_t both = SWEEP_CH0_MEASURE | SWEEP_CH1_MEASURE;
+  CHECK(sweep_order_pass_count(both) == 1U, "default order must use a single pass");
+  CHECK(sweep_order_pass_mask(both, 0) == both, "default pass keeps both channels");
+  CHECK(sweep_order_pass_count(both | SWEEP_CHANNEL_MAJOR) == 2U,
+        "channel-major order with both channels must use two passes");
+  CHECK((sweep_order_pass_mask(both | SWEEP_CHANNEL_MAJOR, 0) & both) == SWEEP_CH0_MEASURE,
+        "first channel-major pass measures channel 0 only");
+  CHECK((sweep_order_pass_mask(both | SWEEP_CHANNEL_MAJOR, 1) & both) == SWEEP_CH1_MEASURE,
+        "second channel-major pass measures channel 1 only");
+  CHECK(sweep_order_pass_count(SWEEP_CH1_MEASURE | SWEEP_CHANNEL_MAJOR) == 1U,
+        "single channel sweeps do not split");
+}
+
+#define EDELAY_TEST_POINTS 401
+
+// Linear sweep grid with the firmware rounding: start + round(i * span / (points - 1))
+static freq_t edelay_test_frequency(uint16_t i) {
+  const uint64_t start = 50000U, stop = 2700000000U, steps = EDELAY_TEST_POINTS - 1U;
+  return (freq_t)(start + ((stop - start) * i + steps / 2U) / steps);
+}
+
+static float edelay_test_error(sweep_correction_t* stepped, sweep_correction_t* direct,
+                               const uint16_t* order, uint16_t count, float* max_mag_error) {
+  float max_error = 0.0f;
+  *max_mag_error = 0.0f;
+  for (uint16_t n = 0; n < count; n++) {
+    uint16_t i = order[n];
+    freq_t f = edelay_test_frequency(i);
+    for (uint8_t ch = 0; ch < 2; ch++) {
+      float a[4] = {1.0f, 0.0f, 1.0f, 0.0f};
+      float b[4] = {1.0f, 0.0f, 1.0f, 0.0f};
+      sweep_correct_channel(stepped, ch, i, f, a, NULL);
+      sweep_correct_channel(direct, ch, i, f, b, NULL);
+      float dr = a[ch * 2] - b[ch * 2];
+      float di = a[ch * 2 + 1] - b[ch * 2 + 1];
+      float err = sqrtf(dr * dr + di * di);
+      float mag = fabsf(sqrtf(a[ch * 2] * a[ch * 2] + a[ch * 2 + 1] * a[ch * 2 + 1]) - 1.0f);
+      if (err > max_error)
+        max_error = err;
+      if (mag > *max_mag_error)
+        *max_mag_error = mag;
+    }
+  }
+  return max_error;
+}
+
+static void test_edelay_phasor_matches_direct(void) {
+  const uint16_t mask = SWEEP_APPLY_EDELAY_S11 | SWEEP_APPLY_EDELAY_S21;
+  const freq_t span = edelay_test_frequency(EDELAY_TEST_POINTS - 1U) - edelay_test_frequency(0);
+  const freq_t steps = EDELAY_TEST_POINTS - 1U;
+  const float freq_step = (float)(span / steps) + (float)(span % steps) / (float)steps;
+  static uint16_t order[EDELAY_TEST_POINTS];
+  sweep_correction_t stepped, direct;
+  float mag_error;
+
+  // Full sequential sweep over the whole band, 30 and 70 turns of rotation
+  for (uint16_t i = 0; i < EDELAY_TEST_POINTS; i++)
+    order[i] = i;
+  sweep_correction_init(&stepped, mask, false, 11.1e-9f, -25.9e-9f, 1.0f, freq_step);
+  sweep_correction_init(&direct, mask, false, 11.1e-9f, -25.9e-9f, 1.0f, 0.0f);
+  CHECK(edelay_test_error(&stepped, &direct, order, EDELAY_TEST_POINTS, &mag_error) < 2e-4f,
+        "stepped edelay rotation must match the direct evaluation");
+  CHECK(mag_error < 1e-5f, "stepped edelay rotation must keep a unit magnitude");
+
+  // Resumed and repeated points reseed the rotation instead of stepping past them
+  uint16_t n = 0;
+  for (uint16_t i = 0; i < 100; i++)
+    order[n++] = i;
+  for (uint16_t i = 250; i < 300; i++)
+    order[n++] = i;
+  order[n++] = 299;
+  order[n++] = 17;
+  for (uint16_t i = 18; i < 40; i++)
+    order[n++] = i;
+  sweep_correction_init(&stepped, mask, false, 11.1e-9f, -25.9e-9f, 1.0f, freq_step);
+  sweep_correction_init(&direct, mask, false, 11.1e-9f, -25.9e-9f, 1.0f, 0.0f);
+  CHECK(edelay_test_error(&stepped, &direct, order, n, &mag_error) < 2e-4f,
+        "point jumps must reseed the edelay rotation");
+}
+
 int main(void) {
   test_init_calls_sweep_service();
   test_tick_null_engine_sleeps();
   test_tick_without_trigger_sleeps_and_skips_events();
   test_tick_completed_sweep_publishes_events();
   test_tick_incomplete_sweep_skips_completed_event();
+  test_sweep_order_pass_layout();
+  test_edelay_phasor_matches_direct();
 
   if (g_failures == 0) {
     puts("[PASS] tests/unit/test_measurement_engine");
@@ -46,6 +46,17 @@ bool app_measurement_sweep(bool break_on_operation, uint16_t channel_mask) {
   return (channel_mask & 0x1u) != 0u;
 }
 
+static bool g_recorrect_result = false;
+static uint16_t g_recorrect_mask = 0u;
+static int g_recorrect_calls = 0;
+
+bool app_measurement_recorrect(uint16_t mask, uint16_t* unfinished_points) {
+  ++g_recorrect_calls;
+  g_recorrect_mask = mask;
+  *unfinished_points = 0u;
+  return g_recorrect_result;
+}
+
 static int g_failures = 0;
 
 static void assert_true(bool cond, const char* msg) {
@@ -79,9 +90,25 @@ static void test_execute(void) {
   assert_true(g_last_channel == 0x00u, "channel mask updated");
 }
 
+static void test_recorrect(void) {
+  measurement_pipeline_t pipeline = {.drivers = NULL};
+  g_recorrect_calls = 0;
+  g_recorrect_result = false;
+  bool done = measurement_pipeline_recorrect(&pipeline, 0x23u);
+  assert_true(!done, "recorrect reports missing raw data");
+  assert_true(g_recorrect_calls == 1, "recorrect delegates to the sweep service");
+  assert_true(g_recorrect_mask == 0x23u, "recorrect forwards the correction mask");
+
+  g_recorrect_result = true;
+  done = measurement_pipeline_recorrect(&pipeline, 0x03u);
+  assert_true(done, "recorrect succeeds when raw data is available");
+  assert_true(g_last_channel == 0x00u, "recorrect must not start a sweep");
+}
+
 int main(void) {
   test_init_and_mask();
   test_execute();
+  test_recorrect();
 
   if (g_failures == 0) {
     puts("[PASS] tests/unit/test_measurement_pipeline");
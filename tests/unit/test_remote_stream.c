@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host-side coverage for src/sys/remote_stream.c ("refresh delta").
+ *
+ * The delta remote desktop stream only sends grid cells whose content changed
+ * since they were last sent, palette/RLE encodes the pixels and keeps solid
+ * fills as single commands. A PC client has to rebuild the exact screen from
+ * that stream alone, so these tests run a reference decoder over everything
+ * the encoder writes and compare the rebuilt frame with the device frame.
+ * A mismatch means the client would show a corrupted or stale screen.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sys/remote_stream.h"
+
+config_t config;
+
+// Palette slots as in ui_style.h (not part of the host stubs)
+enum { PAL_BG = 0, PAL_FG, PAL_GRID, PAL_MENU, PAL_MENU_TEXT, PAL_TRACE = 6 };
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+// Device side: what the LCD shows
+static pixel_t device[LCD_HEIGHT][LCD_WIDTH];
+// Client side: rebuilt from the stream
+static pixel_t client[LCD_HEIGHT][LCD_WIDTH];
+static pixel_t client_palette[REMOTE_PACK_PALETTE_SIZE];
+
+static uint8_t stream[1 << 20];
+static size_t stream_len;
+
+static void capture(const void* data, size_t size) {
+  if (stream_len + size > sizeof(stream)) {
+    ++g_failures;
+    fprintf(stderr, "[FAIL] stream capture overflow\n");
+    return;
+  }
+  memcpy(&stream[stream_len], data, size);
+  stream_len += size;
+}
+
+typedef struct {
+  int bulk, fill, pack, palette;
+} message_count_t;
+
+// Reference client: apply every message to client[], return false on malformed stream
+static bool decode_stream(message_count_t* count) {
+  size_t pos = 0;
+  memset(count, 0, sizeof(*count));
+  while (pos < stream_len) {
+    remote_region_t rd;
+    if (stream_len - pos < sizeof(rd))
+      return false;
+    memcpy(&rd, &stream[pos], sizeof(rd));
+    pos += sizeof(rd);
+    if (memcmp(rd.new_str, "palt\r\n", 6) == 0) {
+      if (rd.w != REMOTE_PACK_PALETTE_SIZE)
+        return false;
+      memcpy(client_palette, &stream[pos], sizeof(client_palette));
+      pos += sizeof(client_palette);
+      count->palette++;
+    } else if (memcmp(rd.new_str, "fill\r\n", 6) == 0) {
+      pixel_t color;
+      memcpy(&color, &stream[pos], sizeof(color));
+      pos += sizeof(color);
+      for (int y = rd.y; y < rd.y + rd.h; y++)
+        for (int x = rd.x; x < rd.x + rd.w; x++)
+          client[y][x] = color;
+      count->fill++;
+    } else if (memcmp(rd.new_str, "bulk\r\n", 6) == 0) {
+      for (int y = rd.y; y < rd.y + rd.h; y++) {
+        memcpy(&client[y][rd.x], &stream[pos], rd.w * sizeof(pixel_t));
+        pos += rd.w * sizeof(pixel_t);
+      }
+      count->bulk++;
+    } else if (memcmp(rd.new_str, "pack\r\n", 6) == 0) {
+      int total = rd.w * rd.h, done = 0;
+      while (done < total) {
+        if (pos >= stream_len)
+          return false;
+        uint8_t t = stream[pos++];
+        int index = t & 0x1F, run = (t >> 5) + 1;
+        if ((t >> 5) == REMOTE_PACK_RUN_SHORT)
+          run = stream[pos++] + REMOTE_PACK_RUN_SHORT + 1;
+        pixel_t color;
+        if (index == REMOTE_PACK_LITERAL) {
+          memcpy(&color, &stream[pos], sizeof(color));
+          pos += sizeof(color);
+        } else
+          color = client_palette[index];
+        if (done + run > total)
+          return false;
+        for (; run; run--, done++)
+          client[rd.y + done / rd.w][rd.x + done % rd.w] = color;
+      }
+      count->pack++;
+    } else
+      return false;
+    if (stream_len - pos < 6 || memcmp(&stream[pos], "ch> \r\n", 6) != 0)
+      return false;
+    pos += 6;
+  }
+  return true;
+}
+
+static bool screens_equal(void) {
+  return memcmp(device, client, sizeof(device)) == 0;
+}
+
+// Draw a region on the device, the way lcd_bulk() hands it to the stream
+static bool draw_bulk(int x, int y, int w, int h, const pixel_t* pixels) {
+  for (int j = 0; j < h; j++)
+    memcpy(&device[y + j][x], &pixels[j * w], w * sizeof(pixel_t));
+  return remote_stream_bulk(x, y, w, h, pixels);
+}
+
+static void draw_fill(int x, int y, int w, int h, pixel_t color) {
+  for (int j = y; j < y + h; j++)
+    for (int i = x; i < x + w; i++)
+      device[j][i] = color;
+  remote_stream_fill(x, y, w, h, color);
+}
+
+// Plot-like cell: background, grid line, a trace segment and a few text pixels
+static void render_cell(pixel_t* buf, int w, int h, int seed) {
+  const pixel_t* pal = config._lcd_palette;
+  for (int i = 0; i < w * h; i++)
+    buf[i] = pal[PAL_BG];
+  for (int x = 0; x < w; x++)
+    buf[(h / 2) * w + x] = pal[PAL_GRID];
+  int y = (seed * 7) % h;
+  for (int x = 0; x < w; x++, y = (y + (seed & 1 ? 1 : h - 1)) % h)
+    buf[y * w + x] = pal[PAL_TRACE];
+  for (int i = 0; i < (seed % 5); i++)
+    buf[(seed * 13 + i * 17) % (w * h)] = pal[PAL_FG];
+}
+
+static void draw_grid(int seed) {
+  pixel_t cell[CELLWIDTH * CELLHEIGHT];
+  for (int r = 0; r < REMOTE_GRID_ROWS; r++)
+    for (int c = 0; c < REMOTE_GRID_COLS; c++) {
+      int x = OFFSETX + c * CELLWIDTH, y = OFFSETY + r * CELLHEIGHT;
+      int w = LCD_WIDTH - x < CELLWIDTH ? LCD_WIDTH - x : CELLWIDTH;
+      int h = LCD_HEIGHT - y < CELLHEIGHT ? LCD_HEIGHT - y : CELLHEIGHT;
+      render_cell(cell, w, h, seed + r * 31 + c);
+      draw_bulk(x, y, w, h, cell);
+    }
+}
+
+static void reset(void) {
+  for (int i = 0; i < MAX_PALETTE; i++)
+    config._lcd_palette[i] = (pixel_t)(0x1111U * (i + 1) + (i << 3));
+  memset(device, 0, sizeof(device));
+  memset(client, 0, sizeof(client));
+  stream_len = 0;
+  remote_stream_start(capture);
+}
+
+static void test_header_layout(void) {
+  // Clients parse the header as 6 tag bytes + 4 little endian int16
+  CHECK(sizeof(remote_region_t) == 14);
+  CHECK(remote_stream_enabled());
+  remote_stream_stop();
+  CHECK(!remote_stream_enabled());
+}
+
+static void test_full_frame_rebuild(void) {
+  /*
+   * First frame after "refresh delta": every cell is sent, the palette goes
+   * out before the first packed cell and the client frame matches.
+   */
+  message_count_t count;
+  reset();
+  draw_fill(0, 0, LCD_WIDTH, LCD_HEIGHT, config._lcd_palette[PAL_BG]);
+  draw_grid(1);
+  CHECK(decode_stream(&count));
+  CHECK(screens_equal());
+  CHECK(count.palette == 1);
+  CHECK(count.fill == 1);
+  CHECK(count.pack + count.bulk == REMOTE_GRID_ROWS * REMOTE_GRID_COLS);
+  CHECK(count.pack > 0);
+}
+
+static void test_unchanged_cells_skipped(void) {
+  /*
+   * Redrawing cells with identical content (the sweep redraws every cell a
+   * trace touches) must not produce any output.
+   */
+  reset();
+  draw_grid(2);
+  stream_len = 0;
+  draw_grid(2);
+  CHECK(stream_len == 0);
+  // One changed cell: exactly one region
+  pixel_t cell[CELLWIDTH * CELLHEIGHT];
+  render_cell(cell, CELLWIDTH, CELLHEIGHT, 99);
+  CHECK(draw_bulk(OFFSETX + CELLWIDTH, OFFSETY, CELLWIDTH, CELLHEIGHT, cell));
+  message_count_t count;
+  CHECK(decode_stream(&count));
+  CHECK(count.pack + count.bulk == 1);
+}
+
+static void test_overdraw_invalidates_cells(void) {
+  /*
+   * A fill or a menu region drawn over cells changes the client screen; when
+   * the cells are drawn again with their old content they must be resent.
+   */
+  message_count_t count;
+  reset();
+  draw_grid(3);
+  CHECK(decode_stream(&count));
+  stream_len = 0;
+  draw_fill(OFFSETX + 3, OFFSETY + 3, CELLWIDTH * 2, CELLHEIGHT, config._lcd_palette[PAL_MENU]);
+  pixel_t menu[50 * 12];
+  for (int i = 0; i < 50 * 12; i++)
+    menu[i] = config._lcd_palette[(i / 7) % 3 ? PAL_MENU : PAL_MENU_TEXT];
+  draw_bulk(LCD_WIDTH - 60, OFFSETY + CELLHEIGHT + 5, 50, 12, menu);
+  draw_grid(3);
+  CHECK(decode_stream(&count));
+  CHECK(screens_equal());
+  CHECK(count.fill == 1);
+  CHECK(count.pack + count.bulk > 2);
+}
+
+static void test_palette_change(void) {
+  /*
+   * Changing a UI color must resend the palette before the next packed cell,
+   * otherwise the client decodes the new cells with old colors.
+   */
+  message_count_t count;
+  reset();
+  draw_grid(4);
+  config._lcd_palette[PAL_TRACE] = 0xBEEF;
+  draw_grid(5);
+  CHECK(decode_stream(&count));
+  CHECK(screens_equal());
+  CHECK(count.palette == 2);
+}
+
+static void test_literals_long_runs_and_raw_fallback(void) {
+  /*
+   * Colors outside the palette are sent as literals, runs longer than one
+   * token are split, and content that does not compress goes out raw.
+   */
+  message_count_t count;
+  static pixel_t region[100 * 20];
+  reset();
+  for (int i = 0; i < 100 * 20; i++)
+    region[i] = i < 1500 ? 0x1234 : config._lcd_palette[PAL_FG];
+  draw_bulk(5, 100, 100, 20, region);
+  CHECK(decode_stream(&count));
+  CHECK(screens_equal());
+  CHECK(count.pack == 1);
+  CHECK(stream_len < 100 * 20 * sizeof(pixel_t) / 20);
+  stream_len = 0;
+  srand(7);
+  for (int i = 0; i < 100 * 20; i++)
+    region[i] = (pixel_t)rand();
+  draw_bulk(5, 130, 100, 20, region);
+  CHECK(decode_stream(&count));
+  CHECK(screens_equal());
+  CHECK(count.bulk == 1 && count.pack == 0);
+}
+
+int main(void) {
+  reset();
+  test_header_layout();
+  test_full_frame_rebuild();
+  test_unchanged_cells_skipped();
+  test_overdraw_invalidates_cells();
+  test_palette_change();
+  test_literals_long_runs_and_raw_fallback();
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_remote_stream");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
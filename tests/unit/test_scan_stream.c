@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host-side coverage for src/sys/scan_stream.c.
+ *
+ * The streaming scan mode pushes one framed record per sweep point while the
+ * sweep is still running, so host tools rely on the record layout, the
+ * sequence counter and the CRC to resynchronize and detect dropped records.
+ * These tests pin the CRC variant (CRC-16/CCITT-FALSE), the byte layout for
+ * every output mask, and decode a record stream the way a host would so that
+ * corrupted and missing records are caught.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sys/scan_stream.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+#define OUT_ALL (SCAN_MASK_OUT_FREQ | SCAN_MASK_OUT_DATA0 | SCAN_MASK_OUT_DATA1)
+
+static uint16_t get_u16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/*
+ * Minimal host decoder: scan for the sync byte, validate the CRC, and count
+ * sequence gaps. Returns the number of valid records.
+ */
+typedef struct {
+  int records;
+  int crc_errors;
+  int seq_gaps;
+  uint16_t last_index;
+} decode_result_t;
+
+static decode_result_t decode_stream(const uint8_t* data, size_t size, uint16_t mask) {
+  decode_result_t r = {0, 0, 0, 0};
+  size_t record = scan_stream_record_size(mask);
+  bool have_seq = false;
+  uint8_t expect_seq = 0;
+  size_t pos = 0;
+  while (pos + record <= size) {
+    if (data[pos] != SCAN_STREAM_SYNC) {
+      pos++;
+      continue;
+    }
+    uint16_t crc = scan_stream_crc16(SCAN_STREAM_CRC_INIT, &data[pos], record - 2);
+    if (crc != get_u16(&data[pos + record - 2])) {
+      r.crc_errors++;
+      pos++;
+      continue;
+    }
+    uint8_t seq = data[pos + 1];
+    if (have_seq && seq != expect_seq)
+      r.seq_gaps++;
+    have_seq = true;
+    expect_seq = (uint8_t)(seq + 1U);
+    r.last_index = get_u16(&data[pos + 2]);
+    r.records++;
+    pos += record;
+  }
+  return r;
+}
+
+static void test_crc_reference_value(void) {
+  // Standard check value of CRC-16/CCITT-FALSE for "123456789"
+  const char* check = "123456789";
+  CHECK(scan_stream_crc16(SCAN_STREAM_CRC_INIT, (const uint8_t*)check, 9) == 0x29B1);
+  // Incremental update gives the same result
+  uint16_t crc = scan_stream_crc16(SCAN_STREAM_CRC_INIT, (const uint8_t*)check, 4);
+  CHECK(scan_stream_crc16(crc, (const uint8_t*)check + 4, 5) == 0x29B1);
+}
+
+static void test_record_layout(void) {
+  uint8_t buf[SCAN_STREAM_RECORD_MAX];
+  const float s11[2] = {0.25f, -0.5f};
+  const float s21[2] = {1.5f, 2.0f};
+
+  CHECK(scan_stream_record_size(0) == 6);
+  CHECK(scan_stream_record_size(SCAN_MASK_OUT_FREQ) == 10);
+  CHECK(scan_stream_record_size(OUT_ALL) == SCAN_STREAM_RECORD_MAX);
+  // Non output bits do not change the layout
+  CHECK(scan_stream_record_size(OUT_ALL | SCAN_MASK_BINARY | SCAN_MASK_STREAM) ==
+        SCAN_STREAM_RECORD_MAX);
+
+  size_t n = scan_stream_encode(buf, OUT_ALL, 0x7E, 0x0123, 50000000U, s11, s21);
+  CHECK(n == SCAN_STREAM_RECORD_MAX);
+  CHECK(buf[0] == SCAN_STREAM_SYNC);
+  CHECK(buf[1] == 0x7E);
+  CHECK(get_u16(&buf[2]) == 0x0123);
+  freq_t f;
+  memcpy(&f, &buf[4], sizeof(f));
+  CHECK(f == 50000000U);
+  float v[4];
+  memcpy(v, &buf[8], sizeof(v));
+  CHECK(v[0] == s11[0] && v[1] == s11[1] && v[2] == s21[0] && v[3] == s21[1]);
+  CHECK(get_u16(&buf[n - 2]) == scan_stream_crc16(SCAN_STREAM_CRC_INIT, buf, n - 2));
+
+  // Only S21 selected: data follows the header directly, S11 is never read
+  n = scan_stream_encode(buf, SCAN_MASK_OUT_DATA1, 1, 7, 0, NULL, s21);
+  CHECK(n == scan_stream_record_size(SCAN_MASK_OUT_DATA1));
+  memcpy(v, &buf[4], 2 * sizeof(float));
+  CHECK(v[0] == s21[0] && v[1] == s21[1]);
+}
+
+static void test_decoder_detects_corruption_and_drops(void) {
+  uint8_t stream[16 * SCAN_STREAM_RECORD_MAX];
+  const uint16_t mask = OUT_ALL;
+  size_t size = 0;
+  uint8_t seq = 250; // wraps inside the stream
+  for (uint16_t i = 0; i < 16; i++) {
+    float s11[2] = {(float)i, -(float)i};
+    float s21[2] = {0.5f * i, 0.25f * i};
+    size_t n = scan_stream_encode(&stream[size], mask, seq++, i, 1000000U + i, s11, s21);
+    size += n;
+  }
+  decode_result_t r = decode_stream(stream, size, mask);
+  CHECK(r.records == 16);
+  CHECK(r.crc_errors == 0);
+  CHECK(r.seq_gaps == 0);
+  CHECK(r.last_index == 15);
+
+  // Flip one payload bit in record 3: it must be rejected by the CRC
+  size_t record = scan_stream_record_size(mask);
+  stream[3 * record + 9] ^= 0x10;
+  r = decode_stream(stream, size, mask);
+  CHECK(r.records == 15);
+  CHECK(r.crc_errors >= 1);
+  CHECK(r.seq_gaps == 1);
+
+  // Drop record 8 entirely: the sequence counter reports the gap
+  memmove(&stream[8 * record], &stream[9 * record], size - 9 * record);
+  size -= record;
+  r = decode_stream(stream, size, mask);
+  CHECK(r.records == 14);
+  CHECK(r.seq_gaps == 2);
+}
+
+int main(void) {
+  test_crc_reference_value();
+  test_record_layout();
+  test_decoder_detects_corruption_and_drops();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_scan_stream");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,258 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host-side coverage for src/sys/settings_journal.c.
+ *
+ * The settings autosave appends small records to a ring of flash pages instead
+ * of reprogramming a whole calibration slot. The pages are emulated in RAM with
+ * flash rules (erase to 0xFF, programming only on erased bytes), and a torn
+ * write can be injected to model a power loss. A failure here means settings
+ * can come back wrong after a reboot, or the journal wears or corrupts flash.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sys/settings_journal.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+#define PAGE_SIZE 256
+#define PAGES 3
+#define PAYLOAD_SIZE 52
+
+static _Alignas(4) uint8_t flash_mem[PAGES * PAGE_SIZE];
+static int erase_count[PAGES];
+static bool program_on_dirty = false;
+static long program_budget = -1; // bytes left before the simulated power loss, -1 unlimited
+
+static void mock_erase(uintptr_t address) {
+  size_t offset = address - (uintptr_t)flash_mem;
+  CHECK(offset % PAGE_SIZE == 0);
+  memset(&flash_mem[offset], 0xFF, PAGE_SIZE);
+  erase_count[offset / PAGE_SIZE]++;
+}
+
+static void mock_program(uintptr_t address, const void* data, uint32_t size) {
+  uint8_t* dst = (uint8_t*)address;
+  const uint8_t* src = (const uint8_t*)data;
+  CHECK(size % 2 == 0);
+  CHECK((address - (uintptr_t)flash_mem) / PAGE_SIZE ==
+        (address + size - 1 - (uintptr_t)flash_mem) / PAGE_SIZE);
+  for (uint32_t i = 0; i < size; i++) {
+    if (program_budget == 0)
+      return;
+    if (program_budget > 0)
+      program_budget--;
+    if (dst[i] != 0xFF)
+      program_on_dirty = true;
+    dst[i] = src[i];
+  }
+}
+
+static const settings_journal_flash_t mock_flash = {
+    0, PAGE_SIZE, PAGES, mock_erase, mock_program};
+
+static settings_journal_flash_t flash;
+
+static void reset_flash(uint8_t fill) {
+  memset(flash_mem, fill, sizeof(flash_mem));
+  memset(erase_count, 0, sizeof(erase_count));
+  program_on_dirty = false;
+  program_budget = -1;
+  flash = mock_flash;
+  flash.address = (uintptr_t)flash_mem;
+}
+
+static void make_payload(uint8_t* payload, uint8_t seed) {
+  for (int i = 0; i < PAYLOAD_SIZE; i++)
+    payload[i] = (uint8_t)(seed * 31 + i);
+}
+
+static bool payload_is(const void* found, uint8_t seed) {
+  uint8_t expected[PAYLOAD_SIZE];
+  make_payload(expected, seed);
+  return found != NULL && memcmp(found, expected, PAYLOAD_SIZE) == 0;
+}
+
+static bool append(settings_journal_t* journal, uint8_t slot, uint32_t base, uint8_t seed) {
+  uint8_t payload[PAYLOAD_SIZE];
+  make_payload(payload, seed);
+  return settings_journal_append(journal, slot, base, payload, PAYLOAD_SIZE);
+}
+
+static void test_empty_journal(void) {
+  settings_journal_t journal;
+  reset_flash(0xFF);
+  settings_journal_init(&journal, &flash);
+  CHECK(journal.write == (uintptr_t)flash_mem);
+  CHECK(settings_journal_find(&journal, 0, 0x1234, PAYLOAD_SIZE) == NULL);
+}
+
+static void test_newest_record_per_slot_and_base(void) {
+  settings_journal_t journal;
+  reset_flash(0xFF);
+  settings_journal_init(&journal, &flash);
+  CHECK(append(&journal, 0, 0xAAAA, 1));
+  CHECK(append(&journal, 1, 0xBBBB, 2));
+  CHECK(append(&journal, 0, 0xAAAA, 3));
+  CHECK(payload_is(settings_journal_find(&journal, 0, 0xAAAA, PAYLOAD_SIZE), 3));
+  CHECK(payload_is(settings_journal_find(&journal, 1, 0xBBBB, PAYLOAD_SIZE), 2));
+  // A slot rewritten in full has a new checksum, its old records must not apply
+  CHECK(settings_journal_find(&journal, 0, 0xCCCC, PAYLOAD_SIZE) == NULL);
+  // Payload size is part of the key (layout change after a firmware update)
+  CHECK(settings_journal_find(&journal, 0, 0xAAAA, PAYLOAD_SIZE - 4) == NULL);
+  // Reboot: a fresh scan finds the same records and continues after them
+  uintptr_t write = journal.write;
+  settings_journal_init(&journal, &flash);
+  CHECK(journal.write == write);
+  CHECK(journal.seq == 3);
+  CHECK(payload_is(settings_journal_find(&journal, 0, 0xAAAA, PAYLOAD_SIZE), 3));
+  CHECK(!program_on_dirty);
+}
+
+static void test_ring_wraps_and_levels_wear(void) {
+  settings_journal_t journal;
+  reset_flash(0xFF);
+  settings_journal_init(&journal, &flash);
+  // 68 byte records, 3 per page: 40 appends go around the 3 pages several times
+  for (int i = 0; i < 40; i++) {
+    CHECK(append(&journal, 2, 0x5555, (uint8_t)i));
+    if (i % 7 == 0)
+      settings_journal_init(&journal, &flash); // reboots in between keep the ring order
+    CHECK(payload_is(settings_journal_find(&journal, 2, 0x5555, PAYLOAD_SIZE), (uint8_t)i));
+  }
+  CHECK(!program_on_dirty);
+  for (int page = 0; page < PAGES; page++)
+    CHECK(erase_count[page] >= 3 && erase_count[page] <= 5);
+}
+
+static void test_other_slot_survives_wrap(void) {
+  settings_journal_t journal;
+  reset_flash(0xFF);
+  settings_journal_init(&journal, &flash);
+  CHECK(append(&journal, 1, 0xBBBB, 100));
+  // Only slot 0 is autosaved: the ring wraps over the page holding slot 1 many times
+  for (int i = 0; i < 40; i++) {
+    CHECK(append(&journal, 0, 0xAAAA, (uint8_t)i));
+    if (i % 5 == 0)
+      settings_journal_init(&journal, &flash);
+    CHECK(payload_is(settings_journal_find(&journal, 0, 0xAAAA, PAYLOAD_SIZE), (uint8_t)i));
+    CHECK(payload_is(settings_journal_find(&journal, 1, 0xBBBB, PAYLOAD_SIZE), 100));
+  }
+  settings_journal_init(&journal, &flash);
+  CHECK(payload_is(settings_journal_find(&journal, 1, 0xBBBB, PAYLOAD_SIZE), 100));
+  CHECK(!program_on_dirty);
+}
+
+static void test_live_records_not_fitting(void) {
+  settings_journal_t journal;
+  reset_flash(0xFF);
+  settings_journal_init(&journal, &flash);
+  // 3 records per page: slots 0-2 fill page 0, 3-5 page 1, 6 starts page 2
+  for (uint8_t slot = 0; slot < 7; slot++)
+    CHECK(append(&journal, slot, 0x1000U + slot, slot));
+  // Page 0 is next: its 3 live records and slot 7 do not fit the rest of page 2
+  CHECK(!append(&journal, 7, 0x1007, 7));
+  for (uint8_t slot = 0; slot < 7; slot++)
+    CHECK(payload_is(settings_journal_find(&journal, slot, 0x1000U + slot, PAYLOAD_SIZE), slot));
+  CHECK(settings_journal_find(&journal, 7, 0x1007, PAYLOAD_SIZE) == NULL);
+  // Slot 0 supersedes its own record, slots 1 and 2 are copied forward
+  CHECK(append(&journal, 0, 0x1000, 50));
+  CHECK(payload_is(settings_journal_find(&journal, 0, 0x1000, PAYLOAD_SIZE), 50));
+  for (uint8_t slot = 1; slot < 7; slot++)
+    CHECK(payload_is(settings_journal_find(&journal, slot, 0x1000U + slot, PAYLOAD_SIZE), slot));
+  CHECK(!program_on_dirty);
+}
+
+static void test_torn_write_is_ignored(void) {
+  settings_journal_t journal;
+  reset_flash(0xFF);
+  settings_journal_init(&journal, &flash);
+  CHECK(append(&journal, 0, 0x1111, 7));
+  // Power lost in the middle of the payload of the next record
+  program_budget = sizeof(settings_journal_record_t) + PAYLOAD_SIZE / 2;
+  append(&journal, 0, 0x1111, 8);
+  program_budget = -1;
+  settings_journal_init(&journal, &flash);
+  CHECK(payload_is(settings_journal_find(&journal, 0, 0x1111, PAYLOAD_SIZE), 7));
+  // The torn record is skipped by size, the next append does not touch programmed bytes
+  CHECK(append(&journal, 0, 0x1111, 9));
+  CHECK(payload_is(settings_journal_find(&journal, 0, 0x1111, PAYLOAD_SIZE), 9));
+  CHECK(!program_on_dirty);
+}
+
+static void test_unknown_flash_content(void) {
+  settings_journal_t journal;
+  // Pages never erased (old firmware data): nothing is found, appends erase first
+  reset_flash(0x5A);
+  settings_journal_init(&journal, &flash);
+  CHECK(settings_journal_find(&journal, 0, 0, PAYLOAD_SIZE) == NULL);
+  CHECK(append(&journal, 0, 0x2222, 4));
+  CHECK(payload_is(settings_journal_find(&journal, 0, 0x2222, PAYLOAD_SIZE), 4));
+  CHECK(!program_on_dirty);
+  settings_journal_erase(&journal);
+  CHECK(settings_journal_find(&journal, 0, 0x2222, PAYLOAD_SIZE) == NULL);
+  CHECK(journal.write == (uintptr_t)flash_mem);
+}
+
+static void test_odd_payload_and_oversize(void) {
+  settings_journal_t journal;
+  uint8_t big[PAGE_SIZE];
+  const uint8_t odd[3] = {1, 2, 3};
+  reset_flash(0xFF);
+  settings_journal_init(&journal, &flash);
+  CHECK(settings_journal_append(&journal, 0, 1, odd, sizeof(odd)));
+  const uint8_t* found = settings_journal_find(&journal, 0, 1, sizeof(odd));
+  CHECK(found != NULL && memcmp(found, odd, sizeof(odd)) == 0);
+  memset(big, 0, sizeof(big));
+  CHECK(!settings_journal_append(&journal, 0, 1, big, sizeof(big)));
+  CHECK(!program_on_dirty);
+}
+
+int main(void) {
+  test_empty_journal();
+  test_newest_record_per_slot_and_base();
+  test_ring_wraps_and_levels_wear();
+  test_other_slot_survives_wrap();
+  test_live_records_not_fitting();
+  test_torn_write_is_ignored();
+  test_unknown_flash_content();
+  test_odd_payload_and_oversize();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_settings_journal");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
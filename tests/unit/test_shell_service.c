@@ -26,7 +26,9 @@
  * scheduling, and event-bus integration can be verified deterministically.
  * Each test feeds a scripted RX buffer and inspects the TX buffer to ensure
  * the shell echoes characters, detects overflow conditions, and drains the
- * pending command queue whenever EVENT_USB_COMMAND_PENDING fires.
+ * pending command queue whenever EVENT_USB_COMMAND_PENDING fires. The
+ * deferred command ring is checked for argument copies, ordering, sweep
+ * pause/resume decisions and the echo/prompt order of queued lines.
  */
 
 #include <stdbool.h>
@@ -90,6 +92,13 @@ static bool tx_contains(const char* needle) {
   return false;
 }
 
+static const char* tx_string(void) {
+  size_t len = g_stream_state.tx_len < sizeof(g_stream_state.tx) ? g_stream_state.tx_len
+                                                                  : sizeof(g_stream_state.tx) - 1;
+  g_stream_state.tx[len] = 0;
+  return (const char*)g_stream_state.tx;
+}
+
 static shell_stream_state_t* stream_from_channel(BaseAsynchronousChannel* chp) {
   SerialUSBDriver* drv = (SerialUSBDriver*)chp;
   return (drv != NULL) ? (shell_stream_state_t*)drv->user_data : NULL;
@@ -167,8 +176,18 @@ void chThdSleepMilliseconds(uint32_t ms) {
   (void)ms;
 }
 
-void pause_sweep(void) {}
-void resume_sweep(void) {}
+uint8_t sweep_mode = 0;
+static int g_pause_calls = 0;
+static int g_resume_calls = 0;
+
+void pause_sweep(void) {
+  ++g_pause_calls;
+  sweep_mode &= (uint8_t)~SWEEP_ENABLE;
+}
+void resume_sweep(void) {
+  ++g_resume_calls;
+  sweep_mode |= SWEEP_ENABLE;
+}
 
 
 void osalSysLock(void) {}
@@ -176,10 +195,18 @@ void osalSysUnlock(void) {}
 void osalThreadQueueObjectInit(threads_queue_t* queue) {
   (void)queue;
 }
-void osalThreadEnqueueTimeoutS(threads_queue_t* queue, systime_t timeout) {
+/* A blocked shell thread waits for the sweep thread, emulate it draining the ring */
+static bool g_wait_drains = false;
+
+msg_t osalThreadEnqueueTimeoutS(threads_queue_t* queue, systime_t timeout) {
   (void)queue;
   (void)timeout;
   ++g_queue_enqueues;
+  if (!g_wait_drains) {
+    return MSG_TIMEOUT;
+  }
+  shell_service_pending_commands();
+  return MSG_OK;
 }
 msg_t osalThreadDequeueNextI(threads_queue_t* queue, msg_t msg) {
   (void)queue;
@@ -265,6 +292,10 @@ static void reset_shell_state(const char* scripted_rx) {
   config._serial_speed = 115200;
   g_queue_enqueues = 0;
   g_queue_dequeues = 0;
+  g_wait_drains = false;
+  g_pause_calls = 0;
+  g_resume_calls = 0;
+  sweep_mode = 0;
   g_published_event_count = 0;
   g_registered_listener = NULL;
   shell_restore_stream();
@@ -276,6 +307,7 @@ static void reset_shell_state(const char* scripted_rx) {
 static int g_command_invocations = 0;
 static int g_last_command_argc = 0;
 static char g_last_command_arg0[32];
+static char g_command_log[128];
 
 static void test_command_callback(int argc, char* argv[]) {
   ++g_command_invocations;
@@ -283,10 +315,26 @@ static void test_command_callback(int argc, char* argv[]) {
   if (argc > 0 && argv != NULL && argv[0] != NULL) {
     strncpy(g_last_command_arg0, argv[0], sizeof(g_last_command_arg0) - 1);
   }
+  // Output of the command, must come after its echo and before its prompt
+  for (int i = 0; i < argc; i++) {
+    strncat(g_command_log, argv[i], sizeof(g_command_log) - strlen(g_command_log) - 2);
+    strcat(g_command_log, ";");
+  }
+  shell_printf("out%d" VNA_SHELL_NEWLINE_STR, argc);
+}
+
+static void test_pause_command(int argc, char* argv[]) {
+  (void)argc;
+  (void)argv;
+  strcat(g_command_log, "pause;");
 }
 
 static const vna_shell_command g_test_commands[] = {
     {.sc_name = "scan", .sc_function = test_command_callback, .flags = 0},
+    {.sc_name = "edelay", .sc_function = test_command_callback,
+     .flags = CMD_WAIT_MUTEX | CMD_BREAK_SWEEP},
+    {.sc_name = "pause", .sc_function = test_pause_command,
+     .flags = CMD_WAIT_MUTEX | CMD_BREAK_SWEEP | CMD_NO_AUTO_RESUME},
     {.sc_name = NULL, .sc_function = NULL, .flags = 0},
 };
 
@@ -343,7 +391,8 @@ static void test_shell_deferred_queue_and_event_bus(void) {
   CHECK(cmd != NULL, "command must parse");
 
   shell_request_deferred_execution(cmd, argc, argv);
-  CHECK(g_queue_enqueues == 1, "request should enqueue a worker wakeup");
+  CHECK(g_queue_enqueues == 0, "request must not block the shell thread");
+  CHECK(shell_deferred_pending(), "request must queue the command");
   CHECK(g_published_event_count == 1, "pending event must be published");
   CHECK(g_published_events[0] == EVENT_USB_COMMAND_PENDING,
         "pending event topic must match specification");
@@ -356,6 +405,114 @@ static void test_shell_deferred_queue_and_event_bus(void) {
 
   shell_service_pending_commands();
   CHECK(g_command_invocations == 1, "no second execution when queue already drained");
+  CHECK(!shell_deferred_pending(), "queue must be empty after draining");
+}
+
+static void test_shell_deferred_ring_copies_and_batches(void) {
+  reset_shell_state(NULL);
+  shell_register_commands(g_test_commands);
+  g_command_log[0] = 0;
+  g_command_invocations = 0;
+  uint16_t argc = 0;
+  char** argv = NULL;
+
+  // Nothing is running: queue refuses, the shell thread must break the sweep itself
+  char line0[] = "edelay 1";
+  const vna_shell_command* cmd = shell_parse_command(line0, &argc, &argv, NULL);
+  CHECK(!shell_queue_deferred_execution(cmd, argc, argv), "idle queue must not batch");
+  sweep_mode = 0; // paused by the shell thread
+  shell_set_auto_resume(true);
+  shell_request_deferred_execution(cmd, argc, argv);
+
+  // Further lines batch behind it, the line buffer is reused for every command
+  char line[32];
+  strcpy(line, "edelay 2 x");
+  cmd = shell_parse_command(line, &argc, &argv, NULL);
+  CHECK(shell_queue_deferred_execution(cmd, argc, argv), "busy queue must batch");
+  // Ring full (2 slots on host builds): the shell thread waits for a free slot. The
+  // emulated sweep thread drains everything, so the command takes the idle path again
+  g_wait_drains = true;
+  strcpy(line, "pause");
+  cmd = shell_parse_command(line, &argc, &argv, NULL);
+  CHECK(!shell_queue_deferred_execution(cmd, argc, argv), "drained queue must not batch");
+  CHECK(g_queue_enqueues >= 1, "full queue must block the shell thread");
+  CHECK(g_command_log[0] != 0 && !shell_deferred_pending(), "waiting must drain the queue");
+  shell_set_auto_resume((sweep_mode & SWEEP_ENABLE) != 0);
+  pause_sweep();
+  g_wait_drains = false;
+  shell_request_deferred_execution(cmd, argc, argv);
+  strcpy(line, "edelay 3");
+  cmd = shell_parse_command(line, &argc, &argv, NULL);
+  CHECK(shell_queue_deferred_execution(cmd, argc, argv), "busy queue must batch");
+  shell_service_pending_commands();
+
+  CHECK(strcmp(g_command_log, "1;2;x;pause;3;") == 0, "commands must run in order with their arguments");
+  // edelay 1 and 2 resume the sweep, pause stops it and edelay 3 must not restart it
+  CHECK((sweep_mode & SWEEP_ENABLE) == 0, "batched commands must keep the sequential sweep state");
+  CHECK(g_resume_calls == 2, "only the commands after a running sweep resume it");
+  CHECK(!shell_deferred_pending(), "queue must be empty after draining");
+}
+
+static void test_shell_deferred_echo_and_prompt_order(void) {
+  // Second line arrives while the first command is still queued
+  reset_shell_state("edelay 5\rscan 6\r");
+  shell_register_commands(g_test_commands);
+  g_command_log[0] = 0;
+  char line[32];
+  uint16_t argc = 0;
+  char** argv = NULL;
+
+  CHECK(vna_shell_read_line(line, sizeof(line)) == 1, "first line must be read");
+  const vna_shell_command* cmd = shell_parse_command(line, &argc, &argv, NULL);
+  shell_request_deferred_execution(cmd, argc, argv);
+  shell_print_prompt();
+  CHECK(!tx_contains(VNA_SHELL_PROMPT_STR), "deferred command prompt follows its output");
+  CHECK(vna_shell_read_line(line, sizeof(line)) == 1, "second line must be read");
+  CHECK(!tx_contains("scan"), "line read behind a queued command must not echo yet");
+  // scan is not deferred, it runs directly after the queue (emulated sweep thread) is done
+  cmd = shell_parse_command(line, &argc, &argv, NULL);
+  CHECK(cmd == &g_test_commands[0], "second line must parse");
+  g_wait_drains = true;
+  shell_wait_deferred_commands();
+  const char* tx = tx_string();
+  const char* out = strstr(tx, "out1");
+  const char* prompt = strstr(tx, VNA_SHELL_PROMPT_STR);
+  const char* echo = strstr(tx, "scan 6" VNA_SHELL_NEWLINE_STR);
+  CHECK(strstr(tx, "edelay 5") == tx, "first line must echo immediately");
+  CHECK(out != NULL && prompt != NULL && echo != NULL, "output, prompt and echo must be sent");
+  CHECK(out < prompt && prompt < echo, "queued output and prompt must precede the next echo");
+  CHECK(strstr(prompt + 1, VNA_SHELL_PROMPT_STR) == NULL,
+        "deferred command prompt must not be printed twice");
+}
+
+static void test_shell_deferred_full_queue_reports_drop(void) {
+  reset_shell_state(NULL);
+  shell_register_commands(g_test_commands);
+  g_command_log[0] = 0;
+  uint16_t argc = 0;
+  char** argv = NULL;
+  char line[32];
+
+  // Fill the ring (2 slots on host builds), the emulated sweep thread never drains it
+  strcpy(line, "edelay 1");
+  const vna_shell_command* cmd = shell_parse_command(line, &argc, &argv, NULL);
+  CHECK(shell_request_deferred_execution(cmd, argc, argv), "free ring must accept a command");
+  strcpy(line, "edelay 2");
+  cmd = shell_parse_command(line, &argc, &argv, NULL);
+  CHECK(shell_queue_deferred_execution(cmd, argc, argv), "busy queue must batch");
+
+  // Timed out waiting for a slot: the host must see an error line
+  strcpy(line, "edelay 3");
+  cmd = shell_parse_command(line, &argc, &argv, NULL);
+  CHECK(!shell_request_deferred_execution(cmd, argc, argv), "dropped request must return false");
+  CHECK(tx_contains("error: command queue full, edelay dropped"), "drop must be reported");
+  g_stream_state.tx_len = 0;
+  CHECK(shell_queue_deferred_execution(cmd, argc, argv),
+        "dropped batch command must not fall back to running it");
+  CHECK(tx_contains("error: command queue full, edelay dropped"), "batched drop must be reported");
+
+  shell_service_pending_commands();
+  CHECK(strcmp(g_command_log, "1;2;") == 0, "only the queued commands must run");
 }
 
 static void test_shell_read_line_and_echo(void) {
@@ -371,6 +528,9 @@ static void test_shell_read_line_and_echo(void) {
 int main(void) {
   test_shell_parse_and_overflow();
   test_shell_deferred_queue_and_event_bus();
+  test_shell_deferred_ring_copies_and_batches();
+  test_shell_deferred_echo_and_prompt_order();
+  test_shell_deferred_full_queue_reports_drop();
   test_shell_read_line_and_echo();
 
   if (g_failures == 0) {
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host-side coverage for src/rf/sweep_profile.c.
+ *
+ * The sweep profiler keeps min/avg/max cycles of every FSM state per si5351
+ * band. These tests pin the statistics and band merging, and the interval
+ * measurement across a wrap of a 32-bit (DWT) and a 24-bit (SysTick) cycle
+ * counter, including the fallback to system ticks once the narrow counter may
+ * have wrapped more than once.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rf/sweep_profile.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+#define TICK_HZ 100000U
+
+static sweep_profile_t profile;
+
+static void test_stats_per_band(void) {
+  sweep_profile_stat_t s;
+  sweep_profile_init(&profile, 72000000U, 0xFFFFFFFFU, TICK_HZ);
+  sweep_profile_get(&profile, SWEEP_PROFILE_PROCESS, SWEEP_PROFILE_ALL_BANDS, &s);
+  CHECK(s.count == 0U && s.min == 0U && s.max == 0U && s.total == 0U);
+
+  sweep_profile_add(&profile, SWEEP_PROFILE_PROCESS, 1, 300);
+  sweep_profile_add(&profile, SWEEP_PROFILE_PROCESS, 1, 100);
+  sweep_profile_add(&profile, SWEEP_PROFILE_PROCESS, 2, 500);
+  sweep_profile_add(&profile, SWEEP_PROFILE_SETUP_FREQ, 2, 7000);
+
+  sweep_profile_get(&profile, SWEEP_PROFILE_PROCESS, 1, &s);
+  CHECK(s.count == 2U && s.min == 100U && s.max == 300U && s.total == 400U);
+  sweep_profile_get(&profile, SWEEP_PROFILE_PROCESS, 2, &s);
+  CHECK(s.count == 1U && s.min == 500U && s.max == 500U);
+  sweep_profile_get(&profile, SWEEP_PROFILE_PROCESS, SWEEP_PROFILE_ALL_BANDS, &s);
+  CHECK(s.count == 3U && s.min == 100U && s.max == 500U && s.total == 900U);
+  sweep_profile_get(&profile, SWEEP_PROFILE_SETUP_FREQ, SWEEP_PROFILE_ALL_BANDS, &s);
+  CHECK(s.count == 1U && s.min == 7000U);
+  sweep_profile_get(&profile, SWEEP_PROFILE_WAIT_CAPTURE, SWEEP_PROFILE_ALL_BANDS, &s);
+  CHECK(s.count == 0U);
+
+  sweep_profile_reset(&profile);
+  sweep_profile_get(&profile, SWEEP_PROFILE_PROCESS, SWEEP_PROFILE_ALL_BANDS, &s);
+  CHECK(s.count == 0U && s.total == 0U);
+}
+
+static void test_out_of_range(void) {
+  sweep_profile_stat_t s;
+  sweep_profile_init(&profile, 72000000U, 0xFFFFFFFFU, TICK_HZ);
+  // IDLE (wraps to 255) and FAULT fall past the profiled states
+  sweep_profile_add(&profile, 0xFF, 0, 10);
+  sweep_profile_add(&profile, SWEEP_PROFILE_STATES, 0, 10);
+  for (uint8_t state = 0; state < SWEEP_PROFILE_STATES; state++) {
+    sweep_profile_get(&profile, state, SWEEP_PROFILE_ALL_BANDS, &s);
+    CHECK(s.count == 0U);
+  }
+  // High bands are accounted in the last one
+  sweep_profile_add(&profile, SWEEP_PROFILE_WAIT_CAPTURE, 200, 10);
+  sweep_profile_get(&profile, SWEEP_PROFILE_WAIT_CAPTURE, SWEEP_PROFILE_BANDS - 1, &s);
+  CHECK(s.count == 1U);
+  sweep_profile_get(&profile, SWEEP_PROFILE_WAIT_CAPTURE, 200, &s);
+  CHECK(s.count == 0U);
+}
+
+static void test_elapsed_32bit_counter(void) {
+  sweep_profile_init(&profile, 72000000U, 0xFFFFFFFFU, TICK_HZ);
+  sweep_profile_stamp_t start = {.ticks = 1000, .cycles = 0xFFFFFF00U};
+  sweep_profile_stamp_t end = {.ticks = 1001, .cycles = 0x00000100U};
+  CHECK(sweep_profile_elapsed(&profile, &start, &end) == 0x200U);
+  // A minute does not fit the counter: measured in ticks, saturated
+  end.ticks = start.ticks + 60U * TICK_HZ;
+  CHECK(sweep_profile_elapsed(&profile, &start, &end) == UINT32_MAX);
+  CHECK(sweep_profile_cycles_to_us(&profile, 72000000U) == 1000000U);
+  CHECK(sweep_profile_cycles_to_us(&profile, 71U) == 0U);
+}
+
+static void test_elapsed_24bit_counter(void) {
+  // SysTick at 48 MHz wraps every 349.5 ms (34952 ticks)
+  sweep_profile_init(&profile, 48000000U, 0x00FFFFFFU, TICK_HZ);
+  CHECK(profile.wrap_ticks == 34952U);
+  sweep_profile_stamp_t start = {.ticks = 0xFFFFFFF0U, .cycles = 0x00FFFF00U};
+  sweep_profile_stamp_t end = {.ticks = 0x00000010U, .cycles = 0x00000100U};
+  CHECK(sweep_profile_elapsed(&profile, &start, &end) == 0x200U);
+  // 300 ms still fits the counter
+  end.ticks = start.ticks + 30000U;
+  end.cycles = (start.cycles + 300U * 48000U) & 0x00FFFFFFU;
+  CHECK(sweep_profile_elapsed(&profile, &start, &end) == 300U * 48000U);
+  // 1 s: the counter wrapped, cycles come from the ticks
+  end.ticks = start.ticks + TICK_HZ;
+  end.cycles = (start.cycles + 48000000U) & 0x00FFFFFFU;
+  CHECK(sweep_profile_elapsed(&profile, &start, &end) == 48000000U);
+  CHECK(sweep_profile_cycles_to_us(&profile, 48000000U) == 1000000U);
+}
+
+int main(void) {
+  test_stats_per_band();
+  test_out_of_range();
+  test_elapsed_32bit_counter();
+  test_elapsed_24bit_counter();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_sweep_profile");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host-side coverage for src/rf/sweep_segments.c.
+ *
+ * A segmented sweep concatenates several linear ranges with their own point
+ * count, IF bandwidth and power. These tests pin the table bookkeeping
+ * (rejection rules, first point of each segment), the point to segment
+ * lookup, and that every segment spreads its points exactly like a linear
+ * sweep of the same range.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rf/sweep_segments.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+static sweep_segment_t make_segment(freq_t start, freq_t stop, uint16_t points) {
+  sweep_segment_t seg = {start, stop, points, SWEEP_SEGMENT_BW_GLOBAL,
+                         SWEEP_SEGMENT_POWER_GLOBAL};
+  return seg;
+}
+
+// Linear sweep reference: start + round(i * span / (points - 1))
+static freq_t linear_reference(freq_t start, freq_t stop, uint16_t points, uint16_t i) {
+  if (points < 2U)
+    return start;
+  uint64_t steps = points - 1U;
+  return start + (freq_t)(((uint64_t)(stop - start) * i + steps / 2U) / steps);
+}
+
+static void test_add_rules(void) {
+  sweep_segment_table_t table;
+  sweep_segments_clear(&table);
+  sweep_segment_t seg = make_segment(1000000U, 2000000U, 0);
+  CHECK(!sweep_segments_add(&table, &seg, 101));  // zero points
+  seg = make_segment(2000000U, 1000000U, 11);
+  CHECK(!sweep_segments_add(&table, &seg, 101));  // reversed range
+  seg = make_segment(1000000U, 2000000U, 102);
+  CHECK(!sweep_segments_add(&table, &seg, 101));  // over the point limit
+  CHECK(table.count == 0 && table.points == 0);
+
+  seg = make_segment(1000000U, 2000000U, 60);
+  CHECK(sweep_segments_add(&table, &seg, 101));
+  seg = make_segment(3000000U, 4000000U, 42);
+  CHECK(!sweep_segments_add(&table, &seg, 101));  // 102 in total
+  seg.points = 41;
+  CHECK(sweep_segments_add(&table, &seg, 101));
+  CHECK(table.count == 2 && table.points == 101);
+  CHECK(table.first[0] == 0 && table.first[1] == 60);
+
+  sweep_segments_clear(&table);
+  seg = make_segment(1000000U, 1000000U, 1);
+  for (int i = 0; i < SWEEP_SEGMENTS_MAX; i++)
+    CHECK(sweep_segments_add(&table, &seg, 101));
+  CHECK(!sweep_segments_add(&table, &seg, 101));  // table full
+  CHECK(table.count == SWEEP_SEGMENTS_MAX);
+}
+
+static void test_find_and_frequency(void) {
+  sweep_segment_table_t table;
+  sweep_segments_clear(&table);
+  // Dense band in the middle, sparse outside, one single point CW segment
+  const sweep_segment_t segs[] = {
+      make_segment(50000U, 100000000U, 11),
+      make_segment(140000000U, 150000000U, 61),
+      make_segment(433920000U, 433920000U, 1),
+      make_segment(200000000U, 900000000U, 28),
+  };
+  for (unsigned s = 0; s < sizeof(segs) / sizeof(segs[0]); s++)
+    CHECK(sweep_segments_add(&table, &segs[s], 401));
+  CHECK(table.points == 101);
+
+  for (unsigned s = 0; s < table.count; s++) {
+    for (uint16_t i = 0; i < segs[s].points; i++) {
+      uint16_t idx = table.first[s] + i;
+      CHECK(sweep_segments_find(&table, idx) == s);
+      CHECK(sweep_segments_frequency(&table, idx) ==
+            linear_reference(segs[s].start, segs[s].stop, segs[s].points, i));
+    }
+  }
+  // Segment ends are hit exactly
+  CHECK(sweep_segments_frequency(&table, 10) == 100000000U);
+  CHECK(sweep_segments_frequency(&table, 11) == 140000000U);
+  CHECK(sweep_segments_frequency(&table, 72) == 433920000U);
+  CHECK(sweep_segments_frequency(&table, 100) == 900000000U);
+  // Past the end the last segment is used
+  CHECK(sweep_segments_find(&table, 200) == 3);
+
+  freq_t start, stop;
+  sweep_segments_range(&table, &start, &stop);
+  CHECK(start == 50000U && stop == 900000000U);
+}
+
+static void test_full_band_rounding(void) {
+  // Wide span with a remainder: the rounding formula must not overflow
+  sweep_segment_table_t table;
+  sweep_segments_clear(&table);
+  sweep_segment_t seg = make_segment(600U, 2700000000U, 401);
+  CHECK(sweep_segments_add(&table, &seg, 401));
+  for (uint16_t i = 0; i < 401; i++)
+    CHECK(sweep_segments_frequency(&table, i) == linear_reference(600U, 2700000000U, 401, i));
+}
+
+static void test_uniform_spacing(void) {
+  sweep_segment_table_t table;
+  sweep_segments_clear(&table);
+  // One segment and the same 1 MHz step continued by a second one
+  sweep_segment_t a = make_segment(1000000U, 10000000U, 10);
+  sweep_segment_t b = make_segment(11000000U, 20000000U, 10);
+  CHECK(sweep_segments_add(&table, &a, 401));
+  CHECK(sweep_segments_uniform(&table));
+  CHECK(sweep_segments_add(&table, &b, 401));
+  CHECK(sweep_segments_uniform(&table));
+
+  // Denser segment
+  sweep_segments_clear(&table);
+  b = make_segment(11000000U, 20000000U, 19);
+  CHECK(sweep_segments_add(&table, &a, 401));
+  CHECK(sweep_segments_add(&table, &b, 401));
+  CHECK(!sweep_segments_uniform(&table));
+
+  // Same step but a gap or a repeated point at the joint
+  sweep_segments_clear(&table);
+  b = make_segment(12000000U, 21000000U, 10);
+  CHECK(sweep_segments_add(&table, &a, 401));
+  CHECK(sweep_segments_add(&table, &b, 401));
+  CHECK(!sweep_segments_uniform(&table));
+  sweep_segments_clear(&table);
+  b = make_segment(10000000U, 19000000U, 10);
+  CHECK(sweep_segments_add(&table, &a, 401));
+  CHECK(sweep_segments_add(&table, &b, 401));
+  CHECK(!sweep_segments_uniform(&table));
+
+  // Segments in descending order
+  sweep_segments_clear(&table);
+  b = make_segment(11000000U, 20000000U, 10);
+  CHECK(sweep_segments_add(&table, &b, 401));
+  CHECK(sweep_segments_add(&table, &a, 401));
+  CHECK(!sweep_segments_uniform(&table));
+
+  // Rounded steps of a wide span split in two still line up
+  sweep_segments_clear(&table);
+  a = make_segment(600U, 1350000300U, 201);
+  b = make_segment(linear_reference(600U, 2700000000U, 401, 201), 2700000000U, 200);
+  CHECK(sweep_segments_add(&table, &a, 401));
+  CHECK(sweep_segments_add(&table, &b, 401));
+  CHECK(sweep_segments_uniform(&table));
+}
+
+int main(void) {
+  test_add_rules();
+  test_find_and_frequency();
+  test_full_band_rounding();
+  test_uniform_spacing();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_sweep_segments");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
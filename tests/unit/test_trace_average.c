@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/*
+ * Host-side coverage for src/rf/trace_average.c.
+ *
+ * Sweep-to-sweep averaging keeps one running mean per point and folds each
+ * complete sweep into it in place. These tests pin the weight sequence of
+ * both modes (plain mean while filling, 2^-k steady state for exponential,
+ * complete after N sweeps for block), the restart rules, and that folding the
+ * sweeps reproduces their arithmetic mean.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rf/trace_average.h"
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+#define POINTS 5
+
+static bool near(float a, float b) {
+  return fabsf(a - b) <= 1e-5f * (1.0f + fabsf(b));
+}
+
+static void test_configure_rules(void) {
+  trace_average_t avg;
+  trace_average_init(&avg);
+  CHECK(trace_average_target(&avg) == 0U);
+  CHECK(!trace_average_configure(&avg, TRACE_AVERAGE_EXP, 0));
+  CHECK(!trace_average_configure(&avg, TRACE_AVERAGE_EXP, TRACE_AVERAGE_EXP_MAX + 1U));
+  CHECK(!trace_average_configure(&avg, TRACE_AVERAGE_BLOCK, 1));
+  CHECK(!trace_average_configure(&avg, TRACE_AVERAGE_BLOCK, TRACE_AVERAGE_BLOCK_MAX + 1U));
+  CHECK(!trace_average_configure(&avg, 3, 4));
+  CHECK(avg.mode == TRACE_AVERAGE_OFF);
+
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_EXP, TRACE_AVERAGE_EXP_MAX));
+  CHECK(trace_average_target(&avg) == (1U << TRACE_AVERAGE_EXP_MAX));
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_BLOCK, 4));
+  CHECK(trace_average_target(&avg) == 4U);
+
+  float weight = -1.0f;
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_OFF, 7));
+  CHECK(avg.factor == 0U);
+  CHECK(!trace_average_next(&avg, 1, 3, &weight));
+  CHECK(weight == -1.0f);
+}
+
+static void test_exponential_weights(void) {
+  trace_average_t avg;
+  trace_average_init(&avg);
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_EXP, 2));
+  // Plain mean until 4 sweeps, then a fixed 1/4
+  const float expected[] = {1.0f, 0.5f, 1.0f / 3.0f, 0.25f, 0.25f, 0.25f};
+  for (unsigned i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+    float weight = 0.0f;
+    CHECK(trace_average_next(&avg, 7, 3, &weight));
+    CHECK(near(weight, expected[i]));
+  }
+  CHECK(avg.count == 4U);
+}
+
+static void test_block_mean_and_next_block(void) {
+  trace_average_t avg;
+  trace_average_init(&avg);
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_BLOCK, 3));
+  float acc[POINTS][2];
+  float data[POINTS][2];
+  const float sweeps[3] = {1.0f, 4.0f, -2.0f};
+  for (int s = 0; s < 3; s++) {
+    for (int i = 0; i < POINTS; i++) {
+      data[i][0] = sweeps[s] * (float)(i + 1);
+      data[i][1] = -sweeps[s];
+    }
+    float weight;
+    CHECK(!trace_average_complete(&avg));
+    CHECK(trace_average_next(&avg, 7, 1, &weight));
+    trace_average_fold(acc, data, POINTS, weight);
+    CHECK(avg.count == (uint16_t)(s + 1));
+  }
+  CHECK(trace_average_complete(&avg));
+  // (1 + 4 - 2) / 3 = 1
+  for (int i = 0; i < POINTS; i++) {
+    CHECK(near(data[i][0], (float)(i + 1)));
+    CHECK(near(data[i][1], -1.0f));
+  }
+
+  // Complete: the next sweep starts a new block instead of freezing on the mean
+  for (int i = 0; i < POINTS; i++) {
+    data[i][0] = 100.0f;
+    data[i][1] = 100.0f;
+  }
+  float weight = -1.0f;
+  CHECK(trace_average_next(&avg, 7, 1, &weight));
+  CHECK(weight == 1.0f);
+  trace_average_fold(acc, data, POINTS, weight);
+  CHECK(avg.count == 1U && !trace_average_complete(&avg));
+  for (int i = 0; i < POINTS; i++) {
+    CHECK(acc[i][0] == 100.0f && acc[i][1] == 100.0f);
+  }
+}
+
+static void test_restart_rules(void) {
+  trace_average_t avg;
+  trace_average_init(&avg);
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_BLOCK, 8));
+  float weight;
+  CHECK(trace_average_next(&avg, 10, 3, &weight));
+  CHECK(trace_average_next(&avg, 10, 3, &weight));
+  CHECK(avg.count == 2U && near(weight, 0.5f));
+
+  // Stimulus or correction change
+  CHECK(trace_average_next(&avg, 11, 3, &weight));
+  CHECK(avg.count == 1U && weight == 1.0f);
+  CHECK(trace_average_next(&avg, 11, 3, &weight));
+  // Different channel set
+  CHECK(trace_average_next(&avg, 11, 1, &weight));
+  CHECK(avg.count == 1U && weight == 1.0f);
+  CHECK(trace_average_next(&avg, 11, 1, &weight));
+  // Explicit restart and reconfiguration
+  trace_average_restart(&avg);
+  CHECK(avg.count == 0U);
+  CHECK(trace_average_next(&avg, 11, 1, &weight));
+  CHECK(avg.count == 1U && weight == 1.0f);
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_EXP, 3));
+  CHECK(avg.count == 0U);
+}
+
+static void test_exponential_tracks_step(void) {
+  // After a restart the first sweep is taken as is, a later step decays by 2^-k per sweep
+  trace_average_t avg;
+  trace_average_init(&avg);
+  CHECK(trace_average_configure(&avg, TRACE_AVERAGE_EXP, 1));
+  float acc[1][2];
+  float data[1][2] = {{3.0f, 0.0f}};
+  float weight;
+  CHECK(trace_average_next(&avg, 1, 1, &weight));
+  trace_average_fold(acc, data, 1, weight);
+  CHECK(data[0][0] == 3.0f);
+  float level = 3.0f;
+  for (int s = 0; s < 6; s++) {
+    data[0][0] = 1.0f;
+    data[0][1] = 2.0f;
+    CHECK(trace_average_next(&avg, 1, 1, &weight));
+    trace_average_fold(acc, data, 1, weight);
+    level = level + (1.0f - level) * 0.5f;
+    CHECK(near(data[0][0], level));
+    CHECK(near(acc[0][0], level));
+  }
+}
+
+int main(void) {
+  test_configure_rules();
+  test_exponential_weights();
+  test_block_mean_and_next_block();
+  test_restart_rules();
+  test_exponential_tracks_step();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_trace_average");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
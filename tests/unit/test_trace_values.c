@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2024, @momentics <momentics@gmail.com>
+ * All rights reserved.
+ *
+ * This is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3, or (at your option)
+ * any later version.
+ *
+ * The software is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with GNU Radio; see the file COPYING.  If not, write to
+ * the Free Software Foundation, Inc., 51 Franklin Street,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * Host-side coverage for the batched trace conversion in src/ui/draw/traces.c.
+ *
+ * The rectangular plot converts a batch of points per trace type with |S|^2
+ * and w shared between traces, the marker readouts keep using the
+ * trace_info_list callbacks. These tests pin trace_get_values against the
+ * callbacks for every type, on batches that do not start or end on a batch
+ * boundary and on points close to |S| = 1, where the impedance formulas are
+ * ill-conditioned.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nanovna.h"
+#include "ui/draw/plot_internal.h"
+#include "ui/draw/render.h"
+#include "ui/draw/traces.h"
+
+/* ------------------------------------------------------------------------- */
+/*                     Globals and drawing hooks of traces.c                  */
+
+config_t config;
+properties_t current_props;
+alignas(8) float measured[2][SWEEP_POINTS_MAX][2];
+map_t markmap[MAX_MARKMAP_Y];
+
+#define TEST_START 1000000U
+#define TEST_STEP 2500000U
+
+freq_t get_frequency(uint16_t idx) {
+  return TEST_START + (freq_t)idx * TEST_STEP;
+}
+
+void request_to_redraw(uint16_t mask) {
+  (void)mask;
+}
+
+void cell_drawline(const RenderCellCtx* rcx, int x0, int y0, int x1, int y1, pixel_t c) {
+  (void)rcx;
+  (void)x0;
+  (void)y0;
+  (void)x1;
+  (void)y1;
+  (void)c;
+}
+
+int cell_printf_ctx(RenderCellCtx* rcx, int16_t x, int16_t y, const char* fmt, ...) {
+  (void)rcx;
+  (void)x;
+  (void)y;
+  (void)fmt;
+  return 0;
+}
+
+/* ------------------------------------------------------------------------- */
+
+static int g_failures = 0;
+
+#define CHECK(cond)                                                                           \
+  do {                                                                                        \
+    if (!(cond)) {                                                                            \
+      ++g_failures;                                                                           \
+      fprintf(stderr, "[FAIL] %s:%d: %s\n", __FILE__, __LINE__, #cond);                       \
+    }                                                                                         \
+  } while (0)
+
+#define POINTS 61
+
+// Spiral through the chart: most points well inside, every fourth one within 1e-3 of |S| = 1
+static void fill_points(float (*data)[2]) {
+  for (int i = 0; i < POINTS; i++) {
+    float mag = (i & 3) == 3 ? 1.0f - 1e-3f * (float)(i % 7 + 1) / 7.0f
+                             : 0.05f + 0.9f * (float)i / POINTS;
+    float angle = 0.37f * (float)i - 3.0f;
+    data[i][0] = mag * cosf(angle);
+    data[i][1] = mag * sinf(angle);
+  }
+}
+
+// Callback value of point i, the reference the batched path must reproduce
+static bool values_match(uint8_t type, uint16_t i, float value) {
+  get_value_cb_t c = trace_info_list[type].get_value_cb;
+  if (c == NULL)
+    return value == 0.0f;
+  float ref = c(i, measured[0][i]);
+  // Bitwise first: -ffast-math folds isinf() and compares of infinities away
+  if (memcmp(&value, &ref, sizeof(ref)) == 0)
+    return true;
+  return fabsf(value - ref) <= 1e-3f * fmaxf(fabsf(ref), 1e-6f);
+}
+
+static void test_values_match_callbacks(void) {
+  sweep_points = POINTS;
+  fill_points(measured[0]);
+  float out[POINTS];
+  for (uint8_t type = 0; type < MAX_TRACE_TYPE; type++) {
+    trace_get_values(type, (const float(*)[2])measured[0], 0, POINTS, out);
+    int mismatches = 0;
+    for (uint16_t i = 0; i < POINTS; i++) {
+      if (!values_match(type, i, out[i])) {
+        if (mismatches++ == 0)
+          fprintf(stderr, "[FAIL] %s point %u: batch %g\n", get_trace_typename(type, 0), i,
+                  out[i]);
+      }
+    }
+    CHECK(mismatches == 0);
+  }
+}
+
+static void test_unaligned_batches(void) {
+  // A range that starts and ends inside a batch gives the same values as the full sweep
+  sweep_points = POINTS;
+  fill_points(measured[0]);
+  float full[POINTS], part[POINTS];
+  const uint16_t first = TRACE_BATCH_POINTS / 2 + 1;
+  const uint16_t count = 2 * TRACE_BATCH_POINTS + 3;
+  for (uint8_t type = 0; type < MAX_TRACE_TYPE; type++) {
+    trace_get_values(type, (const float(*)[2])measured[0], 0, POINTS, full);
+    trace_get_values(type, (const float(*)[2])measured[0], first, count, part);
+    int mismatches = 0;
+    for (uint16_t k = 0; k < count; k++) {
+      if (memcmp(&part[k], &full[first + k], sizeof(float)) != 0)
+        mismatches++;
+    }
+    CHECK(mismatches == 0);
+  }
+}
+
+int main(void) {
+  test_values_match_callbacks();
+  test_unaligned_batches();
+
+  if (g_failures == 0) {
+    puts("[PASS] tests/unit/test_trace_values");
+    return EXIT_SUCCESS;
+  }
+  fprintf(stderr, "[FAIL] %d test(s) failed\n", g_failures);
+  return EXIT_FAILURE;
+}
@@ -177,6 +177,45 @@ static void test_fft_roundtrip(void) {
   }
 }
 
+static void test_fft_inverse_real(void) {
+  /*
+   * The low-pass time domain transform feeds only bins 0..N/2 of a Hermitian
+   * spectrum to fft_inverse_real().  Its real output must match the real part
+   * of the full complex inverse FFT on the mirrored spectrum (imaginary parts
+   * of bins 0 and N/2 do not contribute to it), in the packed sample order.
+   */
+  static float full[FFT_SIZE][2];
+  static float half[FFT_SIZE / 2 + 1][2];
+  srand(5);
+  for (size_t i = 0; i <= FFT_SIZE / 2; ++i) {
+    half[i][0] = (float)rand() / (float)RAND_MAX - 0.5f;
+    half[i][1] = (float)rand() / (float)RAND_MAX - 0.5f;
+  }
+  memset(full, 0, sizeof(full));
+  for (size_t i = 0; i <= FFT_SIZE / 2; ++i) {
+    full[i][0] = half[i][0];
+    full[i][1] = half[i][1];
+  }
+  for (size_t i = 1; i < FFT_SIZE / 2; ++i) {
+    full[FFT_SIZE - i][0] = half[i][0];
+    full[FFT_SIZE - i][1] = -half[i][1];
+  }
+  fft_inverse(full);
+  fft_inverse_real(half);
+  const float* real = &half[0][0];
+  float max_error = 0.0f;
+  for (size_t i = 0; i < FFT_SIZE; ++i) {
+    float error = fabsf(real[i] - full[i][0]);
+    if (error > max_error)
+      max_error = error;
+  }
+  printf("Max real inverse FFT error: %.8f\n", max_error);
+  if (max_error > 1e-4f) { /* outputs are up to ~sqrt(N), float rounding of two different orders */
+    ++g_failures;
+    fprintf(stderr, "[FAIL] fft_inverse_real max error %f\n", max_error);
+  }
+}
+
 int main(void) {
   test_primary_interval();
   test_negative_and_wrapped();
@@ -184,6 +223,7 @@ int main(void) {
   test_vna_sqrt();
   test_fft_impulse();
   test_fft_roundtrip();
+  test_fft_inverse_real();
 
   if (g_failures == 0) {
     puts("[PASS] tests/unit/test_vna_math");